@@ -13,11 +13,14 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <algorithm>
+#include <exception>
 #include <vector>
 #include <thread>
 #include <future>
 
 #include "eckit/config/LocalConfiguration.h"
+#include "eckit/config/Resource.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
@@ -27,6 +30,7 @@
 
 #include "fdb5/api/DistFDB.h"
 #include "fdb5/database/Notifier.h"
+#include "fdb5/rules/Schema.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/api/helpers/ListIterator.h"
 #include "fdb5/io/HandleGatherer.h"
@@ -50,10 +54,22 @@ struct DistributionError : public eckit::Exception {
 //----------------------------------------------------------------------------------------------------------------------
 
 DistFDB::DistFDB(const Config& config, const std::string& name) :
-    FDBBase(config, name) {
+    FDBBase(config, name),
+    byDatabase_(false),
+    maxLaneOrders_(eckit::Resource<size_t>("fdbDistLaneOrderCacheSize;$FDB_DIST_LANE_ORDER_CACHE_SIZE", 4096)),
+    probeInterval_(std::chrono::seconds(eckit::Resource<long>("fdbDistLaneProbeInterval;$FDB_DIST_LANE_PROBE_INTERVAL", 30))),
+    slowLaneFactor_(eckit::Resource<double>("fdbDistSlowLaneFactor;$FDB_DIST_SLOW_LANE_FACTOR", 4.0)),
+    slowLaneMinFlushes_(eckit::Resource<size_t>("fdbDistSlowLaneMinFlushes;$FDB_DIST_SLOW_LANE_MIN_FLUSHES", 5)),
+    slowLaneMinLatency_(eckit::Resource<double>("fdbDistSlowLaneMinLatency;$FDB_DIST_SLOW_LANE_MIN_LATENCY", 1.0)) {
 
     ASSERT(config.getString("type", "") == "dist");
 
+    std::string distribution = config.getString("distribution", "field");
+    if (distribution != "field" && distribution != "database") {
+        throw eckit::UserError("Invalid distribution for pool: " + distribution + " (expected field or database)", Here());
+    }
+    byDatabase_ = (distribution == "database");
+
     // Configure the available lanes.
 
     if (!config.has("lanes")) throw eckit::UserError("No lanes configured for pool", Here());
@@ -66,34 +82,36 @@ DistFDB::DistFDB(const Config& config, const std::string& name) :
             throw eckit::SeriousBug(ss.str(), Here());
         }
     }
+
+    health_.resize(lanes_.size());
 }
 
 DistFDB::~DistFDB() {}
 
 void DistFDB::archive(const Key& key, const void* data, size_t length) {
 
-    std::vector<size_t> laneIndices;
-
-    //Log::debug<LibFdb5>() << "Number of lanes: " << lanes_.size() << std::endl;
-    //Log::debug<LibFdb5>() << "Lane indices: ";
-    //for (const auto& i : laneIndices) Log::debug<LibFdb5>() << i << ", ";
-    //Log::debug<LibFdb5>() << std::endl;
-
-    hash_.hashOrder(key.keyDict(), laneIndices);
-
-    //Log::debug<LibFdb5>() << "Number of lanes: " << lanes_.size() << std::endl;
-    //Log::debug<LibFdb5>() << "Lane indices: ";
-    //for (const auto& i : laneIndices) Log::debug<LibFdb5>() << i << ", ";
-    //Log::debug<LibFdb5>() << std::endl;
+    const std::vector<size_t>& laneIndices(laneOrder(key));
 
     // Given an order supplied by the Rendezvous hash, try the FDB in order until
     // one works. n.b. Errors are unacceptable once the FDB is dirty.
     Log::debug<LibFdb5>() << "Attempting dist FDB archive" << std::endl;
 
-    decltype(laneIndices)::const_iterator it = laneIndices.begin();
-    decltype(laneIndices)::const_iterator end = laneIndices.end();
-    for (; it != end; ++it) {
-        size_t idx = *it;
+    LaneHealth::clock::time_point now = LaneHealth::clock::now();
+
+    double fastest = 0;
+    for (size_t idx = 0; idx < lanes_.size(); ++idx) {
+        const LaneHealth& health(health_[idx]);
+        if (health.available(now) && health.flushes() >= slowLaneMinFlushes_ &&
+            (fastest == 0 || health.flushLatency() < fastest)) {
+            fastest = health.flushLatency();
+        }
+    }
+
+    // Lanes that are passed over for being slow or failing are still used if nothing else works
+
+    std::vector<size_t> slow;
+
+    for (size_t idx : laneIndices) {
 
         FDB& lane = lanes_[idx];
 
@@ -104,55 +122,112 @@ void DistFDB::archive(const Key& key, const void* data, size_t length) {
             eckit::Log::warning() << "FDB lane " << lane << " is disabled" << std::endl;
             continue;
         }
+        if (!health_[idx].available(now)) {
+            continue;
+        }
+        if (spillOver(health_[idx], fastest)) {
+            Log::debug<LibFdb5>() << "Spilling over from lane " << lane << " " << health_[idx] << std::endl;
+            slow.push_back(idx);
+            continue;
+        }
 
-        try {
+        if (tryArchive(idx, key, data, length)) {
+            return;
+        }
+    }
 
-            lane.archive(key, data, length);
+    for (size_t idx : slow) {
+        if (tryArchive(idx, key, data, length)) {
             return;
+        }
+    }
+
+    Log::error() << "No writable lanes!!!!" << std::endl;
+
+    throw DistributionError("No writable lanes available for archive", Here());
+}
 
-        } catch (eckit::Exception& e) {
+bool DistFDB::tryArchive(size_t idx, const Key& key, const void* data, size_t length) {
 
-            // TODO: This will be messy and verbose. Reduce output if it has already failed.
+    FDB& lane = lanes_[idx];
+    LaneHealth& health = health_[idx];
 
-            std::stringstream ss;
-            ss << "Archive failure on lane: " << lane << " (" << idx << ")";
-            eckit::Log::error() << ss.str() << std::endl;
-            eckit::Log::error() << "with exception: " << e << std::endl;
+    try {
 
-            // If we have written, but not flushed, data to a give lane, and an archive operation
-            // fails, then this is a bit of an issue. Otherwise, just skip the lane.
+        lane.archive(key, data, length);
 
-            if (lane.dirty()) {
-                ss << " -- Exception: " << e;
-                throw DistributionError(ss.str(), Here());
-            }
+        if (health.disabled()) {
+            eckit::Log::info() << "FDB lane " << lane << " (" << idx << ") is back in use" << std::endl;
+        }
+        health.archived();
+        return true;
 
-            // Mark the lane as no longer writable
-            lane.disable();
+    } catch (eckit::Exception& e) {
+
+        // TODO: This will be messy and verbose. Reduce output if it has already failed.
+
+        std::stringstream ss;
+        ss << "Archive failure on lane: " << lane << " (" << idx << ")";
+        eckit::Log::error() << ss.str() << std::endl;
+        eckit::Log::error() << "with exception: " << e << std::endl;
+
+        // If we have written, but not flushed, data to a give lane, and an archive operation
+        // fails, then this is a bit of an issue. Otherwise, just skip the lane.
+
+        if (lane.dirty()) {
+            ss << " -- Exception: " << e;
+            throw DistributionError(ss.str(), Here());
         }
+
+        // Take the lane out of use until it is next probed
+        health.failure(LaneHealth::clock::now(), probeInterval_);
+        eckit::Log::warning() << "FDB lane " << lane << " out of use for "
+                              << std::chrono::duration_cast<std::chrono::seconds>(probeInterval_).count()
+                              << "s " << health << std::endl;
+        return false;
     }
+}
 
-    Log::error() << "No writable lanes!!!!" << std::endl;
+const std::vector<size_t>& DistFDB::laneOrder(const Key& key) {
 
-    throw DistributionError("No writable lanes available for archive", Here());
+    Key dbKey;
+    if (!byDatabase_ || !config_.schema().expandFirstLevel(key, dbKey)) {
+        laneIndices_.clear();
+        hash_.hashOrder(key.keyDict(), laneIndices_);
+        return laneIndices_;
+    }
+
+    auto it = laneOrders_.find(dbKey);
+    if (it != laneOrders_.end()) {
+        return it->second;
+    }
+
+    if (laneOrders_.size() >= maxLaneOrders_) {
+        laneOrders_.clear();
+    }
+
+    std::vector<size_t> order;
+    hash_.hashOrder(dbKey.keyDict(), order);
+    return laneOrders_.emplace(dbKey, std::move(order)).first->second;
+}
+
+bool DistFDB::spillOver(const LaneHealth& health, double fastest) {
+
+    // Flush latencies are only compared once there are enough of them to go by, and only matter when they are
+    // long enough that a lane being several times slower than another is not just noise
+
+    double p = health.errorRate();
+
+    if (fastest > 0 && slowLaneFactor_ > 0 &&
+        health.flushes() >= slowLaneMinFlushes_ &&
+        health.flushLatency() > slowLaneMinLatency_ &&
+        health.flushLatency() > slowLaneFactor_ * fastest) {
+        p = std::max(p, 1 - (slowLaneFactor_ * fastest) / health.flushLatency());
+    }
+
+    return p > 0 && std::uniform_real_distribution<double>(0, 1)(random_) < p;
 }
 
-/*
- * Exemplar for templated query functionality:
- *
- * ListIterator DistFDB::list(const FDBToolRequest& request) {
- *
- *     std::queue<ListIterator> lists;
- *
- *     for (FDB& lane : lanes_) {
- *         if (lane.visitable()) {
- *             lists.push(lane.list(request));
- *         }
- *     }
- *
- *     return ListIterator(new ListAggregateIterator(std::move(lists)));
- * }
- */
 
 template <typename QueryFN>
 auto DistFDB::queryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request)) {
@@ -178,10 +253,30 @@ auto DistFDB::queryInternal(const FDBToolRequest& request, const QueryFN& fn) ->
     return QueryIterator(new APIAggregateIterator<ValueType>(std::move(iterQueue)));
 }
 
+template <typename QueryFN>
+auto DistFDB::interleavedQueryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request)) {
+
+    using QueryIterator = decltype(fn(*(FDB*)(nullptr), request));
+    using ValueType = typename QueryIterator::value_type;
+
+    std::vector<std::function<APIIterator<ValueType>()>> sources;
+
+    for (FDB& lane : lanes_) {
+        if (lane.enabled(ControlIdentifier::Retrieve)) {
+            FDB* l = &lane;
+            sources.emplace_back([l, fn, request] {
+                return APIIterator<ValueType>(fn(*l, request));
+            });
+        }
+    }
+
+    return QueryIterator(new APIInterleavingIterator<ValueType>(sources));
+}
+
 
 ListIterator DistFDB::list(const FDBToolRequest& request) {
     Log::debug<LibFdb5>() << "DistFDB::list() : " << request << std::endl;
-    return queryInternal(request,
+    return interleavedQueryInternal(request,
                          [](FDB& fdb, const FDBToolRequest& request) {
                             return fdb.list(request);
                          });
@@ -189,6 +284,8 @@ ListIterator DistFDB::list(const FDBToolRequest& request) {
 
 ListIterator DistFDB::inspect(const metkit::mars::MarsRequest& request) {
     Log::debug<LibFdb5>() << "DistFDB::inspect() : " << request << std::endl;
+    // The lanes are inspected concurrently, but their output is kept in lane order so that the fields
+    // retrieved are in a deterministic order
     return queryInternal(request,
                          [](FDB& fdb, const FDBToolRequest& request) {
                             return fdb.inspect(request.request());
@@ -256,13 +353,35 @@ MoveIterator DistFDB::move(const FDBToolRequest& request, const eckit::URI& dest
 
 void DistFDB::flush() {
 
-    std::vector<std::future<void>> futures;
+    // Only the flushes of lanes with something to flush say anything about how slow they are
+
+    std::vector<std::future<double>> futures;
 
     for (FDB& lane : lanes_) {
-        futures.emplace_back(std::async(std::launch::async, [&lane] {
+        bool dirty = lane.dirty();
+        futures.emplace_back(std::async(std::launch::async, [&lane, dirty] {
+            LaneHealth::clock::time_point start = LaneHealth::clock::now();
             lane.flush();
+            return dirty ? std::chrono::duration<double>(LaneHealth::clock::now() - start).count() : -1.0;
         }));
     }
+
+    std::exception_ptr error;
+
+    for (size_t idx = 0; idx < futures.size(); ++idx) {
+        try {
+            double seconds = futures[idx].get();
+            if (seconds >= 0) {
+                health_[idx].flushed(seconds);
+            }
+        } catch (...) {
+            eckit::Log::error() << "Flush failure on lane: " << lanes_[idx] << " (" << idx << ")" << std::endl;
+            health_[idx].failure(LaneHealth::clock::now(), probeInterval_);
+            if (!error) error = std::current_exception();
+        }
+    }
+
+    if (error) std::rethrow_exception(error);
 }
 
 FDBStats DistFDB::stats() const {
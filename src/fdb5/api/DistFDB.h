@@ -19,8 +19,13 @@
 #ifndef fdb5_api_DistFDB_H
 #define fdb5_api_DistFDB_H
 
+#include <random>
+#include <unordered_map>
+#include <vector>
+
 #include "fdb5/api/FDB.h"
 #include "fdb5/api/FDBFactory.h"
+#include "fdb5/api/LaneHealth.h"
 
 #include "eckit/utils/RendezvousHash.h"
 
@@ -37,6 +42,7 @@ class DistFDB : public FDBBase {
 public: // method
 
     using FDBBase::stats;
+    using FDBBase::archive;
 
     DistFDB(const Config& config, const std::string& name);
     ~DistFDB() override;
@@ -71,14 +77,41 @@ private: // methods
 
     virtual void print(std::ostream& s) const override;
 
+    /// The order in which to try the lanes when archiving the key
+    const std::vector<size_t>& laneOrder(const Key& key);
+
+    bool tryArchive(size_t idx, const Key& key, const void* data, size_t length);
+
+    /// Whether to pass over a lane that is much slower to flush than the others (the slower, the more likely), or
+    /// that has been failing (as likely as its recent error rate)
+    bool spillOver(const LaneHealth& health, double fastest);
+
     template <typename QueryFN>
     auto queryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request));
 
+    /// As queryInternal, but the output of the FDBs is interleaved as it arrives (see APIInterleavingIterator)
+    template <typename QueryFN>
+    auto interleavedQueryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request));
+
 private:
 
     eckit::RendezvousHash hash_;
 
     std::vector<FDB> lanes_;
+    std::vector<LaneHealth> health_;
+
+    /// Distribute the fields by their DB key ("distribution": "database") rather than by their full key, so that
+    /// the fields of a DB go to the same lane and the lane order can be cached.
+    bool byDatabase_;
+    std::unordered_map<Key, std::vector<size_t>> laneOrders_;
+    size_t maxLaneOrders_;
+    std::vector<size_t> laneIndices_; ///< reused when distributing by the full key
+
+    LaneHealth::clock::duration probeInterval_;
+    double slowLaneFactor_;
+    size_t slowLaneMinFlushes_;  ///< before a lane's flush latency is trusted
+    double slowLaneMinLatency_;  ///< below which a lane is never considered slow
+    std::minstd_rand random_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -25,7 +25,9 @@
 #include "fdb5/LibFdb5.h"
 #include "fdb5/api/FDB.h"
 #include "fdb5/api/FDBFactory.h"
+#include "fdb5/api/Metrics.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/database/ArchiveBatch.h"
 #include "fdb5/database/Key.h"
 #include "fdb5/io/HandleGatherer.h"
 #include "fdb5/message/MessageDecoder.h"
@@ -105,6 +107,24 @@ void FDB::archive(const Key& key, const void* data, size_t length) {
 
     timer.stop();
     stats_.addArchive(length, timer);
+    if (Metrics::enabled()) Metrics::instance().add(Metrics::Archive, timer.elapsed());
+}
+
+void FDB::archive(const ArchiveBatch& batch) {
+
+    if (batch.empty()) {
+        return;
+    }
+
+    eckit::Timer timer;
+    timer.start();
+
+    internal_->archive(batch);
+    dirty_ = true;
+
+    timer.stop();
+    stats_.addArchive(batch.length(), timer, batch.size());
+    if (Metrics::enabled()) Metrics::instance().add(Metrics::Archive, timer.elapsed() / batch.size(), batch.size());
 }
 
 bool FDB::sorted(const metkit::mars::MarsRequest &request) {
@@ -140,7 +160,7 @@ eckit::DataHandle* FDB::read(const std::vector<eckit::URI>& uris, bool sorted) {
 
     for (const eckit::URI& uri : uris) {
         FieldLocation* loc = FieldLocationFactory::instance().build(uri.scheme(), uri);
-        result.add(loc->dataHandle());
+        result.add(*loc);
         delete loc;
     }
     return result.dataHandle();
@@ -185,22 +205,32 @@ eckit::DataHandle* FDB::read(ListIterator& it, bool sorted) {
             for (size_t i=0; i< cube.size(); i++) {
                 ListElement element;
                 if (cube.find(i, element)) {
-                    result.add(element.location().dataHandle());
+                    result.add(element.location());
                 }
             }
         }
     }
     else {
         while (it.next(el)) {
-            result.add(el.location().dataHandle());
+            result.add(el.location());
         }
     }
     return result.dataHandle();
 }
 
 eckit::DataHandle* FDB::retrieve(const metkit::mars::MarsRequest& request) {
+    eckit::Timer timer;
+    timer.start();
+
     ListIterator it = inspect(request);
-    return read(it, sorted(request));
+    eckit::DataHandle* dh = read(it, sorted(request));
+
+    timer.stop();
+    stats_.addRetrieve(dh->estimate(), timer);
+    // n.b. the data is only read later, from the handle, so this times the lookup of the fields
+    if (Metrics::enabled()) Metrics::instance().add(Metrics::Lookup, timer.elapsed());
+
+    return dh;
 }
 
 ListIterator FDB::inspect(const metkit::mars::MarsRequest& request) {
@@ -274,6 +304,7 @@ void FDB::flush() {
 
         timer.stop();
         stats_.addFlush(timer);
+        if (Metrics::enabled()) Metrics::instance().add(Metrics::Flush, timer.elapsed());
     }
 }
 
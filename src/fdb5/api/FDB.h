@@ -46,6 +46,7 @@ namespace metkit { class MarsRequest; }
 
 namespace fdb5 {
 
+class ArchiveBatch;
 class FDBBase;
 class FDBToolRequest;
 class Key;
@@ -76,6 +77,9 @@ public: // methods
     void archive(const metkit::mars::MarsRequest& request, eckit::DataHandle& handle);
     // disclaimer: this is a low-level API. The provided key and the corresponding data are not checked for consistency
     void archive(const Key& key, const void* data, size_t length);
+    /// Archive many fields at once. The fields are grouped by DB and index, so each is selected only once,
+    /// and the index entries are inserted in key order. Same caveats as the single field version.
+    void archive(const ArchiveBatch& batch);
 
     /// Flushes all buffers and closes all data handles into a consistent DB state
     /// @note always safe to call
@@ -89,6 +93,9 @@ public: // methods
 
     eckit::DataHandle* retrieve(const metkit::mars::MarsRequest& request);
 
+    /// The fields selected by the request, which may still be being looked up as the iterator is consumed.
+    /// @note The iterator must be exhausted or destroyed before the FDB is, as it may be fed from the FDB (e.g.
+    ///       over the connection of a remote FDB). Destroying it early stops the lookup.
     ListIterator inspect(const metkit::mars::MarsRequest& request);
 
     ListIterator list(const FDBToolRequest& request, bool deduplicate=false);
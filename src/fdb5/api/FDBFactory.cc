@@ -22,6 +22,7 @@
 
 #include "fdb5/api/FDBFactory.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/database/ArchiveBatch.h"
 #include "fdb5/LibFdb5.h"
 
 
@@ -56,6 +57,12 @@ FDBBase::FDBBase(const Config& config, const std::string& name) :
 
 FDBBase::~FDBBase() {}
 
+void FDBBase::archive(const ArchiveBatch& batch) {
+    for (const ArchiveBatch::Element& e : batch) {
+        archive(e.key_, e.data_, e.length_);
+    }
+}
+
 std::string FDBBase::id() const {
     std::stringstream ss;
     ss << config_;
@@ -49,6 +49,7 @@ namespace metkit { class MarsRequest; }
 namespace fdb5 {
 
 class Key;
+class ArchiveBatch;
 class FDBToolRequest;
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -66,6 +67,9 @@ public: // methods
 
     virtual void archive(const Key& key, const void* data, size_t length) = 0;
 
+    /// By default the fields are archived one at a time
+    virtual void archive(const ArchiveBatch& batch);
+
     virtual void flush() = 0;
 
     virtual ListIterator inspect(const metkit::mars::MarsRequest& request) = 0;
@@ -18,6 +18,7 @@
 #include "eckit/log/Timer.h"
 #include "eckit/log/Seconds.h"
 #include "eckit/log/Bytes.h"
+#include "eckit/log/JSON.h"
 
 #include "fdb5/api/FDBStats.h"
 #include "fdb5/LibFdb5.h"
@@ -40,7 +41,12 @@ FDBStats::FDBStats() :
     elapsedRetrieve_(0),
     sumArchiveTimingSquared_(0),
     sumRetrieveTimingSquared_(0),
-    sumFlushTimingSquared_(0) {}
+    sumFlushTimingSquared_(0),
+    numCatalogueCacheHit_(0),
+    numCatalogueCacheMiss_(0),
+    numCatalogueCacheEviction_(0),
+    numCatalogueCacheInvalidation_(0),
+    numCatalogueCacheRefresh_(0) {}
 
 
 FDBStats::~FDBStats() {}
@@ -60,12 +66,24 @@ FDBStats& FDBStats::operator+=(const FDBStats& rhs) {
     sumArchiveTimingSquared_ += rhs.sumArchiveTimingSquared_;
     sumRetrieveTimingSquared_ += rhs.sumRetrieveTimingSquared_;
     sumFlushTimingSquared_ += rhs.sumFlushTimingSquared_;
+    numCatalogueCacheHit_ += rhs.numCatalogueCacheHit_;
+    numCatalogueCacheMiss_ += rhs.numCatalogueCacheMiss_;
+    numCatalogueCacheEviction_ += rhs.numCatalogueCacheEviction_;
+    numCatalogueCacheInvalidation_ += rhs.numCatalogueCacheInvalidation_;
+    numCatalogueCacheRefresh_ += rhs.numCatalogueCacheRefresh_;
+    archiveLatency_ += rhs.archiveLatency_;
+    retrieveLatency_ += rhs.retrieveLatency_;
+    flushLatency_ += rhs.flushLatency_;
     return *this;
 }
 
 
 void FDBStats::addArchive(size_t length, eckit::Timer& timer, size_t nfields) {
 
+    if (nfields == 0) {
+        return;
+    }
+
     numArchive_ += nfields;
     bytesArchive_ += length;
     sumBytesArchiveSquared_ += nfields * ((length / nfields) * (length / nfields));
@@ -73,6 +91,7 @@ void FDBStats::addArchive(size_t length, eckit::Timer& timer, size_t nfields) {
     double elapsed = timer.elapsed() / nfields;
     elapsedArchive_ += elapsed;
     sumArchiveTimingSquared_ += elapsed * elapsed;
+    archiveLatency_.add(elapsed);
 
     Log::debug<LibFdb5>() << "Archive count: " << numArchive_
                          << ", size: " << Bytes(length)
@@ -91,6 +110,7 @@ void FDBStats::addRetrieve(size_t length, eckit::Timer& timer) {
     double elapsed = timer.elapsed();
     elapsedRetrieve_ += elapsed;
     sumRetrieveTimingSquared_ += elapsed * elapsed;
+    retrieveLatency_.add(elapsed);
 
     Log::debug<LibFdb5>() << "Retrieve count: " << numRetrieve_
                          << ", size: " << Bytes(length)
@@ -107,6 +127,7 @@ void FDBStats::addFlush(eckit::Timer& timer) {
     double elapsed = timer.elapsed();
     elapsedFlush_ += elapsed;
     sumFlushTimingSquared_ += elapsed * elapsed;
+    flushLatency_.add(elapsed);
 
     Log::debug<LibFdb5>() << "Flush count: " << numFlush_
                          << ", time: " << elapsed << "s"
@@ -135,6 +156,58 @@ void FDBStats::report(std::ostream& out, const char* prefix) const {
 
     reportCount(out, "num flush", numFlush_, prefix);
     reportTimeStats(out, "flush time", numFlush_, elapsedFlush_, sumFlushTimingSquared_, prefix);
+
+    // Catalogue cache statistics
+
+    if (numCatalogueCacheHit_ + numCatalogueCacheMiss_ > 0) {
+        reportCount(out, "catalogue cache hits", numCatalogueCacheHit_, prefix);
+        reportCount(out, "catalogue cache misses", numCatalogueCacheMiss_, prefix);
+        reportCount(out, "catalogue cache evictions", numCatalogueCacheEviction_, prefix);
+        reportCount(out, "catalogue cache invalidations", numCatalogueCacheInvalidation_, prefix);
+        reportCount(out, "catalogue cache refreshes", numCatalogueCacheRefresh_, prefix);
+    }
+}
+
+void FDBStats::json(eckit::JSON& json) const {
+
+    json.startObject();
+
+    json << "archive";
+    json.startObject();
+    json << "count" << numArchive_;
+    json << "bytes" << bytesArchive_;
+    json << "elapsed" << elapsedArchive_;
+    json << "latency";
+    archiveLatency_.json(json);
+    json.endObject();
+
+    json << "retrieve";
+    json.startObject();
+    json << "count" << numRetrieve_;
+    json << "bytes" << bytesRetrieve_;
+    json << "elapsed" << elapsedRetrieve_;
+    json << "latency";
+    retrieveLatency_.json(json);
+    json.endObject();
+
+    json << "flush";
+    json.startObject();
+    json << "count" << numFlush_;
+    json << "elapsed" << elapsedFlush_;
+    json << "latency";
+    flushLatency_.json(json);
+    json.endObject();
+
+    json << "catalogue_cache";
+    json.startObject();
+    json << "hits" << numCatalogueCacheHit_;
+    json << "misses" << numCatalogueCacheMiss_;
+    json << "evictions" << numCatalogueCacheEviction_;
+    json << "invalidations" << numCatalogueCacheInvalidation_;
+    json << "refreshes" << numCatalogueCacheRefresh_;
+    json.endObject();
+
+    json.endObject();
 }
 
 //----------------------------------------------------------------------------------------------------------------------
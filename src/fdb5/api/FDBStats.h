@@ -24,6 +24,12 @@
 
 #include "eckit/log/Statistics.h"
 
+#include "fdb5/api/LatencyHistogram.h"
+
+namespace eckit {
+class JSON;
+}
+
 
 namespace fdb5 {
 
@@ -42,8 +48,28 @@ public:
     void addRetrieve(size_t length, eckit::Timer& timer);
     void addFlush(eckit::Timer& timer);
 
+    /// See DBCache
+    void addCatalogueCacheHit() { ++numCatalogueCacheHit_; }
+    void addCatalogueCacheMiss() { ++numCatalogueCacheMiss_; }
+    void addCatalogueCacheEvictions(size_t n) { numCatalogueCacheEviction_ += n; }
+    void addCatalogueCacheInvalidation() { ++numCatalogueCacheInvalidation_; }
+    void addCatalogueCacheRefresh() { ++numCatalogueCacheRefresh_; }
+
+    size_t numCatalogueCacheHit() const { return numCatalogueCacheHit_; }
+    size_t numCatalogueCacheMiss() const { return numCatalogueCacheMiss_; }
+    size_t numCatalogueCacheEviction() const { return numCatalogueCacheEviction_; }
+    size_t numCatalogueCacheInvalidation() const { return numCatalogueCacheInvalidation_; }
+    size_t numCatalogueCacheRefresh() const { return numCatalogueCacheRefresh_; }
+
     void report(std::ostream& out, const char* indent) const;
 
+    /// All of the statistics, including the latency histograms
+    void json(eckit::JSON& json) const;
+
+    const LatencyHistogram& archiveLatency() const { return archiveLatency_; }
+    const LatencyHistogram& retrieveLatency() const { return retrieveLatency_; }
+    const LatencyHistogram& flushLatency() const { return flushLatency_; }
+
     FDBStats& operator+=(const FDBStats& rhs);
 
 private: // members
@@ -65,6 +91,16 @@ private: // members
     double sumArchiveTimingSquared_;
     double sumRetrieveTimingSquared_;
     double sumFlushTimingSquared_;
+
+    size_t numCatalogueCacheHit_;
+    size_t numCatalogueCacheMiss_;
+    size_t numCatalogueCacheEviction_;
+    size_t numCatalogueCacheInvalidation_;
+    size_t numCatalogueCacheRefresh_;
+
+    LatencyHistogram archiveLatency_;
+    LatencyHistogram retrieveLatency_;
+    LatencyHistogram flushLatency_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
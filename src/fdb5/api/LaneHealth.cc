@@ -0,0 +1,56 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <ostream>
+
+#include "fdb5/api/LaneHealth.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Weight of the latest sample in the moving averages
+static constexpr double alpha = 0.1;
+
+LaneHealth::LaneHealth() :
+    flushLatency_(0),
+    flushes_(0),
+    errorRate_(0),
+    disabled_(false) {}
+
+bool LaneHealth::available(clock::time_point now) const {
+    return !disabled_ || now >= probeAt_;
+}
+
+void LaneHealth::archived() {
+    errorRate_ = (1 - alpha) * errorRate_;
+    disabled_ = false;
+}
+
+void LaneHealth::flushed(double seconds) {
+    flushLatency_ = (flushes_ == 0) ? seconds : (1 - alpha) * flushLatency_ + alpha * seconds;
+    ++flushes_;
+    errorRate_ = (1 - alpha) * errorRate_;
+}
+
+void LaneHealth::failure(clock::time_point now, clock::duration probeInterval) {
+    errorRate_ = (1 - alpha) * errorRate_ + alpha;
+    disabled_ = true;
+    probeAt_ = now + probeInterval;
+}
+
+void LaneHealth::print(std::ostream& s) const {
+    s << "LaneHealth(flushLatency=" << flushLatency_ << "s,flushes=" << flushes_ << ",errorRate=" << errorRate_
+      << ",disabled=" << disabled_ << ")";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
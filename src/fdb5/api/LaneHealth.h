@@ -0,0 +1,83 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   LaneHealth.h
+/// @date   Oct 2026
+
+#ifndef fdb5_api_LaneHealth_H
+#define fdb5_api_LaneHealth_H
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Tracks how well a lane of a DistFDB is doing, as exponentially weighted moving averages of the time taken to
+/// flush it and of the rate of errors. Archiving a field mostly only buffers it, so it is the flushes that show
+/// how slow a lane is.
+///
+/// A lane that fails is taken out of use, but only for a while (the probe interval). After that, the next archive
+/// is let through as a probe: if it succeeds the lane is back in use, otherwise it is out for another interval.
+
+class LaneHealth {
+
+public: // types
+
+    using clock = std::chrono::steady_clock;
+
+public: // methods
+
+    LaneHealth();
+
+    /// Whether the lane may be archived to now
+    bool available(clock::time_point now) const;
+
+    void archived();
+    void flushed(double seconds);
+    void failure(clock::time_point now, clock::duration probeInterval);
+
+    bool disabled() const { return disabled_; }
+
+    /// Average time taken to flush the lane (when it had something to flush). Zero until it has been flushed.
+    double flushLatency() const { return flushLatency_; }
+
+    /// The number of flushes the latency is averaged over
+    size_t flushes() const { return flushes_; }
+
+    /// Average rate of failed archives and flushes, between 0 and 1
+    double errorRate() const { return errorRate_; }
+
+private: // methods
+
+    void print(std::ostream& s) const;
+
+    friend std::ostream& operator<<(std::ostream& s, const LaneHealth& h) {
+        h.print(s);
+        return s;
+    }
+
+private: // members
+
+    double flushLatency_;
+    size_t flushes_;
+    double errorRate_;
+
+    bool disabled_;
+    clock::time_point probeAt_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif // fdb5_api_LaneHealth_H
@@ -0,0 +1,135 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <ostream>
+
+#include "eckit/log/JSON.h"
+
+#include "fdb5/api/LatencyHistogram.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram() :
+    count_(0),
+    max_(0) {
+    buckets_.fill(0);
+}
+
+size_t LatencyHistogram::bucket(uint64_t micros) {
+
+    if (micros < exact) {
+        return micros;
+    }
+
+    // The highest set bit selects the power of two, and the next three bits the bucket within it
+
+    size_t exponent = 63 - __builtin_clzll(micros);
+    size_t sub = (micros >> (exponent - 3)) & (subBuckets - 1);
+    return exact + (exponent - 4) * subBuckets + sub;
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket) {
+
+    if (bucket < exact) {
+        return bucket + 1;
+    }
+
+    size_t exponent = 4 + (bucket - exact) / subBuckets;
+    uint64_t sub = (bucket - exact) % subBuckets;
+    if (exponent == 63 && sub == subBuckets - 1) {
+        return UINT64_MAX;
+    }
+    return (uint64_t(subBuckets) + sub + 1) << (exponent - 3);
+}
+
+void LatencyHistogram::add(double seconds, uint64_t count) {
+
+    if (count == 0) {
+        return;
+    }
+
+    // n.b. NaN compares false, so is counted as zero rather than converted to an integer
+    if (!(seconds > 0)) {
+        seconds = 0;
+    }
+
+    double micros = seconds * 1e6;
+    uint64_t m = (micros >= 1.8e19) ? UINT64_MAX : uint64_t(micros);
+
+    buckets_[bucket(m)] += count;
+    count_ += count;
+    max_ = std::max(max_, seconds);
+}
+
+LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& rhs) {
+    for (size_t i = 0; i < numBuckets; ++i) {
+        buckets_[i] += rhs.buckets_[i];
+    }
+    count_ += rhs.count_;
+    max_ = std::max(max_, rhs.max_);
+    return *this;
+}
+
+double LatencyHistogram::percentile(double fraction) const {
+
+    if (count_ == 0) {
+        return 0;
+    }
+
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(fraction * count_ + 0.5));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < numBuckets; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(upperBound(i) * 1e-6, max_);
+        }
+    }
+    return max_;
+}
+
+void LatencyHistogram::json(eckit::JSON& json) const {
+
+    json.startObject();
+    json << "count" << count_;
+    json << "max" << max_;
+    json << "p50" << percentile(0.5);
+    json << "p90" << percentile(0.9);
+    json << "p99" << percentile(0.99);
+    json << "p999" << percentile(0.999);
+
+    // Pairs of [upper bound (s), count]
+    json << "buckets";
+    json.startList();
+    for (size_t i = 0; i < numBuckets; ++i) {
+        if (buckets_[i]) {
+            json.startList();
+            json << upperBound(i) * 1e-6 << buckets_[i];
+            json.endList();
+        }
+    }
+    json.endList();
+
+    json.endObject();
+}
+
+void LatencyHistogram::print(std::ostream& out) const {
+    out << "count=" << count_
+        << ",p50=" << percentile(0.5) << "s"
+        << ",p99=" << percentile(0.99) << "s"
+        << ",max=" << max_ << "s";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
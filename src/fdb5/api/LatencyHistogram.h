@@ -0,0 +1,80 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   LatencyHistogram.h
+/// @date   Oct 2026
+
+#ifndef fdb5_LatencyHistogram_H
+#define fdb5_LatencyHistogram_H
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+namespace eckit {
+class JSON;
+}
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Histogram of durations, with buckets in the manner of HdrHistogram: microseconds are counted exactly up to
+/// 16us, and beyond that each power of two is split into 8 buckets, so that a bucket is within 12.5% of the values
+/// it holds, from 1us to days.
+
+class LatencyHistogram {
+
+public: // methods
+
+    LatencyHistogram();
+
+    /// Counts the duration the given number of times (e.g. the average over a batch, once per item in it).
+    /// Negative (or NaN) durations are counted as zero
+    void add(double seconds, uint64_t count = 1);
+
+    LatencyHistogram& operator+=(const LatencyHistogram& rhs);
+
+    uint64_t count() const { return count_; }
+
+    /// @returns the upper bound of the bucket holding the given fraction (0-1) of the values, in seconds
+    double percentile(double fraction) const;
+
+    double max() const { return max_; }
+
+    /// Summary (count, max, percentiles) and the non-empty buckets
+    void json(eckit::JSON& json) const;
+
+    void print(std::ostream& out) const;
+
+private: // members
+
+    static constexpr size_t exact = 16;
+    static constexpr size_t subBuckets = 8;
+    static constexpr size_t numBuckets = exact + (64 - 4) * subBuckets;
+
+    static size_t bucket(uint64_t micros);
+    static uint64_t upperBound(size_t bucket);
+
+    std::array<uint64_t, numBuckets> buckets_;
+    uint64_t count_;
+    double max_;
+
+    friend std::ostream& operator<<(std::ostream& s, const LatencyHistogram& h) {
+        h.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
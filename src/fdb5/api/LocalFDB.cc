@@ -13,6 +13,7 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include "eckit/config/Resource.h"
 #include "eckit/container/Queue.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
@@ -20,6 +21,7 @@
 #include "fdb5/api/helpers/ListIterator.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/api/LocalFDB.h"
+#include "fdb5/database/ArchiveBatch.h"
 #include "fdb5/database/Archiver.h"
 #include "fdb5/database/DB.h"
 #include "fdb5/database/EntryVisitMechanism.h"
@@ -55,6 +57,16 @@ void LocalFDB::archive(const Key& key, const void* data, size_t length) {
     archiver_->archive(key, data, length);
 }
 
+void LocalFDB::archive(const ArchiveBatch& batch) {
+
+    if (!archiver_) {
+        Log::debug<LibFdb5>() << *this << ": Constructing new archiver" << std::endl;
+        archiver_.reset(new Archiver(config_));
+    }
+
+    archiver_->archive(batch);
+}
+
 ListIterator LocalFDB::inspect(const metkit::mars::MarsRequest &request) {
 
     if (!inspector_) {
@@ -65,6 +77,10 @@ ListIterator LocalFDB::inspect(const metkit::mars::MarsRequest &request) {
     return inspector_->inspect(request);
 }
 
+FDBStats LocalFDB::stats() const {
+    return inspector_ ? inspector_->stats() : FDBStats();
+}
+
 template<typename VisitorType, typename ... Ts>
 APIIterator<typename VisitorType::ValueType> LocalFDB::queryInternal(const FDBToolRequest& request, Ts ... args) {
 
@@ -81,19 +97,48 @@ APIIterator<typename VisitorType::ValueType> LocalFDB::queryInternal(const FDBTo
     return QueryIterator(new AsyncIterator(async_worker));
 }
 
+/// As queryInternal, but for read-only visitors, whose DBs may be visited concurrently (see fdbVisitThreads).
+/// The output still comes out DB by DB, in the same order as when they are visited serially.
+
+template<typename VisitorType, typename ... Ts>
+APIIterator<typename VisitorType::ValueType> LocalFDB::concurrentQueryInternal(const FDBToolRequest& request, Ts ... args) {
+
+    size_t threads = EntryVisitMechanism::threads(config_);
+    if (threads <= 1) {
+        return queryInternal<VisitorType>(request, args...);
+    }
+
+    using ValueType = typename VisitorType::ValueType;
+    using QueryIterator = APIIterator<ValueType>;
+    using AsyncIterator = APIAsyncIterator<ValueType>;
+    using Buffered = api::local::BufferedQueryVisitor<VisitorType>;
+
+    static size_t bufferSize = eckit::Resource<size_t>("fdbVisitBufferSize", 100);
+
+    auto async_worker = [this, request, threads, args...] (Queue<ValueType>& queue) {
+        EntryVisitMechanism mechanism(config_);
+        mechanism.visit(request, threads,
+                        [&]() { return std::unique_ptr<EntryVisitor>(new Buffered(bufferSize, request.request(), args...)); },
+                        [](EntryVisitor& visitor) { static_cast<Buffered&>(visitor).complete(); },
+                        [&](EntryVisitor& visitor) { static_cast<Buffered&>(visitor).drain(queue); });
+    };
+
+    return QueryIterator(new AsyncIterator(async_worker));
+}
+
 ListIterator LocalFDB::list(const FDBToolRequest& request) {
     Log::debug<LibFdb5>() << "LocalFDB::list() : " << request << std::endl;
-    return queryInternal<ListVisitor>(request);
+    return concurrentQueryInternal<ListVisitor>(request);
 }
 
 DumpIterator LocalFDB::dump(const FDBToolRequest &request, bool simple) {
     Log::debug<LibFdb5>() << "LocalFDB::dump() : " << request << std::endl;
-    return queryInternal<DumpVisitor>(request, simple);
+    return concurrentQueryInternal<DumpVisitor>(request, simple);
 }
 
 StatusIterator LocalFDB::status(const FDBToolRequest &request) {
     Log::debug<LibFdb5>() << "LocalFDB::status() : " << request << std::endl;
-    return queryInternal<StatusVisitor>(request);
+    return concurrentQueryInternal<StatusVisitor>(request);
 }
 
 WipeIterator LocalFDB::wipe(const FDBToolRequest &request, bool doit, bool porcelain, bool unsafeWipeAll) {
@@ -113,7 +158,7 @@ PurgeIterator LocalFDB::purge(const FDBToolRequest& request, bool doit, bool por
 
 StatsIterator LocalFDB::stats(const FDBToolRequest& request) {
     Log::debug<LibFdb5>() << "LocalFDB::stats() : " << request << std::endl;
-    return queryInternal<StatsVisitor>(request);
+    return concurrentQueryInternal<StatsVisitor>(request);
 }
 
 ControlIterator LocalFDB::control(const FDBToolRequest& request,
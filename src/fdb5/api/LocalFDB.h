@@ -39,6 +39,8 @@ public: // methods
 
     void archive(const Key& key, const void* data, size_t length) override;
 
+    void archive(const ArchiveBatch& batch) override;
+
     ListIterator inspect(const metkit::mars::MarsRequest& request) override;
 
     ListIterator list(const FDBToolRequest& request) override;
@@ -61,6 +63,8 @@ public: // methods
 
     void flush() override;
 
+    FDBStats stats() const override;
+
 private: // methods
 
     void print(std::ostream& s) const override;
@@ -68,6 +72,9 @@ private: // methods
     template <typename VisitorType, typename ... Ts>
     APIIterator<typename VisitorType::ValueType> queryInternal(const FDBToolRequest& request, Ts ... args);
 
+    template <typename VisitorType, typename ... Ts>
+    APIIterator<typename VisitorType::ValueType> concurrentQueryInternal(const FDBToolRequest& request, Ts ... args);
+
 private: // members
 
     std::string home_;
@@ -0,0 +1,250 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/log/JSON.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/api/Metrics.h"
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static const char* latencyNames[Metrics::NumLatencies] = {
+    "archive", "flush", "lookup", "toc_append", "index_flush", "store_write"
+};
+
+static const std::string& metricsFile() {
+    static std::string file = eckit::Resource<std::string>("fdbMetricsFile;$FDB_METRICS_FILE", "");
+    return file;
+}
+
+static const std::string& metricsSocket() {
+    static std::string socket = eckit::Resource<std::string>("fdbMetricsSocket;$FDB_METRICS_SOCKET", "");
+    return socket;
+}
+
+bool Metrics::enabled() {
+    static bool enabled = !metricsFile().empty() || !metricsSocket().empty();
+    return enabled;
+}
+
+Metrics& Metrics::instance() {
+    // Never destroyed, as it may be used by other statics as they are destroyed
+    static Metrics* metrics = new Metrics;
+    return *metrics;
+}
+
+Metrics::Metrics() :
+    maxDatabases_(eckit::Resource<size_t>("fdbMetricsMaxDatabases", 1000)),
+    file_(metricsFile()),
+    socket_(metricsSocket()),
+    interval_(eckit::Resource<long>("fdbMetricsInterval;$FDB_METRICS_INTERVAL", 10)),
+    stopping_(false) {
+
+    if (enabled() && interval_ > 0) {
+
+        // The handlers registered with atexit run before the destruction of the statics constructed before they
+        // were registered. So construct the statics that a report uses first, so that the reporting thread is
+        // stopped before they are destroyed.
+
+        Key::internedCount();
+        eckit::Log::warning();
+        eckit::Log::debug<LibFdb5>();
+
+        reporter_ = std::thread([this] { run(); });
+        std::atexit([] { Metrics::instance().stop(); });
+    }
+}
+
+Metrics::~Metrics() {}
+
+void Metrics::add(Latency latency, double seconds, uint64_t count) {
+    std::lock_guard<std::mutex> lock(latencyMutex_[latency]);
+    latencies_[latency].add(seconds, count);
+}
+
+std::shared_ptr<Metrics::Counters> Metrics::database(const Key& key) {
+    std::ostringstream oss;
+    oss << key;
+    std::lock_guard<std::mutex> lock(countersMutex_);
+
+    // Drop the counters of the DBs that nobody is writing to any more
+
+    if (databases_.size() >= maxDatabases_) {
+        for (auto it = databases_.begin(); it != databases_.end();) {
+            if (it->second.use_count() == 1) {
+                it = databases_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    std::shared_ptr<Counters>& c(databases_[oss.str()]);
+    if (!c) c = std::make_shared<Counters>();
+    return c;
+}
+
+Metrics::Counters& Metrics::store(const std::string& type) {
+    std::lock_guard<std::mutex> lock(countersMutex_);
+    std::shared_ptr<Counters>& c(stores_[type]);
+    if (!c) c = std::make_shared<Counters>();
+    return *c;
+}
+
+static void counters(eckit::JSON& json, const std::map<std::string, std::shared_ptr<Metrics::Counters>>& all) {
+    json.startObject();
+    for (const auto& kv : all) {
+        json << kv.first;
+        json.startObject();
+        json << "fields" << kv.second->fields_.load();
+        json << "bytes" << kv.second->bytes_.load();
+        json << "flushes" << kv.second->flushes_.load();
+        json.endObject();
+    }
+    json.endObject();
+}
+
+void Metrics::json(eckit::JSON& json) const {
+
+    json.startObject();
+
+    json << "time" << long(::time(nullptr));
+    json << "pid" << long(::getpid());
+
+    json << "latency";
+    json.startObject();
+    for (size_t i = 0; i < NumLatencies; ++i) {
+        LatencyHistogram h;
+        {
+            std::lock_guard<std::mutex> lock(latencyMutex_[i]);
+            h = latencies_[i];
+        }
+        json << latencyNames[i];
+        h.json(json);
+    }
+    json.endObject();
+
+    {
+        std::lock_guard<std::mutex> lock(countersMutex_);
+        json << "databases";
+        counters(json, databases_);
+        json << "stores";
+        counters(json, stores_);
+    }
+
+    json << "interned";
+    json.startObject();
+    json << "strings" << Key::internedCount();
+    json << "bytes" << Key::internedBytes();
+    json.endObject();
+
+    json.endObject();
+}
+
+void Metrics::run() {
+    std::unique_lock<std::mutex> lock(stopMutex_);
+    while (!stopCond_.wait_for(lock, std::chrono::seconds(interval_), [this] { return stopping_; })) {
+        lock.unlock();
+        try {
+            report();
+        } catch (std::exception& e) {
+            eckit::Log::warning() << "Failed to report FDB metrics: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+void Metrics::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        stopping_ = true;
+    }
+    stopCond_.notify_all();
+    if (reporter_.joinable()) {
+        reporter_.join();
+    }
+}
+
+void Metrics::report() const {
+
+    std::ostringstream oss;
+    {
+        eckit::JSON json(oss);
+        this->json(json);
+    }
+    oss << std::endl;
+    std::string snapshot = oss.str();
+
+    if (!file_.empty()) {
+        // Replace the file in one go, so that readers never see a partial snapshot
+        eckit::PathName tmp = eckit::PathName::unique(eckit::PathName(file_));
+        {
+            std::ofstream out(tmp.localPath());
+            out << snapshot;
+            if (!out) {
+                throw eckit::WriteError(tmp.asString(), Here());
+            }
+        }
+        eckit::PathName::rename(tmp, file_);
+    }
+
+    if (!socket_.empty()) {
+
+        // n.b. nobody listening is not an error, the monitoring may not be running
+
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return;
+        }
+
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socket_.c_str(), sizeof(addr.sun_path) - 1);
+
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            const char* p = snapshot.c_str();
+            size_t remaining = snapshot.size();
+            while (remaining > 0) {
+                // n.b. not to be killed by SIGPIPE if the monitoring goes away
+                ssize_t n = ::send(fd, p, remaining, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) break;
+                p += n;
+                remaining -= n;
+            }
+        } else {
+            eckit::Log::debug<LibFdb5>() << "FDB metrics: cannot connect to " << socket_ << std::endl;
+        }
+
+        ::close(fd);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
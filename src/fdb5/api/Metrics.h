@@ -0,0 +1,139 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   Metrics.h
+/// @date   Oct 2026
+
+#ifndef fdb5_Metrics_H
+#define fdb5_Metrics_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "eckit/memory/NonCopyable.h"
+
+#include "fdb5/api/LatencyHistogram.h"
+
+namespace eckit {
+class JSON;
+}
+
+namespace fdb5 {
+
+class Key;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Process wide metrics, for monitoring: latency histograms of the main operations (from the API down to the
+/// TOC and the stores), counters per DB and per type of store, and the size of the table of interned Key strings.
+/// Retrievals are timed as far as the lookup of their fields, as the data is read later from the handle returned.
+///
+/// Metrics are only collected if they are going somewhere. Every fdbMetricsInterval seconds a JSON snapshot
+/// of them is written to fdbMetricsFile (replaced atomically) and/or sent to the local (unix) socket
+/// fdbMetricsSocket. The reporting thread is stopped at exit, before the statics it uses are destroyed.
+///
+/// The counters of DBs no longer in use are dropped once there are more than fdbMetricsMaxDatabases DBs.
+
+class Metrics : private eckit::NonCopyable {
+
+public: // types
+
+    enum Latency {
+        Archive,
+        Flush,
+        Lookup,
+        TocAppend,
+        IndexFlush,
+        StoreWrite,
+        NumLatencies
+    };
+
+    struct Counters {
+        std::atomic<uint64_t> fields_{0};
+        std::atomic<uint64_t> bytes_{0};
+        std::atomic<uint64_t> flushes_{0};
+    };
+
+    /// Times a scope, if metrics are enabled
+    class Timer {
+    public:
+        Timer(Latency latency) :
+            latency_(latency), enabled_(Metrics::enabled()) {
+            if (enabled_) start_ = std::chrono::steady_clock::now();
+        }
+        ~Timer() {
+            if (enabled_) {
+                Metrics::instance().add(latency_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+            }
+        }
+    private:
+        Latency latency_;
+        bool enabled_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+public: // methods
+
+    static bool enabled();
+
+    static Metrics& instance();
+
+    /// @param count the number of operations the duration is for, each of which took that long on average
+    void add(Latency latency, double seconds, uint64_t count = 1);
+
+    /// The counters of a DB are kept for as long as they are held on to, and a while after
+    std::shared_ptr<Counters> database(const Key& key);
+
+    /// n.b. the counters live as long as the process, so may be held on to
+    Counters& store(const std::string& type);
+
+    void json(eckit::JSON& json) const;
+
+private: // methods
+
+    Metrics();
+    ~Metrics();
+
+    void run();
+    void stop();
+    void report() const;
+
+private: // members
+
+    mutable std::mutex latencyMutex_[NumLatencies];
+    LatencyHistogram latencies_[NumLatencies];
+
+    mutable std::mutex countersMutex_;
+    std::map<std::string, std::shared_ptr<Counters>> databases_;
+    std::map<std::string, std::shared_ptr<Counters>> stores_;
+    size_t maxDatabases_;
+
+    std::string file_;
+    std::string socket_;
+    long interval_;
+
+    std::thread reporter_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCond_;
+    bool stopping_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -13,7 +13,9 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <exception>
 #include <functional>
+#include <sstream>
 #include <unistd.h>
 
 #include "fdb5/api/RemoteFDB.h"
@@ -23,6 +25,7 @@
 #include "fdb5/remote/RemoteFieldLocation.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/database/Key.h"
+#include "fdb5/rules/Schema.h"
 
 #include "eckit/config/LocalConfiguration.h"
 #include "eckit/io/Buffer.h"
@@ -105,6 +108,18 @@ public:
 //      big deal. The idea that we could be on the 2.1 billionth (successful)
 //      request, and still have an ongoing request 0 is ... laughable.
 
+static size_t archiveConnections(const eckit::Configuration& config) {
+
+    int connections = config.getInt("archiveConnections",
+                                    eckit::Resource<int>("fdbRemoteArchiveConnections;$FDB_REMOTE_ARCHIVE_CONNECTIONS", 1));
+    if (connections < 1) {
+        std::ostringstream ss;
+        ss << "RemoteFDB: archiveConnections must be at least 1, not " << connections;
+        throw eckit::UserError(ss.str(), Here());
+    }
+    return size_t(connections);
+}
+
 static uint32_t generateRequestID() {
 
     static std::mutex m;
@@ -122,6 +137,7 @@ RemoteFDB::RemoteFDB(const eckit::Configuration& config, const std::string& name
     maxArchiveQueueLength_(eckit::Resource<size_t>("fdbRemoteArchiveQueueLength;$FDB_REMOTE_ARCHIVE_QUEUE_LENGTH", 200)),
     maxArchiveBatchSize_(config.getInt("maxBatchSize", 1)),
     retrieveMessageQueue_(eckit::Resource<size_t>("fdbRemoteRetrieveQueueLength;$FDB_REMOTE_RETRIEVE_QUEUE_LENGTH", 200)),
+    archiveConnections_(archiveConnections(config)),
     connected_(false) {}
 
 
@@ -524,7 +540,11 @@ void RemoteFDB::handleError(const MessageHeader& hdr) {
 }
 
 FDBStats RemoteFDB::stats() const {
-    return internalStats_;
+    FDBStats stats(internalStats_);
+    for (const auto& lane : archiveLanes_) {
+        stats += lane->stats();
+    }
+    return stats;
 }
 
 
@@ -759,6 +779,14 @@ MoveIterator RemoteFDB::move(const FDBToolRequest& request, const eckit::URI& de
 // Here we do archive/flush related stuff
 void RemoteFDB::archive(const Key& key, const void* data, size_t length) {
 
+    if (archiveConnections_ > 1) {
+        size_t lane = archiveLane(key);
+        if (lane != 0) {
+            archiveLanes_[lane - 1]->archive(key, data, length);
+            return;
+        }
+    }
+
     connect();
 
     // if there is no archiving thread active, then start one.
@@ -798,6 +826,23 @@ void RemoteFDB::flush() {
 
     timer.start();
 
+    // The other archive connections flush concurrently with this one, so their servers flush in parallel
+
+    std::vector<std::function<void()>> flushes;
+    flushes.emplace_back([this] { flushArchive(); });
+    for (auto& lane : archiveLanes_) {
+        RemoteFDB* fdb = lane.get();
+        flushes.emplace_back([fdb] { fdb->flush(); });
+    }
+
+    flushLanes(flushes, controlEndpoint_);
+
+    timer.stop();
+    internalStats_.addFlush(timer);
+}
+
+void RemoteFDB::flushArchive() {
+
     // Flush only does anything if there is an ongoing archive();
     if (archiveFuture_.valid()) {
 
@@ -823,9 +868,91 @@ void RemoteFDB::flush() {
 
         internalStats_ += stats;
     }
+}
 
-    timer.stop();
-    internalStats_.addFlush(timer);
+void RemoteFDB::flushLanes(const std::vector<std::function<void()>>& flushes, const net::Endpoint& endpoint) {
+
+    ASSERT(!flushes.empty());
+
+    std::vector<std::future<void>> laneFlushes;
+    for (size_t i = 1; i < flushes.size(); ++i) {
+        laneFlushes.emplace_back(std::async(std::launch::async, flushes[i]));
+    }
+
+    // Every lane is waited for, even if another fails, and all of their errors are reported
+
+    std::vector<std::string> errors;
+    std::exception_ptr error;
+
+    try {
+        flushes[0]();
+    }
+    catch (std::exception& e) {
+        errors.push_back(e.what());
+        error = std::current_exception();
+    }
+
+    for (size_t i = 0; i < laneFlushes.size(); ++i) {
+        try {
+            laneFlushes[i].get();
+        }
+        catch (std::exception& e) {
+            errors.push_back(std::string("archive connection ") + std::to_string(i + 1) + ": " + e.what());
+            error = std::current_exception();
+        }
+    }
+
+    if (errors.size() == 1) {
+        std::rethrow_exception(error);
+    }
+    if (!errors.empty()) {
+        std::ostringstream ss;
+        ss << "Flush failed on " << errors.size() << " of " << flushes.size() << " archive connections";
+        for (const std::string& e : errors) {
+            ss << "; " << e;
+        }
+        throw RemoteFDBException(ss.str(), endpoint);
+    }
+}
+
+size_t RemoteFDB::archiveLane(const Key& key) {
+
+    if (archiveLanes_.empty()) {
+
+        // Sharding is by DB key, so that the fields of a DB keep their order. Without a schema we cannot
+        // tell which DB a field belongs to, so all archive traffic stays on this one connection.
+
+        try {
+            config_.schema();
+        }
+        catch (eckit::Exception& e) {
+            Log::warning() << *this << ": no schema available, archiving over a single connection: "
+                           << e.what() << std::endl;
+            archiveConnections_ = 1;
+            return 0;
+        }
+
+        Config laneConfig(config_);
+        laneConfig.set("archiveConnections", 1);
+        for (size_t i = 1; i < archiveConnections_; ++i) {
+            archiveLanes_.emplace_back(new RemoteFDB(laneConfig, name_));
+        }
+    }
+
+    return archiveLane(config_.schema(), key, archiveConnections_);
+}
+
+size_t RemoteFDB::archiveLane(const Schema& schema, const Key& key, size_t connections) {
+
+    // A key that does not match the schema cannot be archived, but the server reports that. Send all such
+    // keys the same way, so that their errors come back in order.
+
+    Key dbKey;
+    if (!schema.expandFirstLevel(key, dbKey)) {
+        return 0;
+    }
+
+    return std::hash<Key>()(dbKey) % connections;
 }
 
 
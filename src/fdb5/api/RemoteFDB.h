@@ -19,8 +19,11 @@
 #ifndef fdb5_remote_RemoteFDB_H
 #define fdb5_remote_RemoteFDB_H
 
+#include <functional>
 #include <future>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "eckit/container/Queue.h"
 #include "eckit/io/Buffer.h"
@@ -36,6 +39,7 @@
 namespace fdb5 {
 
 class FDB;
+class Schema;
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -50,6 +54,7 @@ public: // types
 public: // method
 
     using FDBBase::stats;
+    using FDBBase::archive;
 
     RemoteFDB(const eckit::Configuration& config, const std::string& name);
     ~RemoteFDB() override;
@@ -84,6 +89,14 @@ public: // method
 
     const eckit::net::Endpoint& controlEndpoint() const { return controlEndpoint_; }
 
+    /// Which of `connections` archive connections a field goes down, by the DB it belongs to. Zero is the main
+    /// connection, which also takes the fields that do not match the schema.
+    static size_t archiveLane(const Schema& schema, const Key& key, size_t connections);
+
+    /// Runs the flushes of the archive connections concurrently, the first on the calling thread, and waits for
+    /// all of them. A single failure is rethrown as it is, several are reported together.
+    static void flushLanes(const std::vector<std::function<void()>>& flushes, const eckit::net::Endpoint& endpoint);
+
 private: // methods
 
     // Methods to control the connection
@@ -121,6 +134,13 @@ private: // methods
 
     // Workers for archiving
 
+    /// Which of the archive connections a field goes down. Zero is this connection. Without a schema there
+    /// is only this connection.
+    size_t archiveLane(const Key& key);
+
+    /// Completes the archival on this connection
+    void flushArchive();
+
     FDBStats archiveThreadLoop(uint32_t requestID);
 
     void sendArchiveData(uint32_t id, const Key& key, const void* data, size_t length);
@@ -168,6 +188,12 @@ private: // members
     std::unique_ptr<ArchiveQueue> archiveQueue_;
     MessageQueue retrieveMessageQueue_;
 
+    // Additional connections over which archive traffic is striped, sharded by DB so that the fields of
+    // any one DB are always sent, and archived on the server, in order.
+
+    size_t archiveConnections_;
+    std::vector<std::unique_ptr<RemoteFDB>> archiveLanes_;
+
     bool connected_;
 };
 
@@ -13,6 +13,9 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <set>
+
+#include "eckit/config/Resource.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
 #include "eckit/utils/Tokenizer.h"
@@ -75,6 +78,16 @@ SelectFDB::SelectFDB(const Config& config, const std::string& name) :
     for (const auto& c : config.getSubConfigs("fdbs")) {
         subFdbs_.emplace_back(std::make_pair(parseFDBSelect(c), FDB(c)));
     }
+
+    std::set<std::string> keywords;
+    for (const auto& iter : subFdbs_) {
+        for (const auto& kv : iter.first) {
+            keywords.insert(kv.first);
+        }
+    }
+    selectKeywords_.assign(keywords.begin(), keywords.end());
+
+    maxRoutes_ = eckit::Resource<size_t>("fdbSelectRoutingCacheSize;$FDB_SELECT_ROUTING_CACHE_SIZE", 64 * 1024);
 }
 
 
@@ -82,24 +95,62 @@ SelectFDB::~SelectFDB() {}
 
 void SelectFDB::archive(const Key& key, const void* data, size_t length) {
 
-    for (auto& iter : subFdbs_) {
+    size_t idx = route(key);
 
-        const SelectMap& select(iter.first);
-        FDB& fdb(iter.second);
+    if (idx == subFdbs_.size()) {
+        std::stringstream ss;
+        ss << "No matching fdb for key: " << key;
+        throw eckit::UserError(ss.str(), Here());
+    }
+
+    subFdbs_[idx].second.archive(key, data, length);
+}
 
-        if (matches(key, select, true)) {
-            fdb.archive(key, data, length);
-            return;
+size_t SelectFDB::ProjectionHash::operator()(const Projection& p) const {
+    size_t h = p.size();
+    for (const std::string* v : p) {
+        h ^= std::hash<const std::string*>()(v) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+size_t SelectFDB::route(const Key& key) {
+
+    // The values held by Keys are interned, so the same value is always at the same address
+
+    projection_.clear();
+    for (const std::string& keyword : selectKeywords_) {
+        Key::const_iterator it = key.find(keyword);
+        projection_.push_back(it == key.end() ? nullptr : &it->second);
+    }
+
+    auto it = routes_.find(projection_);
+    if (it != routes_.end()) {
+        return it->second;
+    }
+
+    size_t idx = 0;
+    for (; idx < subFdbs_.size(); ++idx) {
+        if (matches(key, subFdbs_[idx].first, true)) {
+            break;
         }
     }
 
-    std::stringstream ss;
-    ss << "No matching fdb for key: " << key;
-    throw eckit::UserError(ss.str(), Here());
+    if (routes_.size() >= maxRoutes_) {
+        routes_.clear();
+    }
+    if (maxRoutes_ > 0) {
+        routes_.emplace(projection_, idx);
+    }
+
+    return idx;
 }
 
 ListIterator SelectFDB::inspect(const metkit::mars::MarsRequest& request) {
 
+    // The FDBs are inspected concurrently, each into a queue of its own, but their output is kept in order
+    // so that the fields retrieved are too
+
     std::queue<APIIterator<ListElement>> lists;
 
     for (auto& iter : subFdbs_) {
@@ -137,9 +188,32 @@ auto SelectFDB::queryInternal(const FDBToolRequest& request, const QueryFN& fn)
     return QueryIterator(new APIAggregateIterator<ValueType>(std::move(iterQueue)));
 }
 
+template <typename QueryFN>
+auto SelectFDB::interleavedQueryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request)) {
+
+    using QueryIterator = decltype(fn(*(FDB*)(nullptr), request));
+    using ValueType = typename QueryIterator::value_type;
+
+    std::vector<std::function<APIIterator<ValueType>()>> sources;
+
+    for (auto& iter : subFdbs_) {
+
+        const SelectMap& select(iter.first);
+        FDB* fdb = &iter.second;
+
+        if (matches(request.request(), select, false) || request.all()) {
+            sources.emplace_back([fdb, fn, request] {
+                return APIIterator<ValueType>(fn(*fdb, request));
+            });
+        }
+    }
+
+    return QueryIterator(new APIInterleavingIterator<ValueType>(sources));
+}
+
 ListIterator SelectFDB::list(const FDBToolRequest& request) {
     Log::debug<LibFdb5>() << "SelectFDB::list() >> " << request << std::endl;
-    return queryInternal(request,
+    return interleavedQueryInternal(request,
                          [](FDB& fdb, const FDBToolRequest& request) {
                             return fdb.list(request);
                          });
@@ -215,7 +289,7 @@ bool SelectFDB::matches(const Key &key, const SelectMap &select, bool requireMis
         const std::string& k(kv.first);
         const eckit::Regex& re(kv.second);
 
-        eckit::StringDict::const_iterator i = key.find(k);
+        Key::const_iterator i = key.find(k);
         if (i == key.end()) {
             if (requireMissing) return false;
         } else if (!re.match(i->second)) {
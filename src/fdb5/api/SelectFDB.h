@@ -22,6 +22,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <unordered_map>
 
 #include "eckit/utils/Regex.h"
 
@@ -38,9 +39,17 @@ private: // types
 
     using SelectMap = std::map<std::string, eckit::Regex>;
 
+    /// The values of a key for the select keywords (see Key::intern), null where it has none
+    using Projection = std::vector<const std::string*>;
+
+    struct ProjectionHash {
+        size_t operator()(const Projection& p) const;
+    };
+
 public: // methods
 
     using FDBBase::stats;
+    using FDBBase::archive;
 
     SelectFDB(const Config& config, const std::string& name);
 
@@ -77,12 +86,28 @@ private: // methods
     bool matches(const Key& key, const SelectMap& select, bool requireMissing) const;
     bool matches(const metkit::mars::MarsRequest& request, const SelectMap& select, bool requireMissing) const;
 
+    /// @returns the index of the FDB to archive the key to, or subFdbs_.size() if none
+    size_t route(const Key& key);
+
     template <typename QueryFN>
     auto queryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request));
 
+    /// As queryInternal, but the output of the FDBs is interleaved as it arrives (see APIInterleavingIterator)
+    template <typename QueryFN>
+    auto interleavedQueryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request));
+
 private: // members
 
     std::vector<std::pair<SelectMap, FDB>> subFdbs_;
+
+    /// The keywords used by any of the selects. Which FDB a key is archived to only depends on their values,
+    /// so the result of matching the selects is cached against them.
+    std::vector<std::string> selectKeywords_;
+
+    std::unordered_map<Projection, size_t, ProjectionHash> routes_;
+    size_t maxRoutes_;
+
+    Projection projection_; ///< reused from one archive() to the next
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -19,6 +19,7 @@
 #include "fdb5/api/FDB.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/api/helpers/ListIterator.h"
+#include "fdb5/database/ArchiveBatch.h"
 #include "fdb5/database/Key.h"
 
 #include "fdb5/api/fdb_c.h"
@@ -316,6 +317,24 @@ int fdb_archive(fdb_handle_t* fdb, fdb_key_t* key, const char* data, size_t leng
         fdb->archive(*key, data, length);
     });
 }
+int fdb_archive_batch(fdb_handle_t* fdb, fdb_key_t** keys, const char** data, const size_t* lengths, size_t count) {
+    return wrapApiFunction([fdb, keys, data, lengths, count] {
+        ASSERT(fdb);
+        ASSERT(keys);
+        ASSERT(data);
+        ASSERT(lengths);
+
+        ArchiveBatch batch;
+        batch.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT(keys[i]);
+            ASSERT(data[i]);
+            batch.add(*keys[i], data[i], lengths[i]);
+        }
+
+        fdb->archive(batch);
+    });
+}
 int fdb_archive_multiple(fdb_handle_t* fdb, fdb_request_t* req, const char* data, size_t length) {
     return wrapApiFunction([fdb, req, data, length] {
         ASSERT(fdb);
@@ -305,6 +305,18 @@ int fdb_new_handle(fdb_handle_t** fdb);
  */
 int fdb_archive(fdb_handle_t* fdb, fdb_key_t* key, const char* data, size_t length);
 
+/** Archives a batch of fields to a FDB instance. The fields are grouped by database and index, and each index is only
+ * updated once for the batch.
+ * \warning this is a low-level API. The provided keys and the corresponding data are not checked for consistency
+ * \param fdb FDB instance.
+ * \param keys Array of #count keys used for indexing and archiving the data
+ * \param data Array of #count pointers to the binary data to archive
+ * \param lengths Array of #count sizes of the data to archive with the corresponding key
+ * \param count Number of fields in the batch
+ * \returns Return code (#FdbErrorValues)
+ */
+int fdb_archive_batch(fdb_handle_t* fdb, fdb_key_t** keys, const char** data, const size_t* lengths, size_t count);
+
 /** Archives multiple messages to a FDB instance.
  * \param fdb FDB instance.
  * \param req If Request #req is not nullptr, the number of messages and their metadata are checked against the provided request 
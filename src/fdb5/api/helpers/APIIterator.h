@@ -21,10 +21,13 @@
 
 #include "eckit/container/Queue.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <queue>
 #include <exception>
+#include <thread>
+#include <vector>
 
 /*
  * Given a standard, copyable, element, provide a mechanism for iterating over
@@ -156,6 +159,68 @@ private: // members
 };
 
 
+//----------------------------------------------------------------------------------------------------------------------
+
+// Combine the output of a number of sources (e.g. the lanes of a DistFDB) as it arrives, rather than one source
+// after the other. Each source is produced, and then drained, on its own thread into a bounded queue. The order
+// of the elements from any one source is retained.
+
+template <typename ValueType>
+class APIInterleavingIterator : public APIIteratorBase<ValueType> {
+
+public: // methods
+
+    APIInterleavingIterator(const std::vector<std::function<APIIterator<ValueType>()>>& sources,
+                            size_t queueSize=100) :
+        queue_(queueSize),
+        remaining_(sources.size()) {
+
+        if (sources.empty()) {
+            queue_.close();
+        }
+
+        for (const auto& source : sources) {
+            workerThreads_.emplace_back([source, this] {
+                try {
+                    APIIterator<ValueType> it = source();
+                    ValueType elem;
+                    while (it.next(elem)) {
+                        queue_.emplace(std::move(elem));
+                    }
+                    if (--remaining_ == 0) {
+                        queue_.close();
+                    }
+                } catch (...) {
+                    // Really avoid calling std::terminate on worker thread.
+                    queue_.interrupt(std::current_exception());
+                }
+            });
+        }
+    }
+
+    virtual ~APIInterleavingIterator() override {
+        if (!queue_.closed()) {
+            queue_.interrupt(std::make_exception_ptr(eckit::SeriousBug("Destructing incomplete interleaved queue", Here())));
+        }
+        for (std::thread& t : workerThreads_) {
+            t.join();
+        }
+    }
+
+    virtual bool next(ValueType& elem) override {
+        return !(queue_.pop(elem) == -1);
+    }
+
+private: // members
+
+    eckit::Queue<ValueType> queue_;
+
+    std::atomic<size_t> remaining_;
+
+    std::vector<std::thread> workerThreads_;
+};
+
+
 //----------------------------------------------------------------------------------------------------------------------
 
 } // namespace fdb5
@@ -78,6 +78,11 @@ public:
         return false; // Skip contained entries
     }
 
+    /// Only the indexes whose entries will be explored are worth reading in ahead
+    bool preloadIndex(const Index& index) const override {
+        return index.partialMatch(request_);
+    }
+
     /// Test if entry matches the current request. If so, add to the output queue.
     void visitDatum(const Field& field, const Key& key) override {
         ASSERT(currentCatalogue_);
@@ -49,6 +49,49 @@ protected: // members
     metkit::mars::MarsRequest request_;
 };
 
+//----------------------------------------------------------------------------------------------------------------------
+
+/// When DBs are visited concurrently (see EntryVisitMechanism), each DB has its own visitor, which writes into its
+/// own buffer rather than the output queue. The buffers are drained into the output queue in DB order.
+
+template <typename T>
+class QueryBuffer {
+protected: // methods
+    QueryBuffer(size_t size) : buffer_(size) {}
+protected: // members
+    eckit::Queue<T> buffer_;
+};
+
+template <typename VisitorType>
+class BufferedQueryVisitor : private QueryBuffer<typename VisitorType::ValueType>, public VisitorType {
+
+public: // methods
+
+    using ValueType = typename VisitorType::ValueType;
+
+    template <typename ... Ts>
+    BufferedQueryVisitor(size_t size, const metkit::mars::MarsRequest& request, Ts ... args) :
+        QueryBuffer<ValueType>(size),
+        VisitorType(this->buffer_, request, args...) {}
+
+    /// Called once the DB has been visited
+    void complete() { this->buffer_.close(); }
+
+    /// Moves the output of the DB into the queue, waiting for the visit to complete
+    void drain(eckit::Queue<ValueType>& queue) {
+        try {
+            ValueType elem;
+            while (this->buffer_.pop(elem) != -1) {
+                queue.emplace(std::move(elem));
+            }
+        } catch (...) {
+            // Don't leave the visit blocked on a full buffer
+            this->buffer_.interrupt(std::current_exception());
+            throw;
+        }
+    }
+};
+
 
 //----------------------------------------------------------------------------------------------------------------------
 
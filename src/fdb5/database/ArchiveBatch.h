@@ -0,0 +1,75 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ArchiveBatch.h
+/// @date   Oct 2026
+
+#ifndef fdb5_ArchiveBatch_H
+#define fdb5_ArchiveBatch_H
+
+#include <cstddef>
+#include <vector>
+
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A set of fields to be archived in one call. The data is not copied, so must remain valid until
+/// the batch has been archived.
+
+class ArchiveBatch {
+
+public: // types
+
+    struct Element {
+        Element(const Key& key, const void* data, size_t length) : key_(key), data_(data), length_(length) {}
+
+        Key key_;
+        const void* data_;
+        size_t length_;
+    };
+
+    typedef std::vector<Element>::const_iterator const_iterator;
+
+public: // methods
+
+    ArchiveBatch() : length_(0) {}
+
+    void add(const Key& key, const void* data, size_t length) {
+        elements_.emplace_back(key, data, length);
+        length_ += length;
+    }
+
+    void reserve(size_t n) { elements_.reserve(n); }
+
+    size_t size() const { return elements_.size(); }
+    bool empty() const { return elements_.empty(); }
+
+    /// Total size of the data in the batch
+    size_t length() const { return length_; }
+
+    const Element& operator[](size_t i) const { return elements_[i]; }
+
+    const_iterator begin() const { return elements_.begin(); }
+    const_iterator end() const { return elements_.end(); }
+
+private: // members
+
+    std::vector<Element> elements_;
+    size_t length_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
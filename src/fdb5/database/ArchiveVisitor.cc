@@ -8,9 +8,12 @@
  * does it submit to any jurisdiction.
  */
 
+#include "eckit/config/Resource.h"
 #include "eckit/exception/Exceptions.h"
 
-
+#include "fdb5/LibFdb5.h"
+#include "fdb5/database/Archiver.h"
+#include "fdb5/database/ArchiveWorker.h"
 #include "fdb5/database/DB.h"
 #include "fdb5/database/ArchiveVisitor.h"
 
@@ -43,4 +46,92 @@ void ArchiveVisitor::print(std::ostream &out) const {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+PipelinedArchiveVisitor::PipelinedArchiveVisitor(Archiver &owner, const Key &field, const void *data, size_t size) :
+    WriteVisitor(owner.prev_),
+    owner_(owner),
+    field_(field),
+    data_(data),
+    size_(size) {
+    checkMissingKeysOnWrite_ = eckit::Resource<bool>("checkMissingKeysOnWrite", true);
+}
+
+bool PipelinedArchiveVisitor::selectDatabase(const Key &key, const Key&) {
+    eckit::Log::debug<LibFdb5>() << "selectDatabase " << key << std::endl;
+    owner_.currentWorker_ = &owner_.worker(key);
+    owner_.currentIndexKey_ = Key();
+    return true;
+}
+
+bool PipelinedArchiveVisitor::selectIndex(const Key &key, const Key&) {
+    ASSERT(owner_.currentWorker_);
+    owner_.currentIndexKey_ = key;
+    return true;
+}
+
+bool PipelinedArchiveVisitor::selectDatum(const Key &key, const Key &full) {
+
+    if (checkMissingKeysOnWrite_) {
+        field_.validateKeysOf(full);
+    }
+
+    ASSERT(owner_.currentWorker_);
+    ASSERT(!owner_.currentIndexKey_.empty());
+
+    owner_.currentWorker_->archive(owner_.currentIndexKey_, key, data_, size_);
+
+    return true;
+}
+
+const Schema& PipelinedArchiveVisitor::databaseSchema() const {
+    ASSERT(owner_.currentWorker_);
+    return owner_.currentWorker_->db().schema();
+}
+
+void PipelinedArchiveVisitor::print(std::ostream &out) const {
+    out << "PipelinedArchiveVisitor["
+        << "size=" << size_
+        << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+BatchArchiveVisitor::BatchArchiveVisitor(Archiver &owner, const Key &field, size_t element, Routing& routing) :
+    BaseArchiveVisitor(owner, field),
+    element_(element),
+    routing_(routing) {
+}
+
+bool BatchArchiveVisitor::selectDatabase(const Key &key, const Key &full) {
+    routing_.db_ = key;
+    routing_.index_ = Key();
+    return BaseArchiveVisitor::selectDatabase(key, full);
+}
+
+bool BatchArchiveVisitor::selectIndex(const Key &key, const Key&) {
+    // The index is only selected on the DB once the whole batch has been routed
+    ASSERT(current());
+    routing_.index_ = key;
+    return true;
+}
+
+bool BatchArchiveVisitor::selectDatum(const Key &key, const Key &full) {
+
+    checkMissingKeys(full);
+
+    ASSERT(!routing_.db_.empty());
+    ASSERT(!routing_.index_.empty());
+
+    routing_.routes_.emplace_back(Route{routing_.db_, routing_.index_, key, key.valuesToString(), element_});
+
+    return true;
+}
+
+void BatchArchiveVisitor::print(std::ostream &out) const {
+    out << "BatchArchiveVisitor["
+        << "element=" << element_
+        << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 } // namespace fdb5
@@ -16,7 +16,11 @@
 #ifndef fdb5_ArchiveVisitor_H
 #define fdb5_ArchiveVisitor_H
 
+#include <string>
+#include <vector>
+
 #include "fdb5/database/BaseArchiveVisitor.h"
+#include "fdb5/database/WriteVisitor.h"
 
 namespace metkit { class MarsRequest; }
 
@@ -47,6 +51,87 @@ private: // members
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Used by the Archiver in pipelined mode. Expands the schema and routes the field on the caller's thread,
+/// but leaves all interaction with the DB itself to the ArchiveWorker that owns it.
+
+class PipelinedArchiveVisitor : public WriteVisitor {
+
+public: // methods
+
+    PipelinedArchiveVisitor(Archiver &owner, const Key &field, const void *data, size_t size);
+
+protected: // methods
+
+    virtual bool selectDatabase(const Key &key, const Key &full) override;
+
+    virtual bool selectIndex(const Key &key, const Key &full) override;
+
+    virtual bool selectDatum(const Key &key, const Key &full) override;
+
+    virtual const Schema& databaseSchema() const override;
+
+    virtual void print( std::ostream &out ) const override;
+
+private: // members
+
+    Archiver &owner_;
+
+    const Key &field_;
+
+    const void *data_;
+    size_t size_;
+
+    bool checkMissingKeysOnWrite_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Used by the Archiver to archive an ArchiveBatch. Expands the schema for one field of the batch and records
+/// where it is to be written, without writing anything, so that the fields can then be written grouped by DB
+/// and index.
+
+class BatchArchiveVisitor : public BaseArchiveVisitor {
+
+public: // types
+
+    struct Route {
+        Key db_;
+        Key index_;
+        Key datum_;
+        std::string datumString_; ///< n.b. the order the index entries are stored in
+        size_t element_;
+    };
+
+    /// Shared between the visitors of a batch, as the DB and index are only selected when they change
+    struct Routing {
+        Key db_;
+        Key index_;
+        std::vector<Route> routes_;
+    };
+
+public: // methods
+
+    BatchArchiveVisitor(Archiver &owner, const Key &field, size_t element, Routing& routing);
+
+protected: // methods
+
+    virtual bool selectDatabase(const Key &key, const Key &full) override;
+
+    virtual bool selectIndex(const Key &key, const Key &full) override;
+
+    virtual bool selectDatum(const Key &key, const Key &full) override;
+
+    virtual void print( std::ostream &out ) const override;
+
+private: // members
+
+    size_t element_;
+
+    Routing& routing_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 } // namespace fdb5
 
 #endif
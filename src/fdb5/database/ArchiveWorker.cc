@@ -0,0 +1,160 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/database/ArchiveWorker.h"
+#include "fdb5/database/DB.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ArchiveWorker::ArchiveWorker(DB& db, size_t maxQueueLength) :
+    db_(db),
+    maxQueueLength_(maxQueueLength),
+    inFlight_(0),
+    done_(false) {
+
+    ASSERT(maxQueueLength_ > 0);
+
+    thread_ = std::thread([this] { run(); });
+}
+
+ArchiveWorker::~ArchiveWorker() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+    }
+    cv_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (error_) {
+        try {
+            std::rethrow_exception(error_);
+        } catch (const std::exception& e) {
+            eckit::Log::error() << *this << ": unreported error on shutdown: " << e.what() << std::endl;
+        } catch (...) {
+            eckit::Log::error() << *this << ": unreported unknown error on shutdown" << std::endl;
+        }
+    }
+}
+
+void ArchiveWorker::archive(const Key& indexKey, const Key& datumKey, const void* data, size_t length) {
+    enqueue(Task(indexKey, datumKey, data, length));
+}
+
+void ArchiveWorker::flush() {
+    enqueue(Task());
+}
+
+void ArchiveWorker::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return queue_.empty() && inFlight_ == 0; });
+    rethrow();
+}
+
+void ArchiveWorker::deselectIndex() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ASSERT(queue_.empty() && inFlight_ == 0);
+    selectedIndex_ = Key();
+}
+
+void ArchiveWorker::enqueue(Task&& task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return queue_.size() < maxQueueLength_ || error_; });
+    rethrow();
+    ASSERT(!done_);
+    queue_.emplace_back(std::move(task));
+    lock.unlock();
+    cv_.notify_all();
+}
+
+/// n.b. must be called with mutex_ held. The error is only reported once.
+void ArchiveWorker::rethrow() {
+    if (error_) {
+        std::exception_ptr e;
+        std::swap(e, error_);
+        std::rethrow_exception(e);
+    }
+}
+
+void ArchiveWorker::run() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+
+        cv_.wait(lock, [this] { return !queue_.empty() || done_; });
+
+        if (queue_.empty()) {
+            ASSERT(done_);
+            break;
+        }
+
+        Task task(std::move(queue_.front()));
+        queue_.pop_front();
+        ++inFlight_;
+
+        // Once something has gone wrong, discard the remaining work. The error is reported to the
+        // caller on its next call, and the DB is left in the state of the last successful flush.
+        bool failed = bool(error_);
+
+        lock.unlock();
+        cv_.notify_all();
+
+        std::exception_ptr err;
+        if (!failed) {
+            try {
+                process(task);
+            } catch (...) {
+                err = std::current_exception();
+            }
+        }
+
+        lock.lock();
+        --inFlight_;
+        if (err && !error_) {
+            error_ = err;
+        }
+        cv_.notify_all();
+    }
+}
+
+void ArchiveWorker::process(Task& task) {
+
+    if (task.flush_) {
+        eckit::Log::debug<LibFdb5>() << *this << ": flush" << std::endl;
+        db_.flush();
+        return;
+    }
+
+    if (task.index_ != selectedIndex_) {
+        db_.deselectIndex();
+        db_.selectIndex(task.index_);
+        selectedIndex_ = task.index_;
+    }
+
+    db_.archive(task.datum_, task.data_.data(), task.data_.size());
+}
+
+void ArchiveWorker::print(std::ostream& out) const {
+    out << "ArchiveWorker[" << db_.key() << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,119 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ArchiveWorker.h
+/// @date   Oct 2026
+
+#ifndef fdb5_ArchiveWorker_H
+#define fdb5_ArchiveWorker_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iosfwd>
+#include <mutex>
+#include <thread>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/memory/NonCopyable.h"
+
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+class DB;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Owns the write side of one DB when the Archiver runs in pipelined mode.
+///
+/// Schema expansion and key routing happen on the caller's thread, which then hands (index key, datum key, data)
+/// to the worker of the matching DB. From then on the DB, including its currently selected index, is only ever
+/// touched by the worker thread, so different DBs archive concurrently while each DB sees its fields in order.
+
+class ArchiveWorker : private eckit::NonCopyable {
+
+public: // methods
+
+    ArchiveWorker(DB& db, size_t maxQueueLength);
+
+    /// Drains the queue and joins the thread. Errors not yet reported are logged, never thrown.
+    ~ArchiveWorker();
+
+    DB& db() const { return db_; }
+
+    /// Queue a field for archival. The data is copied, so the caller may reuse its buffer on return.
+    /// Blocks whilst the queue is full. Rethrows any error raised by previously queued work.
+    void archive(const Key& indexKey, const Key& datumKey, const void* data, size_t length);
+
+    /// Queue a DB::flush() behind all the fields archived so far. Does not wait for it.
+    void flush();
+
+    /// Wait until all queued work has been done. Rethrows any error raised by that work.
+    void wait();
+
+    /// The index selected on the DB has been changed by someone else, so the next field must select its index
+    /// again. Only to be called with the worker idle (see wait()).
+    void deselectIndex();
+
+private: // types
+
+    struct Task {
+        Task(const Key& index, const Key& datum, const void* data, size_t length) :
+            flush_(false), index_(index), datum_(datum), data_(data, length) {}
+        Task() :
+            flush_(true), data_(0) {}
+
+        bool flush_;
+        Key index_;
+        Key datum_;
+        eckit::Buffer data_;
+    };
+
+private: // methods
+
+    void enqueue(Task&& task);
+    void rethrow();
+    void run();
+    void process(Task& task);
+
+    void print(std::ostream& out) const;
+
+    friend std::ostream& operator<<(std::ostream& s, const ArchiveWorker& w) {
+        w.print(s);
+        return s;
+    }
+
+private: // members
+
+    DB& db_;
+
+    size_t maxQueueLength_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    std::deque<Task> queue_;
+    size_t inFlight_;
+    bool done_;
+
+    std::exception_ptr error_;
+
+    /// Only used on the worker thread, or with the worker idle
+    Key selectedIndex_;
+
+    std::thread thread_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -11,11 +11,16 @@
 
 #include "fdb5/database/Archiver.h"
 
+#include <algorithm>
+
 #include "eckit/config/Resource.h"
 
 #include "fdb5/LibFdb5.h"
+#include "fdb5/database/ArchiveBatch.h"
 #include "fdb5/database/ArchiveVisitor.h"
+#include "fdb5/database/ArchiveWorker.h"
 #include "fdb5/database/BaseArchiveVisitor.h"
+#include "fdb5/database/FlushCoordinator.h"
 #include "fdb5/rules/Schema.h"
 #include "fdb5/rules/Rule.h"
 
@@ -24,28 +29,150 @@ namespace fdb5 {
 //----------------------------------------------------------------------------------------------------------------------
 
 
+static bool pipelineByDefault() {
+    static bool fdbArchivePipeline = eckit::Resource<bool>("fdbArchivePipeline;$FDB_ARCHIVE_PIPELINE", false);
+    return fdbArchivePipeline;
+}
+
 Archiver::Archiver(const Config& dbConfig) :
     dbConfig_(dbConfig),
-    current_(nullptr) {
+    current_(nullptr),
+    pipelined_(dbConfig_.userConfig().getBool("archivePipeline", pipelineByDefault())),
+    currentWorker_(nullptr) {
 }
 
 Archiver::~Archiver() {
 
     flush(); // certify that all sessions are flushed before closing them
 
+    workers_.clear(); //< workers reference the DBs, so stop them first
     databases_.clear(); //< explicitly delete the DBs before schemas are destroyed
 }
 
 void Archiver::archive(const Key &key, const void* data, size_t len) {
+
+    if (pipelined_) {
+        PipelinedArchiveVisitor visitor(*this, key, data, len);
+
+        visitor.rule(nullptr);
+
+        dbConfig_.schema().expand(key, visitor);
+
+        if (visitor.rule() == nullptr) { // Make sure we did find a rule that matched
+            std::ostringstream oss;
+            oss << "FDB: Could not find a rule to archive " << key;
+            throw eckit::SeriousBug(oss.str());
+        }
+        return;
+    }
+
     ArchiveVisitor visitor(*this, key, data, len);
     archive(key, visitor);
 }
 
+void Archiver::archive(const ArchiveBatch& batch) {
+
+    // The workers already separate the fields by DB, and select each index only when it changes
+
+    if (pipelined_) {
+        for (const ArchiveBatch::Element& e : batch) {
+            archive(e.key_, e.data_, e.length_);
+        }
+        return;
+    }
+
+    // Expand the schema for every field first, without writing anything
+
+    BatchArchiveVisitor::Routing routing;
+    routing.routes_.reserve(batch.size());
+
+    prev_.clear();
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+
+        BatchArchiveVisitor visitor(*this, batch[i].key_, i, routing);
+        visitor.rule(nullptr);
+
+        dbConfig_.schema().expand(batch[i].key_, visitor);
+
+        if (visitor.rule() == nullptr) { // Make sure we did find a rule that matched
+            prev_.clear();
+            std::ostringstream oss;
+            oss << "FDB: Could not find a rule to archive " << batch[i].key_;
+            throw eckit::SeriousBug(oss.str());
+        }
+    }
+
+    // Then write the fields grouped by DB and index, so each is selected once and the data of an index is
+    // appended contiguously. The entries go in the order of the index. A stable sort ensures that if a key
+    // appears more than once in the batch, the last one wins.
+
+    std::vector<BatchArchiveVisitor::Route>& routes(routing.routes_);
+
+    std::stable_sort(routes.begin(), routes.end(),
+                     [](const BatchArchiveVisitor::Route& a, const BatchArchiveVisitor::Route& b) {
+                         if (a.db_ != b.db_) return a.db_ < b.db_;
+                         if (a.index_ != b.index_) return a.index_ < b.index_;
+                         return a.datumString_ < b.datumString_;
+                     });
+
+    // The selections made on the DBs no longer match those cached by the visitors
+
+    prev_.clear();
+    current_ = nullptr;
+
+    DB* db = nullptr;
+    const BatchArchiveVisitor::Route* group = nullptr;
+
+    for (const BatchArchiveVisitor::Route& route : routes) {
+
+        if (!group || route.db_ != group->db_) {
+            db = &database(route.db_);
+            db->deselectIndex();
+            group = nullptr;
+        }
+
+        if (!group || route.index_ != group->index_) {
+            db->deselectIndex();
+            db->selectIndex(route.index_);
+            group = &route;
+        }
+
+        const ArchiveBatch::Element& e(batch[route.element_]);
+        db->archive(route.datum_, e.data_, e.length_);
+    }
+
+    if (db) {
+        db->deselectIndex();
+    }
+}
+
 void Archiver::archive(const Key &key, BaseArchiveVisitor& visitor) {
 
+    // Generic visitors act on the DBs directly, so the workers must be idle. The selections cached in prev_ refer
+    // to the pipelined state, so start from scratch on the way in and on the way out. n.b. the visitor has already
+    // sized prev_, so the entries are reset rather than removed.
+
+    if (pipelined_) {
+        waitForWorkers();
+        prev_.assign(3, Key());
+        current_ = nullptr;
+    }
+
     visitor.rule(nullptr);
 
-    dbConfig_.schema().expand(key, visitor);
+    try {
+        dbConfig_.schema().expand(key, visitor);
+    } catch (...) {
+        if (pipelined_) {
+            resetWorkerSelections();
+        }
+        throw;
+    }
+
+    if (pipelined_) {
+        resetWorkerSelections();
+    }
 
     if (visitor.rule() == nullptr) { // Make sure we did find a rule that matched
         std::ostringstream oss;
@@ -55,11 +182,78 @@ void Archiver::archive(const Key &key, BaseArchiveVisitor& visitor) {
 }
 
 void Archiver::flush() {
+
+    if (pipelined_) {
+
+        // Queue the flushes behind the outstanding fields, so the DBs flush concurrently, then wait for
+        // all of them before reporting the first error encountered.
+
+        for (workers_t::iterator i = workers_.begin(); i != workers_.end(); ++i) {
+            i->second->flush();
+        }
+        waitForWorkers();
+        return;
+    }
+
+    std::vector<DB*> dbs;
+    dbs.reserve(databases_.size());
     for (store_t::iterator i = databases_.begin(); i != databases_.end(); ++i) {
-        i->second.second->flush();
+        dbs.push_back(i->second.second.get());
+    }
+
+    FlushCoordinator::flush(dbs);
+}
+
+void Archiver::resetWorkerSelections() {
+
+    // The visitor may have changed the index selected on any of the DBs
+
+    prev_.assign(3, Key());
+    currentWorker_ = nullptr;
+
+    for (workers_t::iterator i = workers_.begin(); i != workers_.end(); ++i) {
+        i->second->deselectIndex();
     }
 }
 
+void Archiver::waitForWorkers() {
+
+    std::exception_ptr error;
+
+    for (workers_t::iterator i = workers_.begin(); i != workers_.end(); ++i) {
+        try {
+            i->second->wait();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+ArchiveWorker& Archiver::worker(const Key &key) {
+
+    ASSERT(pipelined_);
+
+    DB& db = database(key);
+
+    workers_t::iterator i = workers_.find(key);
+    if (i != workers_.end()) {
+        return *(i->second);
+    }
+
+    static size_t fdbArchivePipelineQueueLength = eckit::Resource<size_t>("fdbArchivePipelineQueueLength", 64);
+
+    std::unique_ptr<ArchiveWorker> w(new ArchiveWorker(db, fdbArchivePipelineQueueLength));
+    ArchiveWorker& out = *w;
+    workers_[key] = std::move(w);
+    return out;
+}
+
 
 DB& Archiver::database(const Key &key) {
 
@@ -86,6 +280,14 @@ DB& Archiver::database(const Key &key) {
         }
         if (found) {
             eckit::Log::info() << "Closing database " << *databases_[oldK].second << std::endl;
+            workers_t::iterator w = workers_.find(oldK);
+            if (w != workers_.end()) {
+                w->second->wait();
+                if (currentWorker_ == w->second.get()) {
+                    currentWorker_ = nullptr;
+                }
+                workers_.erase(w);
+            }
             databases_.erase(oldK);
         }
     }
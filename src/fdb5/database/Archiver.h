@@ -33,7 +33,10 @@ class MarsTask;
 namespace fdb5 {
 
 class Key;
+class ArchiveBatch;
+class ArchiveWorker;
 class BaseArchiveVisitor;
+class PipelinedArchiveVisitor;
 class Schema;
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -49,8 +52,13 @@ public: // methods
     void archive(const Key &key, BaseArchiveVisitor& visitor);
     void archive(const Key &key, const void* data, size_t len);
 
+    /// Routes all the fields first, then writes them grouped by DB and index, in index order
+    void archive(const ArchiveBatch& batch);
+
     /// Flushes all buffers and closes all data handles into a consistent DB state
     /// @note always safe to call
+    /// @note in pipelined mode this is the barrier: it returns once every field archived so far has been written
+    ///       and flushed by the worker of its DB, and rethrows any error those workers encountered
     void flush();
 
     friend std::ostream &operator<<(std::ostream &s, const Archiver &x) {
@@ -64,11 +72,23 @@ private: // methods
 
     DB& database(const Key &key);
 
+    /// Pipelined mode only. Returns the worker owning the DB for this key, starting it if needed.
+    ArchiveWorker& worker(const Key &key);
+
+    /// Pipelined mode only. Waits until all workers are idle.
+    void waitForWorkers();
+
+    /// Pipelined mode only, with the workers idle. Forgets the DB and index selections made through the workers,
+    /// after a generic visitor has acted on the DBs directly.
+    void resetWorkerSelections();
+
 private: // members
 
     friend class BaseArchiveVisitor;
+    friend class PipelinedArchiveVisitor;
 
     typedef std::map< Key, std::pair<time_t, std::unique_ptr<DB> > > store_t;
+    typedef std::map< Key, std::unique_ptr<ArchiveWorker> > workers_t;
 
     Config dbConfig_;
 
@@ -77,6 +97,14 @@ private: // members
     std::vector<Key> prev_;
 
     DB* current_;
+
+    /// If set, fields are routed on the caller's thread and written by one ArchiveWorker per DB
+    bool pipelined_;
+
+    workers_t workers_;
+
+    ArchiveWorker* currentWorker_;
+    Key currentIndexKey_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,115 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/serialisation/Stream.h"
+
+#include "fdb5/database/BloomFilter.h"
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// FNV-1a, followed by a 64-bit finaliser so that both halves are usable for double hashing
+uint64_t fnv1a(const std::string& s) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}
+
+BloomFilter::BloomFilter() :
+    numHashes_(0) {}
+
+BloomFilter::BloomFilter(const std::vector<uint64_t>& hashes, size_t bitsPerKey, size_t maxBytes) :
+    numHashes_(0) {
+
+    if (hashes.empty() || bitsPerKey == 0) {
+        return;
+    }
+
+    size_t nbits = std::max<size_t>(64, hashes.size() * bitsPerKey);
+    if ((nbits + 7) / 8 > maxBytes) {
+        return;
+    }
+
+    // The number of hashes that minimises the false positive rate is bitsPerKey * ln(2)
+
+    numHashes_ = std::max(1UL, std::min(16UL, static_cast<unsigned long>(std::lround(bitsPerKey * 0.69))));
+
+    bits_.assign((nbits + 7) / 8, '\0');
+    nbits = bits_.size() * 8;
+
+    for (uint64_t h : hashes) {
+        uint64_t h1 = h;
+        uint64_t h2 = (h >> 32) | (h << 32);
+        for (unsigned long i = 0; i < numHashes_; ++i) {
+            uint64_t bit = (h1 + i * h2) % nbits;
+            bits_[bit >> 3] |= char(1 << (bit & 7));
+        }
+    }
+}
+
+uint64_t BloomFilter::hash(const Key& key) {
+    return fnv1a(key.valuesToString());
+}
+
+bool BloomFilter::mayContain(uint64_t h) const {
+
+    if (bits_.empty()) {
+        return true;
+    }
+
+    const uint64_t nbits = bits_.size() * 8;
+    uint64_t h1 = h;
+    uint64_t h2 = (h >> 32) | (h << 32);
+    for (unsigned long i = 0; i < numHashes_; ++i) {
+        uint64_t bit = (h1 + i * h2) % nbits;
+        if (!(bits_[bit >> 3] & char(1 << (bit & 7)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BloomFilter::encode(eckit::Stream& s) const {
+    s << numHashes_;
+    s << bits_;
+}
+
+void BloomFilter::decode(eckit::Stream& s) {
+    s >> numHashes_;
+    s >> bits_;
+    ASSERT(bits_.empty() || numHashes_ > 0);
+}
+
+void BloomFilter::print(std::ostream& out) const {
+    out << "BloomFilter[hashes=" << numHashes_ << ",size=" << eckit::Bytes(bits_.size()) << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,77 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   BloomFilter.h
+/// @date   Oct 2026
+
+#ifndef fdb5_BloomFilter_H
+#define fdb5_BloomFilter_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace eckit {
+class Stream;
+}
+
+namespace fdb5 {
+
+class Key;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Bloom filter over the full keys of the fields of an index, so that lookups for keys that are not in the index
+/// can mostly be answered without reading the B-tree.
+///
+/// The filter is persisted, so keys are hashed with a hash that is fixed here (rather than std::hash) over their
+/// canonical values, as used for the B-tree keys.
+
+class BloomFilter {
+
+public: // methods
+
+    BloomFilter();
+
+    /// Sized for the given hashes, at bitsPerKey bits per key. Left empty (so that it is neither used nor
+    /// persisted) if it would take more than maxBytes.
+    BloomFilter(const std::vector<uint64_t>& hashes, size_t bitsPerKey, size_t maxBytes);
+
+    static uint64_t hash(const Key& key);
+
+    bool empty() const { return bits_.empty(); }
+
+    /// False if the key was certainly not added. Always true if the filter is empty.
+    bool mayContain(uint64_t hash) const;
+
+    size_t footprint() const { return bits_.size(); }
+
+    void encode(eckit::Stream& s) const;
+    void decode(eckit::Stream& s);
+
+    void print(std::ostream& out) const;
+
+    friend std::ostream& operator<<(std::ostream& s, const BloomFilter& f) {
+        f.print(s);
+        return s;
+    }
+
+private: // members
+
+    std::string bits_;
+    unsigned long numHashes_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -116,6 +116,15 @@ private: // members
 
 class CatalogueReader {
 public:
+    /// Bring the catalogue up to date with anything appended since it was loaded, if this can be done
+    /// cheaply. Returns false if it cannot, e.g. as the catalogue was truncated, rewritten or removed, or
+    /// indexes were masked, in which case the catalogue must be loaded afresh.
+    virtual bool refresh() { return false; }
+    /// True if the catalogue has changed on disk since it was loaded (or refreshed). Must be cheap, as it is
+    /// checked each time a cached reader is reused.
+    virtual bool modified() const { return false; }
+    /// Approximate memory held by the loaded catalogue
+    virtual size_t footprint() const { return 0; }
     virtual DbStats stats() const = 0;
     virtual bool axis(const std::string& keyword, eckit::StringSet& s) const = 0;
     virtual bool retrieve(const Key& key, Field& field) const = 0;
@@ -110,6 +110,17 @@ void DB::archive(const Key& key, const void* data, eckit::Length length) {
 
     const Index& idx = cat->currentIndex();
     cat->archive(key, store().archive(idx.key(), data, length));
+
+    if (Metrics::enabled()) {
+        if (!dbMetrics_) {
+            dbMetrics_ = Metrics::instance().database(this->key());
+            storeMetrics_ = &Metrics::instance().store(store().type());
+        }
+        ++dbMetrics_->fields_;
+        dbMetrics_->bytes_ += length;
+        ++storeMetrics_->fields_;
+        storeMetrics_->bytes_ += length;
+    }
 }
 
 bool DB::open() {
@@ -120,10 +131,44 @@ bool DB::open() {
     return store().open();
 }
 
+bool DB::refresh() {
+    CatalogueReader* cat = dynamic_cast<CatalogueReader*>(catalogue_.get());
+    ASSERT(cat);
+
+    return cat->refresh();
+}
+
+bool DB::modified() const {
+    CatalogueReader* cat = dynamic_cast<CatalogueReader*>(catalogue_.get());
+    ASSERT(cat);
+
+    return cat->modified();
+}
+
+size_t DB::footprint() const {
+    CatalogueReader* cat = dynamic_cast<CatalogueReader*>(catalogue_.get());
+    ASSERT(cat);
+
+    return cat->footprint();
+}
+
 void DB::flush() {
+    flushStore();
+    flushCatalogue();
+}
+
+void DB::flushStore() {
     if (store_ != nullptr)
         store_->flush();
+}
+
+void DB::flushCatalogue() {
     catalogue_->flush();
+
+    if (dbMetrics_) {
+        ++dbMetrics_->flushes_;
+        ++storeMetrics_->flushes_;
+    }
 }
 
 void DB::close() {
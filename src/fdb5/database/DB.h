@@ -18,6 +18,7 @@
 
 #include "eckit/types/Types.h"
 
+#include "fdb5/api/Metrics.h"
 #include "fdb5/config/Config.h"
 #include "fdb5/database/Catalogue.h"
 #include "fdb5/database/EntryVisitMechanism.h"
@@ -62,6 +63,18 @@ public: // methods
     void flush();
     void close();
 
+    /// The two halves of flush(), for flushing several DBs together (see FlushCoordinator).
+    /// n.b. the catalogue may only be flushed once the data it refers to has been
+    void flushStore();
+    void flushCatalogue();
+
+    /// For readers held open for a long time. See CatalogueReader::refresh()
+    bool refresh();
+
+    /// See CatalogueReader::modified() and CatalogueReader::footprint()
+    bool modified() const;
+    size_t footprint() const;
+
     bool exists() const;
 
     void dump(std::ostream& out, bool simple=false, const eckit::Configuration& conf = eckit::LocalConfiguration()) const;
@@ -99,6 +112,10 @@ private: // members
 
     std::unique_ptr<Catalogue> catalogue_;
     mutable std::unique_ptr<Store> store_ = nullptr;
+
+    /// See Metrics. Looked up on first use.
+    std::shared_ptr<Metrics::Counters> dbMetrics_;
+    Metrics::Counters* storeMetrics_ = nullptr;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
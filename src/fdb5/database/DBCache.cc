@@ -0,0 +1,141 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/api/FDBStats.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/DBCache.h"
+#include "fdb5/database/Engine.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/database/Manager.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+DBCache& DBCache::instance() {
+    // Never destroyed: closing the cached DBs during static destruction would depend on the order in which the
+    // libraries' statics (logging, configuration) are torn down.
+    static DBCache* cache =
+        new DBCache(eckit::Resource<size_t>("fdbCatalogueCacheMemory;$FDB_CATALOGUE_CACHE_MEMORY", 512 * 1024 * 1024),
+                    eckit::Resource<size_t>("fdbMaxOpenDatabases", 16));
+    return *cache;
+}
+
+DBCache::DBCache(size_t maxMemory, size_t maxDatabases) :
+    footprint_(0),
+    maxMemory_(maxMemory),
+    maxDatabases_(maxDatabases) {}
+
+DBCache::~DBCache() {}
+
+eckit::URI DBCache::location(const Key& key, const Config& config) {
+    return Engine::backend(Manager(config).engine(key)).location(key, config);
+}
+
+std::unique_ptr<DB> DBCache::checkout(const eckit::URI& location, FDBStats& stats) {
+
+    std::unique_ptr<DB> db;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = index_.find(location.asString());
+        if (it != index_.end()) {
+            LRU::iterator e = it->second;
+            index_.erase(it);
+            db = std::move(e->db_);
+            footprint_ -= e->footprint_;
+            lru_.erase(e);
+        }
+    }
+
+    if (!db) {
+        stats.addCatalogueCacheMiss();
+        return db;
+    }
+
+    if (db->modified()) {
+        if (!db->refresh()) {
+            eckit::Log::debug<LibFdb5>() << "DBCache: " << location << " cannot be refreshed, reloading" << std::endl;
+            stats.addCatalogueCacheInvalidation();
+            stats.addCatalogueCacheMiss();
+            return nullptr;
+        }
+        eckit::Log::debug<LibFdb5>() << "DBCache: " << location << " refreshed" << std::endl;
+        stats.addCatalogueCacheRefresh();
+    }
+
+    stats.addCatalogueCacheHit();
+    return db;
+}
+
+void DBCache::checkin(std::unique_ptr<DB> db, FDBStats& stats) {
+
+    ASSERT(db);
+
+    if (maxMemory_ == 0 || maxDatabases_ == 0) {
+        return;
+    }
+
+    size_t footprint = db->footprint();
+    std::string location = db->uri().asString();
+
+    std::list<Entry> evicted;
+    size_t held;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        lru_.push_front(Entry{location, std::move(db), footprint});
+        index_.emplace(location, lru_.begin());
+        footprint_ += footprint;
+
+        evicted = evict();
+        held = footprint_;
+    }
+
+    if (!evicted.empty()) {
+        eckit::Log::debug<LibFdb5>() << "DBCache: evicted " << evicted.size() << " DB(s), now holding "
+                                     << eckit::Bytes(held) << std::endl;
+        stats.addCatalogueCacheEvictions(evicted.size());
+    }
+}
+
+std::list<DBCache::Entry> DBCache::evict() {
+
+    std::list<Entry> evicted;
+
+    while (!lru_.empty() && (footprint_ > maxMemory_ || lru_.size() > maxDatabases_)) {
+
+        LRU::iterator e = std::prev(lru_.end());
+
+        auto range = index_.equal_range(e->location_);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == e) {
+                index_.erase(it);
+                break;
+            }
+        }
+
+        footprint_ -= e->footprint_;
+        evicted.splice(evicted.end(), lru_, e);
+    }
+
+    return evicted;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
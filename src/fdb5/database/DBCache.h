@@ -0,0 +1,102 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   DBCache.h
+/// @date   Oct 2026
+
+#ifndef fdb5_DBCache_H
+#define fdb5_DBCache_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "eckit/filesystem/URI.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace fdb5 {
+
+class Config;
+class DB;
+class FDBStats;
+class Key;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Process wide cache of opened reader DBs, so that the catalogues are not loaded again by each FDB (and each
+/// client of the fdb-server) reading the same DBs.
+///
+/// DBs are identified by their location, so that readers with different configurations that resolve to the same
+/// DB share it. A DB is not thread safe, so a reader checks a DB out of the cache for as long as it uses it, and
+/// checks it back in afterwards. Two readers using the same DB at once each get their own.
+///
+/// An idle DB whose catalogue has changed on disk since it was loaded (see CatalogueReader::modified()) is
+/// refreshed as it is handed out, which for a DB being appended to is much cheaper than reloading it. It is only
+/// dropped if it cannot be refreshed, as when its TOC was truncated, rewritten or removed, or indexes masked (see
+/// CatalogueReader::refresh()).
+///
+/// The idle DBs are bounded by the memory held by their catalogues (fdbCatalogueCacheMemory, 0 disables the
+/// cache) and, as each holds its index files open, by number (fdbMaxOpenDatabases, as for the open DBs of
+/// each reader before). The least recently used are evicted first.
+
+class DBCache : private eckit::NonCopyable {
+
+public: // methods
+
+    static DBCache& instance();
+
+    /// A cache of its own, with the given limits, as for testing. The process wide instance takes its limits
+    /// from the resources above.
+    DBCache(size_t maxMemory, size_t maxDatabases);
+    ~DBCache();
+
+    /// Where the DB of the key is found with the given configuration
+    static eckit::URI location(const Key& key, const Config& config);
+
+    /// @returns an opened reader for the DB at the location, or null if there is none to reuse
+    std::unique_ptr<DB> checkout(const eckit::URI& location, FDBStats& stats);
+
+    void checkin(std::unique_ptr<DB> db, FDBStats& stats);
+
+private: // types
+
+    struct Entry {
+        std::string location_;
+        std::unique_ptr<DB> db_;
+        size_t footprint_;
+    };
+
+    typedef std::list<Entry> LRU;
+
+private: // methods
+
+    /// n.b. must be called with mutex_ held. Returns the entries to be destroyed once the lock is released.
+    std::list<Entry> evict();
+
+private: // members
+
+    std::mutex mutex_;
+
+    LRU lru_; ///< most recently used first
+    std::multimap<std::string, LRU::iterator> index_; ///< by location
+
+    size_t footprint_;
+
+    size_t maxMemory_;
+    size_t maxDatabases_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
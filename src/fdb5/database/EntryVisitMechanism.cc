@@ -10,6 +10,14 @@
 
 #include "fdb5/database/EntryVisitMechanism.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "eckit/config/Resource.h"
 #include "eckit/io/AutoCloser.h"
 
 #include "fdb5/api/helpers/FDBToolRequest.h"
@@ -90,30 +98,41 @@ void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& vis
 
     try {
 
-        std::vector<URI> uris(Manager(dbConfig_).visitableLocations(request.request(), request.all()));
+        std::vector<URI> uris(locations(request));
 
         // n.b. it is not an error if nothing is found (especially in a sub-fdb).
 
         // And do the visitation
 
-        for (URI uri : uris) {
+        for (const URI& uri : uris) {
+            visit(uri, visitor);
+        }
 
-            PathName path(uri.path());
-            if (path.exists()) {
-                if (!path.isDir())
-                    path = path.dirName();
-                path = path.realName();
+    } catch (eckit::UserError&) {
+        throw;
+    } catch (eckit::Exception& e) {
+        Log::warning() << e.what() << std::endl;
+        if (fail_) throw;
+    }
+}
 
-                Log::debug<LibFdb5>() << "FDB processing Path " << path << std::endl;
+void EntryVisitMechanism::visit(const FDBToolRequest& request,
+                                size_t threads,
+                                const std::function<std::unique_ptr<EntryVisitor>()>& makeVisitor,
+                                const std::function<void(EntryVisitor&)>& complete,
+                                const std::function<void(EntryVisitor&)>& collect) {
 
-                std::unique_ptr<DB> db = DB::buildReader(eckit::URI(uri.scheme(), path), dbConfig_);
-                ASSERT(db->open());
-                eckit::AutoCloser<DB> closer(*db);
+    std::shared_ptr<EntryVisitor> first(makeVisitor());
 
-                db->visitEntries(visitor, false);
-            }
-        }
+    if (first->visitEntries() && !first->visitIndexes()) {
+        throw FDBVisitException("Cannot visit entries without visiting indexes", Here());
+    }
 
+    ASSERT(request.all() == request.request().empty());
+
+    std::vector<URI> uris;
+    try {
+        uris = locations(request);
     } catch (eckit::UserError&) {
         throw;
     } catch (eckit::Exception& e) {
@@ -121,10 +140,153 @@ void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& vis
         if (fail_) throw;
     }
 
+    // The visitor of each DB is made as it is started, and released once both visited and collected, so that
+    // only the DBs being visited or waiting to be collected have one. Each is shared by the worker visiting
+    // it and the collector, and whichever finishes with it last destroys it.
+    //
+    // The DBs are started in order, so the DB whose output is being collected is always either being visited
+    // or done, even if the visitors of later DBs are held up waiting for their output to be collected. No DB
+    // is started more than window DBs ahead of the one being collected, so that the output of DBs visited
+    // ahead does not pile up.
+
+    struct Slot {
+        std::shared_ptr<EntryVisitor> visitor;
+        bool ready = false;
+    };
+
+    const size_t window = 2 * threads;
+
+    std::vector<Slot> slots(uris.size());
+    size_t collected = 0;
+    std::atomic<size_t> next(0);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        size_t i;
+        while ((i = next++) < uris.size()) {
+
+            std::shared_ptr<EntryVisitor> visitor;
+            bool skip;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return i < collected + window; });
+                skip = bool(error);
+                if (i == 0) {
+                    visitor = std::move(first);
+                }
+            }
+
+            if (!skip) {
+                try {
+                    if (!visitor) visitor.reset(makeVisitor().release());
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) error = std::current_exception();
+                    skip = true;
+                }
+            }
+
+            if (visitor) {
+                std::lock_guard<std::mutex> lock(mutex);
+                slots[i].visitor = visitor;
+            }
 
+            if (!skip) {
+                try {
+                    visit(uris[i], *visitor);
+                } catch (eckit::UserError&) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) error = std::current_exception();
+                } catch (eckit::Exception& e) {
+                    Log::warning() << e.what() << std::endl;
+                    if (fail_) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!error) error = std::current_exception();
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) error = std::current_exception();
+                }
+            }
 
+            if (visitor) complete(*visitor);
 
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slots[i].ready = true;
+            }
+            cv.notify_all();
+        }
+    };
 
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < std::min(threads, uris.size()); ++t) {
+        pool.emplace_back(worker);
+    }
+
+    // Even if collecting fails, carry on with the remaining visitors so that no worker is left waiting on them
+
+    std::exception_ptr collectError;
+    for (size_t i = 0; i < uris.size(); ++i) {
+        std::shared_ptr<EntryVisitor> visitor;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return slots[i].visitor || slots[i].ready; });
+            visitor = slots[i].visitor;
+        }
+
+        if (visitor) {
+            try {
+                collect(*visitor);
+            } catch (...) {
+                if (!collectError) collectError = std::current_exception();
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return slots[i].ready; });
+            slots[i].visitor.reset();
+            ++collected;
+        }
+        cv.notify_all();
+    }
+
+    for (std::thread& t : pool) {
+        t.join();
+    }
+
+    if (collectError) std::rethrow_exception(collectError);
+    if (error) std::rethrow_exception(error);
+}
+
+size_t EntryVisitMechanism::threads(const Config& config) {
+    static long fdbVisitThreads = eckit::Resource<long>("fdbVisitThreads;$FDB_VISIT_THREADS", 1);
+    return std::max(1L, config.userConfig().getLong("visitThreads", fdbVisitThreads));
+}
+
+std::vector<URI> EntryVisitMechanism::locations(const FDBToolRequest& request) const {
+    return Manager(dbConfig_).visitableLocations(request.request(), request.all());
+}
+
+void EntryVisitMechanism::visit(const URI& uri, EntryVisitor& visitor) {
+
+    PathName path(uri.path());
+    if (path.exists()) {
+        if (!path.isDir())
+            path = path.dirName();
+        path = path.realName();
+
+        Log::debug<LibFdb5>() << "FDB processing Path " << path << std::endl;
+
+        std::unique_ptr<DB> db = DB::buildReader(eckit::URI(uri.scheme(), path), dbConfig_);
+        ASSERT(db->open());
+        eckit::AutoCloser<DB> closer(*db);
+
+        db->visitEntries(visitor, false);
+    }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -14,6 +14,11 @@
 #ifndef fdb5_EntryVisitMechanism_H
 #define fdb5_EntryVisitMechanism_H
 
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "eckit/filesystem/URI.h"
 #include "eckit/memory/NonCopyable.h"
 
 #include "fdb5/config/Config.h"
@@ -45,6 +50,10 @@ public:  // methods
     virtual void catalogueComplete(const Catalogue& catalogue);
     virtual void visitDatum(const Field& field, const std::string& keyFingerprint);
 
+    /// Whether an index is worth reading ahead of its visit. May be called from another thread, before
+    /// visitIndex(), so must not depend on the state of the visit.
+    virtual bool preloadIndex(const Index& index) const { return true; }
+
     time_t indexTimestamp() const;
 
 private: // methods
@@ -69,6 +78,27 @@ public:  // methods
 
     void visit(const FDBToolRequest& request, EntryVisitor& visitor);
 
+    /// Visit the DBs on up to the given number of threads, each DB with its own visitor from makeVisitor(). The
+    /// visitors are made as the DBs are started, on the threads that visit them, and destroyed once collected.
+    /// Once a DB has been visited (or has failed), complete() is called on its visitor, on the thread that visited
+    /// it. collect() is called on the calling thread with each visitor in turn, in the order in which visit()
+    /// would have visited the DBs, so that it can pass on their output whilst the visit goes on.
+    void visit(const FDBToolRequest& request,
+               size_t threads,
+               const std::function<std::unique_ptr<EntryVisitor>()>& makeVisitor,
+               const std::function<void(EntryVisitor&)>& complete,
+               const std::function<void(EntryVisitor&)>& collect);
+
+    /// The number of threads to visit DBs on. From the user config (visitThreads) or fdbVisitThreads. The indexes
+    /// of each DB are read ahead on up to as many threads again, bounded in total by fdbVisitReadAheadThreads.
+    static size_t threads(const Config& config);
+
+private:  // methods
+
+    std::vector<eckit::URI> locations(const FDBToolRequest& request) const;
+
+    void visit(const eckit::URI& uri, EntryVisitor& visitor);
+
 private:  // members
 
     const Config& dbConfig_;
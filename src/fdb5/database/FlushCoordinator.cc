@@ -0,0 +1,139 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <system_error>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+
+#include "fdb5/database/DB.h"
+#include "fdb5/database/FlushCoordinator.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+size_t FlushCoordinator::threads() {
+    static size_t fdbFlushThreads = std::max(size_t(1), eckit::Resource<size_t>("fdbFlushThreads;$FDB_FLUSH_THREADS", 8));
+    return fdbFlushThreads;
+}
+
+/// The threads started by run() that are still running, across the process. However the runs are nested, no more
+/// than fdbFlushThreads - 1 threads are added to those calling run().
+static std::atomic<size_t> started(0);
+
+/// @returns how many of the wanted threads may be started
+static size_t reserveThreads(size_t wanted) {
+    size_t limit = FlushCoordinator::threads() - 1;
+    size_t current = started.load();
+    size_t n;
+    do {
+        n = std::min(wanted, limit - std::min(limit, current));
+    } while (n && !started.compare_exchange_weak(current, current + n));
+    return n;
+}
+
+void FlushCoordinator::run(size_t n, const std::function<void(size_t)>& task) {
+
+    std::vector<std::exception_ptr> errors(n);
+
+    std::atomic<size_t> next(0);
+
+    auto worker = [&] {
+        size_t i;
+        while ((i = next++) < n) {
+            try {
+                task(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    size_t extra = (n > 1) ? reserveThreads(n - 1) : 0;
+
+    std::vector<std::future<void>> futures;
+    try {
+        for (size_t i = 0; i < extra; ++i) {
+            futures.emplace_back(std::async(std::launch::async, worker));
+        }
+    } catch (std::system_error&) {
+        // Short of threads, this one does the rest
+        started -= extra - futures.size();
+        extra = futures.size();
+    }
+
+    worker();
+
+    for (std::future<void>& f : futures) {
+        f.get();
+    }
+    started -= extra;
+
+    for (const std::exception_ptr& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+void FlushCoordinator::flush(const std::vector<DB*>& dbs) {
+    flush(dbs.size(), [&dbs](size_t i) { dbs[i]->flushStore(); }, [&dbs](size_t i) { dbs[i]->flushCatalogue(); });
+}
+
+void FlushCoordinator::flush(size_t n, const std::function<void(size_t)>& flushStore,
+                             const std::function<void(size_t)>& flushCatalogue) {
+
+    std::vector<std::exception_ptr> errors(n);
+
+    // Phase 1: the data
+
+    run(n, [&](size_t i) {
+        try {
+            flushStore(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+
+    // Phase 2: the catalogues referring to it
+
+    std::vector<size_t> synced;
+    for (size_t i = 0; i < n; ++i) {
+        if (!errors[i]) {
+            synced.push_back(i);
+        }
+    }
+
+    std::exception_ptr error;
+    try {
+        run(synced.size(), [&](size_t i) { flushCatalogue(synced[i]); });
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    for (const std::exception_ptr& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
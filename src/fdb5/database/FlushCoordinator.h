@@ -0,0 +1,58 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   FlushCoordinator.h
+/// @date   Oct 2026
+
+#ifndef fdb5_FlushCoordinator_H
+#define fdb5_FlushCoordinator_H
+
+#include <functional>
+#include <vector>
+
+namespace fdb5 {
+
+class DB;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Flushes several DBs (or data files) together, so that the time spent waiting for the disks is that of the
+/// slowest sync rather than the sum of them all.
+///
+/// The data of a DB must be on disk before its catalogue refers to it, so the DBs are flushed in two phases: first
+/// the stores of all of them, then the catalogues of those whose data was flushed successfully. A DB whose store
+/// failed to flush is left in the state of its last successful flush.
+///
+/// Up to fdbFlushThreads ($FDB_FLUSH_THREADS) are used at each phase, 1 flushes one after the other. The threads
+/// are shared by the whole process, so that the flush of each store, which may itself run() the flushes of its data
+/// files, only gets the threads that the other DBs are not using.
+
+class FlushCoordinator {
+
+public: // methods
+
+    static void flush(const std::vector<DB*>& dbs);
+
+    /// As flush(), with the stores and catalogues of the n DBs flushed by the functions given
+    static void flush(size_t n, const std::function<void(size_t)>& flushStore,
+                      const std::function<void(size_t)>& flushCatalogue);
+
+    /// Runs task(i) for each i in [0, n), on the calling thread and on as many others as are free. All the tasks
+    /// are run, even if some fail, and the first error is rethrown once they are all done.
+    static void run(size_t n, const std::function<void(size_t)>& task);
+
+    static size_t threads();
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -8,6 +8,8 @@
  * does it submit to any jurisdiction.
  */
 
+#include "eckit/config/Resource.h"
+
 #include "fdb5/LibFdb5.h"
 #include "fdb5/database/Index.h"
 #include "fdb5/rules/Schema.h"
@@ -28,7 +30,8 @@ enum IndexBaseStreamKeys {
     IndexKeyUnrecognised,
     IndexKey,
     IndexType,
-    IndexTimestamp
+    IndexTimestamp,
+    IndexBloomFilter
 };
 
 IndexBaseStreamKeys keyId(const std::string& s) {
@@ -36,6 +39,7 @@ IndexBaseStreamKeys keyId(const std::string& s) {
         {"key" , IndexKey},
         {"type", IndexType},
         {"time", IndexTimestamp},
+        {"bloom", IndexBloomFilter},
     };
 
     auto it = keys.find(s);
@@ -65,6 +69,13 @@ void IndexBase::decodeCurrent(eckit::Stream& s, const int version) {
             case IndexTimestamp:
                 s >> timestamp_;
                 break;
+            case IndexBloomFilter:
+                // As read before version 4, so that the filters are never silently ignored
+                if (version < 4) {
+                    throw eckit::SeriousBug("IndexBase de-serialization error: "+k+" field is not recognized");
+                }
+                filter_.decode(s);
+                break;
             default:
                 throw eckit::SeriousBug("IndexBase de-serialization error: "+k+" field is not recognized");
         }
@@ -113,6 +124,10 @@ void IndexBase::encodeCurrent(eckit::Stream& s, const int version) const {
     s << "key" << key_;
     s << "type" << type_;
     s << "time" << timestamp_;
+    if (version >= 4 && !filter_.empty()) {
+        s << "bloom";
+        filter_.encode(s);
+    }
     s.endObject();
 }
 
@@ -125,12 +140,38 @@ void IndexBase::encodeLegacy(eckit::Stream& s, const int version) const {
     s << type_;
 }
 
+/// The filters are only written to the TOC with tocSerialisationVersion 4 or later
+static size_t bloomFilterBitsPerKey() {
+    static size_t bitsPerKey = eckit::Resource<size_t>("fdbIndexBloomFilterBitsPerKey;$FDB_INDEX_BLOOM_FILTER_BITS_PER_KEY", 0);
+    return bitsPerKey;
+}
+
 void IndexBase::put(const Key &key, const Field &field) {
 
     eckit::Log::debug<LibFdb5>() << "FDB Index " << indexer_ << " " << key << " -> " << field << std::endl;
 
     axes_.insert(key);
     add(key, field);
+
+    if (bloomFilterBitsPerKey()) {
+        filterHashes_.push_back(BloomFilter::hash(key));
+    }
+}
+
+void IndexBase::buildFilter() {
+
+    size_t bitsPerKey = bloomFilterBitsPerKey();
+
+    // The filter is written into the TOC record of the index, which must fit in TocRecord::maxPayloadSize
+
+    static size_t maxBytes = eckit::Resource<size_t>("fdbIndexBloomFilterMaxBytes", 512 * 1024);
+
+    filter_ = BloomFilter(filterHashes_, bitsPerKey, maxBytes);
+}
+
+void IndexBase::wipeFilter() {
+    filter_ = BloomFilter();
+    filterHashes_.clear();
 }
 
 bool IndexBase::partialMatch(const metkit::mars::MarsRequest& request) const {
@@ -143,7 +184,10 @@ bool IndexBase::partialMatch(const metkit::mars::MarsRequest& request) const {
 }
 
 bool IndexBase::mayContain(const Key &key) const {
-    return axes_.contains(key);
+    if (!axes_.contains(key)) {
+        return false;
+    }
+    return filter_.empty() || filter_.mayContain(BloomFilter::hash(key));
 }
 
 const Key &IndexBase::key() const {
@@ -24,6 +24,7 @@
 #include "eckit/types/Types.h"
 #include "eckit/memory/Counted.h"
 
+#include "fdb5/database/BloomFilter.h"
 #include "fdb5/database/EntryVisitMechanism.h"
 #include "fdb5/database/Field.h"
 #include "fdb5/database/IndexStats.h"
@@ -68,6 +69,9 @@ public: // methods
     virtual void reopen() = 0;
     virtual void close() = 0;
 
+    /// Open the index, and read it in ahead of visiting its entries
+    virtual void preload() { open(); }
+
     /// Flush and Sync data (for mediums where sync() is required)
     virtual void flush() = 0;
 
@@ -100,6 +104,10 @@ public: // methods
 protected: // methods
     void takeTimestamp() { time(&timestamp_); }
 
+    /// Build the Bloom filter over the keys put so far (if enabled, see fdbIndexBloomFilterBitsPerKey)
+    void buildFilter();
+    void wipeFilter();
+
 private: // methods
 
     void encodeCurrent(eckit::Stream& s, const int version) const;
@@ -121,6 +129,9 @@ protected: // members
 
     Indexer   indexer_;
 
+    BloomFilter           filter_;        ///< only serialised from version 4
+    std::vector<uint64_t> filterHashes_;  ///< of the keys put, until the filter is built
+
     friend std::ostream& operator<<(std::ostream& s, const IndexBase& o) {
         o.print(s); return s;
     }
@@ -149,6 +160,7 @@ public: // methods
     void open()   { return content_->open();   }
     void reopen() { return content_->reopen(); }
     void close()  { return content_->close();  }
+    void preload() { return content_->preload(); }
     void flush()  { return content_->flush();  }
 
     void visit(IndexLocationVisitor& visitor) const { content_->visit(visitor); }
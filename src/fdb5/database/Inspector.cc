@@ -28,34 +28,10 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
-InspectIterator::InspectIterator() : index_(0) {}
-
-InspectIterator::~InspectIterator() {
-    queue_.clear();
-}
-
-void InspectIterator::emplace(ListElement&& elem) {
-    queue_.push_back(elem);
-}
-
-bool InspectIterator::next(ListElement& elem) {
-    if (index_ >= queue_.size())
-        return false;
-    elem = queue_[index_];
-    index_++;
-    return true;
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-static void purgeDB(Key& key, DB*& db) {
-    Log::debug() << "Purging DB with key " << key << std::endl;
-    delete db;
-}
-
 Inspector::Inspector(const Config& dbConfig) :
-    databases_(Resource<size_t>("fdbMaxOpenDatabases", 16), &purgeDB),
-    dbConfig_(dbConfig) {}
+    dbConfig_(dbConfig),
+    stats_(std::make_shared<SharedStats>()),
+    queueSize_(eckit::Resource<size_t>("fdbInspectQueueSize", 100)) {}
 
 Inspector::~Inspector() {
 }
@@ -64,15 +40,27 @@ ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request,
                                 const Schema& schema,
                                 const fdb5::Notifier& notifyee) const {
 
-    InspectIterator* iterator = new InspectIterator();
-    MultiRetrieveVisitor visitor(notifyee, *iterator, databases_, dbConfig_);
-
     Log::debug<LibFdb5>() << "Using schema: " << schema << std::endl;
 
-    schema.expand(request, visitor);
+    // The worker may outlive the Inspector (see inspect() in the header), so it holds its own copy of
+    // the configuration and a share of the stats. The schema belongs to the SchemaRegistry.
+
+    Config config(dbConfig_);
+    std::shared_ptr<SharedStats> shared(stats_);
+
+    auto worker = [config, shared, request, &schema, &notifyee](eckit::Queue<ListElement>& queue) {
+        FDBStats stats;
+        try {
+            MultiRetrieveVisitor visitor(notifyee, queue, config, stats);
+            schema.expand(request, visitor);
+        } catch (...) {
+            shared->add(stats);
+            throw;
+        }
+        shared->add(stats);
+    };
 
-    using QueryIterator = APIIterator<ListElement>;
-    return QueryIterator(iterator);
+    return ListIterator(new ListAsyncIterator(worker, queueSize_));
 }
 
 ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request) const {
@@ -81,7 +69,8 @@ ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request) const
         void notifyWind() const override {}
     };
 
-    return inspect(request, NullNotifier());
+    static const NullNotifier notifyee;
+    return inspect(request, notifyee);
 }
 
 ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request, const Notifier& notifyee) const {
@@ -93,6 +82,16 @@ void Inspector::visitEntries(const FDBToolRequest &request, EntryVisitor &visito
 
 }
 
+FDBStats Inspector::stats() const {
+    std::lock_guard<std::mutex> lock(stats_->mutex_);
+    return stats_->stats_;
+}
+
+void Inspector::SharedStats::add(const FDBStats& stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_ += stats;
+}
+
 void Inspector::print(std::ostream &out) const {
     out << "Inspector[]";
 }
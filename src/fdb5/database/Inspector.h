@@ -19,12 +19,14 @@
 #include <iosfwd>
 #include <cstdlib>
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include "fdb5/config/Config.h"
+#include "fdb5/api/FDBStats.h"
 #include "fdb5/api/helpers/ListIterator.h"
 
 #include "eckit/memory/NonCopyable.h"
-#include "eckit/container/CacheLRU.h"
 #include "eckit/config/LocalConfiguration.h"
 
 namespace eckit {
@@ -48,20 +50,6 @@ class EntryVisitor;
 
 //----------------------------------------------------------------------------------------------------------------------
 
-class InspectIterator : public APIIteratorBase<ListElement> {
-public:
-    InspectIterator();
-    ~InspectIterator();
-
-    void emplace(ListElement&& elem);
-    bool next(ListElement& elem) override;
-private:
-    std::vector<ListElement> queue_;
-    size_t index_;
-};
-
-//----------------------------------------------------------------------------------------------------------------------
-
 class Inspector : public eckit::NonCopyable {
 
 public: // methods
@@ -70,14 +58,15 @@ public: // methods
 
     ~Inspector();
 
-    /// Retrieves the data selected by the MarsRequest to the provided DataHandle
-    /// @returns  data handle to read from
+    /// Lists the fields selected by the MarsRequest. They are looked up on a separate thread, and come out
+    /// of the iterator as they are found (through a bounded queue, see fdbInspectQueueSize). The iterator
+    /// may outlive the Inspector.
 
     ListIterator inspect(const metkit::mars::MarsRequest& request) const;
 
-    /// Retrieves the data selected by the MarsRequest to the provided DataHandle
-    /// @param notifyee is an object that handles notifications for the client, e.g. wind conversion
-    /// @returns  data handle to read from
+    /// As above
+    /// @param notifyee is an object that handles notifications for the client, e.g. wind conversion.
+    ///        It is used until the iterator is exhausted (or destroyed), so must outlive it.
 
     ListIterator inspect(const metkit::mars::MarsRequest& request, const Notifier& notifyee) const;
 
@@ -85,6 +74,9 @@ public: // methods
 
     void visitEntries(const FDBToolRequest& request, EntryVisitor& visitor) const;
 
+    /// The use made of the (process wide) DBCache by this Inspector
+    FDBStats stats() const;
+
     friend std::ostream &operator<<(std::ostream &s, const Inspector &x) {
         x.print(s);
         return s;
@@ -98,9 +90,17 @@ private: // methods
 
 private: // data
 
-    mutable eckit::CacheLRU<Key,DB*> databases_;
-
     Config dbConfig_;
+
+    /// Shared with the workers of the iterators, which may outlive the Inspector
+    struct SharedStats {
+        void add(const FDBStats& stats);
+        std::mutex mutex_;
+        FDBStats stats_;
+    };
+    std::shared_ptr<SharedStats> stats_;
+
+    size_t queueSize_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -9,6 +9,11 @@
  */
 
 #include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "eckit/container/DenseSet.h"
 #include "eckit/utils/Tokenizer.h"
@@ -26,12 +31,93 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+namespace {
+
+/// Keywords and values are drawn from small vocabularies (the schema keywords, dates, steps, params, ...), so they are
+/// interned once and kept for the lifetime of the process. Each thread keeps its own index of the strings it has
+/// already seen, so that the shared table is only locked for strings new to the thread.
+///
+/// Nothing is ever removed, as Keys hold pointers to the strings. The table grows with every distinct value the process
+/// meets, so a long running server accumulates every date, expver, etc. it has been sent. Its size is reported in the
+/// metrics (see Key::internedCount() and Key::internedBytes()).
+
+class InternTable {
+public:
+
+    static InternTable& instance() {
+        static InternTable* table = new InternTable; // never destroyed, as Keys may outlive static destruction
+        return *table;
+    }
+
+    const std::string& intern(const std::string& s) {
+
+        thread_local std::unordered_map<std::string_view, const std::string*> seen;
+
+        auto it = seen.find(s);
+        if (it != seen.end()) {
+            return *it->second;
+        }
+
+        const std::string* interned;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto inserted = strings_.insert(s);
+            interned = &*inserted.first; // elements of an unordered_set are never moved
+            if (inserted.second) {
+                bytes_ += s.size();
+            }
+        }
+
+        seen.emplace(*interned, interned);
+        return *interned;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return strings_.size();
+    }
+
+    size_t bytes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return bytes_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_set<std::string> strings_;
+    size_t bytes_ = 0;
+};
+
+size_t entryHash(const std::string* keyword, const std::string* value) {
+    uint64_t h = reinterpret_cast<uintptr_t>(keyword) * 0x9e3779b97f4a7c15ULL ^ reinterpret_cast<uintptr_t>(value);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return size_t(h);
+}
+
+}
+
+const std::string& Key::intern(const std::string& s) {
+    return InternTable::instance().intern(s);
+}
+
+size_t Key::internedCount() {
+    return InternTable::instance().size();
+}
+
+size_t Key::internedBytes() {
+    return InternTable::instance().bytes();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 Key::Key() :
-    keys_(),
+    hash_(0),
     rule_(0) {}
 
 Key::Key(const std::string &s, const Rule *rule) :
-    keys_(),
+    hash_(0),
     rule_(0) {
     eckit::Tokenizer parse(":", true);
     eckit::StringList values;
@@ -42,7 +128,7 @@ Key::Key(const std::string &s, const Rule *rule) :
 }
 
 Key::Key(const std::string &s) :
-    keys_(),
+    hash_(0),
     rule_(0) {
 
     const TypesRegistry &registry = this->registry();
@@ -72,17 +158,21 @@ Key::Key(const std::string &s) :
 }
 
 Key::Key(const eckit::StringDict &keys) :
-    keys_(keys),
+    hash_(0),
     rule_(0) {
 
+    entries_.reserve(keys.size());
+    names_.reserve(keys.size());
+
     eckit::StringDict::const_iterator it = keys.begin();
     eckit::StringDict::const_iterator end = keys.end();
     for (; it != end; ++it) {
-        names_.emplace_back(it->first);
+        push(it->first, it->second);
     }
 }
 
 Key::Key(eckit::Stream& s) :
+    hash_(0),
     rule_(nullptr) {
     decode(s);
 }
@@ -91,9 +181,7 @@ void Key::decode(eckit::Stream& s) {
 
     ASSERT(rule_ == nullptr);
 
-    keys_.clear();
-    names_.clear();
-
+    clear();
 
     size_t n;
 
@@ -103,31 +191,31 @@ void Key::decode(eckit::Stream& s) {
     for (size_t i = 0; i < n; ++i) {
         s >> k;
         s >> v;
-        keys_[k] = v;
+        insert(&intern(k), &intern(v), false);
     }
 
+    names_.clear();
+
     s >> n;
     for (size_t i = 0; i < n; ++i) {
         s >> k;
         s >> v; // this is the type (ignoring FTM)
-        names_.push_back(k);
+        names_.push_back(&intern(k));
     }
 }
 
 void Key::encode(eckit::Stream& s) const {
     const TypesRegistry& registry = this->registry();
 
-    s << keys_.size();
-    for (eckit::StringDict::const_iterator i = keys_.begin(); i != keys_.end(); ++i) {
-        const Type &t = registry.lookupType(i->first);
-        s << i->first << canonicalise(i->first, i->second);
-
+    s << entries_.size();
+    for (const Entry& e : entries_) {
+        s << *e.keyword_ << canonicalise(*e.keyword_, *e.value_);
     }
 
     s << names_.size();
-    for (eckit::StringList::const_iterator i = names_.begin(); i != names_.end(); ++i) {
-        const Type &t = registry.lookupType(*i);
-        s << (*i);
+    for (const std::string* name : names_) {
+        const Type &t = registry.lookupType(*name);
+        s << *name;
         s << t.type();
     }
 }
@@ -136,8 +224,8 @@ std::set<std::string> Key::keys() const {
 
     std::set<std::string> k;
 
-    for (eckit::StringDict::const_iterator i = keys_.begin(); i != keys_.end(); ++i) {
-        k.insert(i->first);
+    for (const Entry& e : entries_) {
+        k.insert(*e.keyword_);
     }
 
     return k;
@@ -153,40 +241,111 @@ const Rule *Key::rule() const {
 }
 
 void Key::clear() {
-    keys_.clear();
+    entries_.clear();
     names_.clear();
+    hash_ = 0;
 }
 
-void Key::set(const std::string &k, const std::string &v) {
+std::vector<Key::Entry>::iterator Key::lowerBound(const std::string& keyword) {
+    return std::lower_bound(entries_.begin(), entries_.end(), keyword,
+                            [](const Entry& e, const std::string& k) { return *e.keyword_ < k; });
+}
+
+Key::const_iterator Key::find(const std::string& s) const {
+    auto it = const_cast<Key*>(this)->lowerBound(s);
+    if (it == entries_.end() || *it->keyword_ != s) {
+        return end();
+    }
+    return const_iterator(&*it);
+}
+
+Key::const_iterator Key::findInterned(const std::string* keyword) const {
+    for (const Entry& e : entries_) {
+        if (e.keyword_ == keyword) {
+            return const_iterator(&e);
+        }
+    }
+    return end();
+}
+
+/// Sets the value of the keyword, adding it to the names if it is new to the entries (set), or in any case (push)
+void Key::insert(const std::string* keyword, const std::string* value, bool push) {
 
-    eckit::StringDict::iterator it = keys_.find(k);
-    if (it == keys_.end()) {
-        names_.push_back(k);
-        keys_[k] = v;
+    auto it = lowerBound(*keyword);
+    if (it != entries_.end() && it->keyword_ == keyword) {
+        hash_ ^= entryHash(keyword, it->value_) ^ entryHash(keyword, value);
+        it->value_ = value;
     } else {
-        it->second = v;
+        entries_.insert(it, Entry{keyword, value});
+        hash_ ^= entryHash(keyword, value);
+        push = true;
     }
 
+    if (push) {
+        names_.push_back(keyword);
+    }
+}
+
+void Key::set(const std::string &k, const std::string &v) {
+    insert(&intern(k), &intern(v), false);
+}
+
+void Key::setInterned(const std::string* keyword, const std::string* value) {
+    insert(keyword, value, false);
 }
 
 void Key::unset(const std::string &k) {
-    keys_.erase(k);
+    auto it = lowerBound(k);
+    if (it != entries_.end() && *it->keyword_ == k) {
+        hash_ ^= entryHash(it->keyword_, it->value_);
+        entries_.erase(it);
+    }
 }
 
 void Key::push(const std::string &k, const std::string &v) {
-    keys_[k] = v;
-    names_.push_back(k);
+    pushInterned(&intern(k), &intern(v));
+}
+
+void Key::pushInterned(const std::string* keyword, const std::string* value) {
+    insert(keyword, value, true);
 }
 
 void Key::pop(const std::string &k) {
-    keys_.erase(k);
-    ASSERT(names_.back() == k);
+    unset(k);
+    ASSERT(*names_.back() == k);
     names_.pop_back();
 }
 
+bool Key::operator==(const Key& other) const {
+    if (hash_ != other.hash_ || entries_.size() != other.entries_.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].keyword_ != other.entries_[i].keyword_ || entries_[i].value_ != other.entries_[i].value_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Key::operator<(const Key& other) const {
+    size_t n = std::min(entries_.size(), other.entries_.size());
+    for (size_t i = 0; i < n; ++i) {
+        const Entry& a(entries_[i]);
+        const Entry& b(other.entries_[i]);
+        if (a.keyword_ != b.keyword_) {
+            return *a.keyword_ < *b.keyword_;
+        }
+        if (a.value_ != b.value_) {
+            return *a.value_ < *b.value_;
+        }
+    }
+    return entries_.size() < other.entries_.size();
+}
+
 const std::string &Key::get( const std::string &k ) const {
-    eckit::StringDict::const_iterator i = keys_.find(k);
-    if ( i == keys_.end() ) {
+    const_iterator i = find(k);
+    if ( i == end() ) {
         std::ostringstream oss;
         oss << "Key::get() failed for [" + k + "] in " << *this;
         throw eckit::SeriousBug(oss.str(), Here());
@@ -255,7 +414,7 @@ bool Key::match(const Key& other, const eckit::StringList& ignore) const {
 
 bool Key::match(const std::string &key, const std::set<std::string> &values) const {
 
-    eckit::StringDict::const_iterator i = find(key);
+    const_iterator i = find(key);
     if (i == end()) {
         return false;
     }
@@ -265,7 +424,7 @@ bool Key::match(const std::string &key, const std::set<std::string> &values) con
 
 bool Key::match(const std::string &key, const eckit::DenseSet<std::string> &values) const {
 
-    eckit::StringDict::const_iterator i = find(key);
+    const_iterator i = find(key);
     if (i == end()) {
         return false;
     }
@@ -310,25 +469,25 @@ std::string Key::canonicalise(const std::string& keyword, const std::string& val
 
 std::string Key::canonicalValue(const std::string& keyword) const {
 
-    eckit::StringDict::const_iterator it = keys_.find(keyword);
-    ASSERT(it != keys_.end());
+    const_iterator it = find(keyword);
+    ASSERT(it != end());
 
     return canonicalise(keyword, it->second);
 }
 
 std::string Key::valuesToString() const {
 
-    ASSERT(names_.size() == keys_.size());
+    ASSERT(names_.size() == entries_.size());
 
     std::ostringstream oss;
     const char *sep = "";
 
-    for (eckit::StringList::const_iterator j = names_.begin(); j != names_.end(); ++j) {
-        eckit::StringDict::const_iterator i = keys_.find(*j);
-        ASSERT(i != keys_.end());
+    for (const std::string* name : names_) {
+        const_iterator i = findInterned(name);
+        ASSERT(i != end());
 
         oss << sep;
-        oss << canonicalise(*j, i->second);
+        oss << canonicalise(*name, i->second);
 
         sep = ":";
     }
@@ -337,14 +496,19 @@ std::string Key::valuesToString() const {
 }
 
 
-const eckit::StringList& Key::names() const {
-    return names_;
+eckit::StringList Key::names() const {
+    eckit::StringList names;
+    names.reserve(names_.size());
+    for (const std::string* name : names_) {
+        names.push_back(*name);
+    }
+    return names;
 }
 
 std::string Key::value(const std::string& key) const {
 
-    eckit::StringDict::const_iterator it = keys_.find(key);
-    ASSERT(it != keys_.end());
+    const_iterator it = find(key);
+    ASSERT(it != end());
     return it->second;
 }
 
@@ -389,15 +553,19 @@ void Key::validateKeysOf(const Key& other, bool checkAlsoValues) const
     }
 }
 
-const eckit::StringDict &Key::keyDict() const {
-    return keys_;
+eckit::StringDict Key::keyDict() const {
+    eckit::StringDict keys;
+    for (const Entry& e : entries_) {
+        keys.emplace_hint(keys.end(), *e.keyword_, *e.value_);
+    }
+    return keys;
 }
 
 metkit::mars::MarsRequest Key::request(std::string verb) const {
     metkit::mars::MarsRequest req(verb);
 
-    for (eckit::StringDict::const_iterator i = keys_.begin(); i != keys_.end(); ++i) {
-        req.setValue(i->first, i->second);
+    for (const Entry& e : entries_) {
+        req.setValue(*e.keyword_, *e.value_);
     }
 
     return req;
@@ -405,7 +573,7 @@ metkit::mars::MarsRequest Key::request(std::string verb) const {
 
 
 fdb5::Key::operator std::string() const {
-    ASSERT(names_.size() == keys_.size());
+    ASSERT(names_.size() == entries_.size());
     return toString();
 }
 
@@ -413,31 +581,31 @@ fdb5::Key::operator eckit::StringDict() const
 {
     eckit::StringDict res;
 
-    ASSERT(names_.size() == keys_.size());
+    ASSERT(names_.size() == entries_.size());
 
     const TypesRegistry &registry = this->registry();
 
-    for (eckit::StringList::const_iterator j = names_.begin(); j != names_.end(); ++j) {
+    for (const std::string* name : names_) {
 
-        eckit::StringDict::const_iterator i = keys_.find(*j);
+        const_iterator i = findInterned(name);
 
-        ASSERT(i != keys_.end());
+        ASSERT(i != end());
         ASSERT(!(*i).second.empty());
 
-        res[*j] = registry.lookupType(*j).tidy(*j, (*i).second);
+        res[*name] = registry.lookupType(*name).tidy(*name, (*i).second);
     }
 
     return res;
 }
 
 void Key::print(std::ostream &out) const {
-    if (names_.size() == keys_.size()) {
+    if (names_.size() == entries_.size()) {
         out << "{" << toString() << "}";
         if (rule_) {
             out << " (" << *rule_ << ")";
         }
     } else {
-        out << keys_;
+        out << keyDict();
         if (rule_) {
             out << " (" << *rule_ << ")";
         }
@@ -447,11 +615,11 @@ void Key::print(std::ostream &out) const {
 std::string Key::toString() const {
     std::string res;
     const char *sep = "";
-    for (eckit::StringList::const_iterator j = names_.begin(); j != names_.end(); ++j) {
-        eckit::StringDict::const_iterator i = keys_.find(*j);
-        ASSERT(i != keys_.end());
+    for (const std::string* name : names_) {
+        const_iterator i = findInterned(name);
+        ASSERT(i != end());
         if (!i->second.empty()) {
-            res += sep + *j + '=' + i->second;
+            res += sep + *name + '=' + i->second;
             sep = ",";
         }
     }
@@ -16,8 +16,10 @@
 #ifndef fdb5_Key_H
 #define fdb5_Key_H
 
+#include <iterator>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 #include <set>
 
@@ -41,8 +43,53 @@ class Rule;
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// A Key is a small flat array of (keyword, value) entries, sorted by keyword, plus the order in which the keywords
+/// were added. The strings themselves are interned (process wide, and never freed), so a Key holds only pointers,
+/// copying one allocates no strings, and equality and hashing are done on the pointers. The hash is maintained as the
+/// Key is modified. Iteration still presents (keyword, value) pairs in keyword order, as it did when the entries were
+/// held in a StringDict.
+
 class Key {
 
+public: // types
+
+    struct Entry {
+        const std::string* keyword_;
+        const std::string* value_;
+    };
+
+    class const_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<const std::string&, const std::string&> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef value_type reference;
+
+        struct pointer {
+            value_type value_;
+            const value_type* operator->() const { return &value_; }
+        };
+
+        const_iterator() : entry_(nullptr) {}
+        explicit const_iterator(const Entry* entry) : entry_(entry) {}
+
+        reference operator*() const { return value_type(*entry_->keyword_, *entry_->value_); }
+        pointer operator->() const { return pointer{**this}; }
+
+        const_iterator& operator++() { ++entry_; return *this; }
+        const_iterator operator++(int) { const_iterator i(*this); ++entry_; return i; }
+        const_iterator& operator--() { --entry_; return *this; }
+        const_iterator operator--(int) { const_iterator i(*this); --entry_; return i; }
+
+        bool operator==(const const_iterator& other) const { return entry_ == other.entry_; }
+        bool operator!=(const const_iterator& other) const { return entry_ != other.entry_; }
+
+    private:
+        const Entry* entry_;
+    };
+
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
 public: // methods
 
     Key();
@@ -77,17 +124,14 @@ public: // methods
     /// keys present in the key. Essentially implements a reject-filter
     bool partialMatch(const metkit::mars::MarsRequest& request) const;
 
-    bool operator< (const Key &other) const {
-        return keys_ < other.keys_;
-    }
+    /// Ordered as the StringDicts of the entries would be
+    bool operator< (const Key &other) const;
 
     bool operator!= (const Key &other) const {
-        return keys_ != other.keys_;
+        return !(*this == other);
     }
 
-    bool operator== (const Key &other) const {
-        return keys_ == other.keys_;
-    }
+    bool operator== (const Key &other) const;
 
     friend std::ostream& operator<<(std::ostream &s, const Key &x) {
         x.print(s);
@@ -110,30 +154,29 @@ public: // methods
 
     std::string valuesToString() const;
 
-    const eckit::StringList& names() const;
+    eckit::StringList names() const;
 
     std::string value(const std::string& keyword) const;
     std::string canonicalValue(const std::string& keyword) const;
 
-    typedef eckit::StringDict::const_iterator const_iterator;
-    typedef eckit::StringDict::const_reverse_iterator const_reverse_iterator;
+    const_iterator begin() const { return const_iterator(entries_.data()); }
+    const_iterator end() const { return const_iterator(entries_.data() + entries_.size()); }
 
-    const_iterator begin() const { return keys_.begin(); }
-    const_iterator end() const { return keys_.end(); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
 
-    const_reverse_iterator rbegin() const { return keys_.rbegin(); }
-    const_reverse_iterator rend() const { return keys_.rend(); }
+    const_iterator find(const std::string& s) const;
 
-    const_iterator find(const std::string& s) const { return keys_.find(s); }
+    size_t size() const { return entries_.size(); }
 
-    size_t size() const { return keys_.size(); }
+    bool empty() const { return entries_.empty(); }
 
-    bool empty() const { return keys_.empty(); }
+    size_t hash() const { return hash_; }
 
     /// @throws When "other" doesn't contain all the keys of "this"
     void validateKeysOf(const Key& other, bool checkAlsoValues = false) const;
 
-    const eckit::StringDict& keyDict() const;
+    eckit::StringDict keyDict() const;
 
     metkit::mars::MarsRequest request(std::string verb = "retrieve") const;
 
@@ -141,7 +184,27 @@ public: // methods
 
     operator eckit::StringDict() const;
 
-private: // members
+    /// @returns the interned copy of the string, which lives for the lifetime of the process
+    /// @note the table of interned strings is never pruned, so it grows with the distinct keywords and values seen
+    static const std::string& intern(const std::string& s);
+
+    /// The number of strings interned so far, and the characters they hold
+    static size_t internedCount();
+    static size_t internedBytes();
+
+private: // methods
+
+    friend class CompiledSchema;
+
+    /// As find(), set() and push(), for strings that are already interned
+    const_iterator findInterned(const std::string* keyword) const;
+    void setInterned(const std::string* keyword, const std::string* value);
+    void pushInterned(const std::string* keyword, const std::string* value);
+
+    const std::vector<const std::string*>& internedNames() const { return names_; }
+
+    std::vector<Entry>::iterator lowerBound(const std::string& keyword);
+    void insert(const std::string* keyword, const std::string* value, bool push);
 
     //TODO add unit test for each type
     std::string canonicalise(const std::string& keyword, const std::string& value) const;
@@ -152,8 +215,12 @@ private: // members
 
     std::string toString() const;
 
-    eckit::StringDict keys_;
-    eckit::StringList names_;
+private: // members
+
+    std::vector<Entry> entries_;                ///< sorted by keyword
+    std::vector<const std::string*> names_;     ///< in the order they were added
+
+    size_t hash_;
 
     const Rule *rule_;
 
@@ -167,7 +234,7 @@ namespace std {
     template <>
     struct hash<fdb5::Key> {
         size_t operator() (const fdb5::Key& key) const {
-            return std::hash<std::string>()(key.valuesToString());
+            return key.hash();
         }
     };
 }
@@ -16,6 +16,7 @@
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/database/DB.h"
+#include "fdb5/database/DBCache.h"
 #include "fdb5/database/Key.h"
 #include "fdb5/io/HandleGatherer.h"
 #include "fdb5/types/Type.h"
@@ -28,17 +29,19 @@ namespace fdb5 {
 //----------------------------------------------------------------------------------------------------------------------
 
 MultiRetrieveVisitor::MultiRetrieveVisitor(const Notifier& wind,
-                                           InspectIterator& iterator,
-                                           eckit::CacheLRU<Key,DB*>& databases,
-                                           const Config& config) :
-    db_(nullptr),
+                                           eckit::Queue<ListElement>& queue,
+                                           const Config& config,
+                                           FDBStats& stats) :
     wind_(wind),
-    databases_(databases),
-    iterator_(iterator),
-    config_(config) {
+    queue_(queue),
+    config_(config),
+    stats_(stats) {
 }
 
 MultiRetrieveVisitor::~MultiRetrieveVisitor() {
+    if (db_) {
+        DBCache::instance().checkin(std::move(db_), stats_);
+    }
 }
 
 // From Visitor
@@ -56,11 +59,15 @@ bool MultiRetrieveVisitor::selectDatabase(const Key& key, const Key&) {
         }
     }
 
+    if (db_) {
+        DBCache::instance().checkin(std::move(db_), stats_);
+    }
+
     /* is the DB already open ? */
 
-    if(databases_.exists(key)) {
+    db_ = DBCache::instance().checkout(DBCache::location(key, config_), stats_);
+    if (db_) {
         eckit::Log::debug<LibFdb5>() << "FDB5 Reusing database " << key << std::endl;
-        db_ = databases_.access(key);
         return true;
     }
 
@@ -83,8 +90,7 @@ bool MultiRetrieveVisitor::selectDatabase(const Key& key, const Key&) {
         eckit::Log::debug() << "Database does not exist " << key << std::endl;
         return false;
     } else {
-        db_ = newDB.release();
-        databases_.insert(key, db_);
+        db_ = std::move(newDB);
         return true;
     }
 }
@@ -108,7 +114,7 @@ bool MultiRetrieveVisitor::selectDatum(const Key& key, const Key& full) {
                 simplifiedKey.set(k->first, k->second);
         }
 
-        iterator_.emplace(ListElement({db_->key(), db_->indexKey(), simplifiedKey}, field.stableLocation(), field.timestamp()));
+        queue_.emplace(ListElement({db_->key(), db_->indexKey(), simplifiedKey}, field.stableLocation(), field.timestamp()));
         return true;
     }
 
@@ -120,7 +126,7 @@ void MultiRetrieveVisitor::values(const metkit::mars::MarsRequest &request,
                              const TypesRegistry &registry,
                              eckit::StringList &values) {
     eckit::StringList list;
-    registry.lookupType(keyword).getValues(request, keyword, list, wind_, db_);
+    registry.lookupType(keyword).getValues(request, keyword, list, wind_, db_.get());
 
     eckit::StringSet filter;
     bool toFilter = false;
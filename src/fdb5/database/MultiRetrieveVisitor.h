@@ -18,7 +18,8 @@
 
 #include <string>
 
-#include "eckit/container/CacheLRU.h"
+#include <memory>
+
 #include "eckit/container/Queue.h"
 
 #include "fdb5/api/helpers/ListIterator.h"
@@ -28,6 +29,7 @@
 
 namespace fdb5 {
 
+class FDBStats;
 class HandleGatherer;
 class Notifier;
 
@@ -40,9 +42,9 @@ class MultiRetrieveVisitor : public ReadVisitor {
 public: // methods
 
     MultiRetrieveVisitor(const Notifier& wind,
-                         InspectIterator& queue,
-                         eckit::CacheLRU<Key,DB*>& databases,
-                         const Config& config);
+                         eckit::Queue<ListElement>& queue,
+                         const Config& config,
+                         FDBStats& stats);
 
     ~MultiRetrieveVisitor();
 
@@ -67,15 +69,16 @@ private:  // methods
 
 private:
 
-    DB* db_;
+    /// Checked out of the DBCache, and checked back in when done with
+    std::unique_ptr<DB> db_;
 
     const Notifier& wind_;
 
-    eckit::CacheLRU<Key,DB*>& databases_;
-
-    InspectIterator& iterator_;
+    eckit::Queue<ListElement>& queue_;
 
     Config config_;
+
+    FDBStats& stats_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
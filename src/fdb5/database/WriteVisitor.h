@@ -67,6 +67,7 @@ private: // members
     }
 
     friend class Rule;
+    friend class CompiledSchema;
 
     std::vector<Key> &prev_;
 
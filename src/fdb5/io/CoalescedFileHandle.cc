@@ -0,0 +1,280 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "eckit/log/Log.h"
+#include "eckit/log/Plural.h"
+
+#include "fdb5/io/CoalescedFileHandle.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+::eckit::ClassSpec CoalescedFileHandle::classSpec_ = {
+    &DataHandle::classSpec(),
+    "CoalescedFileHandle",
+};
+::eckit::Reanimator<CoalescedFileHandle> CoalescedFileHandle::reanimator_;
+
+CoalescedFileHandle::CoalescedFileHandle(const PathName& path, const Ranges& ranges, size_t gap, size_t maxExtent) :
+    path_(path),
+    ranges_(ranges),
+    gap_(gap),
+    maxExtent_(maxExtent) {
+    init();
+}
+
+CoalescedFileHandle::CoalescedFileHandle(Stream& s) :
+    DataHandle(s) {
+
+    s >> path_;
+
+    size_t n;
+    s >> n;
+    ranges_.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        unsigned long long offset;
+        unsigned long long length;
+        s >> offset;
+        s >> length;
+        ranges_.emplace_back(offset, length);
+    }
+
+    s >> gap_;
+    s >> maxExtent_;
+
+    init();
+}
+
+void CoalescedFileHandle::init() {
+
+    length_ = 0;
+    fd_ = -1;
+    piece_ = 0;
+    piecePos_ = 0;
+    loaded_ = std::numeric_limits<size_t>::max();
+
+    for (const auto& range : ranges_) {
+
+        off_t offset = range.first;
+        size_t length = range.second;
+
+        if (length == 0) {
+            continue;
+        }
+
+        size_t start = length_;
+        length_ += length;
+
+        // Adjacent ranges are simply joined up
+
+        if (!pieces_.empty()) {
+            Piece& last(pieces_.back());
+            Extent& e(extents_.back());
+            ASSERT(offset >= last.offset_);
+            bool fits = (e.pieces_ == 1 || size_t(offset + off_t(length) - e.offset_) <= maxExtent_);
+            if (last.offset_ + off_t(last.length_) == offset && fits) {
+                last.length_ += length;
+                e.length_ += length;
+                continue;
+            }
+        }
+
+        // Otherwise, read through the hole if it is small enough, and the extent doesn't get too big
+
+        if (!extents_.empty()) {
+            Extent& e(extents_.back());
+            off_t end = e.offset_ + off_t(e.length_);
+            if (offset >= end && size_t(offset - end) <= gap_ && size_t(offset + off_t(length) - e.offset_) <= maxExtent_) {
+                e.length_ = offset + length - e.offset_;
+                e.pieces_++;
+                pieces_.push_back(Piece{start, offset, length, extents_.size() - 1});
+                continue;
+            }
+        }
+
+        extents_.push_back(Extent{offset, length, 1});
+        pieces_.push_back(Piece{start, offset, length, extents_.size() - 1});
+    }
+}
+
+CoalescedFileHandle::~CoalescedFileHandle() {
+    close();
+}
+
+void CoalescedFileHandle::encode(Stream& s) const {
+    DataHandle::encode(s);
+    s << path_;
+    s << ranges_.size();
+    for (const auto& range : ranges_) {
+        s << static_cast<unsigned long long>(range.first);
+        s << static_cast<unsigned long long>(range.second);
+    }
+    s << gap_;
+    s << maxExtent_;
+}
+
+Length CoalescedFileHandle::openForRead() {
+
+    ASSERT(fd_ == -1);
+
+    SYSCALL2(fd_ = ::open(path_.localPath(), O_RDONLY), path_);
+
+    piece_ = 0;
+    piecePos_ = 0;
+    loaded_ = std::numeric_limits<size_t>::max();
+
+    return estimate();
+}
+
+void CoalescedFileHandle::readExtent(size_t extent) {
+
+    const Extent& e(extents_[extent]);
+    buffer_.resize(e.length_);
+
+    size_t pos = 0;
+    while (pos < e.length_) {
+        ssize_t len;
+        SYSCALL2(len = ::pread(fd_, &buffer_[pos], e.length_ - pos, e.offset_ + pos), path_);
+        if (len == 0) {
+            std::ostringstream oss;
+            oss << "CoalescedFileHandle: unexpected end of file " << path_ << " reading " << e.length_
+                << " bytes at offset " << e.offset_;
+            throw ReadError(oss.str(), Here());
+        }
+        pos += len;
+    }
+
+    loaded_ = extent;
+}
+
+long CoalescedFileHandle::read(void* buffer, long length) {
+
+    ASSERT(fd_ != -1);
+
+    char* out = static_cast<char*>(buffer);
+    long total = 0;
+
+    while (total < length && piece_ < pieces_.size()) {
+
+        const Piece& p(pieces_[piece_]);
+        const Extent& e(extents_[p.extent_]);
+
+        size_t n = std::min(size_t(length - total), p.length_ - piecePos_);
+
+        if (e.pieces_ > 1) {
+            // Holes are read through, so take the piece out of the extent
+            if (loaded_ != p.extent_) {
+                readExtent(p.extent_);
+            }
+            ::memcpy(out + total, &buffer_[p.offset_ - e.offset_ + piecePos_], n);
+        } else {
+            ssize_t len;
+            SYSCALL2(len = ::pread(fd_, out + total, n, p.offset_ + piecePos_), path_);
+            if (len == 0) {
+                std::ostringstream oss;
+                oss << "CoalescedFileHandle: unexpected end of file " << path_ << " reading " << p.length_
+                    << " bytes at offset " << p.offset_;
+                throw ReadError(oss.str(), Here());
+            }
+            n = len;
+        }
+
+        total += n;
+        piecePos_ += n;
+
+        if (piecePos_ == p.length_) {
+            piece_++;
+            piecePos_ = 0;
+        }
+    }
+
+    return total;
+}
+
+void CoalescedFileHandle::close() {
+    if (fd_ != -1) {
+        SYSCALL2(::close(fd_), path_);
+        fd_ = -1;
+    }
+    std::vector<char>().swap(buffer_);
+    loaded_ = std::numeric_limits<size_t>::max();
+}
+
+void CoalescedFileHandle::rewind() {
+    piece_ = 0;
+    piecePos_ = 0;
+}
+
+Offset CoalescedFileHandle::position() {
+    if (piece_ == pieces_.size()) {
+        return length_;
+    }
+    return pieces_[piece_].start_ + piecePos_;
+}
+
+Offset CoalescedFileHandle::seek(const Offset& offset) {
+
+    ASSERT(offset >= Offset(0));
+
+    // Past the end of the data is at its end
+    if (size_t(offset) >= length_) {
+        piece_ = pieces_.size();
+        piecePos_ = 0;
+        return length_;
+    }
+
+    // The last piece that starts at or before the offset. The buffered extent is kept, as it may still serve.
+    auto it = std::upper_bound(pieces_.begin(), pieces_.end(), size_t(offset),
+                               [](size_t pos, const Piece& p) { return pos < p.start_; });
+    ASSERT(it != pieces_.begin());
+    --it;
+
+    piece_ = it - pieces_.begin();
+    piecePos_ = size_t(offset) - it->start_;
+    ASSERT(piecePos_ < it->length_);
+
+    return offset;
+}
+
+Length CoalescedFileHandle::size() {
+    return length_;
+}
+
+Length CoalescedFileHandle::estimate() {
+    return length_;
+}
+
+void CoalescedFileHandle::print(std::ostream& s) const {
+    if (format(s) == Log::compactFormat) {
+        s << "CoalescedFileHandle";
+    } else {
+        s << "CoalescedFileHandle[path=" << path_
+          << "," << Plural(pieces_.size(), "range")
+          << "," << Plural(extents_.size(), "read") << ']';
+    }
+}
+
+std::string CoalescedFileHandle::title() const {
+    return PathName::shorten(path_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,123 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   CoalescedFileHandle.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_CoalescedFileHandle_h
+#define fdb5_io_CoalescedFileHandle_h
+
+#include <utility>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/Length.h"
+#include "eckit/io/Offset.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Returns a set of byte ranges of one file, like a sorted eckit::PartFileHandle, but ranges separated by
+/// holes of no more than `gap` bytes are fetched with a single read, and the holes discarded. A read never
+/// spans more than `maxExtent` bytes, which bounds the memory used.
+///
+/// The handle can seek to any position of the data returned, as that maps directly onto a range of the file.
+
+class CoalescedFileHandle : public eckit::DataHandle {
+public:
+
+    typedef std::vector<std::pair<eckit::Offset, eckit::Length>> Ranges;
+
+    /// The ranges must be sorted by offset
+    CoalescedFileHandle(const eckit::PathName& path, const Ranges& ranges, size_t gap, size_t maxExtent);
+    CoalescedFileHandle(eckit::Stream&);
+    ~CoalescedFileHandle() override;
+
+    // From DataHandle
+
+    eckit::Length openForRead() override;
+    void openForWrite(const eckit::Length&) override { NOTIMP; }
+    void openForAppend(const eckit::Length&) override { NOTIMP; }
+
+    long read(void*, long) override;
+    long write(const void*, long) override { NOTIMP; }
+    void close() override;
+    void rewind() override;
+
+    void print(std::ostream&) const override;
+    eckit::Length size() override;
+    eckit::Length estimate() override;
+
+    eckit::Offset position() override;
+    eckit::Offset seek(const eckit::Offset&) override;
+    bool canSeek() const override { return true; }
+
+    std::string title() const override;
+
+    // From Streamable
+
+    void encode(eckit::Stream&) const override;
+    const eckit::ReanimatorBase& reanimator() const override { return reanimator_; }
+    static const eckit::ClassSpec& classSpec() { return classSpec_; }
+
+private: // types
+
+    /// A contiguous range that is returned to the caller
+    struct Piece {
+        size_t start_;      ///< within the data returned
+        off_t offset_;
+        size_t length_;
+        size_t extent_;
+    };
+
+    /// A contiguous range that is read from the file
+    struct Extent {
+        off_t offset_;
+        size_t length_;
+        size_t pieces_;
+    };
+
+private: // methods
+
+    void init();
+    void readExtent(size_t extent);
+
+private: // members
+
+    eckit::PathName path_;
+    Ranges ranges_;
+    size_t gap_;
+    size_t maxExtent_;
+
+    std::vector<Piece> pieces_;
+    std::vector<Extent> extents_;
+    size_t length_;
+
+    int fd_;
+
+    size_t piece_;        ///< the piece being returned
+    size_t piecePos_;     ///< within that piece
+    size_t loaded_;       ///< the extent held in buffer_
+    std::vector<char> buffer_;
+
+    // For Streamable
+
+    static eckit::ClassSpec classSpec_;
+    static eckit::Reanimator<CoalescedFileHandle> reanimator_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
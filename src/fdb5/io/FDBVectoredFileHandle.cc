@@ -0,0 +1,234 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/eckit.h"
+#include "eckit/io/FDataSync.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/FDBVectoredFileHandle.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void FDBVectoredFileHandle::print(std::ostream& s) const {
+    s << "FDBVectoredFileHandle[file=" << path_ << ",buffers=" << buffers_.size() << "x" << bufferSize_ << ']';
+}
+
+FDBVectoredFileHandle::FDBVectoredFileHandle(const std::string& name, size_t count, size_t size,
+                                             const PWriteV& pwritev) :
+    path_(name),
+    fd_(-1),
+    pwritev_(pwritev),
+    buffers_(count),
+    bufferSize_(size),
+    buffered_(0),
+    written_(0) {
+
+    // One more entry than there are buffers, for the data of a write that does not fit
+    ASSERT(count > 0 && count < IOV_MAX);
+    ASSERT(bufferSize_ > 0);
+
+    iov_.reserve(count + 1);
+}
+
+FDBVectoredFileHandle::~FDBVectoredFileHandle() {}
+
+Length FDBVectoredFileHandle::openForRead() {
+    NOTIMP;
+}
+
+void FDBVectoredFileHandle::openForWrite(const Length&) {
+    NOTIMP;
+}
+
+void FDBVectoredFileHandle::openForAppend(const Length&) {
+    ASSERT(fd_ < 0);
+
+    // n.b. not O_APPEND, as pwritev() would then ignore the offset. The file is only ever appended to by this handle.
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+    if (fd_ < 0) {
+        throw eckit::CantOpenFile(path_);
+    }
+    SYSCALL(written_ = ::lseek(fd_, 0, SEEK_END));
+    buffered_ = 0;
+}
+
+long FDBVectoredFileHandle::read(void*, long) {
+    NOTIMP;
+}
+
+long FDBVectoredFileHandle::write(const void* buffer, long length) {
+    ASSERT(buffer);
+    ASSERT(fd_ >= 0);
+    ASSERT(length >= 0);
+
+    size_t len = length;
+
+    if (buffered_ + len > buffers_.size() * bufferSize_) {
+        submit(buffer, len);
+        return length;
+    }
+
+    const char* p = static_cast<const char*>(buffer);
+    while (len) {
+        size_t i      = buffered_ / bufferSize_;
+        size_t offset = buffered_ % bufferSize_;
+        size_t n      = std::min(len, bufferSize_ - offset);
+
+        if (!buffers_[i]) {
+            buffers_[i].reset(new eckit::Buffer(bufferSize_));
+        }
+
+        ::memcpy(static_cast<char*>(buffers_[i]->data()) + offset, p, n);
+
+        buffered_ += n;
+        p += n;
+        len -= n;
+    }
+
+    return length;
+}
+
+void FDBVectoredFileHandle::submit(const void* data, size_t length) {
+
+    iov_.clear();
+
+    size_t left = buffered_;
+    for (size_t i = 0; left; ++i) {
+        size_t n = std::min(left, bufferSize_);
+        iov_.push_back(iovec{buffers_[i]->data(), n});
+        left -= n;
+    }
+
+    if (length) {
+        iov_.push_back(iovec{const_cast<void*>(data), length});
+    }
+
+    if (!iov_.empty()) {
+        writev(iov_);
+    }
+
+    buffered_ = 0;
+}
+
+void FDBVectoredFileHandle::writev(std::vector<struct iovec>& iov) {
+
+    size_t first = 0;
+
+    while (first < iov.size()) {
+
+        ssize_t n = pwritev_(fd_, &iov[first], iov.size() - first, written_);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            Log::error() << "Cannot pwritev(" << path_ << ") " << fd_ << Log::syserr << std::endl;
+            throw eckit::WriteError(path_);
+        }
+
+        written_ += n;
+
+        // Skip what has been written, on a short write resuming part way through an entry
+
+        size_t done = n;
+        while (done) {
+            struct iovec& v(iov[first]);
+            if (done < v.iov_len) {
+                v.iov_base = static_cast<char*>(v.iov_base) + done;
+                v.iov_len -= done;
+                break;
+            }
+            done -= v.iov_len;
+            ++first;
+        }
+    }
+}
+
+void FDBVectoredFileHandle::release() {
+    for (std::unique_ptr<eckit::Buffer>& b : buffers_) {
+        b.reset();
+    }
+}
+
+void FDBVectoredFileHandle::flush() {
+    static bool fdbDataSyncOnFlush =
+        eckit::LibResource<bool, LibFdb5>("$FDB_DATA_SYNC_ON_FLUSH;fdbDataSyncOnFlush", true);
+
+    if (fd_ >= 0) {
+        submit();
+        release();
+
+        if (fdbDataSyncOnFlush) {
+            int ret = eckit::fdatasync(fd_);
+
+            while (ret < 0 && errno == EINTR) {
+                ret = eckit::fdatasync(fd_);
+            }
+            if (ret < 0) {
+                Log::error() << "Cannot fdatasync(" << path_ << ") " << fd_ << Log::syserr << std::endl;
+                throw eckit::WriteError(path_);
+            }
+        }
+    }
+}
+
+void FDBVectoredFileHandle::close() {
+    if (fd_ >= 0) {
+        int fd = fd_;
+        try {
+            submit();
+        }
+        catch (...) {
+            ::close(fd);
+            fd_       = -1;
+            buffered_ = 0;
+            release();
+            throw;
+        }
+        release();
+        fd_ = -1;
+        if (::close(fd)) {
+            throw WriteError(std::string("close ") + name());
+        }
+    }
+}
+
+size_t FDBVectoredFileHandle::allocated() const {
+    size_t n = 0;
+    for (const std::unique_ptr<eckit::Buffer>& b : buffers_) {
+        if (b) n += bufferSize_;
+    }
+    return n;
+}
+
+Offset FDBVectoredFileHandle::position() {
+    return written_ + off_t(buffered_);
+}
+
+std::string FDBVectoredFileHandle::title() const {
+    return PathName::shorten(path_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
@@ -0,0 +1,100 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   FDBVectoredFileHandle.h
+/// @date   Oct 2026
+
+#ifndef fdb5_FDBVectoredFileHandle_h
+#define fdb5_FDBVectoredFileHandle_h
+
+#include <sys/uio.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The signature of pwritev(2), so that the system call can be substituted
+typedef std::function<ssize_t(int, const struct iovec*, int, off_t)> PWriteV;
+
+/// An append only handle, like FDBFileHandle, that gathers the writes into a set of fixed size buffers and
+/// hands them to the kernel with a single pwritev() once they are full, or on flush.
+///
+/// A write that does not fit in the remaining buffer space is not copied, but written together with the buffered
+/// data in the same call. The buffers are only allocated as they are first filled, and are released on flush()
+/// and close(), so a handle to a data file receiving few fields, or one idle since the last flush, does not hold
+/// the full buffer space.
+///
+///   * it does not fsync() on close(), only on flush() (see fdbDataSyncOnFlush)
+///   * it fails on ENOSPC
+///   * this is not thread-safe neither multi-process safe
+
+class FDBVectoredFileHandle : public eckit::DataHandle {
+public:  // methods
+
+    FDBVectoredFileHandle(const std::string&, size_t count, size_t size, const PWriteV& pwritev = ::pwritev);
+
+    ~FDBVectoredFileHandle();
+
+    virtual eckit::Length openForRead() override;
+    virtual void   openForWrite(const eckit::Length &) override;
+    virtual void   openForAppend(const eckit::Length &) override;
+
+    virtual long   read(void *, long) override;
+    virtual long   write(const void *, long) override;
+    virtual void   close() override;
+    virtual void   flush() override;
+    virtual void print(std::ostream &) const override;
+    virtual eckit::Offset position() override;
+    virtual std::string title() const override;
+    virtual bool canSeek() const override { return false; }
+
+    /// The buffer space allocated, in bytes
+    size_t allocated() const;
+
+protected: // members
+
+    std::string      path_;
+
+private: // methods
+
+    /// Write out the buffered data, followed by the (unbuffered) data given, if any
+    void submit(const void* data = nullptr, size_t length = 0);
+
+    void writev(std::vector<struct iovec>& iov);
+
+    void release();
+
+private: // members
+
+    int fd_;
+
+    PWriteV pwritev_;
+
+    std::vector<std::unique_ptr<eckit::Buffer>> buffers_;
+    size_t bufferSize_;
+    size_t buffered_;   ///< bytes held in the buffers, filled in order
+
+    std::vector<struct iovec> iov_;
+
+    off_t written_;     ///< offset in the file at which the buffered data will be written
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -10,10 +10,17 @@
 
 #include "fdb5/io/HandleGatherer.h"
 
+#include <algorithm>
+
+#include "eckit/config/Resource.h"
 #include "eckit/io/MultiHandle.h"
 #include "eckit/log/Plural.h"
 #include "eckit/exception/Exceptions.h"
 
+#include "fdb5/database/FieldLocation.h"
+#include "fdb5/io/CoalescedFileHandle.h"
+#include "fdb5/io/ReadAheadHandle.h"
+
 namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -31,10 +38,29 @@ HandleGatherer::~HandleGatherer() {
 
 eckit::DataHandle *HandleGatherer::dataHandle() {
     for (std::vector<eckit::DataHandle *>::iterator j = handles_.begin(); j != handles_.end(); ++j) {
-        (*j)->compress(sorted_);
+        if (*j) {
+            (*j)->compress(sorted_);
+        }
+    }
+
+    for (FileRanges& file : files_) {
+        ASSERT(!handles_[file.slot_]);
+        handles_[file.slot_] = fileHandle(file);
     }
+    files_.clear();
+    fileIndex_.clear();
+
+    // Optionally read the (merged) handles ahead of the consumer, several at once
 
-    eckit::DataHandle *h = new eckit::MultiHandle(handles_);
+    static size_t fdbReadAheadDepth = eckit::Resource<size_t>("fdbReadAheadDepth;$FDB_READ_AHEAD_DEPTH", 0);
+    static size_t fdbReadAheadMemory = eckit::Resource<size_t>("fdbReadAheadMemory;$FDB_READ_AHEAD_MEMORY", 256 * 1024 * 1024);
+
+    eckit::DataHandle *h;
+    if (fdbReadAheadDepth > 0 && handles_.size() > 1) {
+        h = new ReadAheadHandle(handles_, fdbReadAheadDepth, fdbReadAheadMemory);
+    } else {
+        h = new eckit::MultiHandle(handles_);
+    }
     handles_.clear();
     return h;
 }
@@ -44,7 +70,7 @@ void HandleGatherer::add(eckit::DataHandle *h) {
     ASSERT(h);
     if (sorted_) {
         for (std::vector<eckit::DataHandle *>::iterator j = handles_.begin(); j != handles_.end(); ++j) {
-            if ( (*j)->merge(h) ) {
+            if ( *j && (*j)->merge(h) ) {
                 delete h;
                 return;
             }
@@ -60,6 +86,61 @@ void HandleGatherer::add(eckit::DataHandle *h) {
     handles_.push_back(h);
 }
 
+void HandleGatherer::add(const FieldLocation& location) {
+
+    // Only plain files, whose data is returned as is, can be coalesced by byte range
+
+    if (!sorted_ || location.uri().scheme() != "file" || !location.remapKey().empty()) {
+        add(location.dataHandle());
+        return;
+    }
+
+    count_++;
+
+    const eckit::PathName& path(location.uri().path());
+
+    auto it = fileIndex_.find(path.asString());
+    if (it == fileIndex_.end()) {
+        it = fileIndex_.emplace(path.asString(), files_.size()).first;
+        files_.push_back(FileRanges{path, handles_.size(), {}});
+        handles_.push_back(nullptr);
+    }
+
+    files_[it->second].ranges_.emplace_back(location.offset(), location.length());
+}
+
+eckit::DataHandle* HandleGatherer::fileHandle(FileRanges& file) const {
+
+    static size_t fdbReadCoalesceGap = eckit::Resource<size_t>("fdbReadCoalesceGap;$FDB_READ_COALESCE_GAP", 0);
+    static size_t fdbReadCoalesceMaxExtent = eckit::Resource<size_t>("fdbReadCoalesceMaxExtent;$FDB_READ_COALESCE_MAX_EXTENT", 64 * 1024 * 1024);
+
+    std::vector<std::pair<eckit::Offset, eckit::Length>>& ranges(file.ranges_);
+
+    std::stable_sort(ranges.begin(), ranges.end(),
+                     [](const std::pair<eckit::Offset, eckit::Length>& a, const std::pair<eckit::Offset, eckit::Length>& b) {
+                         return a.first < b.first;
+                     });
+
+    if (fdbReadCoalesceGap > 0) {
+        return new CoalescedFileHandle(file.path_, ranges, fdbReadCoalesceGap, fdbReadCoalesceMaxExtent);
+    }
+
+    // Join up the adjacent ranges, as eckit::PartFileHandle::compress() does
+
+    eckit::OffsetList offsets;
+    eckit::LengthList lengths;
+    for (const auto& range : ranges) {
+        if (!offsets.empty() && offsets.back() + lengths.back() == range.first) {
+            lengths.back() += range.second;
+        } else {
+            offsets.push_back(range.first);
+            lengths.push_back(range.second);
+        }
+    }
+
+    return file.path_.partHandle(offsets, lengths);
+}
+
 size_t HandleGatherer::count() const {
     return count_;
 }
@@ -17,9 +17,15 @@
 #define fdb5_HandleGatherer_H
 
 #include <cstdlib>
-#include <vector>
 #include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/Length.h"
+#include "eckit/io/Offset.h"
 #include "eckit/memory/NonCopyable.h"
 
 namespace eckit {
@@ -29,6 +35,7 @@ class DataHandle;
 
 namespace fdb5 {
 
+class FieldLocation;
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -42,10 +49,25 @@ public: // methods
 
     void add(eckit::DataHandle *);
 
+    /// When sorted, the byte ranges of plain files are gathered per file and coalesced once all have been
+    /// added, rather than merged into the handles one at a time.
+    void add(const FieldLocation&);
+
     eckit::DataHandle *dataHandle();
 
     size_t count() const;
 
+private: // types
+
+    struct FileRanges {
+        eckit::PathName path_;
+        size_t slot_; ///< position in handles_, to preserve the order in which the files were first seen
+        std::vector<std::pair<eckit::Offset, eckit::Length>> ranges_;
+    };
+
+private: // methods
+
+    eckit::DataHandle* fileHandle(FileRanges& file) const;
 
 private: // members
 
@@ -53,6 +75,9 @@ private: // members
     std::vector<eckit::DataHandle *> handles_;
     size_t count_;
 
+    std::vector<FileRanges> files_;
+    std::unordered_map<std::string, size_t> fileIndex_;
+
     void print( std::ostream &out ) const;
     friend std::ostream &operator<<(std::ostream &s, const HandleGatherer &x) {
         x.print(s);
@@ -0,0 +1,357 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "eckit/log/Log.h"
+#include "eckit/log/Plural.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/ReadAheadHandle.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+::eckit::ClassSpec ReadAheadHandle::classSpec_ = {
+    &DataHandle::classSpec(),
+    "ReadAheadHandle",
+};
+::eckit::Reanimator<ReadAheadHandle> ReadAheadHandle::reanimator_;
+
+namespace {
+
+/// Bounds on the size of the chunks that the handles are read in
+constexpr size_t min_chunk_size = 64 * 1024;
+constexpr size_t max_chunk_size = 4 * 1024 * 1024;
+
+}
+
+ReadAheadHandle::ReadAheadHandle(const std::vector<DataHandle*>& handles, size_t depth, size_t memoryBudget) :
+    handles_(handles),
+    depth_(depth),
+    memoryBudget_(memoryBudget) {
+    init();
+}
+
+ReadAheadHandle::ReadAheadHandle(Stream& s) :
+    DataHandle(s) {
+
+    size_t n;
+    s >> n;
+    handles_.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        handles_.push_back(Reanimator<DataHandle>::reanimate(s));
+    }
+    s >> depth_;
+    s >> memoryBudget_;
+
+    init();
+}
+
+void ReadAheadHandle::init() {
+
+    ASSERT(depth_ > 0);
+
+    // Leave room in the budget for every thread to be reading a chunk, with as much again buffered
+    chunkSize_ = std::min(max_chunk_size, std::max(min_chunk_size, memoryBudget_ / (2 * depth_)));
+    chunkSize_ = std::max<size_t>(1, std::min(chunkSize_, memoryBudget_));
+
+    next_ = 0;
+    current_ = 0;
+    position_ = 0;
+    buffered_ = 0;
+    returned_ = 0;
+    stopping_ = false;
+
+    estimates_.reserve(handles_.size());
+    for (DataHandle* h : handles_) {
+        estimates_.push_back(h->estimate());
+    }
+}
+
+ReadAheadHandle::~ReadAheadHandle() {
+    stop();
+    for (DataHandle* h : handles_) {
+        delete h;
+    }
+}
+
+void ReadAheadHandle::encode(Stream& s) const {
+    DataHandle::encode(s);
+    s << handles_.size();
+    for (const DataHandle* h : handles_) {
+        s << *h;
+    }
+    s << depth_;
+    s << memoryBudget_;
+}
+
+Length ReadAheadHandle::openForRead() {
+    start();
+    return estimate();
+}
+
+void ReadAheadHandle::start() {
+
+    ASSERT(threads_.empty());
+
+    slots_.clear();
+    slots_.resize(handles_.size());
+    next_ = 0;
+    current_ = 0;
+    position_ = 0;
+    buffered_ = 0;
+    returned_ = 0;
+    stopping_ = false;
+
+    size_t nthreads = std::min(depth_, handles_.size());
+    for (size_t i = 0; i < nthreads; ++i) {
+        threads_.emplace_back([this] { run(); });
+    }
+}
+
+void ReadAheadHandle::run() {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (true) {
+
+        // Read no more than depth_ handles ahead of the consumer
+
+        cv_.wait(lock, [this] {
+            return stopping_ || next_ >= slots_.size() || next_ < current_ + depth_;
+        });
+
+        if (stopping_ || next_ >= slots_.size()) {
+            return;
+        }
+
+        size_t i = next_++;
+
+        lock.unlock();
+        readSlot(i);
+        lock.lock();
+    }
+}
+
+void ReadAheadHandle::readSlot(size_t i) {
+
+    size_t reserved = 0;
+
+    try {
+        DataHandle& h(*handles_[i]);
+        h.openForRead();
+        AutoClose closer(h);
+
+        bool eof = false;
+        while (!eof) {
+
+            // Stay within the memory budget, unless the consumer is waiting on this very handle
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                const Slot& slot(slots_[i]);
+                cv_.wait(lock, [this, i, &slot] {
+                    return stopping_ || buffered_ + chunkSize_ <= memoryBudget_ || (i == current_ && slot.chunks_.empty());
+                });
+                if (stopping_) {
+                    return;
+                }
+                buffered_ += chunkSize_;
+                reserved = chunkSize_;
+            }
+
+            // Whatever was read before an error is still returned to the consumer, ahead of the error
+
+            std::vector<char> chunk(chunkSize_);
+            std::exception_ptr error;
+            size_t pos = 0;
+            try {
+                while (pos < chunk.size()) {
+                    long len = h.read(&chunk[pos], chunk.size() - pos);
+                    if (len < 0) {
+                        std::ostringstream oss;
+                        oss << "ReadAheadHandle: error reading " << h;
+                        throw ReadError(oss.str(), Here());
+                    }
+                    if (len == 0) {
+                        eof = true;
+                        break;
+                    }
+                    pos += len;
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            chunk.resize(pos);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            Slot& slot(slots_[i]);
+            buffered_ = buffered_ - reserved + pos;
+            reserved = 0;
+            if (pos > 0) {
+                slot.chunks_.emplace_back(std::move(chunk));
+            }
+            slot.error_ = error;
+            slot.done_ = eof || error;
+            cv_.notify_all();
+
+            if (error) {
+                return;
+            }
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& slot(slots_[i]);
+        buffered_ -= reserved;
+        slot.error_ = std::current_exception();
+        slot.done_ = true;
+        cv_.notify_all();
+    }
+}
+
+long ReadAheadHandle::read(void* buffer, long length) {
+
+    char* out = static_cast<char*>(buffer);
+    long total = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (total < length && current_ < slots_.size()) {
+
+        Slot& slot(slots_[current_]);
+        cv_.wait(lock, [&slot] { return slot.done_ || !slot.chunks_.empty(); });
+
+        if (slot.chunks_.empty()) {
+
+            // The data read before any error has been returned, so now report it
+            if (slot.error_) {
+                std::rethrow_exception(slot.error_);
+            }
+
+            ++current_;
+            position_ = 0;
+            cv_.notify_all();
+            continue;
+        }
+
+        // Workers only ever append chunks, so the front one can be copied without the lock
+        const std::vector<char>& chunk(slot.chunks_.front());
+        size_t n = std::min(size_t(length - total), chunk.size() - position_);
+        lock.unlock();
+        ::memcpy(out + total, chunk.data() + position_, n);
+        lock.lock();
+
+        total += n;
+        position_ += n;
+
+        if (position_ == chunk.size()) {
+            buffered_ -= chunk.size();
+            slot.chunks_.pop_front();
+            position_ = 0;
+            cv_.notify_all();
+        }
+    }
+
+    returned_ += total;
+    return total;
+}
+
+void ReadAheadHandle::close() {
+    stop();
+}
+
+void ReadAheadHandle::rewind() {
+    stop();
+    start();
+}
+
+Offset ReadAheadHandle::position() {
+    return returned_;
+}
+
+Offset ReadAheadHandle::seek(const Offset& offset) {
+
+    ASSERT(offset >= Offset(0));
+
+    if (size_t(offset) < returned_) {
+        rewind();
+    }
+
+    // Read through to the requested offset, or the end of the data if that comes first
+    char buffer[64 * 1024];
+    while (returned_ < size_t(offset)) {
+        long len = read(buffer, long(std::min(sizeof(buffer), size_t(offset) - returned_)));
+        if (len == 0) {
+            break;
+        }
+    }
+
+    return returned_;
+}
+
+void ReadAheadHandle::stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+
+    // n.b. reads of a chunk already in progress run to completion
+    for (std::thread& t : threads_) {
+        t.join();
+    }
+    threads_.clear();
+
+    slots_.clear();
+    buffered_ = 0;
+}
+
+Length ReadAheadHandle::size() {
+    Length total = 0;
+    for (DataHandle* h : handles_) {
+        total += h->size();
+    }
+    return total;
+}
+
+Length ReadAheadHandle::estimate() {
+    Length total = 0;
+    for (const Length& e : estimates_) {
+        total += e;
+    }
+    return total;
+}
+
+void ReadAheadHandle::print(std::ostream& s) const {
+    if (format(s) == Log::compactFormat) {
+        s << "ReadAheadHandle";
+    } else {
+        s << "ReadAheadHandle[" << Plural(handles_.size(), "handle")
+          << ",depth=" << depth_
+          << ",memoryBudget=" << memoryBudget_
+          << ",chunkSize=" << chunkSize_ << ']';
+    }
+}
+
+std::string ReadAheadHandle::title() const {
+    std::ostringstream oss;
+    oss << "ReadAhead[" << handles_.size() << "]";
+    return oss.str();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,125 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ReadAheadHandle.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_ReadAheadHandle_h
+#define fdb5_io_ReadAheadHandle_h
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/Length.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Reads a sequence of DataHandles as one, like eckit::MultiHandle, but reads up to `depth` of them ahead
+/// concurrently, each on its own thread. The data are returned in the order of the handles.
+///
+/// The handles are read in chunks of a fraction of the memory budget, and no chunk is read whilst the data
+/// buffered would then exceed the budget. The handle that the consumer is waiting on may always read one
+/// chunk, so the budget is exceeded by at most a chunk, however large the individual handles.
+///
+/// Seeking is emulated by reading through (or rewinding and reading up to) the requested offset.
+
+class ReadAheadHandle : public eckit::DataHandle {
+public:
+
+    /// Takes ownership of the handles
+    ReadAheadHandle(const std::vector<eckit::DataHandle*>& handles, size_t depth, size_t memoryBudget);
+    ReadAheadHandle(eckit::Stream&);
+    ~ReadAheadHandle() override;
+
+    // From DataHandle
+
+    eckit::Length openForRead() override;
+    void openForWrite(const eckit::Length&) override { NOTIMP; }
+    void openForAppend(const eckit::Length&) override { NOTIMP; }
+
+    long read(void*, long) override;
+    long write(const void*, long) override { NOTIMP; }
+    void close() override;
+    void rewind() override;
+
+    void print(std::ostream&) const override;
+    eckit::Length size() override;
+    eckit::Length estimate() override;
+
+    eckit::Offset position() override;
+    eckit::Offset seek(const eckit::Offset&) override;
+    bool canSeek() const override { return true; }
+
+    std::string title() const override;
+
+    // From Streamable
+
+    void encode(eckit::Stream&) const override;
+    const eckit::ReanimatorBase& reanimator() const override { return reanimator_; }
+    static const eckit::ClassSpec& classSpec() { return classSpec_; }
+
+private: // types
+
+    struct Slot {
+        Slot() : done_(false) {}
+        bool done_;                             ///< the handle has been read to the end, or has failed
+        std::deque<std::vector<char>> chunks_;  ///< read, but not yet returned to the consumer
+        std::exception_ptr error_;
+    };
+
+private: // methods
+
+    void init();
+    void start();
+    void run();
+    void readSlot(size_t i);
+    void stop();
+
+private: // members
+
+    std::vector<eckit::DataHandle*> handles_;
+    std::vector<eckit::Length> estimates_;
+
+    size_t depth_;
+    size_t memoryBudget_;
+    size_t chunkSize_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    std::vector<Slot> slots_;
+    size_t next_;       ///< the next handle to be read ahead
+    size_t current_;    ///< the handle being returned to the consumer
+    size_t position_;   ///< within the first chunk of the current handle
+    size_t buffered_;   ///< including the chunks being read
+    size_t returned_;   ///< bytes returned to the consumer since opening
+    bool stopping_;
+
+    std::vector<std::thread> threads_;
+
+    // For Streamable
+
+    static eckit::ClassSpec classSpec_;
+    static eckit::Reanimator<ReadAheadHandle> reanimator_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <limits.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include "eckit/exception/Exceptions.h"
+
+#include "fdb5/io/VectoredRead.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void preadvFully(int fd, std::vector<struct iovec>& iov, off_t offset, const eckit::PathName& path,
+                 const PReadV& preadv) {
+
+    static const size_t maxIov = IOV_MAX;
+
+    size_t i = 0;
+    while (i < iov.size()) {
+
+        if (iov[i].iov_len == 0) {
+            ++i;
+            continue;
+        }
+
+        ssize_t len;
+        SYSCALL2(len = preadv(fd, &iov[i], int(std::min(iov.size() - i, maxIov)), offset), path);
+        if (len == 0) {
+            std::ostringstream ss;
+            ss << "Unexpected end of file reading " << path << " at offset " << offset;
+            throw eckit::ReadError(ss.str(), Here());
+        }
+
+        offset += len;
+
+        // Step over the iovecs that have been filled, and trim the one that was partially filled
+
+        size_t n = len;
+        while (n > 0 && n >= iov[i].iov_len) {
+            n -= iov[i].iov_len;
+            ++i;
+        }
+        if (n > 0) {
+            iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + n;
+            iov[i].iov_len -= n;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
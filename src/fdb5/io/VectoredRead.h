@@ -0,0 +1,42 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   VectoredRead.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_VectoredRead_h
+#define fdb5_io_VectoredRead_h
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <functional>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The signature of preadv(2), so that the system call can be substituted
+typedef std::function<ssize_t(int, const struct iovec*, int, off_t)> PReadV;
+
+/// Read exactly the sum of the lengths of the iovecs, starting at offset, resuming after short reads and
+/// splitting the iovecs into calls of no more than IOV_MAX. The iovecs are consumed in the process.
+/// Throws eckit::ReadError if the file ends first.
+void preadvFully(int fd, std::vector<struct iovec>& iov, off_t offset, const eckit::PathName& path,
+                 const PReadV& preadv = ::preadv);
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -8,6 +8,8 @@
  * does it submit to any jurisdiction.
  */
 
+#include <atomic>
+#include <future>
 #include <vector>
 
 #include "eckit/log/Timer.h"
@@ -43,7 +45,8 @@ MessageArchiver::MessageArchiver(const fdb5::Key& key, bool completeTransfers, b
     fdb_(config),
     key_(key),
     completeTransfers_(completeTransfers),
-    verbose_(verbose)
+    verbose_(verbose),
+    threads_(1)
 {
 }
 
@@ -98,9 +101,28 @@ static std::vector<metkit::mars::MarsRequest> make_filter_requests(const std::st
     return r;
 }
 
+template <typename Filter>
+static std::vector<Filter> compile_filters(const std::vector<metkit::mars::MarsRequest>& requests) {
+
+    std::vector<Filter> filters;
+
+    for (const metkit::mars::MarsRequest& r : requests) {
+        Filter f;
+        for (const std::string& param : r.params()) {
+            f.emplace_back(&Key::intern(param), typename Filter::value_type::second_type());
+            for (const std::string& v : r.values(param)) {
+                f.back().second.insert(&Key::intern(v));
+            }
+        }
+        filters.emplace_back(std::move(f));
+    }
+
+    return filters;
+}
+
 void MessageArchiver::filters(const std::string& include, const std::string& exclude) {
-    include_ = make_filter_requests(include);
-    exclude_ = make_filter_requests(exclude);
+    include_ = compile_filters<Filter>(make_filter_requests(include));
+    exclude_ = compile_filters<Filter>(make_filter_requests(exclude));
 }
 
 void MessageArchiver::modifiers(const std::string& modify) {
@@ -126,9 +148,21 @@ eckit::message::Message MessageArchiver::transform(eckit::message::Message& msg)
     return msg.transform(modifiers_);
 }
 
-static bool matchAny(const metkit::mars::MarsRequest& f, const std::vector<metkit::mars::MarsRequest>& v) {
-    for (auto r = v.begin(); r != v.end(); ++r) {
-        if(f.matches(*r)) return true;
+/// As MarsRequest::matches: the key must have each of the keywords of the filter, with one of its values.
+/// The values held by Keys are interned, so they are compared by address.
+
+template <typename Filter>
+static bool matchAny(const Key& k, const std::vector<Filter>& filters) {
+    for (const Filter& filter : filters) {
+        bool match = true;
+        for (const auto& kv : filter) {
+            Key::const_iterator j = k.find(*kv.first);
+            if (j == k.end() || kv.second.find(&j->second) == kv.second.end()) {
+                match = false;
+                break;
+            }
+        }
+        if (match) return true;
     }
     return false;
 }
@@ -137,20 +171,13 @@ bool MessageArchiver::filterOut(const Key& k) const {
 
     const bool out = true;
 
-    metkit::mars::MarsRequest field;
-    for (Key::const_iterator j = k.begin(); j != k.end(); ++j) {
-        eckit::StringList s;
-        s.push_back(j->second);
-        field.values(j->first, s);
-    }
-
     // filter includes
 
-    if(include_.size() && not matchAny(field, include_)) return out;
+    if(include_.size() && not matchAny(k, include_)) return out;
 
     // filter excludes
 
-    if(exclude_.size() && matchAny(field, exclude_)) return out;
+    if(exclude_.size() && matchAny(k, exclude_)) return out;
 
     // datum wasn't filtered out
 
@@ -161,59 +188,74 @@ eckit::Channel& MessageArchiver::logVerbose() const {
     return verbose_ ? Log::info() : Log::debug<LibFdb5>();
 }
 
-eckit::Length MessageArchiver::archive(eckit::DataHandle& source) {
+bool MessageArchiver::decode(eckit::message::Message& msg, Key& key) {
 
-    eckit::Timer timer("fdb::service::archive");
+#ifdef metkit_HAVE_FAIL_ON_CCSDS
 
-    eckit::message::Reader reader(source);
+    if(msg.getString("packingType") == "grid_ccsds") {
+        throw eckit::SeriousBug("grid_ccsds is disabled");
+    }
 
-    size_t count = 0;
-    size_t total_size = 0;
+#endif
 
-    eckit::Progress progress("FDB archive", 0, source.estimate());
+    messageToKey(msg, key);
 
-    try {
+    LOG_DEBUG_LIB(LibFdb5) << "Archiving message "
+                           << " key: " << key_ << " data: " << msg.data() << " length:" << msg.length()
+                           << std::endl;
 
-        eckit::message::Message msg;
+    ASSERT(key.match(key_));
 
-        while ( (msg = reader.next()) ) {
+    if (filterOut(key))
+        return false;
 
-#ifdef metkit_HAVE_FAIL_ON_CCSDS
+    if (modifiers_.size()) {
+        msg = transform(msg);
+        key.clear();
+        messageToKey(msg, key);  // re-build the key, as it may have changed
+    }
 
-            if(msg.getString("packingType") == "grid_ccsds") {
-                throw eckit::SeriousBug("grid_ccsds is disabled");
-            }
+    return true;
+}
 
-#endif
+eckit::Length MessageArchiver::archive(eckit::DataHandle& source) {
+
+    eckit::Timer timer("fdb::service::archive");
+
+    eckit::message::Reader reader(source);
 
-            Key key;
+    size_t count = 0;
+    size_t total_size = 0;
 
-            messageToKey(msg, key);
+    eckit::Progress progress("FDB archive", 0, source.estimate());
 
-            LOG_DEBUG_LIB(LibFdb5) << "Archiving message "
-                                   << " key: " << key_ << " data: " << msg.data() << " length:" << msg.length()
-                                   << std::endl;
+    Commit commit = [&](const Key& key, const eckit::message::Message& msg) {
 
-            ASSERT(key.match(key_));
+        logVerbose() << "Archiving " << key << std::endl;
 
-            if (filterOut(key))
-                continue;
+        fdb_.archive(key, msg.data(), msg.length());
 
-            if (modifiers_.size()) {
-                msg = transform(msg);
-                key.clear();
-                messageToKey(msg, key);  // re-build the key, as it may have changed
-            }
+        total_size += msg.length();
+        count++;
+        progress(total_size);
 
-            logVerbose() << "Archiving " << key << std::endl;
+        // flush();
+    };
 
-            fdb_.archive(key, msg.data(), msg.length());
+    try {
+
+        if (threads_ > 1) {
+            archiveParallel(reader, commit);
+        } else {
 
-            total_size += msg.length();
-            count++;
-            progress(total_size);
+            eckit::message::Message msg;
 
-            // flush();
+            while ( (msg = reader.next()) ) {
+                Key key;
+                if (decode(msg, key)) {
+                    commit(key, msg);
+                }
+            }
         }
 
     } catch (...) {
@@ -236,6 +278,110 @@ eckit::Length MessageArchiver::archive(eckit::DataHandle& source) {
     return total_size;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+
+/// One call to archive() in parallel mode. Once it has failed, the decoders skip the rest of its messages.
+
+struct MessageArchiver::Transfer {
+    std::atomic<bool> cancelled_{false};
+};
+
+struct MessageArchiver::Task {
+
+    Task(const std::shared_ptr<Transfer>& transfer, const eckit::message::Message& msg) :
+        transfer_(transfer), msg_(msg), filtered_(false), future_(decoded_.get_future()) {}
+
+    std::shared_ptr<Transfer> transfer_;
+    eckit::message::Message msg_;
+    Key key_;
+    bool filtered_;
+
+    std::promise<void> decoded_;
+    std::future<void> future_;
+};
+
+void MessageArchiver::threads(size_t n) {
+
+    ASSERT(decoders_.empty());
+
+    threads_ = n;
+    if (threads_ > 1) {
+        work_.reset(new eckit::Queue<std::shared_ptr<Task>>(4 * threads_));
+        for (size_t i = 0; i < threads_; ++i) {
+            decoders_.emplace_back([this] { decoder(); });
+        }
+    }
+}
+
+MessageArchiver::~MessageArchiver() {
+    if (work_) {
+        work_->close();
+    }
+    for (std::thread& t : decoders_) {
+        t.join();
+    }
+}
+
+void MessageArchiver::decoder() {
+
+    std::shared_ptr<Task> task;
+
+    while (work_->pop(task) != -1) {
+        try {
+            if (!task->transfer_->cancelled_) {
+                task->filtered_ = !decode(task->msg_, task->key_);
+            }
+            task->decoded_.set_value();
+        } catch (...) {
+            task->decoded_.set_exception(std::current_exception());
+        }
+        task.reset();
+    }
+}
+
+void MessageArchiver::archiveParallel(eckit::message::Reader& reader, const Commit& commit) {
+
+    // The messages are read on their own thread, decoded by the pool of decoders, and committed in order on
+    // this one. The size of the ordered queue bounds how far the reading and decoding get ahead.
+
+    std::shared_ptr<Transfer> transfer = std::make_shared<Transfer>();
+    eckit::Queue<std::shared_ptr<Task>> ordered(4 * threads_);
+
+    std::thread readerThread([&reader, &ordered, &transfer, this] {
+        try {
+            eckit::message::Message msg;
+            while ( (msg = reader.next()) ) {
+                std::shared_ptr<Task> task = std::make_shared<Task>(transfer, msg);
+                ordered.push(task);
+                work_->push(task);
+            }
+            ordered.close();
+        } catch (...) {
+            ordered.interrupt(std::current_exception());
+        }
+    });
+
+    try {
+        std::shared_ptr<Task> task;
+        while (ordered.pop(task) != -1) {
+            task->future_.get();
+            if (!task->filtered_) {
+                commit(task->key_, task->msg_);
+            }
+            task.reset();
+        }
+    } catch (...) {
+        transfer->cancelled_ = true;
+        ordered.interrupt(std::current_exception());
+        readerThread.join();
+        throw;
+    }
+
+    readerThread.join();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 void MessageArchiver::flush() {
     fdb_.flush();
 }
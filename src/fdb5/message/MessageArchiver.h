@@ -15,8 +15,15 @@
 
 #pragma once
 
+#include <functional>
 #include <iosfwd>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "eckit/container/Queue.h"
 #include "eckit/io/Length.h"
 
 #include "metkit/mars/MarsRequest.h"
@@ -29,6 +36,9 @@
 
 namespace eckit {
 class DataHandle;
+namespace message {
+class Reader;
+}
 }
 
 namespace fdb5 {
@@ -47,15 +57,39 @@ public: // methods
     void filters(const std::string& include, const std::string& exclude);
     void modifiers(const std::string& modify);
 
+    /// Decode the messages (building their keys, and applying the filters and modifiers) on this many threads.
+    /// The messages are still archived one at a time, in the order in which they are read.
+    void threads(size_t n);
+
+    ~MessageArchiver();
+
     eckit::Length archive(eckit::DataHandle &source);
 
     void flush();
 
+    /// @returns true if the include and exclude filters leave out the field with this key
+    bool filterOut(const Key& k) const;
+
+private: // types
+
+    struct Transfer;
+    struct Task;
+
+    using Commit = std::function<void(const Key&, const eckit::message::Message&)>;
+
+    /// A filter request, as the values it accepts for each of its keywords (all interned, see Key::intern)
+    using Filter = std::vector<std::pair<const std::string*, std::unordered_set<const std::string*>>>;
+
 private: // protected
 
     eckit::Channel& logVerbose() const;
 
-    bool filterOut(const Key& k) const;
+    /// @returns false if the message is filtered out
+    bool decode(eckit::message::Message& msg, Key& key);
+
+    void archiveParallel(eckit::message::Reader& reader, const Commit& commit);
+
+    void decoder();
 
     eckit::message::Message transform(eckit::message::Message&);
 
@@ -65,14 +99,18 @@ private: // members
 
     fdb5::Key key_;
 
-    std::vector<metkit::mars::MarsRequest> include_;
-    std::vector<metkit::mars::MarsRequest> exclude_;
+    std::vector<Filter> include_;
+    std::vector<Filter> exclude_;
 
     eckit::StringDict modifiers_;
 
     bool completeTransfers_;
 
     bool verbose_;
+
+    size_t threads_;
+    std::unique_ptr<eckit::Queue<std::shared_ptr<Task>>> work_;
+    std::vector<std::thread> decoders_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
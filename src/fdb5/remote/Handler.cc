@@ -13,7 +13,14 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 
 #include "eckit/config/Resource.h"
 #include "eckit/maths/Functions.h"
@@ -28,6 +35,7 @@
 #include "fdb5/fdb5_version.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/database/Key.h"
+#include "fdb5/io/VectoredRead.h"
 #include "fdb5/remote/AvailablePortList.h"
 #include "fdb5/remote/Handler.h"
 #include "fdb5/remote/Messages.h"
@@ -802,10 +810,7 @@ void RemoteHandler::read(const MessageHeader& hdr) {
 
     Log::debug<LibFdb5>() << "Queuing for read: " << hdr.requestID << " " << *location << std::endl;
 
-    std::unique_ptr<eckit::DataHandle> dh;
-    dh.reset(location->dataHandle());
-
-    readLocationQueue_.emplace(std::make_pair(hdr.requestID, std::move(dh)));
+    readLocationQueue_.emplace(std::make_pair(hdr.requestID, std::move(location)));
 }
 
 void RemoteHandler::writeToParent(const uint32_t requestID, std::unique_ptr<eckit::DataHandle> dh) {
@@ -846,20 +851,251 @@ void RemoteHandler::writeToParent(const uint32_t requestID, std::unique_ptr<ecki
     }
 }
 
-void RemoteHandler::readLocationThreadLoop() {
-    std::pair<uint32_t, std::unique_ptr<eckit::DataHandle>> elem;
+namespace {
+
+constexpr size_t no_extent = size_t(-1);
+
+struct LocationRead {
+
+    LocationRead(uint32_t requestID, std::unique_ptr<FieldLocation> location) :
+        requestID_(requestID), location_(std::move(location)), length_(0), extent_(no_extent) {}
+
+    uint32_t requestID_;
+    std::unique_ptr<FieldLocation> location_;
+    std::unique_ptr<char[]> data_;
+    size_t length_;
+    std::string error_;
+    size_t extent_; ///< the extent of a plain file that the field is read with, if any
+};
+
+/// Fields of one file, sorted by offset, that are read together by one preadv() straight into their own buffers
+
+struct ReadExtent {
+    PathName path_;
+    std::vector<LocationRead*> fields_;
+    bool done_;
+};
+
+/// Split the fields of one file, sorted by offset, into extents. Fields that are adjacent, or separated by no
+/// more than fdbServerReadCoalesceGap bytes, share an extent of up to fdbServerReadMaxExtent bytes.
+
+void planExtents(const PathName& path, const std::vector<LocationRead*>& fields, std::vector<ReadExtent>& extents) {
+
+    static const size_t gap = eckit::Resource<size_t>("fdbServerReadCoalesceGap", 64 * 1024);
+    static const size_t maxExtent = eckit::Resource<size_t>("fdbServerReadMaxExtent", 64 * 1024 * 1024);
+    static const size_t maxIov = IOV_MAX;
+
+    bool first = true;
+    off_t start = 0;
+    off_t end = 0;
+    size_t niov = 0;
+
+    for (LocationRead* field : fields) {
+
+        const off_t offset = field->location_->offset();
+        const size_t length = field->location_->length();
+
+        // Overlapping fields (e.g. repeated requests) cannot share an extent
+        if (first || offset < end || size_t(offset - end) > gap || size_t(offset + length - start) > maxExtent ||
+            niov + 2 > maxIov) {
+            extents.push_back(ReadExtent{path, {}, false});
+            first = false;
+            start = offset;
+            end = offset;
+            niov = 0;
+        }
+
+        niov += (offset > end) ? 2 : 1;
+        end = offset + length;
+
+        field->extent_ = extents.size() - 1;
+        extents.back().fields_.push_back(field);
+    }
+}
+
+/// Read the fields of an extent. The holes between them are discarded.
+
+void readExtent(const ReadExtent& extent) {
+
+    const off_t start = extent.fields_.front()->location_->offset();
+
+    size_t holeSize = 0;
+    off_t end = start;
+    for (const LocationRead* field : extent.fields_) {
+        holeSize = std::max(holeSize, size_t(field->location_->offset() - end));
+        end = field->location_->offset() + off_t(field->location_->length());
+    }
+
+    std::vector<char> hole(holeSize);
+    std::vector<struct iovec> iov;
+
+    end = start;
+    for (LocationRead* field : extent.fields_) {
+        const off_t offset = field->location_->offset();
+        const size_t length = field->location_->length();
+        if (offset > end) {
+            iov.push_back({hole.data(), size_t(offset - end)});
+        }
+        field->data_.reset(new char[length]);
+        field->length_ = length;
+        iov.push_back({field->data_.get(), length});
+        end = offset + length;
+    }
+
+    int fd;
+    SYSCALL2(fd = ::open(extent.path_.localPath(), O_RDONLY), extent.path_);
+
+    try {
+        preadvFully(fd, iov, start, extent.path_);
+    }
+    catch (...) {
+        ::close(fd);
+        throw;
+    }
+
+    SYSCALL2(::close(fd), extent.path_);
+}
+
+}  // namespace
+
+void RemoteHandler::readLocations(std::vector<std::pair<uint32_t, std::unique_ptr<FieldLocation>>>& batch) {
+
+    static const size_t blobSize = 10 * 1024 * 1024;
+
+    std::vector<LocationRead> reads;
+    reads.reserve(batch.size());
+    for (auto& elem : batch) {
+        reads.emplace_back(elem.first, std::move(elem.second));
+    }
 
-    while (readLocationQueue_.pop(elem) != -1) {
-        // Get the next MarsRequest in sequence to work on, do the retrieve, and
-        // send the data back to the client.
+    Log::status() << "Reading: " << reads.size() << " fields" << std::endl;
 
-        const uint32_t requestID(elem.first);
+    // Gather the fields stored as is in plain files, by file, and plan to read them sorted by offset
 
-        // Forward the API call
-        writeToParent(elem.first, std::move(elem.second));
+    std::map<PathName, std::vector<LocationRead*>> files;
+    for (LocationRead& r : reads) {
+        if (r.location_->uri().scheme() == "file" && r.location_->remapKey().empty()) {
+            files[r.location_->uri().path()].push_back(&r);
+        }
+    }
+
+    std::vector<ReadExtent> extents;
+    for (auto& file : files) {
+        std::vector<LocationRead*>& fields(file.second);
+        std::stable_sort(fields.begin(), fields.end(), [](const LocationRead* a, const LocationRead* b) {
+            return a->location_->offset() < b->location_->offset();
+        });
+        planExtents(file.first, fields, extents);
+    }
+
+    // Reply in request order. The messages for consecutive small fields are packed into one frame, and sent
+    // with a single write to the data socket.
+
+    Buffer frame(blobSize + sizeof(MessageHeader) + sizeof(EndMarker));
+    size_t framePos = 0;
+
+    auto flushFrame = [&] {
+        if (framePos > 0) {
+            std::lock_guard<std::mutex> lock(dataWriteMutex_);
+            dataWriteUnsafe(frame, framePos);
+            framePos = 0;
+        }
+    };
+
+    auto frameMessage = [&](Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
+        const size_t size = sizeof(MessageHeader) + payloadLength + sizeof(EndMarker);
+        if (framePos + size > frame.size()) {
+            flushFrame();
+        }
+        MessageHeader message(msg, requestID, payloadLength);
+        char* pos = static_cast<char*>(frame.data()) + framePos;
+        ::memcpy(pos, &message, sizeof(message));
+        if (payloadLength > 0) {
+            ::memcpy(pos + sizeof(message), payload, payloadLength);
+        }
+        ::memcpy(pos + sizeof(message) + payloadLength, &EndMarker, sizeof(EndMarker));
+        framePos += size;
+    };
+
+    for (LocationRead& r : reads) {
+
+        if (r.extent_ == no_extent) {
+            flushFrame();
+            std::unique_ptr<DataHandle> dh;
+            try {
+                dh.reset(r.location_->dataHandle());
+            }
+            catch (std::exception& e) {
+                // n.b. more general than eckit::Exception
+                std::string what(e.what());
+                dataWrite(Message::Error, r.requestID_, what.c_str(), what.length());
+                continue;
+            }
+            writeToParent(r.requestID_, std::move(dh));
+            continue;
+        }
+
+        // Each extent is only read once a reply needs it, so that replies start to flow after the first read.
+        // Whatever is ready is sent before blocking on the read.
+
+        ReadExtent& extent(extents[r.extent_]);
+        if (!extent.done_) {
+            flushFrame();
+            try {
+                readExtent(extent);
+            }
+            catch (std::exception& e) {
+                // n.b. more general than eckit::Exception
+                for (LocationRead* field : extent.fields_) {
+                    field->error_ = e.what();
+                }
+            }
+            extent.done_ = true;
+        }
+
+        if (!r.error_.empty()) {
+            frameMessage(Message::Error, r.requestID_, r.error_.c_str(), r.error_.length());
+            continue;
+        }
+
+        for (size_t pos = 0; pos < r.length_; pos += blobSize) {
+            frameMessage(Message::Blob, r.requestID_, r.data_.get() + pos, std::min(blobSize, r.length_ - pos));
+        }
+        frameMessage(Message::Complete, r.requestID_, nullptr, 0);
+
+        // Release the data as soon as it has been queued to go
+        r.data_.reset();
     }
+
+    flushFrame();
+
+    Log::status() << "Done reading: " << reads.size() << " fields" << std::endl;
 }
 
+void RemoteHandler::readLocationThreadLoop() {
+
+    // Serve the reads in batches of whatever has been queued so far, so that they can be merged
+
+    static const size_t maxBatchSize = eckit::Resource<size_t>("fdbServerReadBatchSize", 1024);
+    static const size_t maxBatchMemory = eckit::Resource<size_t>("fdbServerReadBatchMemory", 256 * 1024 * 1024);
+
+    std::vector<std::pair<uint32_t, std::unique_ptr<FieldLocation>>> batch;
+    std::pair<uint32_t, std::unique_ptr<FieldLocation>> elem;
+    size_t batchMemory = 0;
+
+    long queuelen;
+    while ((queuelen = readLocationQueue_.pop(elem)) != -1) {
+
+        batchMemory += size_t(elem.second->length());
+        batch.emplace_back(std::move(elem));
+
+        if (queuelen == 0 || batch.size() >= maxBatchSize || batchMemory >= maxBatchMemory) {
+            readLocations(batch);
+            batch.clear();
+            batchMemory = 0;
+        }
+    }
+}
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -22,6 +22,7 @@
 
 #include <future>
 #include <mutex>
+#include <vector>
 
 #include "eckit/io/Buffer.h"
 #include "eckit/io/DataHandle.h"
@@ -33,6 +34,7 @@
 
 #include "fdb5/api/FDB.h"
 #include "fdb5/config/Config.h"
+#include "fdb5/database/FieldLocation.h"
 #include "fdb5/database/Key.h"
 #include "fdb5/remote/Messages.h"
 
@@ -96,6 +98,11 @@ private:  // methods
 
     void writeToParent(const uint32_t requestID, std::unique_ptr<eckit::DataHandle> dh);
 
+    /// Serve a batch of queued reads. The reads from plain files are sorted, merged and done with vectored I/O,
+    /// but the responses are always sent in the order in which the requests arrived. Each merged read is only
+    /// done when the first response that needs it is due, so the responses are streamed as the reads complete.
+    void readLocations(std::vector<std::pair<uint32_t, std::unique_ptr<FieldLocation>>>& batch);
+
     size_t archiveThreadLoop(uint32_t id);
     void readLocationThreadLoop();
 
@@ -122,7 +129,7 @@ private:  // members
     // Retrieve helpers
 
     std::thread readLocationWorker_;
-    eckit::Queue<std::pair<uint32_t, std::unique_ptr<eckit::DataHandle>>> readLocationQueue_;
+    eckit::Queue<std::pair<uint32_t, std::unique_ptr<FieldLocation>>> readLocationQueue_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
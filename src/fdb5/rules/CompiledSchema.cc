@@ -0,0 +1,364 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+
+#include "fdb5/database/Key.h"
+#include "fdb5/database/WriteVisitor.h"
+#include "fdb5/rules/CompiledSchema.h"
+#include "fdb5/rules/MatchHidden.h"
+#include "fdb5/rules/Predicate.h"
+#include "fdb5/rules/Rule.h"
+#include "fdb5/rules/Schema.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The Keys handed to the visitor. Their storage is reused from one field to the next.
+
+struct CompiledSchema::Scratch {
+    Key keys_[3];
+    Key full_;
+};
+
+struct CompiledSchema::State {
+
+    State(const Key& field, WriteVisitor& visitor, Scratch& scratch, const Key* dbKey, size_t numKeywords) :
+        field_(field), visitor_(visitor), scratch_(scratch), dbKey_(dbKey) {
+        std::fill_n(resolved_, numKeywords, false);
+        std::fill_n(sizes_, 3, 0);
+    }
+
+    const Key& field_;
+    WriteVisitor& visitor_;
+    Scratch& scratch_;
+    const Key* dbKey_; ///< when expanding from the second level
+
+    const std::string* values_[maxKeywords];
+    bool resolved_[maxKeywords];
+
+    Entry entries_[3][maxPredicates];
+    size_t sizes_[3];
+};
+
+/// Expansions nest (the first level of one schema continues into the second level of the DB's schema), so each
+/// one in progress on a thread takes its own Scratch.
+
+class CompiledSchema::ScratchLease {
+public:
+    ScratchLease() {
+        if (used_ == pool_.size()) {
+            pool_.emplace_back(new Scratch);
+        }
+        scratch_ = pool_[used_++].get();
+    }
+    ~ScratchLease() { --used_; }
+
+    Scratch& scratch() { return *scratch_; }
+
+private:
+    Scratch* scratch_;
+    static thread_local std::vector<std::unique_ptr<Scratch>> pool_;
+    static thread_local size_t used_;
+};
+
+thread_local std::vector<std::unique_ptr<CompiledSchema::Scratch>> CompiledSchema::ScratchLease::pool_;
+thread_local size_t CompiledSchema::ScratchLease::used_ = 0;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::unique_ptr<CompiledSchema> CompiledSchema::compile(const std::vector<Rule*>& rules) {
+
+    std::unique_ptr<CompiledSchema> compiled(new CompiledSchema);
+
+    for (const Rule* rule : rules) {
+        size_t index;
+        if (!compiled->add(*rule, 0, index)) {
+            return nullptr;
+        }
+        compiled->topRules_.push_back(index);
+    }
+
+    if (compiled->keywords_.size() > maxKeywords) {
+        return nullptr;
+    }
+
+    return compiled;
+}
+
+size_t CompiledSchema::intern(const std::string& keyword) {
+    const std::string* interned = &Key::intern(keyword);
+    auto it = std::find(keywords_.begin(), keywords_.end(), interned);
+    if (it != keywords_.end()) {
+        return it - keywords_.begin();
+    }
+    keywords_.push_back(interned);
+    return keywords_.size() - 1;
+}
+
+bool CompiledSchema::add(const Rule& rule, size_t depth, size_t& index) {
+
+    ASSERT(depth < 3);
+
+    if (rule.predicates_.size() > maxPredicates) {
+        return false;
+    }
+
+    index = rules_.size();
+    rules_.push_back(CompiledRule{&rule, depth, steps_.size(), 0, 0, 0});
+
+    for (const fdb5::Predicate* predicate : rule.predicates_) {
+
+        const Matcher& matcher(predicate->matcher());
+
+        Source source = Source::Field;
+        if (dynamic_cast<const MatchHidden*>(&matcher)) {
+            source = Source::Default;
+        } else if (matcher.optional()) {
+            source = Source::FieldOrDefault;
+        }
+
+        const std::string* def = (source == Source::Field) ? nullptr : &Key::intern(matcher.defaultValue());
+
+        steps_.push_back(Step{intern(predicate->keyword()), &matcher, source, def});
+    }
+    rules_[index].endStep_ = steps_.size();
+
+    // The children of a rule are contiguous in children_, so are added once their own subtrees are done
+
+    std::vector<size_t> children;
+    for (const Rule* child : rule.rules_) {
+        size_t childIndex;
+        if (!add(*child, depth + 1, childIndex)) {
+            return false;
+        }
+        children.push_back(childIndex);
+    }
+
+    rules_[index].firstChild_ = children_.size();
+    children_.insert(children_.end(), children.begin(), children.end());
+    rules_[index].endChild_ = children_.size();
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void CompiledSchema::expand(const Key& field, WriteVisitor& visitor) const {
+
+    ScratchLease lease;
+    State state(field, visitor, lease.scratch(), nullptr, keywords_.size());
+
+    visitor.rule(0); // reset to no rule so we verify that we pick at least one
+
+    for (size_t rule : topRules_) {
+        expand(state, rule, rules_[rule].firstStep_);
+    }
+}
+
+void CompiledSchema::expandSecond(const Key& field, WriteVisitor& visitor, const Key& dbKey) const {
+
+    const CompiledRule* dbRule = nullptr;
+    for (size_t rule : topRules_) {
+        if (rules_[rule].rule_->match(dbKey)) {
+            dbRule = &rules_[rule];
+            break;
+        }
+    }
+    ASSERT(dbRule);
+
+    ScratchLease lease;
+    State state(field, visitor, lease.scratch(), &dbKey, keywords_.size());
+
+    for (size_t i = dbRule->firstChild_; i != dbRule->endChild_; ++i) {
+        size_t rule = children_[i];
+        expand(state, rule, rules_[rule].firstStep_);
+    }
+}
+
+void CompiledSchema::expand(State& state, size_t rule, size_t step) const {
+
+    static bool matchFirstFdbRule = eckit::Resource<bool>("matchFirstFdbRule", true);
+
+    if (matchFirstFdbRule && state.visitor_.rule()) {
+        return;
+    }
+
+    const CompiledRule& r(rules_[rule]);
+
+    if (step == r.endStep_) {
+        endOfRule(state, r);
+        return;
+    }
+
+    const Step& s(steps_[step]);
+    const std::string& v(value(state, s));
+
+    size_t& n(state.sizes_[r.depth_]);
+    state.entries_[r.depth_][n++] = Entry{keywords_[s.keyword_], &v};
+
+    if (s.matcher_->match(v)) {
+        expand(state, rule, step + 1);
+    }
+
+    --n;
+}
+
+void CompiledSchema::endOfRule(State& state, const CompiledRule& rule) const {
+
+    WriteVisitor& visitor(state.visitor_);
+    Scratch& scratch(state.scratch_);
+    const size_t depth = rule.depth_;
+
+    // As in Rule::expand(), the full key starts from the DB key when expanding from the second level
+
+    const Key* base = state.dbKey_;
+    const size_t from = base ? 1 : 0;
+
+    Key& key(scratch.keys_[depth]);
+    assign(key, nullptr, state, depth, depth);
+    key.rule(rule.rule_);
+
+    if (rule.firstChild_ == rule.endChild_) {
+        ASSERT(depth == 2); /// we have 3 levels ATM
+        if (visitor.rule() != 0) {
+            std::ostringstream oss;
+            oss << "More than one rule matching "
+                << (base ? *base : scratch.keys_[0]) << ", "
+                << scratch.keys_[1] << ", "
+                << scratch.keys_[2] << " "
+                << rule.rule_->topRule() << " and "
+                << visitor.rule()->topRule();
+            throw eckit::SeriousBug(oss.str());
+        }
+        visitor.rule(rule.rule_);
+        assign(scratch.full_, base, state, from, depth);
+        visitor.selectDatum(key, scratch.full_);
+        return;
+    }
+
+    switch (depth) {
+    case 0:
+        if (key != visitor.prev_[0]) {
+            assign(scratch.full_, base, state, from, depth);
+            visitor.selectDatabase(key, scratch.full_);
+            visitor.prev_[0] = key;
+            visitor.prev_[1] = Key();
+        }
+
+        // Here we recurse on the database's schema (rather than the master schema)
+        visitor.databaseSchema().expandSecond(state.field_, visitor, key);
+        return;
+
+    case 1:
+        if (key != visitor.prev_[1]) {
+            assign(scratch.full_, base, state, from, depth);
+            visitor.selectIndex(key, scratch.full_);
+            visitor.prev_[1] = key;
+        }
+        break;
+
+    default:
+        ASSERT(depth == 0 || depth == 1);
+        break;
+    }
+
+    for (size_t i = rule.firstChild_; i != rule.endChild_; ++i) {
+        size_t child = children_[i];
+        expand(state, child, rules_[child].firstStep_);
+    }
+}
+
+const std::string& CompiledSchema::value(State& state, const Step& step) const {
+
+    if (step.source_ == Source::Default) {
+        return *step.default_;
+    }
+
+    const size_t k = step.keyword_;
+    if (!state.resolved_[k]) {
+        Key::const_iterator it = state.field_.findInterned(keywords_[k]);
+        state.values_[k] = (it == state.field_.end()) ? nullptr : &it->second;
+        state.resolved_[k] = true;
+    }
+
+    if (state.values_[k]) {
+        return *state.values_[k];
+    }
+
+    if (step.source_ == Source::FieldOrDefault) {
+        return *step.default_;
+    }
+
+    // Throws, exactly as the uncompiled expansion does
+    return state.field_.get(*keywords_[k]);
+}
+
+void CompiledSchema::assign(Key& key, const Key* base, const State& state, size_t from, size_t to) {
+
+    const std::vector<const std::string*>& names(key.internedNames());
+
+    // If the key already has the same keywords in the same order, only the values need (re)assigning
+
+    size_t count = base ? base->internedNames().size() : 0;
+    for (size_t depth = from; depth <= to; ++depth) {
+        count += state.sizes_[depth];
+    }
+
+    bool same = (names.size() == count);
+    size_t pos = 0;
+    if (same && base) {
+        for (const std::string* name : base->internedNames()) {
+            if (names[pos++] != name) {
+                same = false;
+                break;
+            }
+        }
+    }
+    for (size_t depth = from; same && depth <= to; ++depth) {
+        for (size_t i = 0; i < state.sizes_[depth]; ++i) {
+            if (names[pos++] != state.entries_[depth][i].keyword_) {
+                same = false;
+                break;
+            }
+        }
+    }
+
+    if (!same) {
+        key.clear();
+    }
+
+    if (base) {
+        for (const std::string* name : base->internedNames()) {
+            Key::const_iterator it = base->findInterned(name);
+            ASSERT(it != base->end());
+            const std::string* value = &it->second;
+            same ? key.setInterned(name, value) : key.pushInterned(name, value);
+        }
+    }
+
+    for (size_t depth = from; depth <= to; ++depth) {
+        for (size_t i = 0; i < state.sizes_[depth]; ++i) {
+            const Entry& e(state.entries_[depth][i]);
+            same ? key.setInterned(e.keyword_, e.value_) : key.pushInterned(e.keyword_, e.value_);
+        }
+    }
+
+    key.rule(base ? base->rule() : nullptr);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
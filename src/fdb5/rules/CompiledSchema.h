@@ -0,0 +1,117 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   CompiledSchema.h
+/// @date   Oct 2026
+
+#ifndef fdb5_CompiledSchema_H
+#define fdb5_CompiledSchema_H
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/memory/NonCopyable.h"
+
+namespace fdb5 {
+
+class Key;
+class Matcher;
+class Rule;
+class WriteVisitor;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The rules of a Schema flattened into tables, for the write side expansion of field keys.
+///
+/// The rule tree is laid out in arrays of rules and steps (predicates), and the keywords are interned, so that expand()
+/// walks the same rules in the same order as Rule::expand(), with the same calls on the visitor, but keeps the
+/// partial keys as arrays of pointers on the stack. Keys are only built to be handed to the visitor, and the
+/// (thread local) Keys used for that are reused from one field to the next, so that once warmed up an expansion
+/// makes no heap allocations of its own.
+
+class CompiledSchema : private eckit::NonCopyable {
+
+public: // methods
+
+    /// @returns null if the rules are beyond the fixed limits of the compiled form
+    static std::unique_ptr<CompiledSchema> compile(const std::vector<Rule*>& rules);
+
+    void expand(const Key& field, WriteVisitor& visitor) const;
+    void expandSecond(const Key& field, WriteVisitor& visitor, const Key& dbKey) const;
+
+    size_t numKeywords() const { return keywords_.size(); }
+
+private: // types
+
+    static constexpr size_t maxKeywords = 256;
+    static constexpr size_t maxPredicates = 64; ///< per rule, hence per level
+
+    enum class Source : unsigned char {
+        Field,          ///< the value must be in the field key
+        FieldOrDefault, ///< optional keyword
+        Default         ///< hidden keyword
+    };
+
+    struct Step {
+        size_t keyword_;
+        const Matcher* matcher_;
+        Source source_;
+        const std::string* default_;
+    };
+
+    struct CompiledRule {
+        const Rule* rule_;
+        size_t depth_;
+        size_t firstStep_;
+        size_t endStep_;
+        size_t firstChild_;
+        size_t endChild_;
+    };
+
+    struct Entry {
+        const std::string* keyword_;
+        const std::string* value_;
+    };
+
+    struct Scratch;
+    struct State;
+    class ScratchLease;
+
+private: // methods
+
+    CompiledSchema() = default;
+
+    size_t intern(const std::string& keyword);
+    bool add(const Rule& rule, size_t depth, size_t& index);
+
+    void expand(State& state, size_t rule, size_t step) const;
+    void endOfRule(State& state, const CompiledRule& rule) const;
+
+    const std::string& value(State& state, const Step& step) const;
+
+    /// Set the key to the base key (if any) followed by the entries of the levels [from, to]
+    static void assign(Key& key, const Key* base, const State& state, size_t from, size_t to);
+
+private: // members
+
+    std::vector<const std::string*> keywords_; ///< interned (see Key::intern)
+    std::vector<Step> steps_;
+    std::vector<CompiledRule> rules_;
+    std::vector<size_t> children_;
+    std::vector<size_t> topRules_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
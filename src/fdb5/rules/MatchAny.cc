@@ -35,6 +35,10 @@ bool MatchAny::match(const std::string &keyword, const Key &key) const {
     return (values_.find(i->second) != values_.end());
 }
 
+bool MatchAny::match(const std::string &value) const {
+    return values_.find(value) != values_.end();
+}
+
 void MatchAny::dump(std::ostream &s, const std::string &keyword, const TypesRegistry &registry) const {
     const char *sep = "";
     registry.dump(s, keyword);
@@ -34,6 +34,7 @@ public: // methods
     virtual ~MatchAny() override;
 
     virtual bool match(const std::string &keyword, const Key &key) const override;
+    virtual bool match(const std::string &value) const override;
 
     virtual void dump(std::ostream &s, const std::string &keyword, const TypesRegistry &registry) const override;
 
@@ -34,6 +34,10 @@ bool MatchValue::match(const std::string &keyword, const Key &key) const {
     return ( i->second == value_ );
 }
 
+bool MatchValue::match(const std::string &value) const {
+    return value == value_;
+}
+
 void MatchValue::dump(std::ostream &s, const std::string &keyword, const TypesRegistry &registry) const {
     registry.dump(s, keyword);
     s << "=" << value_;
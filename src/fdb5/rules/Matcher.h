@@ -50,6 +50,9 @@ public: // methods
     virtual const std::string &defaultValue() const;
 
     virtual bool match(const std::string &keyword, const Key &key) const = 0;
+
+    /// Match the value of the keyword directly, as used by the CompiledSchema
+    virtual bool match(const std::string &value) const = 0;
     virtual void fill(Key &key, const std::string &keyword, const std::string& value) const;
 
 
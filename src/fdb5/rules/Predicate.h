@@ -53,6 +53,8 @@ public: // methods
 
     std::string keyword() const;
 
+    const Matcher& matcher() const { return *matcher_; }
+
 private: // methods
 
     friend std::ostream &operator<<(std::ostream &s, const Predicate &x);
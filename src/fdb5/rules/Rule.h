@@ -128,6 +128,7 @@ private: // members
     TypesRegistry registry_;
 
     friend class Schema;
+    friend class CompiledSchema;
     size_t line_;
 
 };
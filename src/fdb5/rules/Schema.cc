@@ -10,7 +10,10 @@
 
 #include <fstream>
 
+#include "eckit/config/Resource.h"
+
 #include "fdb5/LibFdb5.h"
+#include "fdb5/rules/CompiledSchema.h"
 #include "fdb5/rules/Schema.h"
 #include "fdb5/rules/Rule.h"
 #include "fdb5/database/Key.h"
@@ -62,6 +65,12 @@ void Schema::expand(const metkit::mars::MarsRequest &request, ReadVisitor &visit
 }
 
 void Schema::expand(const Key &field, WriteVisitor &visitor) const {
+
+    if (compiled_) {
+        compiled_->expand(field, visitor);
+        return;
+    }
+
     Key full;
     std::vector<Key> keys(3);
 
@@ -94,6 +103,11 @@ void Schema::expandSecond(const metkit::mars::MarsRequest& request, ReadVisitor&
 
 void Schema::expandSecond(const Key& field, WriteVisitor& visitor, const Key& dbKey) const {
 
+    if (compiled_) {
+        compiled_->expandSecond(field, visitor, dbKey);
+        return;
+    }
+
     const Rule* dbRule = nullptr;
     for (const Rule* r : rules_) {
         if (r->match(dbKey)) {
@@ -165,9 +179,28 @@ void Schema::load(std::istream& s, bool replace) {
     parser.parse(*this, rules_, registry_);
 
     check();
+
+    static bool fdbCompiledSchema = eckit::Resource<bool>("fdbCompiledSchema;$FDB_COMPILED_SCHEMA", true);
+
+    compiled(fdbCompiledSchema);
+}
+
+bool Schema::compiled() const {
+    return bool(compiled_);
+}
+
+void Schema::compiled(bool use) {
+    compiled_.reset();
+    if (use) {
+        compiled_ = CompiledSchema::compile(rules_);
+        if (!compiled_) {
+            eckit::Log::debug<LibFdb5>() << "Schema " << path_ << " is not compiled, using the rule tree" << std::endl;
+        }
+    }
 }
 
 void Schema::clear() {
+    compiled_.reset();
     for (std::vector<Rule *>::iterator i = rules_.begin(); i != rules_.end(); ++i ) {
         delete *i;
     }
@@ -17,6 +17,7 @@
 #define fdb5_Schema_H
 
 #include <iosfwd>
+#include <memory>
 #include <vector>
 
 #include "eckit/exception/Exceptions.h"
@@ -30,6 +31,7 @@ namespace metkit { class MarsRequest; }
 
 namespace fdb5 {
 
+class CompiledSchema;
 class Key;
 class Rule;
 class ReadVisitor;
@@ -77,6 +79,10 @@ public: // methods
 
     const TypesRegistry& registry() const;
 
+    /// Whether the write side expansion uses the compiled rules (see fdbCompiledSchema). Turning them off
+    /// here, to expand with the rule tree, is for checking the one against the other.
+    bool compiled() const;
+    void compiled(bool use);
 
 private: // methods
 
@@ -93,6 +99,9 @@ private: // members
     std::vector<Rule *>  rules_;
     std::string path_;
 
+    /// Used by the write side expansion, when available
+    std::unique_ptr<CompiledSchema> compiled_;
+
 };
 
 //----------------------------------------------------------------------------------------------------------------------
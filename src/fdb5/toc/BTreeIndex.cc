@@ -11,7 +11,9 @@
 #include "eckit/log/BigNum.h"
 #include "eckit/config/Resource.h"
 
+#include "fdb5/database/Key.h"
 #include "fdb5/toc/BTreeIndex.h"
+#include "fdb5/toc/BinaryIndexKey.h"
 #include "fdb5/toc/TocIndex.h"
 #include "fdb5/toc/FieldRef.h"
 
@@ -149,11 +151,110 @@ BTREE(32, 65536, FieldRefFull);
 BTREE(32, 4194304, FieldRefReduced);
 
 
+//----------------------------------------------------------------------------------------------------------------------
+
+template<int KEYSIZE, int RECSIZE, typename PAYLOAD>
+class TBinaryBTreeIndex : public BTreeIndex {
+
+public: // types
+
+    typedef BinaryIndexKey<KEYSIZE> BTreeKey;
+    typedef eckit::BTree<BTreeKey, PAYLOAD, RECSIZE> BTreeStore;
+
+public: // methods
+
+    TBinaryBTreeIndex(const eckit::PathName &path, bool readOnly, off_t offset) :
+        btree_(path, readOnly, offset) {}
+
+    ~TBinaryBTreeIndex() {
+        btree_.funlock();
+    }
+
+private: // methods
+
+    bool get(const Key& key, FieldRef& data) const override {
+        PAYLOAD payload;
+        bool found = btree_.get(BTreeKey(key), payload);
+        if (found) {
+            data = FieldRef(payload);
+        }
+        return found;
+    }
+
+    bool set(const Key& key, const FieldRef& data) override {
+        PAYLOAD payload(data);
+        return btree_.set(BTreeKey(key), payload);
+    }
+
+    /// The fingerprint holds the canonical values, which is all that the encoding uses
+    bool get(const std::string& key, FieldRef& data) const override {
+        PAYLOAD payload;
+        bool found = btree_.get(BTreeKey(key), payload);
+        if (found) {
+            data = FieldRef(payload);
+        }
+        return found;
+    }
+
+    bool set(const std::string& key, const FieldRef& data) override {
+        PAYLOAD payload(data);
+        return btree_.set(BTreeKey(key), payload);
+    }
+
+    void flush() override { btree_.flush(); }
+    void sync() override { btree_.sync(); }
+    void flock() override { btree_.flock(); }
+    void funlock() override { btree_.funlock(); }
+    void preload() override { btree_.preload(); }
+
+    void visit(BTreeIndexVisitor& visitor) const override {
+        Visitor v(visitor);
+        btree_.range(BTreeKey(), BTreeKey::max(), v);
+    }
+
+private: // types
+
+    class Visitor {
+        BTreeIndexVisitor& visitor_;
+    public:
+        Visitor(BTreeIndexVisitor& visitor) : visitor_(visitor) {}
+
+        // BTree::range() expect a STL like collection
+
+        void clear() {}
+
+        void push_back(const typename BTreeStore::result_type& kv) {
+            visitor_.visit(kv.first.fingerprint(), kv.second);
+        }
+    };
+
+private: // members
+
+    mutable BTreeStore btree_;
+};
+
+#define BINARY_BTREE(KEYSIZE, RECSIZE, PAYLOAD)                                                                  \
+struct BinaryBTreeIndex_##KEYSIZE##_##RECSIZE##_##PAYLOAD : public TBinaryBTreeIndex<KEYSIZE, RECSIZE, PAYLOAD> { \
+    BinaryBTreeIndex_##KEYSIZE##_##RECSIZE##_##PAYLOAD (const eckit::PathName& path, bool readOnly, off_t offset): \
+        TBinaryBTreeIndex<KEYSIZE, RECSIZE, PAYLOAD>(path, readOnly, offset){};                                  \
+}
+
+BINARY_BTREE(24, 65536, FieldRefReduced);
+BINARY_BTREE(32, 65536, FieldRefReduced);
+
 //----------------------------------------------------------------------------------------------------------------------
 
 BTreeIndex::~BTreeIndex() {
 }
 
+bool BTreeIndex::get(const Key& key, FieldRef& data) const {
+    return get(key.valuesToString(), data);
+}
+
+bool BTreeIndex::set(const Key& key, const FieldRef& data) {
+    return set(key.valuesToString(), data);
+}
+
 
 const std::string& BTreeIndex::defaulType() {
     static std::string fdbIndexType = eckit::Resource<std::string>("fdbIndexType;$FDB_INDEX_TYPE", "BTreeIndex");
@@ -164,6 +265,9 @@ static BTreeIndexBuilder<BTreeIndex_32_65536_FieldRefReduced>   defaultIndex("BT
 static BTreeIndexBuilder<BTreeIndex_32_65536_FieldRefFull>      PointDBIndex("PointDBIndex");
 static BTreeIndexBuilder<BTreeIndex_32_4194304_FieldRefReduced> BTreeIndex4MB("BTreeIndex4MB");
 
+static BTreeIndexBuilder<BinaryBTreeIndex_24_65536_FieldRefReduced> BinaryIndex("BTreeIndexBinary");
+static BTreeIndexBuilder<BinaryBTreeIndex_32_65536_FieldRefReduced> BinaryIndex32("BTreeIndexBinary32");
+
 //----------------------------------------------------------------------------------------------------------------------
 
 } // namespace fdb5
@@ -29,6 +29,7 @@
 namespace fdb5 {
 
 class FieldRef;
+class Key;
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -43,6 +44,11 @@ public:
     virtual ~BTreeIndex();
     virtual bool get(const std::string& key, FieldRef& data) const = 0;
     virtual bool set(const std::string& key, const FieldRef& data)= 0;
+
+    /// Index types that do not key on the values fingerprint override these. Visitors are always given
+    /// the fingerprint.
+    virtual bool get(const Key& key, FieldRef& data) const;
+    virtual bool set(const Key& key, const FieldRef& data);
     virtual void flush() = 0;
     virtual void sync() = 0;
     virtual void visit(BTreeIndexVisitor& visitor) const = 0;
@@ -0,0 +1,183 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   BinaryIndexKey.h
+/// @date   Oct 2026
+
+#ifndef fdb5_toc_BinaryIndexKey_H
+#define fdb5_toc_BinaryIndexKey_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Keys of the binary index types. The values of the key, canonicalised by their Type, are encoded as a tuple of
+/// self-delimiting elements, such that memcmp order is a consistent total order, and the padding sorts first:
+///
+///   - canonical integers: a tag giving the sign and number of significant bytes, then those bytes big-endian
+///     (complemented for negative numbers). 850 takes 3 bytes rather than 4, 20261018 takes 5 rather than 9.
+///   - anything else: a tag, the characters and a terminating NUL.
+///
+/// The encoding depends on the canonical values only, so a key is encoded from its values fingerprint.
+/// It is reversible, so that visitors are still given the usual fingerprint.
+
+template<int SIZE>
+class BinaryIndexKey {
+
+    enum : unsigned char {
+        Padding = 0x00,
+        Integer = 0x10, ///< Integer - n is a negative number with n bytes, Integer + n a positive one
+        String  = 0x20
+    };
+
+public: // methods
+
+    BinaryIndexKey() { ::memset(data_, Padding, SIZE); }
+
+    explicit BinaryIndexKey(const Key& key) : BinaryIndexKey(key.valuesToString()) {}
+
+    /// From the ':' separated canonical values, as given by Key::valuesToString()
+    explicit BinaryIndexKey(const std::string& fingerprint) {
+        std::vector<std::string> values;
+        size_t start = 0;
+        size_t colon;
+        while ((colon = fingerprint.find(':', start)) != std::string::npos) {
+            values.push_back(fingerprint.substr(start, colon - start));
+            start = colon + 1;
+        }
+        values.push_back(fingerprint.substr(start));
+        encode(values, fingerprint);
+    }
+
+    static BinaryIndexKey max() {
+        BinaryIndexKey k;
+        ::memset(k.data_, 0xff, SIZE);
+        return k;
+    }
+
+    /// The ':' separated values, as given by Key::valuesToString()
+    std::string fingerprint() const {
+        std::string result;
+        size_t pos = 0;
+        bool first = true;
+        while (pos < SIZE && data_[pos] != Padding) {
+            if (!first) result += ':';
+            first = false;
+            unsigned char tag = data_[pos++];
+            if (tag == String) {
+                const char* s = reinterpret_cast<const char*>(&data_[pos]);
+                size_t len = ::strnlen(s, SIZE - pos);
+                ASSERT(pos + len < SIZE);
+                result.append(s, len);
+                pos += len + 1;
+            } else {
+                ASSERT(tag >= Integer - 8 && tag <= Integer + 8);
+                bool negative = tag < Integer;
+                size_t len = negative ? Integer - tag : tag - Integer;
+                ASSERT(pos + len <= SIZE);
+                uint64_t u = 0;
+                for (size_t i = 0; i < len; ++i) {
+                    u = (u << 8) | (negative ? static_cast<unsigned char>(~data_[pos + i]) : data_[pos + i]);
+                }
+                pos += len;
+                result += negative ? std::to_string(-static_cast<int64_t>(u) - 1) : std::to_string(u);
+            }
+        }
+        return result;
+    }
+
+    const unsigned char* data() const { return data_; }
+
+    bool operator<(const BinaryIndexKey& other) const { return ::memcmp(data_, other.data_, SIZE) < 0; }
+    bool operator>(const BinaryIndexKey& other) const { return ::memcmp(data_, other.data_, SIZE) > 0; }
+    bool operator==(const BinaryIndexKey& other) const { return ::memcmp(data_, other.data_, SIZE) == 0; }
+    bool operator!=(const BinaryIndexKey& other) const { return !(*this == other); }
+
+    friend std::ostream& operator<<(std::ostream& s, const BinaryIndexKey& k) {
+        s << k.fingerprint();
+        return s;
+    }
+
+    /// Only integers written canonically (no sign but '-', no leading zeros or spaces, and at most 18 digits)
+    /// are encoded as such, so that the original value is recovered exactly. Anything else is a string.
+    static bool integer(const std::string& value, int64_t& n) {
+        size_t digits = (!value.empty() && value[0] == '-') ? 1 : 0;
+        if (value.size() == digits || value.size() - digits > 18) return false;
+        if (value[digits] == '0' && (value.size() > digits + 1 || digits == 1)) return false;
+        for (size_t i = digits; i < value.size(); ++i) {
+            if (value[i] < '0' || value[i] > '9') return false;
+        }
+        n = std::stoll(value);
+        return true;
+    }
+
+private: // methods
+
+    void encode(const std::vector<std::string>& values, const std::string& original) {
+        size_t pos = 0;
+        for (const std::string& value : values) {
+            int64_t n;
+            if (integer(value, n)) {
+                encodeInteger(n, pos);
+            } else {
+                if (pos + value.size() + 2 > SIZE) overflow(original);
+                data_[pos++] = String;
+                ::memcpy(&data_[pos], value.c_str(), value.size() + 1);
+                pos += value.size() + 1;
+            }
+            if (pos > SIZE) overflow(original);
+        }
+        ::memset(&data_[pos], Padding, SIZE - pos);
+    }
+
+    void encodeInteger(int64_t n, size_t& pos) {
+        bool negative = n < 0;
+        uint64_t u = negative ? static_cast<uint64_t>(-(n + 1)) : static_cast<uint64_t>(n);
+        size_t len = 0;
+        while (len < 8 && (u >> (8 * len)) != 0) ++len;
+        if (negative && len == 0) len = 1;
+        if (pos + 1 + len > SIZE) {
+            pos = SIZE + 1;
+            return;
+        }
+        data_[pos++] = negative ? Integer - len : Integer + len;
+        for (size_t i = len; i > 0; --i) {
+            unsigned char b = (u >> (8 * (i - 1))) & 0xff;
+            data_[pos++] = negative ? ~b : b;
+        }
+    }
+
+    [[noreturn]] static void overflow(const std::string& original) {
+        std::ostringstream ss;
+        ss << "Key " << original << " does not fit in the " << SIZE << " bytes of a binary index key";
+        throw eckit::UserError(ss.str(), Here());
+    }
+
+private: // members
+
+    unsigned char data_[SIZE];
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -0,0 +1,361 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <future>
+
+#include "eckit/eckit.h"
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/StdDir.h"
+#include "eckit/log/Log.h"
+#include "eckit/os/Stat.h"
+#include "eckit/serialisation/FileStream.h"
+#include "eckit/utils/MD5.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/RootScanner.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+constexpr const char* cache_magic = "FDBRootScan";
+constexpr int cache_version = 2;
+
+size_t scanThreads() {
+    static size_t fdbScanThreads = std::max(size_t(1), eckit::Resource<size_t>("fdbScanThreads;$FDB_SCAN_THREADS", 8));
+    return fdbScanThreads;
+}
+
+std::string join(const std::string& path, const std::string& name) {
+    std::string full = path;
+    if (path[path.length()-1] != '/') full += "/";
+    full += name;
+    return full;
+}
+
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+RootScanner::RootScanner(const eckit::PathName& root) :
+    root_(root),
+    useCache_(eckit::Resource<bool>("fdbRootScanCache;$FDB_ROOT_SCAN_CACHE", false)),
+    cacheDir_(eckit::Resource<std::string>("fdbRootScanCacheDir;$FDB_ROOT_SCAN_CACHE_DIR", "~fdb/var/cache/scan")),
+    start_(::time(nullptr)),
+    changed_(false) {}
+
+std::list<std::string> RootScanner::scan() {
+
+    start_ = ::time(nullptr);
+
+    previous_.clear();
+    current_.clear();
+    changed_ = false;
+
+    if (useCache_) {
+        readCache();
+    }
+
+    std::list<std::string> result;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::string> queue{root_};
+    size_t busy = 0;
+    std::exception_ptr error;
+
+    // Taking the most recently found directory first keeps the queue short (depth first), while the threads
+    // spread over the subtrees as they find them.
+
+    auto worker = [&] {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+
+            cv.wait(lock, [&] { return !queue.empty() || busy == 0 || error; });
+            if (error || queue.empty()) {
+                break;
+            }
+
+            std::string path(std::move(queue.back()));
+            queue.pop_back();
+            ++busy;
+            lock.unlock();
+
+            std::vector<std::string> dbs;
+            std::vector<std::string> next;
+            std::exception_ptr err;
+            try {
+                visit(path, dbs, next);
+            } catch (...) {
+                err = std::current_exception();
+            }
+
+            lock.lock();
+            --busy;
+            result.insert(result.end(), dbs.begin(), dbs.end());
+            queue.insert(queue.end(), next.begin(), next.end());
+            if (err && !error) {
+                error = err;
+            }
+            cv.notify_all();
+        }
+    };
+
+    size_t nthreads = scanThreads();
+    if (nthreads == 1) {
+        worker();
+    } else {
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i < nthreads; ++i) {
+            futures.emplace_back(std::async(std::launch::async, worker));
+        }
+        for (std::future<void>& f : futures) {
+            f.get();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    if (useCache_ && (changed_ || current_.size() != previous_.size())) {
+        try {
+            writeCache();
+        } catch (eckit::Exception& e) {
+            // e.g. a root that this user may read but not write
+            Log::debug<LibFdb5>() << "Unable to write scan cache " << cachePath() << ": " << e.what() << std::endl;
+        }
+    }
+
+    result.sort();
+
+    Log::debug<LibFdb5>() << "Scanned " << root_ << ": " << result.size() << " DBs" << std::endl;
+
+    return result;
+}
+
+void RootScanner::visit(const std::string& path, std::vector<std::string>& dbs, std::vector<std::string>& next) {
+
+    if ((eckit::PathName(path) / "toc").exists()) {
+        dbs.push_back(path);
+        return;
+    }
+
+    if (!useCache_) {
+        std::vector<std::string> subdirs;
+        list(path, subdirs);
+        for (const std::string& s : subdirs) {
+            next.push_back(join(path, s));
+        }
+        return;
+    }
+
+    eckit::Stat::Struct info;
+    if (eckit::Stat::stat(path.c_str(), &info) != 0) {
+        // As in list(), a directory may have been wiped in the meantime, or not be readable
+        if (errno == ENOENT || errno == EACCES) {
+            return;
+        }
+        Log::error() << "Cannot stat " << path << Log::syserr << std::endl;
+        throw FailedSystemCall("stat");
+    }
+
+    unsigned long long ino = info.st_ino;
+    long long mtime = info.st_mtime;
+
+    // An unmodified directory has the same entries, so it is still not a DB and has the same subdirectories.
+    // A directory replaced by another (or a root moved, and another put in its place) has a different inode.
+
+    Directories::const_iterator it = previous_.find(path);
+    if (it != previous_.end() && it->second.mtime_ >= 0 && it->second.mtime_ == mtime && it->second.ino_ == ino) {
+        for (const std::string& s : it->second.subdirs_) {
+            next.push_back(join(path, s));
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_.emplace(path, it->second);
+        return;
+    }
+
+    Directory dir;
+    dir.ino_ = ino;
+    if (!list(path, dir.subdirs_)) {
+        return;
+    }
+
+    for (const std::string& s : dir.subdirs_) {
+        next.push_back(join(path, s));
+    }
+
+    // The modification times are in seconds. Entries added within the same second as the directory was read
+    // would not change it, so don't trust the directories modified too recently.
+
+    dir.mtime_ = (mtime < start_ - 1) ? mtime : -1;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.emplace(path, std::move(dir));
+    changed_ = true;
+}
+
+bool RootScanner::list(const std::string& path, std::vector<std::string>& subdirs) const {
+
+    eckit::StdDir d(path.c_str());
+    if (d == nullptr) {
+        // If fdb-wipe is running in parallel, it is perfectly legit for a (non-matching)
+        // path to have disappeared
+        if (errno == ENOENT) {
+            return false;
+        }
+
+        // It should not be an error if we don't have permission to read a path/DB in the
+        // tree. This is a multi-user system.
+        if (errno == EACCES) {
+            return false;
+        }
+
+        Log::error() << "opendir(" << path << ")" << Log::syserr << std::endl;
+        throw FailedSystemCall("opendir");
+    }
+
+    for(;;)
+    {
+        struct dirent* e = d.dirent();
+        if (e == nullptr) {
+            break;
+        }
+
+        if(e->d_name[0] == '.') {
+            if(e->d_name[1] == 0 || (e->d_name[1] =='.' && e->d_name[2] == 0))
+                continue;
+        }
+
+        bool do_stat = true;
+
+#if defined(eckit_HAVE_DIRENT_D_TYPE)
+        do_stat = false;
+        if (e->d_type == DT_DIR) {
+            subdirs.push_back(e->d_name);
+        } else if (e->d_type == DT_UNKNOWN) {
+            do_stat = true;
+        }
+#endif
+        if(do_stat) {
+            std::string full = join(path, e->d_name);
+            eckit::Stat::Struct info;
+            if(eckit::Stat::stat(full.c_str(), &info) == 0)
+            {
+                if(S_ISDIR(info.st_mode)) {
+                    subdirs.push_back(e->d_name);
+                }
+            }
+            else Log::error() << "Cannot stat " << full << Log::syserr << std::endl;
+        }
+    }
+
+    return true;
+}
+
+eckit::PathName RootScanner::cachePath() const {
+    return cacheDir_ / (eckit::MD5(root_).digest() + ".cache");
+}
+
+void RootScanner::readCache() {
+
+    eckit::PathName path(cachePath());
+    if (!path.exists()) {
+        return;
+    }
+
+    try {
+
+        eckit::FileStream s(path, "r");
+
+        std::string magic;
+        int version;
+        std::string root;
+        unsigned long long count;
+        s >> magic;
+        s >> version;
+        s >> root;
+
+        // If the root has been moved, the recorded paths are stale
+        if (magic != cache_magic || version != cache_version || root != root_) {
+            Log::debug<LibFdb5>() << "Ignoring stale scan cache " << path << std::endl;
+            s.close();
+            return;
+        }
+
+        s >> count;
+        for (unsigned long long i = 0; i < count; ++i) {
+            std::string dirpath;
+            Directory dir;
+            unsigned long long nsubdirs;
+            s >> dirpath;
+            s >> dir.ino_;
+            s >> dir.mtime_;
+            s >> nsubdirs;
+            dir.subdirs_.resize(nsubdirs);
+            for (std::string& sub : dir.subdirs_) {
+                s >> sub;
+            }
+            previous_.emplace(std::move(dirpath), std::move(dir));
+        }
+        s.close();
+
+    } catch (eckit::Exception& e) {
+        Log::warning() << "Unable to use scan cache " << path << ": " << e.what() << std::endl;
+        previous_.clear();
+    }
+}
+
+void RootScanner::writeCache() const {
+
+    if (!cacheDir_.exists()) {
+        cacheDir_.mkdir();
+    }
+
+    eckit::PathName tmp = eckit::PathName::unique(cachePath());
+    {
+        eckit::FileStream s(tmp, "w");
+        s << std::string(cache_magic);
+        s << cache_version;
+        s << root_;
+        s << static_cast<unsigned long long>(current_.size());
+        for (const auto& kv : current_) {
+            s << kv.first;
+            s << kv.second.ino_;
+            s << kv.second.mtime_;
+            s << static_cast<unsigned long long>(kv.second.subdirs_.size());
+            for (const std::string& sub : kv.second.subdirs_) {
+                s << sub;
+            }
+        }
+        s.close();
+    }
+    eckit::PathName::rename(tmp, cachePath());
+
+    Log::debug<LibFdb5>() << "Written scan cache " << cachePath() << " for " << current_.size()
+                          << " directories" << std::endl;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,95 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   RootScanner.h
+/// @date   Oct 2026
+
+#ifndef fdb5_RootScanner_H
+#define fdb5_RootScanner_H
+
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Finds the TOC DBs (directories containing a toc file) under a root.
+///
+/// The directories are crawled by fdbScanThreads ($FDB_SCAN_THREADS) threads, taking them from a shared queue
+/// to which each adds the subdirectories it finds.
+///
+/// If fdbRootScanCache ($FDB_ROOT_SCAN_CACHE) is set, the subdirectories of each directory that is not a DB are
+/// recorded in a file, along with the directory's inode and modification time. On the next scan a directory that
+/// is the same and has not been modified since is not read again: its entries are the same, so only its (recorded)
+/// subdirectories are visited. The cache is only an accelerator, if it cannot be read or written the root is crawled
+/// in full.
+///
+/// The cache files are kept in fdbRootScanCacheDir ($FDB_ROOT_SCAN_CACHE_DIR), one per root, and not in the roots
+/// themselves: writing the cache would otherwise modify the root it describes, so that the root is never trusted.
+
+class RootScanner : private eckit::NonCopyable {
+
+public: // methods
+
+    RootScanner(const eckit::PathName& root);
+
+    /// @returns the paths of the DBs under the root, sorted
+    std::list<std::string> scan();
+
+private: // types
+
+    struct Directory {
+        unsigned long long ino_;
+        long long mtime_; ///< -1 if modified too recently for the entries to be trusted
+        std::vector<std::string> subdirs_;
+    };
+
+    typedef std::unordered_map<std::string, Directory> Directories;
+
+private: // methods
+
+    /// Adds the path to the DBs if it is one, otherwise its subdirectories to those to visit
+    void visit(const std::string& path, std::vector<std::string>& dbs, std::vector<std::string>& next);
+
+    /// @returns false if the directory can (legitimately) not be read
+    bool list(const std::string& path, std::vector<std::string>& subdirs) const;
+
+    eckit::PathName cachePath() const;
+    void readCache();
+    void writeCache() const;
+
+private: // members
+
+    std::string root_;
+
+    bool useCache_;
+    eckit::PathName cacheDir_;
+    time_t start_;
+
+    Directories previous_; ///< as read from the cache, not modified during the scan
+
+    std::mutex mutex_;
+    Directories current_;
+    bool changed_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
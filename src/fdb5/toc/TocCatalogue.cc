@@ -8,9 +8,15 @@
  * does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+
+#include "eckit/config/Resource.h"
 #include "eckit/log/Timer.h"
 
 #include "fdb5/LibFdb5.h"
+#include "fdb5/database/EntryVisitMechanism.h"
 #include "fdb5/rules/Rule.h"
 #include "fdb5/toc/RootManager.h"
 #include "fdb5/toc/TocCatalogue.h"
@@ -71,12 +77,30 @@ std::vector<PathName> TocCatalogue::metadataPaths() const {
     paths.emplace_back(schemaPath());
     paths.emplace_back(tocPath());
 
+    PathName summary(summaryPath());
+    if (summary.exists()) paths.emplace_back(summary);
+
     std::vector<PathName>&& lpaths(lockfilePaths());
     paths.insert(paths.end(), lpaths.begin(), lpaths.end());
 
     return paths;
 }
 
+/// The indexes being read ahead, across all the DBs being visited in the process. As each DB visited reads ahead
+/// on threads of its own, this bounds the threads (fdbVisitReadAheadThreads, by default as many as the visit
+/// threads). An index that would exceed it is not read ahead, but in turn.
+static std::atomic<size_t> readingAhead(0);
+
+static bool startReadAhead(const Config& config) {
+    static size_t maxThreads = eckit::Resource<size_t>("fdbVisitReadAheadThreads;$FDB_VISIT_READ_AHEAD_THREADS",
+                                                       EntryVisitMechanism::threads(config));
+    if (readingAhead.fetch_add(1) < maxThreads) {
+        return true;
+    }
+    --readingAhead;
+    return false;
+}
+
 void TocCatalogue::visitEntries(EntryVisitor& visitor, const Store& store, bool sorted) {
 
     std::vector<Index> all = indexes(sorted);
@@ -84,12 +108,56 @@ void TocCatalogue::visitEntries(EntryVisitor& visitor, const Store& store, bool
     // Allow the visitor to selectively reject this DB.
     if (visitor.visitDatabase(*this, store)) {
         if (visitor.visitIndexes()) {
-            for (const Index& idx : all) {
-                if (visitor.visitEntries()) {
-                    idx.entries(visitor); // contains visitIndex
-                } else {
-                    visitor.visitIndex(idx);
+
+            // Read the next few indexes in ahead, while the visitor works through the entries of the current one.
+            // The indexes read in are left open, so are closed again once visited.
+
+            size_t readAhead = visitor.visitEntries() ? EntryVisitMechanism::threads(config_) - 1 : 0;
+            std::vector<std::future<void>> preloading(all.size());
+            std::vector<bool> preloaded(all.size(), false);
+            size_t next = 0;
+            size_t i = 0;
+
+            try {
+                for (; i < all.size(); ++i) {
+                    Index& idx(all[i]);
+                    if (visitor.visitEntries()) {
+                        for (next = std::max(next, i + 1); next < all.size() && next <= i + readAhead; ++next) {
+                            Index* ahead = &all[next];
+                            if (visitor.preloadIndex(*ahead) && startReadAhead(config_)) {
+                                preloaded[next] = true;
+                                preloading[next] = std::async(std::launch::async, [ahead] {
+                                    try {
+                                        ahead->preload();
+                                    } catch (...) {
+                                        --readingAhead;
+                                        throw;
+                                    }
+                                    --readingAhead;
+                                });
+                            }
+                        }
+
+                        if (preloading[i].valid()) preloading[i].get();
+
+                        idx.entries(visitor); // contains visitIndex
+
+                        if (preloaded[i]) idx.close();
+                    } else {
+                        visitor.visitIndex(idx);
+                    }
+                }
+            } catch (...) {
+                // Wait for the indexes being read ahead, and close them along with the current one
+                for (size_t j = i; j < std::max(next, i + 1) && j < all.size(); ++j) {
+                    if (preloading[j].valid()) {
+                        try {
+                            preloading[j].get();
+                        } catch (...) {}
+                    }
+                    if (preloaded[j]) all[j].close();
                 }
+                throw;
             }
         }
 
@@ -9,8 +9,11 @@
  */
 
 #include <algorithm>
+#include <sys/stat.h>
+#include <unordered_set>
 
 #include "eckit/log/Log.h"
+#include "eckit/log/Timer.h"
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/toc/TocCatalogueReader.h"
@@ -22,12 +25,14 @@ namespace fdb5 {
 //----------------------------------------------------------------------------------------------------------------------
 
 TocCatalogueReader::TocCatalogueReader(const Key& key, const fdb5::Config& config) :
-    TocCatalogue(key, config) {
+    TocCatalogue(key, config),
+    lookupBuildTime_(0) {
     loadIndexesAndRemap();
 }
 
 TocCatalogueReader::TocCatalogueReader(const eckit::URI& uri, const fdb5::Config& config) :
-    TocCatalogue(uri.path(), ControlIdentifiers{}, config) {
+    TocCatalogue(uri.path(), ControlIdentifiers{}, config),
+    lookupBuildTime_(0) {
     loadIndexesAndRemap();
 }
 
@@ -37,13 +42,138 @@ TocCatalogueReader::~TocCatalogueReader() {
 
 void TocCatalogueReader::loadIndexesAndRemap() {
     std::vector<Key> remapKeys;
-    std::vector<Index> indexes = loadIndexes(false, nullptr, nullptr, &remapKeys);
+    std::set<std::string> subTocs;
+    std::vector<Index> indexes = loadIndexes(false, &subTocs, nullptr, &remapKeys);
+    setIndexes(indexes, remapKeys);
+    recordFileStates(subTocs);
+}
+
+/// n.b. called after loading, so a change racing with the load is at worst seen as a modification later on
+
+void TocCatalogueReader::recordFileStates(const std::set<std::string>& subTocs) {
+
+    fileStates_.clear();
+    fileStates_.reserve(subTocs.size() + 1);
+
+    std::vector<std::string> paths;
+    paths.push_back(tocPath());
+    paths.insert(paths.end(), subTocs.begin(), subTocs.end());
+
+    for (const std::string& path : paths) {
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0) {
+            fileStates_.push_back(FileState{path, st.st_ino, st.st_size, st.st_mtim});
+        } else {
+            fileStates_.push_back(FileState{path, 0, -1, {0, 0}});
+        }
+    }
+}
+
+bool TocCatalogueReader::modified() const {
+
+    for (const FileState& f : fileStates_) {
+        struct stat st;
+        if (::stat(f.path_.c_str(), &st) != 0) {
+            if (f.size_ != -1) return true;
+            continue;
+        }
+        if (st.st_size != f.size_ ||
+            st.st_mtim.tv_sec != f.mtime_.tv_sec ||
+            st.st_mtim.tv_nsec != f.mtime_.tv_nsec) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// The decoded catalogue is of the order of the size of the TOC records it was decoded from
+
+size_t TocCatalogueReader::footprint() const {
+
+    size_t size = sizeof(*this) + indexes_.size() * sizeof(std::pair<Index, Key>);
+    for (const FileState& f : fileStates_) {
+        if (f.size_ > 0) {
+            size += f.size_;
+        }
+    }
+    return size;
+}
+
+void TocCatalogueReader::setIndexes(const std::vector<Index>& indexes, const std::vector<Key>& remapKeys) {
+
+    // matching_ and lookup_ point into indexes_, so they are rebuilt along with it
+
+    currentIndexKey_ = Key();
+    matching_.clear();
+    lookup_.clear();
+    indexes_.clear();
 
     ASSERT(remapKeys.size() == indexes.size());
     indexes_.reserve(remapKeys.size());
     for (size_t i = 0; i < remapKeys.size(); ++i) {
         indexes_.emplace_back(indexes[i], remapKeys[i]);
     }
+
+    eckit::Timer timer;
+
+    lookup_.reserve(indexes_.size());
+    for (auto idx = indexes_.begin(); idx != indexes_.end(); ++idx) {
+        lookup_[idx->first.key()].push_back(&(*idx));
+    }
+
+    lookupBuildTime_ = timer.elapsed();
+
+    eckit::Log::debug<LibFdb5>() << "TocCatalogueReader::setIndexes " << indexes_.size() << " indexes, "
+                                 << lookup_.size() << " distinct keys, lookup built in " << lookupBuildTime_
+                                 << "s" << std::endl;
+}
+
+bool TocCatalogueReader::refresh() {
+
+    // With mapped TOCs only newly appended records are decoded, so reloading is cheap. Otherwise
+    // the whole TOC would be read again, which is no cheaper than reopening the DB.
+
+    if (!TocHandler::mapTocsOnRead()) {
+        return false;
+    }
+
+    // Only appending to the TOC and subtocs can be followed
+
+    for (const FileState& f : fileStates_) {
+        struct stat st;
+        if (::stat(f.path_.c_str(), &st) != 0) {
+            if (f.size_ != -1) return false;
+            continue;
+        }
+        if (f.size_ != -1 && (st.st_ino != f.ino_ || st.st_size < f.size_)) {
+            return false;
+        }
+    }
+
+    std::vector<Key> remapKeys;
+    std::set<std::string> subTocs;
+    std::vector<Index> indexes = loadIndexes(false, &subTocs, nullptr, &remapKeys);
+
+    // The TocHandler hands back the same Index objects for records it has already decoded, so an index that
+    // has gone from the list has been masked
+
+    std::unordered_set<const IndexBase*> loaded;
+    for (const Index& index : indexes) {
+        loaded.insert(index.content());
+    }
+    for (const auto& index : indexes_) {
+        if (loaded.find(index.first.content()) == loaded.end()) {
+            return false;
+        }
+    }
+
+    recordFileStates(subTocs);
+
+    if (indexes.size() != indexes_.size()) {
+        setIndexes(indexes, remapKeys);
+    }
+    return true;
 }
 
 bool TocCatalogueReader::selectIndex(const Key &key) {
@@ -55,10 +185,9 @@ bool TocCatalogueReader::selectIndex(const Key &key) {
     currentIndexKey_ = key;
     matching_.clear();
 
-    for (auto idx = indexes_.begin(); idx != indexes_.end(); ++idx) {
-        if (idx->first.key() == key) {
-            matching_.push_back(&(*idx));
-        }
+    auto it = lookup_.find(key);
+    if (it != lookup_.end()) {
+        matching_ = it->second;
     }
 
     eckit::Log::debug<LibFdb5>() << "TocCatalogueReader::selectIndex " << key << ", found "
@@ -121,6 +250,17 @@ bool TocCatalogueReader::retrieve(const Key& key, Field& field) const {
     return false;
 }
 
+DbStats TocCatalogueReader::stats() const {
+
+    DbStats s = TocHandler::stats();
+
+    TocDbStats* lookup = new TocDbStats();
+    lookup->indexLookupBuildTime_ = lookupBuildTime_;
+    s.add(DbStats(lookup));
+
+    return s;
+}
+
 void TocCatalogueReader::print(std::ostream &out) const {
     out << "TocCatalogueReader(" << directory() << ")";
 }
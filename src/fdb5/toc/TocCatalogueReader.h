@@ -16,6 +16,8 @@
 #ifndef fdb5_TocCatalogueReader_H
 #define fdb5_TocCatalogueReader_H
 
+#include <unordered_map>
+
 #include "fdb5/toc/TocCatalogue.h"
 
 namespace fdb5 {
@@ -34,11 +36,16 @@ public: // methods
     ~TocCatalogueReader() override;
 
     std::vector<Index> indexes(bool sorted) const override;
-    DbStats stats() const override { return TocHandler::stats(); }
+    bool refresh() override;
+    bool modified() const override;
+    size_t footprint() const override;
+    DbStats stats() const override;
 
 private: // methods
 
     void loadIndexesAndRemap();
+    void recordFileStates(const std::set<std::string>& subTocs);
+    void setIndexes(const std::vector<Index>& indexes, const std::vector<Key>& remapKeys);
     bool selectIndex(const Key &key) override;
     void deselectIndex() override;
 
@@ -63,6 +70,21 @@ private: // members
     // If there is a key remapping for a mounted SubToc, this is stored alongside
     std::vector<std::pair<Index, Key>> indexes_;
 
+    // All the entries of indexes_ for each index key, in TOC order. Built once when the
+    // indexes are loaded, so that selectIndex doesn't need to scan indexes_
+    std::unordered_map<Key, std::vector<std::pair<Index, Key>*>> lookup_;
+
+    double lookupBuildTime_;
+
+    /// The TOC and subtocs the indexes were loaded from, as they were then (see modified())
+    struct FileState {
+        std::string path_;
+        ino_t ino_;
+        off_t size_;
+        struct timespec mtime_;
+    };
+    std::vector<FileState> fileStates_;
+
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -32,7 +32,8 @@ namespace fdb5 {
 
 TocCatalogueWriter::TocCatalogueWriter(const Key &key, const fdb5::Config& config) :
     TocCatalogue(key, config),
-    umask_(config.umask()) {
+    umask_(config.umask()),
+    summaryStale_(false) {
     writeInitRecord(key);
     TocCatalogue::loadSchema();
     TocCatalogue::checkUID();
@@ -40,7 +41,8 @@ TocCatalogueWriter::TocCatalogueWriter(const Key &key, const fdb5::Config& confi
 
 TocCatalogueWriter::TocCatalogueWriter(const eckit::URI &uri, const fdb5::Config& config) :
     TocCatalogue(uri.path(), ControlIdentifiers{}, config),
-    umask_(config.umask()) {
+    umask_(config.umask()),
+    summaryStale_(false) {
     writeInitRecord(TocCatalogue::key());
     TocCatalogue::loadSchema();
     TocCatalogue::checkUID();
@@ -119,6 +121,21 @@ void TocCatalogueWriter::clean() {
 void TocCatalogueWriter::close() {
 
     closeIndexes();
+
+    if (summaryStale_ && useSummary()) {
+        updateSummary();
+    }
+}
+
+void TocCatalogueWriter::updateSummary(bool force) {
+
+    // The summary only speeds up reading. Failing to write it must not fail the archive.
+    try {
+        writeSummary(force);
+        summaryStale_ = false;
+    } catch (eckit::Exception& e) {
+        Log::warning() << "Failed to write TOC summary " << summaryPath() << ": " << e.what() << std::endl;
+    }
 }
 
 void TocCatalogueWriter::index(const Key &key, const eckit::URI &uri, eckit::Offset offset, eckit::Length length) {
@@ -215,6 +232,11 @@ void TocCatalogueWriter::reconsolidateIndexesAndTocs() {
     // And write all the TOC records in one go!
 
     appendBlock(buf, combinedSize);
+
+    // Reconsolidation masks most of what the summary holds, so it is always worth rewriting
+    if (useSummary()) {
+        updateSummary(true);
+    }
 }
 
 const Index& TocCatalogueWriter::currentIndex() {
@@ -318,6 +340,7 @@ void TocCatalogueWriter::flush() {
     flushIndexes();
 
     dirty_ = false;
+    summaryStale_ = true;
     current_ = Index();
     currentFull_ = Index();
 }
@@ -80,6 +80,7 @@ private: // methods
     void closeIndexes();
     void flushIndexes();
     void compactSubTocIndexes();
+    void updateSummary(bool force = false);
 
     eckit::PathName generateIndexPath(const Key &key) const;
 
@@ -105,6 +106,8 @@ private: // members
     Index currentFull_;
 
     eckit::AutoUmask umask_;
+
+    bool summaryStale_; ///< TOC records have been written since the summary was last updated
 };
 
 //----------------------------------------------------------------------------------------------------------------------
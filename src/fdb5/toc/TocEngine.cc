@@ -8,8 +8,6 @@
  * does it submit to any jurisdiction.
  */
 
-#include <dirent.h>
-
 #include <algorithm>
 #include <cstring>
 #include <list>
@@ -19,15 +17,14 @@
 
 #include "eckit/filesystem/LocalFileManager.h"
 #include "eckit/filesystem/LocalPathName.h"
-#include "eckit/filesystem/StdDir.h"
 #include "eckit/log/Log.h"
 #include "eckit/os/BackTrace.h"
-#include "eckit/os/Stat.h"
 #include "eckit/utils/Regex.h"
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/rules/Schema.h"
 #include "fdb5/toc/RootManager.h"
+#include "fdb5/toc/RootScanner.h"
 #include "fdb5/toc/TocEngine.h"
 #include "fdb5/toc/TocHandler.h"
 
@@ -39,73 +36,7 @@ namespace fdb5 {
 //----------------------------------------------------------------------------------------------------------------------
 
 void TocEngine::scan_dbs(const std::string& path, std::list<std::string>& dbs) const {
-
-    if ((eckit::PathName(path) / "toc").exists()) {
-        dbs.push_back(path);
-        return;
-    }
-
-    eckit::StdDir d(path.c_str());
-    if (d == nullptr) {
-        // If fdb-wipe is running in parallel, it is perfectly legit for a (non-matching)
-        // path to have disappeared
-        if (errno == ENOENT) {
-            return;
-        }
-
-        // It should not be an error if we don't have permission to read a path/DB in the
-        // tree. This is a multi-user system.
-        if (errno == EACCES) {
-            return;
-        }
-
-        Log::error() << "opendir(" << path << ")" << Log::syserr << std::endl;
-        throw FailedSystemCall("opendir");
-    }
-
-    // Once readdir_r finally gets deprecated and removed, we may need to 
-    // protecting readdir() as not yet guarranteed thread-safe by POSIX
-    // technically it should only be needed on a per-directory basis
-    // this should be a resursive mutex
-    // AutoLock<Mutex> lock(mutex_); 
-
-    for(;;)
-    {
-        struct dirent* e = d.dirent();
-        if (e == nullptr) {
-            break;
-        }
-
-        if(e->d_name[0] == '.') {
-            if(e->d_name[1] == 0 || (e->d_name[1] =='.' && e->d_name[2] == 0))
-                continue;
-        }
-
-        std::string full = path;
-        if (path[path.length()-1] != '/') full += "/";
-        full += e->d_name;
-
-        bool do_stat = true;
-
-#if defined(eckit_HAVE_DIRENT_D_TYPE)
-        do_stat = false;
-        if (e->d_type == DT_DIR) {
-            scan_dbs(full.c_str(), dbs);
-        } else if (e->d_type == DT_UNKNOWN) {
-            do_stat = true;
-        }
-#endif
-        if(do_stat) {
-            eckit::Stat::Struct info;
-            if(eckit::Stat::stat(full.c_str(), &info) == 0)
-            {
-                if(S_ISDIR(info.st_mode)) {
-                    scan_dbs(full.c_str(), dbs);
-                }
-            }
-            else Log::error() << "Cannot stat " << full << Log::syserr << std::endl;
-        }
-    }
+    dbs.splice(dbs.end(), RootScanner(path).scan());
 }
 
 std::string TocEngine::name() const {
@@ -9,21 +9,32 @@
  */
 
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <pwd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+
 #include "eckit/config/Resource.h"
+#include "eckit/io/Buffer.h"
 #include "eckit/io/FileHandle.h"
 #include "eckit/io/FileDescHandle.h"
 #include "eckit/log/BigNum.h"
 #include "eckit/log/Log.h"
 #include "eckit/maths/Functions.h"
+#include "eckit/serialisation/FileStream.h"
 #include "eckit/serialisation/MemoryStream.h"
 #include "eckit/thread/AutoLock.h"
 #include "eckit/thread/StaticMutex.h"
+#include "eckit/utils/MD5.h"
 #include "eckit/filesystem/PathName.h"
 
 #include "fdb5/LibFdb5.h"
+#include "fdb5/api/Metrics.h"
 #include "fdb5/database/Index.h"
 #include "fdb5/toc/TocCommon.h"
 #include "fdb5/toc/TocFieldLocation.h"
@@ -68,18 +79,129 @@ class TocHandlerCloser {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// A read-only view of a TOC file mapped into memory. Rather than copying the whole TOC each time it is
+/// opened, the mapping is only renewed when the file has grown, so that appended records become visible.
+
+class MappedToc : private eckit::NonCopyable {
+public: // methods
+
+    explicit MappedToc(const eckit::PathName& path) :
+        path_(path),
+        addr_(nullptr),
+        size_(0),
+        position_(0) {
+        map();
+    }
+
+    ~MappedToc() {
+        unmap();
+    }
+
+    /// Re-map the file if its size has changed. Returns true if it has.
+    bool refresh() {
+        if (size_t(path_.size()) == size_) {
+            return false;
+        }
+        unmap();
+        map();
+        return true;
+    }
+
+    size_t size() const { return size_; }
+
+    long read(void* buf, long len) {
+        size_t n = std::min(size_t(len), size_ - position_);
+        if (n > 0) {
+            ::memcpy(buf, addr_ + position_, n);
+            position_ += n;
+        }
+        return n;
+    }
+
+    Offset position() const { return position_; }
+
+    Offset seek(const Offset& pos) {
+        ASSERT(size_t(pos) <= size_);
+        position_ = pos;
+        return pos;
+    }
+
+    /// Is there a complete record at the current position? A writer may be appending a record
+    /// whilst we read, in which case we stop short of it and pick it up on the next refresh.
+    bool recordAvailable() const {
+        if (size_ - position_ < sizeof(TocRecord::Header)) {
+            return false;
+        }
+        TocRecord::Header header;
+        ::memcpy(&header, addr_ + position_, sizeof(TocRecord::Header));
+        return header.size_ >= sizeof(TocRecord::Header) && header.size_ <= size_ - position_;
+    }
+
+private: // methods
+
+    void map() {
+
+        int fd;
+        SYSCALL2((fd = ::open(path_.localPath(), O_RDONLY)), path_);
+
+        struct stat st;
+        int ret = ::fstat(fd, &st);
+        if (ret < 0) {
+            ::close(fd);
+            throw eckit::FailedSystemCall(std::string("fstat ") + path_.asString());
+        }
+
+        size_ = st.st_size;
+
+        if (size_ > 0) {
+            void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                throw eckit::FailedSystemCall(std::string("mmap ") + path_.asString());
+            }
+            addr_ = static_cast<const char*>(addr);
+        }
+
+        // The mapping remains valid once the descriptor is closed, so we don't hold on to one per TOC
+        SYSCALL2(::close(fd), path_);
+
+        position_ = std::min(position_, size_);
+    }
+
+    void unmap() {
+        if (addr_) {
+            ::munmap(const_cast<char*>(addr_), size_);
+            addr_ = nullptr;
+        }
+        size_ = 0;
+    }
+
+private: // members
+
+    eckit::PathName path_;
+    const char* addr_;
+    size_t size_;
+    size_t position_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 class CachedFDProxy {
 public: // methods
 
-    CachedFDProxy(const eckit::PathName& path, int fd, std::unique_ptr<eckit::MemoryHandle>& cached) :
+    CachedFDProxy(const eckit::PathName& path, int fd, std::unique_ptr<eckit::MemoryHandle>& cached,
+                  std::unique_ptr<MappedToc>& mapped) :
         path_(path),
         fd_(fd),
-        cached_(cached.get()) {
-        ASSERT((fd != -1) != (!!cached));
+        cached_(cached.get()),
+        mapped_(mapped.get()) {
+        ASSERT(int(fd != -1) + int(!!cached) + int(!!mapped) == 1);
     }
 
     long read(void* buf, long len) {
-        if (cached_) {
+        if (mapped_) {
+            return mapped_->read(buf, len);
+        } else if (cached_) {
             return cached_->read(buf, len);
         } else {
             long ret;
@@ -89,7 +211,9 @@ public: // methods
     }
 
     Offset position() {
-        if (cached_) {
+        if (mapped_) {
+            return mapped_->position();
+        } else if (cached_) {
             return cached_->position();
         } else {
             off_t pos;
@@ -99,7 +223,9 @@ public: // methods
     }
 
     Offset seek(const Offset& pos) {
-        if (cached_) {
+        if (mapped_) {
+            return mapped_->seek(pos);
+        } else if (cached_) {
             return cached_->seek(pos);
         } else {
             off_t ret;
@@ -114,10 +240,51 @@ private: // members
     const eckit::PathName& path_;
     int fd_;
     MemoryHandle* cached_;
+    MappedToc* mapped_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
 
+namespace {
+
+constexpr const char* summary_file = "toc.summary";
+constexpr const char* summary_magic = "FDBTocSummary";
+constexpr int summary_version = 2;
+
+/// How much of the end of the summarised part of the TOC is checked when the summary is used
+constexpr size_t summary_check_bytes = 64 * 1024;
+
+/// Unless forced, the summary is only rewritten once the TOC has grown by this fraction of the part it covers
+constexpr off_t summary_rewrite_fraction = 4;
+
+bool summaryByDefault() {
+    static bool fdbUseTocSummary = eckit::Resource<bool>("fdbUseTocSummary;$FDB_USE_TOC_SUMMARY", false);
+    return fdbUseTocSummary;
+}
+
+/// Digest of the bytes leading up to the given length of the TOC. As TOCs are only ever appended to, this
+/// identifies a TOC that has been truncated, or rewritten in place, since a summary of it was written.
+std::string tocDigest(const eckit::PathName& path, off_t length) {
+
+    size_t len = std::min(size_t(length), summary_check_bytes);
+    eckit::Buffer buf(len);
+
+    eckit::FileHandle fh(path);
+    fh.openForRead();
+    eckit::AutoClose closer(fh);
+
+    fh.seek(length - off_t(len));
+    if (fh.read(buf, len) != long(len)) {
+        throw eckit::ShortFile(path.asString(), Here());
+    }
+
+    return eckit::MD5(buf, len).digest();
+}
+
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 TocHandler::TocHandler(const eckit::PathName& directory, const Config& config) :
     TocCommon(directory),
     tocPath_(directory_ / "toc"),
@@ -126,11 +293,14 @@ TocHandler::TocHandler(const eckit::PathName& directory, const Config& config) :
     useSubToc_(config.userConfig().getBool("useSubToc", false)),
     isSubToc_(false),
     preloadBTree_(config.userConfig().getBool("preloadTocBTree", true)),
+    useSummary_(config.userConfig().getBool("useTocSummary", summaryByDefault())),
     fd_(-1),
     cachedToc_(nullptr),
+    mappedToc_(nullptr),
     count_(0),
     enumeratedMaskedEntries_(false),
-    writeMode_(false)
+    writeMode_(false),
+    parsedOffset_(0)
 {
 
     // An override to enable using sub tocs without configurations being passed in, for ease
@@ -149,11 +319,14 @@ TocHandler::TocHandler(const eckit::PathName& path, const Key& parentKey) :
     useSubToc_(false),
     isSubToc_(true),
     preloadBTree_(false),
+    useSummary_(false),
     fd_(-1),
     cachedToc_(nullptr),
+    mappedToc_(nullptr),
     count_(0),
     enumeratedMaskedEntries_(false),
-    writeMode_(false)
+    writeMode_(false),
+    parsedOffset_(0)
 {
 
     /// Are we remapping a mounted DB?
@@ -186,6 +359,23 @@ TocHandler::TocHandler(const eckit::PathName& path, const Key& parentKey) :
     }
 }
 
+TocHandler::TocHandler(const eckit::PathName& path, const Key& parentKey, const Key& remapKey) :
+    TocCommon(path.dirName()),
+    parentKey_(parentKey),
+    tocPath_(TocCommon::findRealPath(path)),
+    serialisationVersion_(TocSerialisationVersion(dbConfig_)),
+    useSubToc_(false),
+    isSubToc_(true),
+    preloadBTree_(false),
+    useSummary_(false),
+    remapKey_(remapKey),
+    fd_(-1),
+    cachedToc_(nullptr),
+    mappedToc_(nullptr),
+    count_(0),
+    enumeratedMaskedEntries_(false),
+    writeMode_(false),
+    parsedOffset_(0) {}
 
 TocHandler::~TocHandler() {
     close();
@@ -230,6 +420,10 @@ void TocHandler::openForAppend() {
         cachedToc_.reset();
     }
 
+    if (mappedToc_) {
+        mappedToc_.reset();
+    }
+
     writeMode_ = true;
 
     ASSERT(fd_ == -1);
@@ -247,8 +441,36 @@ void TocHandler::openForAppend() {
     SYSCALL2((fd_ = ::open( tocPath_.localPath(), iomode, (mode_t)0777 )), tocPath_);
 }
 
+bool TocHandler::mapTocsOnRead() {
+    static bool fdbMapTocsOnRead = eckit::Resource<bool>("fdbMapTocsOnRead;$FDB_MAP_TOCS_ON_READ", false);
+    return fdbMapTocsOnRead;
+}
+
+static int readMode() {
+    int iomode = O_RDONLY;
+#ifdef O_NOATIME
+    // this introduces issues of permissions
+    static bool fdbNoATime = eckit::Resource<bool>("fdbNoATime;$FDB_OPEN_NOATIME", false);
+    if(fdbNoATime) {
+        iomode |= O_NOATIME;
+    }
+#endif
+    return iomode;
+}
+
 void TocHandler::openForRead() const {
 
+    if (mappedToc_) {
+        ASSERT(not writeMode_);
+        if (mappedToc_->refresh()) {
+            // The masked subtocs and indexes could have been updated, so reset this.
+            enumeratedMaskedEntries_ = false;
+            maskedEntries_.clear();
+        }
+        mappedToc_->seek(0);
+        return;
+    }
+
     if (cachedToc_) {
         ASSERT(not writeMode_);
         cachedToc_->seek(0);
@@ -261,17 +483,20 @@ void TocHandler::openForRead() const {
 
     writeMode_ = false;
 
-    eckit::Log::debug<LibFdb5>() << "Opening for read TOC " << tocPath_ << std::endl;
+    if (mapTocsOnRead()) {
 
-    int iomode = O_RDONLY;
-#ifdef O_NOATIME
-    // this introduces issues of permissions
-    static bool fdbNoATime = eckit::Resource<bool>("fdbNoATime;$FDB_OPEN_NOATIME", false);
-    if(fdbNoATime) {
-        iomode |= O_NOATIME;
+        eckit::Log::debug<LibFdb5>() << "Mapping for read TOC " << tocPath_ << std::endl;
+
+        enumeratedMaskedEntries_ = false;
+        maskedEntries_.clear();
+
+        mappedToc_.reset(new MappedToc(tocPath_));
+        return;
     }
-#endif
-    SYSCALL2((fd_ = ::open( tocPath_.localPath(), iomode )), tocPath_ );
+
+    eckit::Log::debug<LibFdb5>() << "Opening for read TOC " << tocPath_ << std::endl;
+
+    SYSCALL2((fd_ = ::open( tocPath_.localPath(), readMode() )), tocPath_ );
     eckit::Length tocSize = tocPath_.size();
 
     // The masked subtocs and indexes could be updated each time, so reset this.
@@ -294,6 +519,26 @@ void TocHandler::openForRead() const {
     }
 }
 
+void TocHandler::openTailForRead() const {
+
+    ASSERT(fd_ == -1);
+    ASSERT(not mappedToc_);
+
+    writeMode_ = false;
+
+    // An in-memory copy of the TOC would predate what is to be read, and reading the TOC in full is what
+    // this avoids
+    cachedToc_.reset();
+
+    enumeratedMaskedEntries_ = false;
+    maskedEntries_.clear();
+
+    eckit::Log::debug<LibFdb5>() << "Opening for read TOC " << tocPath_ << " from offset " << parsedOffset_
+                                 << std::endl;
+
+    SYSCALL2((fd_ = ::open( tocPath_.localPath(), readMode() )), tocPath_ );
+}
+
 void TocHandler::dumpTocCache() const {
     if (cachedToc_) {
         eckit::Offset offset = cachedToc_->position();
@@ -320,9 +565,12 @@ void TocHandler::append(TocRecord &r, size_t payloadSize ) {
 
     ASSERT(fd_ != -1);
     ASSERT(not cachedToc_);
+    ASSERT(not mappedToc_);
 
     Log::debug<LibFdb5>() << "Writing toc entry: " << (int)r.header_.tag_ << std::endl;
 
+    Metrics::Timer timer(Metrics::TocAppend);
+
     // Obtain the rounded size, and set it in the record header.
     size_t roundedSize = roundRecord(r, payloadSize);
 
@@ -339,11 +587,14 @@ void TocHandler::appendBlock(const void *data, size_t size) {
 
     ASSERT(fd_ != -1);
     ASSERT(not cachedToc_);
+    ASSERT(not mappedToc_);
 
     // Ensure that this block is appropriately rounded.
 
     ASSERT(size % recordRoundSize() == 0);
 
+    Metrics::Timer timer(Metrics::TocAppend);
+
     size_t len;
     SYSCALL2( len = ::write(fd_, data, size), tocPath_ );
     dirty_ = true;
@@ -479,7 +730,7 @@ bool TocHandler::readNext( TocRecord &r, bool walkSubTocs, bool hideSubTocEntrie
 // readNextInternal reads the next TOC entry from this toc.
 bool TocHandler::readNextInternal(TocRecord& r) const {
 
-    CachedFDProxy proxy(tocPath_, fd_, cachedToc_);
+    CachedFDProxy proxy(tocPath_, fd_, cachedToc_, mappedToc_);
 
     try {
         long len = proxy.read(&r, sizeof(TocRecord::Header));
@@ -582,7 +833,7 @@ void TocHandler::close() const {
 void TocHandler::allMaskableEntries(Offset startOffset, Offset endOffset,
                                     std::set<std::pair<PathName, Offset>>& maskedEntries) const {
 
-    CachedFDProxy proxy(tocPath_, fd_, cachedToc_);
+    CachedFDProxy proxy(tocPath_, fd_, cachedToc_, mappedToc_);
 
     // Start reading entries where we are told to
 
@@ -633,8 +884,8 @@ void TocHandler::allMaskableEntries(Offset startOffset, Offset endOffset,
 
 void TocHandler::populateMaskedEntriesList() const {
 
-    ASSERT(fd_ != -1 || cachedToc_);
-    CachedFDProxy proxy(tocPath_, fd_, cachedToc_);
+    ASSERT(fd_ != -1 || cachedToc_ || mappedToc_);
+    CachedFDProxy proxy(tocPath_, fd_, cachedToc_, mappedToc_);
 
     Offset startPosition = proxy.position(); // remember the current position of the file descriptor
 
@@ -889,6 +1140,10 @@ bool TocHandler::anythingWrittenToSubToc() const {
     return !!subTocWrite_;
 }
 
+bool TocHandler::useSummary() const {
+    return useSummary_;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 class HasPath {
@@ -975,6 +1230,34 @@ const eckit::PathName& TocHandler::directory() const
     return directory_;
 }
 
+void TocHandler::orderIndexes(bool sorted,
+                              std::vector<Index>& indexes,
+                              std::vector<bool>* indexInSubtoc,
+                              std::vector<Key>* remapKeys) {
+
+    // For some purposes, it is useful to have the indexes sorted by their location, as this is is faster for
+    // iterating through the data.
+
+    if (sorted) {
+
+        ASSERT(!indexInSubtoc);
+        ASSERT(!remapKeys);
+        std::sort(indexes.begin(), indexes.end(), TocIndexFileSort());
+
+    } else {
+
+        // In the normal case, the entries are sorted into reverse order. The last index takes precedence
+        std::reverse(indexes.begin(), indexes.end());
+
+        if (indexInSubtoc) {
+            std::reverse(indexInSubtoc->begin(), indexInSubtoc->end());
+        }
+        if (remapKeys) {
+            std::reverse(remapKeys->begin(), remapKeys->end());
+        }
+    }
+}
+
 std::vector<Index> TocHandler::loadIndexes(bool sorted,
                                            std::set<std::string>* subTocs,
                                            std::vector<bool>* indexInSubtoc,
@@ -986,6 +1269,29 @@ std::vector<Index> TocHandler::loadIndexes(bool sorted,
         return indexes;
     }
 
+    if (mapTocsOnRead() || readSummary()) {
+
+        // Only the records appended since the last call (or since the summary was written) are decoded.
+        // Masking is applied as the cached entries are collected, so the result is the same as walking
+        // the TOC with readNext()
+
+        refreshIndexCache(preloadBTree_);
+        collectCachedIndexes(indexes, nullptr, subTocs, indexInSubtoc, remapKeys);
+        count_ = 0;
+
+        orderIndexes(sorted, indexes, indexInSubtoc, remapKeys);
+        return indexes;
+    }
+
+    if (!isSubToc_ && subTocLoadThreads() > 1) {
+
+        loadIndexesConcurrently(indexes, subTocs, indexInSubtoc, remapKeys);
+        count_ = 0;
+
+        orderIndexes(sorted, indexes, indexInSubtoc, remapKeys);
+        return indexes;
+    }
+
     openForRead();
     TocHandlerCloser close(*this);
 
@@ -1053,30 +1359,570 @@ std::vector<Index> TocHandler::loadIndexes(bool sorted,
 
     }
 
-    // For some purposes, it is useful to have the indexes sorted by their location, as this is is faster for
-    // iterating through the data.
+    orderIndexes(sorted, indexes, indexInSubtoc, remapKeys);
 
-    if (sorted) {
+    return indexes;
 
-        ASSERT(!indexInSubtoc);
-        ASSERT(!remapKeys);
-        std::sort(indexes.begin(), indexes.end(), TocIndexFileSort());
+}
+
+size_t TocHandler::subTocLoadThreads() {
+    static size_t fdbSubTocLoadThreads = eckit::Resource<size_t>("fdbSubTocLoadThreads;$FDB_SUBTOC_LOAD_THREADS", 0);
+    return fdbSubTocLoadThreads;
+}
+
+void TocHandler::loadIndexesConcurrently(std::vector<Index>& indexes,
+                                         std::set<std::string>* subTocs,
+                                         std::vector<bool>* indexInSubtoc,
+                                         std::vector<Key>* remapKeys) const {
+
+    // One slot per live TOC_INDEX or TOC_SUB_TOC record, in TOC order. Indexes in this TOC are decoded
+    // as we go, the subtocs are loaded afterwards on a pool of threads.
+
+    struct Slot {
+        Index index_;
+        eckit::PathName subTocPath_;
+        std::unique_ptr<TocHandler> subToc_;
+        std::vector<Index> subTocIndexes_;
+        std::vector<Key> subTocRemapKeys_;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<size_t> subTocSlots;
+
+    {
+        openForRead();
+        TocHandlerCloser close(*this);
+
+        populateMaskedEntriesList();
+
+        // Allocate (large) TocRecord on heap not stack (MARS-779)
+        std::unique_ptr<TocRecord> r(new TocRecord(serialisationVersion_.used()));
+
+        bool debug = LibFdb5::instance().debug();
+        while (readNextInternal(*r)) {
+
+            eckit::MemoryStream s(&r->payload_[0], r->maxPayloadSize);
+            std::string path;
+            std::string type;
+            off_t offset;
+
+            switch (r->header_.tag_) {
+
+            case TocRecord::TOC_INIT:
+                dbUID_ = r->header_.uid_;
+                if (parentKey_.empty()) parentKey_ = Key(s);
+                break;
+
+            case TocRecord::TOC_INDEX: {
+                s >> path;
+                s >> offset;
+                s >> type;
+
+                // The same masking as in readNext()
+                PathName absPath = directory_ / path;
+                if (maskedEntries_.find(std::make_pair(absPath.baseName(), Offset(offset))) != maskedEntries_.end()) {
+                    Log::debug<LibFdb5>() << "Index ignored by mask: " << path << ":" << offset << std::endl;
+                    break;
+                }
+
+                LOG_DEBUG(debug, LibFdb5) << "TocRecord TOC_INDEX " << path << " - " << offset << std::endl;
+                slots.emplace_back();
+                slots.back().index_ = Index(new TocIndex(s, r->header_.serialisationVersion_, directory_,
+                                                         absPath, offset, preloadBTree_));
+                break;
+            }
+
+            case TocRecord::TOC_SUB_TOC: {
+                eckit::PathName subTocPath;
+                s >> subTocPath;
+
+                if (maskedEntries_.find(std::make_pair(subTocPath.baseName(), Offset(0))) != maskedEntries_.end()) {
+                    Log::debug<LibFdb5>() << "SubToc ignored by mask: " << subTocPath << std::endl;
+                    break;
+                }
+
+                // See readNext() for the handling of absolute and relative paths
+                ASSERT(subTocPath.path().size() > 0);
+                eckit::PathName absPath;
+                if (subTocPath.path()[0] == '/') {
+                    absPath = findRealPath(subTocPath);
+                    if (!absPath.exists()) {
+                        absPath = directory_ / subTocPath.baseName();
+                    }
+                } else {
+                    absPath = directory_ / subTocPath;
+                }
+
+                subTocSlots.push_back(slots.size());
+                slots.emplace_back();
+                slots.back().subTocPath_ = absPath;
+                break;
+            }
+
+            case TocRecord::TOC_CLEAR:
+                break;
+
+            default:
+                std::ostringstream oss;
+                oss << "Unknown tag in TocRecord " << *r;
+                throw eckit::SeriousBug(oss.str(), Here());
+                break;
+            }
+        }
+    }
+
+    // Open, read and decode the subtocs concurrently.
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+
+    auto worker = [&] {
+        size_t i;
+        while (!failed && (i = next++) < subTocSlots.size()) {
+            Slot& slot(slots[subTocSlots[i]]);
+            try {
+                eckit::Log::debug<LibFdb5>() << "Opening SUB_TOC: " << slot.subTocPath_ << " " << parentKey_ << std::endl;
+                slot.subToc_.reset(new TocHandler(slot.subTocPath_, parentKey_));
+                slot.subToc_->preloadBTree_ = preloadBTree_;
+                slot.subTocIndexes_ = slot.subToc_->loadIndexes(false, nullptr, nullptr, &slot.subTocRemapKeys_);
+            } catch (...) {
+                failed = true;
+                throw;
+            }
+        }
+    };
+
+    size_t nthreads = std::min(subTocLoadThreads(), subTocSlots.size());
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < nthreads; ++i) {
+        futures.emplace_back(std::async(std::launch::async, worker));
+    }
+
+    // Wait for all the workers before reporting any error, as they refer to the slots
+    std::exception_ptr error;
+    for (std::future<void>& f : futures) {
+        try {
+            f.get();
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // And assemble the results in TOC order. n.b. loadIndexes() on a subtoc returns them in reverse.
+
+    for (Slot& slot : slots) {
+        if (!slot.subToc_) {
+            indexes.push_back(slot.index_);
+            if (indexInSubtoc) {
+                indexInSubtoc->push_back(false);
+            }
+            if (remapKeys) {
+                remapKeys->push_back(remapKey_);
+            }
+        } else {
+            indexes.insert(indexes.end(), slot.subTocIndexes_.rbegin(), slot.subTocIndexes_.rend());
+            if (subTocs != 0 && !slot.subTocIndexes_.empty()) {
+                subTocs->insert(slot.subToc_->tocPath());
+            }
+            if (indexInSubtoc) {
+                indexInSubtoc->insert(indexInSubtoc->end(), slot.subTocIndexes_.size(), true);
+            }
+            if (remapKeys) {
+                remapKeys->insert(remapKeys->end(), slot.subTocRemapKeys_.rbegin(), slot.subTocRemapKeys_.rend());
+            }
+        }
+    }
+}
+
+void TocHandler::refreshIndexCache(bool preloadBTree) const {
+
+    // Without a mapping, avoid opening a TOC restored from the summary unless something has been appended to it.
+    // Subtocs are not kept mapped between refreshes (a DB may have thousands of them), so the same applies.
+
+    if ((!mapTocsOnRead() || isSubToc_) && parsedOffset_ != 0 && size_t(tocPath_.size()) == size_t(parsedOffset_)) {
+        return;
+    }
 
+    // Unless mapped, the TOC is read with the file descriptor from where the last call (or the summary) left
+    // off, so that the cost is that of the records appended since rather than of the whole TOC
+
+    if (mapTocsOnRead()) {
+        openForRead();
     } else {
+        openTailForRead();
+    }
+    TocHandlerCloser close(*this);
 
-        // In the normal case, the entries are sorted into reverse order. The last index takes precedence
-        std::reverse(indexes.begin(), indexes.end());
+    size_t tocSize = mappedToc_ ? mappedToc_->size() : size_t(tocPath_.size());
 
-        if (indexInSubtoc) {
-            std::reverse(indexInSubtoc->begin(), indexInSubtoc->end());
+    if (tocSize < size_t(parsedOffset_)) {
+        // The TOC has been replaced underneath us. Start again from scratch.
+        Log::warning() << "TOC " << tocPath_ << " has shrunk. Reloading" << std::endl;
+        cachedEntries_.clear();
+        cachedMasks_.clear();
+        parsedOffset_ = 0;
+    }
+
+    CachedFDProxy proxy(tocPath_, fd_, cachedToc_, mappedToc_);
+    proxy.seek(parsedOffset_);
+
+    // Allocate (large) TocRecord on heap not stack (MARS-779)
+    std::unique_ptr<TocRecord> r(new TocRecord(serialisationVersion_.used()));
+
+    bool debug = LibFdb5::instance().debug();
+    while ((!mappedToc_ || mappedToc_->recordAvailable()) && readNextInternal(*r)) {
+
+        eckit::MemoryStream s(&r->payload_[0], r->maxPayloadSize);
+        std::string path;
+        std::string type;
+        off_t offset;
+
+        switch (r->header_.tag_) {
+
+        case TocRecord::TOC_INIT:
+            dbUID_ = r->header_.uid_;
+            if (parentKey_.empty()) parentKey_ = Key(s);
+            break;
+
+        case TocRecord::TOC_INDEX: {
+            s >> path;
+            s >> offset;
+            s >> type;
+            LOG_DEBUG(debug, LibFdb5) << "TocRecord TOC_INDEX " << path << " - " << offset << std::endl;
+
+            CachedTocEntry entry;
+            entry.maskKey_ = std::make_pair(eckit::PathName(path).baseName(), Offset(offset));
+            entry.index_ = Index(new TocIndex(s, r->header_.serialisationVersion_, directory_,
+                                              directory_ / path, offset, preloadBTree));
+            cachedEntries_.emplace_back(std::move(entry));
+            break;
         }
-        if (remapKeys) {
-            std::reverse(remapKeys->begin(), remapKeys->end());
+
+        case TocRecord::TOC_SUB_TOC: {
+            eckit::PathName subTocPath;
+            s >> subTocPath;
+
+            // See readNext() for the handling of absolute and relative paths
+            ASSERT(subTocPath.path().size() > 0);
+            eckit::PathName absPath;
+            if (subTocPath.path()[0] == '/') {
+                absPath = findRealPath(subTocPath);
+                if (!absPath.exists()) {
+                    absPath = directory_ / subTocPath.baseName();
+                }
+            } else {
+                absPath = directory_ / subTocPath;
+            }
+
+            // The subtoc is only opened once we know that it is not masked
+            CachedTocEntry entry;
+            entry.maskKey_ = std::make_pair(subTocPath.baseName(), Offset(0));
+            entry.subTocPath_ = absPath;
+            cachedEntries_.emplace_back(std::move(entry));
+            break;
         }
+
+        case TocRecord::TOC_CLEAR:
+            s >> path;
+            s >> offset;
+            if (path == "*") { // For the "*" path, mask EVERYTHING that we have already seen
+                for (const CachedTocEntry& entry : cachedEntries_) {
+                    cachedMasks_.insert(entry.maskKey_);
+                }
+            } else {
+                cachedMasks_.emplace(eckit::PathName(path).baseName(), offset);
+            }
+            break;
+
+        default:
+            // This is only a warning, as it is legal for later versions of software to add stuff
+            // that is just meaningless in a backwards-compatible sense.
+            Log::warning() << "Unknown TOC entry " << (*r) << " @ " << Here() << std::endl;
+            break;
+        }
+
+        parsedOffset_ = proxy.position();
     }
 
-    return indexes;
+    // The records are decoded, so the mapping is no longer needed until the subtoc grows
+    if (isSubToc_) {
+        mappedToc_.reset();
+    }
+}
+
+void TocHandler::collectCachedIndexes(std::vector<Index>& indexes,
+                                      const eckit::PathName* subTocPath,
+                                      std::set<std::string>* subTocs,
+                                      std::vector<bool>* indexInSubtoc,
+                                      std::vector<Key>* remapKeys) const {
+
+    for (CachedTocEntry& entry : cachedEntries_) {
+
+        if (cachedMasks_.find(entry.maskKey_) != cachedMasks_.end()) {
+            continue;
+        }
+
+        if (entry.index_.null()) {
+
+            if (!entry.subToc_) {
+                eckit::Log::debug<LibFdb5>() << "Opening SUB_TOC: " << entry.subTocPath_ << " " << parentKey_ << std::endl;
+                entry.subToc_.reset(new TocHandler(entry.subTocPath_, parentKey_));
+            }
+
+            // Indexes are reported against the subtoc referenced from this TOC, as readNext() does
+            entry.subToc_->refreshIndexCache(preloadBTree_);
+            entry.subToc_->collectCachedIndexes(indexes, subTocPath ? subTocPath : &entry.subToc_->tocPath(),
+                                                subTocs, indexInSubtoc, remapKeys);
+
+        } else {
+
+            indexes.push_back(entry.index_);
+
+            if (subTocs != 0 && subTocPath) {
+                subTocs->insert(*subTocPath);
+            }
+            if (indexInSubtoc) {
+                indexInSubtoc->push_back(!!subTocPath);
+            }
+            if (remapKeys) {
+                remapKeys->push_back(remapKey_);
+            }
+        }
+    }
+}
+
+eckit::PathName TocHandler::summaryPath() const {
+    return directory_ / summary_file;
+}
+
+void TocHandler::writeSummary(bool force) const {
+
+    ASSERT(!isSubToc_);
+
+    // Build the index cache with a separate handler, so that we don't disturb the state of this one (which
+    // may be mid-write). It starts from the existing summary, so only the records appended since are read.
+
+    TocHandler reader(directory_, dbConfig_);
+    bool seeded = reader.readSummary();
+    off_t summarised = reader.parsedOffset_;
+
+    struct stat st;
+    SYSCALL2(::stat(reader.tocPath_.localPath(), &st), reader.tocPath_);
+
+    // Rewriting the summary costs time in proportion to the number of live indexes. Waiting until the TOC has
+    // grown by a fraction of what is already summarised keeps the total cost linear in the size of the TOC.
+
+    if (seeded && !force && (st.st_size - summarised) * summary_rewrite_fraction < summarised) {
+        eckit::Log::debug<LibFdb5>() << "TOC summary " << summaryPath() << " up to offset " << summarised
+                                     << " is recent enough for " << st.st_size << " bytes of TOC" << std::endl;
+        return;
+    }
+
+    reader.refreshIndexCache(false);
+
+    // Collecting the indexes opens every live subtoc, bringing any that have grown up to date
+    std::vector<Index> indexes;
+    reader.collectCachedIndexes(indexes, nullptr, nullptr, nullptr, nullptr);
+
+    eckit::PathName tmp = eckit::PathName::unique(summaryPath());
+    {
+        eckit::FileStream s(tmp, "w");
+        s << std::string(summary_magic);
+        s << summary_version;
+        s << static_cast<unsigned long long>(st.st_dev);
+        s << static_cast<unsigned long long>(st.st_ino);
+        s << static_cast<unsigned long long>(reader.parsedOffset_);
+        s << tocDigest(reader.tocPath_, reader.parsedOffset_);
+        reader.encodeIndexCache(s);
+        s.close();
+    }
+    eckit::PathName::rename(tmp, summaryPath());
+
+    eckit::Log::debug<LibFdb5>() << "Written TOC summary " << summaryPath() << " for " << indexes.size()
+                                 << " indexes, up to offset " << reader.parsedOffset_ << std::endl;
+}
+
+bool TocHandler::readSummary() const {
+
+    if (!useSummary_ || isSubToc_) {
+        return false;
+    }
+
+    // Already seeded, so carry on incrementally from there
+    if (parsedOffset_ != 0) {
+        return true;
+    }
+
+    eckit::PathName path(summaryPath());
+    if (!path.exists()) {
+        return false;
+    }
+
+    try {
+
+        struct stat st;
+        SYSCALL2(::stat(tocPath_.localPath(), &st), tocPath_);
+
+        eckit::FileStream s(path, "r");
+
+        std::string magic;
+        int version;
+        unsigned long long dev;
+        unsigned long long ino;
+        unsigned long long length;
+        std::string digest;
+        s >> magic;
+        s >> version;
+
+        if (magic != summary_magic || version != summary_version) {
+            eckit::Log::debug<LibFdb5>() << "Ignoring TOC summary " << path << " of another version" << std::endl;
+            s.close();
+            return false;
+        }
+
+        s >> dev;
+        s >> ino;
+        s >> length;
+        s >> digest;
+
+        // If the TOC has been replaced (e.g. the DB wiped and re-created), or truncated or rewritten in place,
+        // then the summary is stale
+
+        if (dev != static_cast<unsigned long long>(st.st_dev) || ino != static_cast<unsigned long long>(st.st_ino) ||
+            length > static_cast<unsigned long long>(st.st_size) || tocDigest(tocPath_, off_t(length)) != digest) {
+            eckit::Log::debug<LibFdb5>() << "Ignoring stale TOC summary " << path << std::endl;
+            s.close();
+            return false;
+        }
+
+        decodeIndexCache(s, preloadBTree_);
+        s.close();
+
+        if (static_cast<unsigned long long>(parsedOffset_) != length) {
+            throw eckit::SeriousBug("TOC summary is inconsistent with the length of TOC it describes", Here());
+        }
+
+    } catch (eckit::Exception& e) {
+        Log::warning() << "Unable to use TOC summary " << path << ": " << e.what() << std::endl;
+        cachedEntries_.clear();
+        cachedMasks_.clear();
+        parsedOffset_ = 0;
+        return false;
+    }
+
+    // Make sure that the remainder of the TOC is read afresh, rather than from an earlier copy
+    cachedToc_.reset();
+
+    eckit::Log::debug<LibFdb5>() << "Using TOC summary " << path << " up to offset " << parsedOffset_ << std::endl;
+    return true;
+}
+
+void TocHandler::encodeIndexCache(eckit::Stream& s) const {
+
+    s << static_cast<unsigned long long>(parsedOffset_);
+    s << static_cast<long>(dbUID_);
+    s << parentKey_;
+
+    s << cachedMasks_.size();
+    for (const auto& mask : cachedMasks_) {
+        s << mask.first.asString();
+        s << static_cast<unsigned long long>(mask.second);
+    }
+
+    // Entries that are already masked will never be visible again, so are not worth keeping
 
+    std::vector<const CachedTocEntry*> live;
+    for (const CachedTocEntry& entry : cachedEntries_) {
+        if (cachedMasks_.find(entry.maskKey_) == cachedMasks_.end()) {
+            live.push_back(&entry);
+        }
+    }
+
+    s << live.size();
+    for (const CachedTocEntry* entry : live) {
+
+        s << entry->maskKey_.first.asString();
+        s << static_cast<unsigned long long>(entry->maskKey_.second);
+
+        bool isIndex = !entry->index_.null();
+        s << isIndex;
+
+        if (isIndex) {
+            const TocIndex* index = dynamic_cast<const TocIndex*>(entry->index_.content());
+            ASSERT(index);
+            int version = serialisationVersion_.used();
+            s << index->path().baseName().asString();
+            s << static_cast<unsigned long long>(index->offset());
+            s << version;
+            entry->index_.encode(s, version);
+        } else {
+            // collectCachedIndexes() has opened every live subtoc. Those in the DB directory are stored
+            // relative to it, so that the summary survives the DB being moved.
+            ASSERT(entry->subToc_);
+            bool local = entry->subTocPath_.dirName().sameAs(directory_);
+            s << (local ? entry->subTocPath_.baseName() : entry->subTocPath_).asString();
+            s << entry->subToc_->remapKey_;
+            entry->subToc_->encodeIndexCache(s);
+        }
+    }
+}
+
+void TocHandler::decodeIndexCache(eckit::Stream& s, bool preloadBTree) const {
+
+    unsigned long long parsed;
+    long uid;
+    s >> parsed;
+    s >> uid;
+    parsedOffset_ = parsed;
+    dbUID_ = static_cast<uid_t>(uid);
+    parentKey_ = Key(s);
+
+    size_t nmasks;
+    s >> nmasks;
+    for (size_t i = 0; i < nmasks; ++i) {
+        std::string path;
+        unsigned long long offset;
+        s >> path;
+        s >> offset;
+        cachedMasks_.emplace(eckit::PathName(path), Offset(offset));
+    }
+
+    size_t nentries;
+    s >> nentries;
+    for (size_t i = 0; i < nentries; ++i) {
+
+        CachedTocEntry entry;
+        std::string maskPath;
+        unsigned long long maskOffset;
+        bool isIndex;
+        s >> maskPath;
+        s >> maskOffset;
+        s >> isIndex;
+        entry.maskKey_ = std::make_pair(eckit::PathName(maskPath), Offset(maskOffset));
+
+        if (isIndex) {
+            std::string path;
+            unsigned long long offset;
+            int version;
+            s >> path;
+            s >> offset;
+            s >> version;
+            entry.index_ = Index(new TocIndex(s, version, directory_, directory_ / path, offset, preloadBTree));
+        } else {
+            std::string subTocPath;
+            s >> subTocPath;
+            Key remapKey(s);
+            ASSERT(!subTocPath.empty());
+            entry.subTocPath_ = (subTocPath[0] == '/') ? eckit::PathName(subTocPath) : directory_ / subTocPath;
+            entry.subToc_.reset(new TocHandler(entry.subTocPath_, parentKey_, remapKey));
+            entry.subToc_->decodeIndexCache(s, preloadBTree);
+        }
+
+        cachedEntries_.emplace_back(std::move(entry));
+    }
 }
 
 const eckit::PathName &TocHandler::tocPath() const {
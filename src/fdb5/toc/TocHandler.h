@@ -34,12 +34,14 @@
 
 namespace eckit {
 class Configuration;
+class Stream;
 }
 
 namespace fdb5 {
 
 class Key;
 class Index;
+class MappedToc;
 
 //----------------------------------------------------------------------------------------------------------------------
 
@@ -125,6 +127,7 @@ public: // methods
 
     bool useSubToc() const;
     bool anythingWrittenToSubToc() const;
+    bool useSummary() const;
 
     /// Return a list of existent indexes. If supplied, also supply a list of associated
     /// subTocs that were read to get these indexes
@@ -150,6 +153,20 @@ public: // methods
                          std::set<eckit::URI>& data) const;
 
     std::vector<eckit::PathName> subTocPaths() const;
+
+    /// If set, TOCs are memory mapped for reading rather than copied, and loadIndexes() only decodes
+    /// the records appended since it was last called on this handler.
+    static bool mapTocsOnRead();
+
+    /// If more than one, the subtocs referenced from a TOC are loaded concurrently on this many threads
+    static size_t subTocLoadThreads();
+
+    /// The summary holds the live indexes of the DB as of a given length of the TOC. If it is present and
+    /// enabled, loadIndexes() only walks the records appended after that point.
+    /// Unless forced, writeSummary() leaves an existing summary alone until the TOC has grown significantly.
+    eckit::PathName summaryPath() const;
+    void writeSummary(bool force = false) const;
+
     // Utilities for handling locks
     std::vector<eckit::PathName> lockfilePaths() const;
 
@@ -198,14 +215,31 @@ protected: // methods
 
     const TocSerialisationVersion& serialisationVersion() const;
 
+private: // types
+
+    /// A TOC_INDEX or TOC_SUB_TOC record already parsed from a mapped TOC
+    struct CachedTocEntry {
+        std::pair<eckit::PathName, eckit::Offset> maskKey_;
+        Index index_;                       ///< null for a subtoc
+        eckit::PathName subTocPath_;
+        std::shared_ptr<TocHandler> subToc_; ///< only opened once found not to be masked
+    };
+
 private: // methods
 
+    /// For restoring sub tocs from the summary, without reading them
+    TocHandler(const eckit::PathName& path, const Key& parentKey, const Key& remapKey);
+
     friend class TocHandlerCloser;
 
     void openForAppend();
 
     void openForRead() const;
 
+    /// Open the TOC to read the records appended since parsedOffset_. Unlike openForRead(), the TOC is never
+    /// copied into memory (see fdbCacheTocsOnRead), so that only what follows parsedOffset_ is read.
+    void openTailForRead() const;
+
     void close() const;
 
     /// Populate the masked sub toc list, starting from the _current_position_ in the
@@ -229,6 +263,34 @@ private: // methods
 
     void dumpTocCache() const;
 
+    static void orderIndexes(bool sorted,
+                             std::vector<Index>& indexes,
+                             std::vector<bool>* indexInSubtoc,
+                             std::vector<Key>* remapKeys);
+
+    /// Equivalent to walking the TOC with readNext(), but loading the subtocs concurrently. Returns the indexes
+    /// in TOC order.
+    void loadIndexesConcurrently(std::vector<Index>& indexes,
+                                 std::set<std::string>* subTocs,
+                                 std::vector<bool>* indexInSubtoc,
+                                 std::vector<Key>* remapKeys) const;
+
+    /// Parse the records appended to the TOC since the last call (or since the summary) into cachedEntries_
+    void refreshIndexCache(bool preloadBTree) const;
+
+    /// Append the indexes that are not masked, in TOC order, descending into (and refreshing) subtocs
+    void collectCachedIndexes(std::vector<Index>& indexes,
+                              const eckit::PathName* subTocPath,
+                              std::set<std::string>* subTocs,
+                              std::vector<bool>* indexInSubtoc,
+                              std::vector<Key>* remapKeys) const;
+
+    /// Seed the index cache from the summary, if enabled and still valid for this TOC
+    bool readSummary() const;
+
+    void encodeIndexCache(eckit::Stream& s) const;
+    void decodeIndexCache(eckit::Stream& s, bool preloadBTree) const;
+
 private: // members
 
     eckit::PathName tocPath_;
@@ -239,6 +301,7 @@ private: // members
     bool useSubToc_;
     bool isSubToc_;
     bool preloadBTree_;
+    bool useSummary_;
 
     // If we have mounted another TocCatalogue internally, what is the current
     // remapping key?
@@ -248,6 +311,7 @@ private: // members
 
     mutable TocCopyWatcher tocReadStats_;
     mutable std::unique_ptr<eckit::MemoryHandle> cachedToc_; ///< this is only for read path
+    mutable std::unique_ptr<MappedToc> mappedToc_;           ///< this is only for read path
 
     /// The sub toc is initialised in the read or write pathways for maintaining state.
     mutable std::unique_ptr<TocHandler> subTocRead_;
@@ -258,6 +322,11 @@ private: // members
 
     mutable bool enumeratedMaskedEntries_;
     mutable bool writeMode_;
+
+    // State of the incremental index loading from a mapped TOC, or from the summary
+    mutable eckit::Offset parsedOffset_;
+    mutable std::vector<CachedTocEntry> cachedEntries_;
+    mutable std::set<std::pair<eckit::PathName, eckit::Offset>> cachedMasks_;
 };
 
 
@@ -11,6 +11,7 @@
 #include "eckit/log/BigNum.h"
 
 #include "fdb5/LibFdb5.h"
+#include "fdb5/api/Metrics.h"
 #include "fdb5/toc/TocStats.h"
 #include "fdb5/toc/TocIndex.h"
 #include "fdb5/toc/BTreeIndex.h"
@@ -82,7 +83,7 @@ bool TocIndex::get(const Key &key, const Key &remapKey, Field &field) const {
     ASSERT(btree_);
     FieldRef ref;
 
-    bool found = btree_->get(key.valuesToString(), ref);
+    bool found = btree_->get(key, ref);
     if ( found ) {
         const eckit::URI& uri = files_.get(ref.uriId());
         FieldLocation* loc = FieldLocationFactory::instance().build(uri.scheme(), uri, ref.offset(), ref.length(), remapKey);
@@ -113,10 +114,17 @@ void TocIndex::reopen() {
     // at the second level of the schema, but is a NEW index).
 
     axes_.wipe();
+    wipeFilter();
 
     open();
 }
 
+void TocIndex::preload() {
+    bool opened = bool(btree_);
+    open();
+    if (mode_ == TocIndex::READ && (opened || !preloadBTree_)) btree_->preload();
+}
+
 void TocIndex::close() {
     if (btree_) {
         eckit::Log::debug<LibFdb5>() << "Closing " << *this << std::endl;
@@ -131,7 +139,7 @@ void TocIndex::add(const Key &key, const Field &field) {
     FieldRef ref(files_, field);
 
     //  bool replace =
-    btree_->set(key.valuesToString(), ref); // returns true if replace, false if new insert
+    btree_->set(key, ref); // returns true if replace, false if new insert
 
     dirty_ = true;
 
@@ -141,10 +149,12 @@ void TocIndex::flush() {
     ASSERT( mode_ == TocIndex::WRITE );
 
     if (dirty_) {
+        Metrics::Timer timer(Metrics::IndexFlush);
         axes_.sort();
         ASSERT(btree_);
         btree_->flush();
         btree_->sync();
+        buildFilter();
         takeTimestamp();
         dirty_ = false;
     }
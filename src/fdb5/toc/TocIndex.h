@@ -94,6 +94,7 @@ private: // methods
     void open() override;
     void close() override;
     void reopen() override;
+    void preload() override;
 
     void visit(IndexLocationVisitor& visitor) const override;
 
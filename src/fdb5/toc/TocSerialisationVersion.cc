@@ -51,12 +51,13 @@ TocSerialisationVersion::TocSerialisationVersion(const fdb5::Config& config) {
 TocSerialisationVersion::~TocSerialisationVersion() {}
 
 std::vector<unsigned int> TocSerialisationVersion::supported() {
-    std::vector<unsigned int> versions = {3, 2, 1};
+    std::vector<unsigned int> versions = {4, 3, 2, 1};
     return versions;
 }
 
+/// Version 4 adds the (optional) Bloom filters of the indexes
 unsigned int TocSerialisationVersion::latest() {
-    return 3;
+    return 4;
 }
 
 unsigned int TocSerialisationVersion::defaulted() {
@@ -20,6 +20,7 @@ namespace fdb5 {
 
 /// Version 2: TOC format originally used in first public release
 /// Version 3: TOC serialisation format includes Stream objects
+/// Version 4: Index records may include a Bloom filter over the keys of the index
 class TocSerialisationVersion {
 
 public:
@@ -37,11 +37,13 @@ TocDbStats::TocDbStats():
     indexFilesSize_(0),
     ownedFilesCount_(0),
     adoptedFilesCount_(0),
-    indexFilesCount_(0)
+    indexFilesCount_(0),
+    indexLookupBuildTime_(0)
 {
 }
 
-TocDbStats::TocDbStats(Stream &s) {
+TocDbStats::TocDbStats(Stream &s) :
+    indexLookupBuildTime_(0) {
 
     s >> dbCount_;
     s >> tocRecordsCount_;
@@ -69,6 +71,7 @@ TocDbStats& TocDbStats::operator+=(const TocDbStats &rhs) {
     ownedFilesCount_ += rhs.ownedFilesCount_;
     adoptedFilesCount_ += rhs.adoptedFilesCount_;
     indexFilesCount_ += rhs.indexFilesCount_;
+    indexLookupBuildTime_ += rhs.indexLookupBuildTime_;
 
     return *this;
 }
@@ -99,6 +102,8 @@ void TocDbStats::report(std::ostream &out, const char *indent) const {
     reportBytes(out, "Total owned size", tocFileSize_ + schemaFileSize_ +  indexFilesSize_ + ownedFilesSize_, indent);
     reportBytes(out, "Total size", tocFileSize_ + schemaFileSize_ +  indexFilesSize_ + ownedFilesSize_ + adoptedFilesSize_, indent);
 
+    reportTime(out, "Index lookup build time", indexLookupBuildTime_, indent);
+
 }
 
 void TocDbStats::encode(Stream& s) const {
@@ -58,6 +58,10 @@ public:
     size_t adoptedFilesCount_;
     size_t indexFilesCount_;
 
+    /// Time spent building the index-key lookup of the readers (s). Only meaningful locally, it
+    /// is not part of the encoded stats so that the remote protocol is unchanged.
+    double indexLookupBuildTime_;
+
     TocDbStats& operator+= (const TocDbStats& rhs);
 
     virtual void add(const DbStatsContent&) override;
@@ -18,14 +18,17 @@
 #include "eckit/io/EmptyHandle.h"
 
 #include "fdb5/LibFdb5.h"
+#include "fdb5/api/Metrics.h"
 #include "fdb5/rules/Rule.h"
 #include "fdb5/database/FieldLocation.h"
+#include "fdb5/database/FlushCoordinator.h"
 #include "fdb5/toc/TocFieldLocation.h"
 #include "fdb5/toc/RootManager.h"
 #include "fdb5/toc/TocPurgeVisitor.h"
 #include "fdb5/toc/TocStats.h"
 #include "fdb5/toc/TocStore.h"
 #include "fdb5/io/FDBFileHandle.h"
+#include "fdb5/io/FDBVectoredFileHandle.h"
 #include "fdb5/io/LustreFileHandle.h"
 
 using namespace eckit;
@@ -61,7 +64,11 @@ std::unique_ptr<FieldLocation> TocStore::archive(const Key &key, const void *dat
 
     eckit::Offset position = dh.position();
 
-    long len = dh.write( data, length );
+    long len;
+    {
+        Metrics::Timer timer(Metrics::StoreWrite);
+        len = dh.write( data, length );
+    }
 
     ASSERT(len == length);
 
@@ -154,6 +161,29 @@ eckit::DataHandle *TocStore::createAsyncHandle(const eckit::PathName &path) {
     return new eckit::AIOHandle(path, nbBuffers, sizeBuffer);
 }
 
+eckit::DataHandle *TocStore::createVectoredHandle(const eckit::PathName &path) {
+
+    static size_t nbBuffers  = eckit::Resource<unsigned long>("fdbNbVectoredBuffers", 4);
+    static size_t sizeBuffer = eckit::Resource<unsigned long>("fdbSizeVectoredBuffer", 1024 * 1024);
+
+    if(stripeLustre()) {
+
+        eckit::Log::debug<LibFdb5>() << "Creating LustreFileHandle<FDBVectoredFileHandle> to " << path
+                                     << " with " << nbBuffers
+                                     << " buffer each with " << eckit::Bytes(sizeBuffer)
+                                     << std::endl;
+
+        return new LustreFileHandle<FDBVectoredFileHandle>(path, nbBuffers, sizeBuffer, stripeDataLustreSettings());
+    }
+
+    eckit::Log::debug<LibFdb5>() << "Creating FDBVectoredFileHandle to " << path
+                                 << " with " << nbBuffers
+                                 << " buffer each with " << eckit::Bytes(sizeBuffer)
+                                 << std::endl;
+
+    return new FDBVectoredFileHandle(path, nbBuffers, sizeBuffer);
+}
+
 eckit::DataHandle *TocStore::createDataHandle(const eckit::PathName &path) {
 
     static bool fdbWriteToNull = eckit::Resource<bool>("fdbWriteToNull;$FDB_WRITE_TO_NULL", false);
@@ -164,6 +194,10 @@ eckit::DataHandle *TocStore::createDataHandle(const eckit::PathName &path) {
     if(fdbAsyncWrite)
         return createAsyncHandle(path);
 
+    static bool fdbVectoredWrite = eckit::Resource<bool>("fdbVectoredWrite;$FDB_VECTORED_WRITE", false);
+    if(fdbVectoredWrite)
+        return createVectoredHandle(path);
+
     return createFileHandle(path);
 }
 
@@ -200,10 +234,15 @@ eckit::PathName TocStore::getDataPath(const Key &key) const {
 
 void TocStore::flushDataHandles() {
 
+    // The handles are independent, so their data is synced concurrently
+
+    std::vector<eckit::DataHandle*> handles;
+    handles.reserve(handles_.size());
     for (HandleStore::iterator j = handles_.begin(); j != handles_.end(); ++j) {
-        eckit::DataHandle *dh = j->second;
-        dh->flush();
+        handles.push_back(j->second);
     }
+
+    FlushCoordinator::run(handles.size(), [&](size_t i) { handles[i]->flush(); });
 }
 
 bool TocStore::canMoveTo(const Key& key, const Config& config, const eckit::URI& dest) const {
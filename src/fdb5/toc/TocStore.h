@@ -65,6 +65,7 @@ protected: // methods
     void closeDataHandles();
     eckit::DataHandle *createFileHandle(const eckit::PathName &path);
     eckit::DataHandle *createAsyncHandle(const eckit::PathName &path);
+    eckit::DataHandle *createVectoredHandle(const eckit::PathName &path);
     eckit::DataHandle *createDataHandle(const eckit::PathName &path);
     eckit::DataHandle& getDataHandle( const eckit::PathName &path );
     eckit::PathName generateDataPath(const Key &key) const;
@@ -121,6 +121,7 @@ bool TocWipeVisitor::visitDatabase(const Catalogue& catalogue, const Store& stor
 
     ASSERT(!tocPath_.asString().size());
     ASSERT(!schemaPath_.asString().size());
+    ASSERT(!summaryPath_.asString().size());
 
     // Having selected a DB, construct the residual request. This is the request that is used for
     // matching Index(es) -- which is relevant if there is subselection of the DB.
@@ -208,6 +209,11 @@ void TocWipeVisitor::addMetadataPaths() {
     const auto&& subtocs(catalogue_.subTocPaths());
     subtocPaths_.insert(subtocs.begin(), subtocs.end());
 
+    // the summary is only a cache of the toc and subtocs, so it is removed before anything it refers to
+
+    PathName summary(catalogue_.summaryPath());
+    if (summary.exists()) summaryPath_ = summary;
+
     // lockfiles
 
     const auto&& lockfiles(catalogue_.lockfilePaths());
@@ -220,6 +226,7 @@ void TocWipeVisitor::ensureSafePaths() {
 
     if (safePaths_.find(tocPath_) != safePaths_.end()) tocPath_ = "";
     if (safePaths_.find(schemaPath_) != safePaths_.end()) schemaPath_ = "";
+    if (safePaths_.find(summaryPath_) != safePaths_.end()) summaryPath_ = "";
 
     for (const auto& p : safePaths_) {
         for (std::set<PathName>* s : {&subtocPaths_, &lockfilePaths_, &indexPaths_, &dataPaths_}) {
@@ -246,6 +253,8 @@ void TocWipeVisitor::calculateResidualPaths() {
     if (schemaPath_.asString().size() && !schemaPath_.exists())
         schemaPath_ = "";
 
+    if (summaryPath_.asString().size() && !summaryPath_.exists()) summaryPath_ = "";
+
     // Consider the total sets of paths
 
     std::set<eckit::PathName> deletePaths;
@@ -256,6 +265,7 @@ void TocWipeVisitor::calculateResidualPaths() {
     if (tocPath_.asString().size()) deletePaths.insert(tocPath_);
     if (schemaPath_.asString().size())
         deletePaths.insert(schemaPath_);
+    if (summaryPath_.asString().size()) deletePaths.insert(summaryPath_);
 
     std::vector<eckit::PathName> allPathsVector;
     StdDir(catalogue_.basePath()).children(allPathsVector);
@@ -289,7 +299,7 @@ void TocWipeVisitor::calculateResidualPaths() {
 bool TocWipeVisitor::anythingToWipe() const {
     return (!subtocPaths_.empty() || !lockfilePaths_.empty() || !indexPaths_.empty() ||
             !dataPaths_.empty() || !indexesToMask_.empty() ||
-            tocPath_.asString().size() || schemaPath_.asString().size());
+            tocPath_.asString().size() || schemaPath_.asString().size() || summaryPath_.asString().size());
 }
 
 void TocWipeVisitor::report() {
@@ -300,8 +310,10 @@ void TocWipeVisitor::report() {
          << std::endl;
 
     out_ << "Toc files to delete:" << std::endl;
-    if (!tocPath_.asString().size() && subtocPaths_.empty()) out_ << " - NONE -" << std::endl;
+    if (!tocPath_.asString().size() && !summaryPath_.asString().size() && subtocPaths_.empty())
+        out_ << " - NONE -" << std::endl;
     if (tocPath_.asString().size()) out_ << "    " << tocPath_ << std::endl;
+    if (summaryPath_.asString().size()) out_ << "    " << summaryPath_ << std::endl;
     for (const auto& f : subtocPaths_) {
         out_ << "    " << f << std::endl;
     }
@@ -386,7 +398,12 @@ void TocWipeVisitor::wipe(bool wipeAll) {
     }
 
     // Now we want to do the actual deletion
-    // n.b. We delete carefully in a order such that we can always access the DB by what is left
+    // n.b. We delete carefully in a order such that we can always access the DB by what is left.
+    //      The summary goes first, so that no reader is directed by it to files that are already gone.
+    if (summaryPath_.asString().size() && summaryPath_.exists()) {
+        catalogue_.remove(summaryPath_, logAlways, logVerbose, doit_);
+    }
+
     for (const PathName& path : residualPaths_) {
         if (path.exists()) {
             catalogue_.remove(path, logAlways, logVerbose, doit_);
@@ -428,6 +445,7 @@ void TocWipeVisitor::catalogueComplete(const Catalogue& catalogue) {
         lockfilePaths_.clear();
         tocPath_ = "";
         schemaPath_ = "";
+        summaryPath_ = "";
     }
 
     ensureSafePaths();
@@ -63,6 +63,7 @@ private: // members
 
     eckit::PathName tocPath_;
     eckit::PathName schemaPath_;
+    eckit::PathName summaryPath_;
 
     std::set<eckit::PathName> subtocPaths_;
     std::set<eckit::PathName> lockfilePaths_;
@@ -33,7 +33,8 @@ FDBVisitTool::FDBVisitTool(int argc, char **argv, std::string minimumKeys) :
     FDBTool(argc, argv),
     fail_(true),
     all_(false),
-    raw_(false) {
+    raw_(false),
+    threads_(0) {
 
     minimumKeys_ = Resource<std::vector<std::string> >("FDBInspectMinimumKeys", minimumKeys, true);
 
@@ -51,6 +52,10 @@ FDBVisitTool::FDBVisitTool(int argc, char **argv, std::string minimumKeys) :
     options_.push_back(
                 new SimpleOption<bool>("ignore-errors",
                                        "Ignore errors (report them as warnings) and continue processing wherever possible"));
+
+    options_.push_back(
+                new SimpleOption<long>("threads",
+                                       "Number of databases to visit concurrently (output remains in database order)"));
 }
 
 FDBVisitTool::~FDBVisitTool() {}
@@ -81,6 +86,11 @@ void FDBVisitTool::init(const option::CmdArgs& args) {
 
     raw_ = args.getBool("raw", false);
 
+    threads_ = args.getLong("threads", 0);
+    if (threads_ < 0) {
+        throw eckit::UserError("--threads must not be negative", Here());
+    }
+
     if (all_ && args.count()) {
         usage(args.tool());
         exit(1);
@@ -99,6 +109,18 @@ bool FDBVisitTool::fail() const {
     return fail_;
 }
 
+Config FDBVisitTool::config(const option::CmdArgs& args) const {
+
+    Config base = FDBTool::config(args);
+    if (threads_ == 0) {
+        return base;
+    }
+
+    eckit::LocalConfiguration user(base.userConfig());
+    user.set("visitThreads", threads_);
+    return Config(base, user);
+}
+
 std::vector<FDBToolRequest> FDBVisitTool::requests(const std::string& verb) const {
 
     std::vector<FDBToolRequest> requests;
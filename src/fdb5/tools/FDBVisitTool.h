@@ -37,6 +37,9 @@ protected: // methods
 
     bool fail() const;
 
+    /// The configuration, with the number of threads to visit with (see fdbVisitThreads)
+    Config config(const eckit::option::CmdArgs& args) const;
+
     std::vector<FDBToolRequest> requests(const std::string& verb="retrieve") const;
 
 private: // members
@@ -54,6 +57,9 @@ private: // members
 
     // Don't apply contextual exapansion on mars requests.
     bool raw_;
+
+    // Visit this many DBs (and read ahead this many indexes) at once. 0 leaves it to the configuration.
+    long threads_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
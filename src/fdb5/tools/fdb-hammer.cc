@@ -8,8 +8,10 @@
  * does it submit to any jurisdiction.
  */
 
+#include <algorithm>
 #include <unordered_set>
 #include <memory>
+#include <vector>
 
 #include "eccodes.h"
 
@@ -18,12 +20,17 @@
 #include "eckit/io/StdFile.h"
 #include "eckit/io/MemoryHandle.h"
 #include "eckit/io/EmptyHandle.h"
+#include "eckit/message/Message.h"
+#include "eckit/message/Reader.h"
 #include "eckit/option/CmdArgs.h"
 #include "eckit/option/SimpleOption.h"
 #include "eckit/option/VectorOption.h"
 
+#include "fdb5/database/WriteVisitor.h"
 #include "fdb5/message/MessageArchiver.h"
+#include "fdb5/message/MessageDecoder.h"
 #include "fdb5/io/HandleGatherer.h"
+#include "fdb5/rules/Schema.h"
 #include "fdb5/tools/FDBTool.h"
 
 // This list is currently sufficient to get to nparams=200 of levtype=ml,type=fc
@@ -32,6 +39,32 @@ const std::unordered_set<size_t> AWKWARD_PARAMS {11, 12, 13, 14, 15, 16, 49, 51,
 
 using namespace eckit;
 
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Expands the schema for each field, without selecting or writing anything
+
+class ExpansionVisitor : public fdb5::WriteVisitor {
+public:
+    ExpansionVisitor(const fdb5::Schema& schema, std::vector<fdb5::Key>& prev) :
+        fdb5::WriteVisitor(prev), schema_(schema), count_(0) {}
+
+    bool selectDatabase(const fdb5::Key&, const fdb5::Key&) override { return true; }
+    bool selectIndex(const fdb5::Key&, const fdb5::Key&) override { return true; }
+    bool selectDatum(const fdb5::Key&, const fdb5::Key&) override { ++count_; return true; }
+
+    const fdb5::Schema& databaseSchema() const override { return schema_; }
+
+    size_t count() const { return count_; }
+
+private:
+    void print(std::ostream& out) const override { out << "ExpansionVisitor[]"; }
+
+    const fdb5::Schema& schema_;
+    size_t count_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 
 class FDBWrite : public fdb5::FDBTool {
 
@@ -45,12 +78,14 @@ class FDBWrite : public fdb5::FDBTool {
 
     void executeRead(const eckit::option::CmdArgs& args);
     void executeWrite(const eckit::option::CmdArgs& args);
+    void reportExpansion(const eckit::option::CmdArgs& args, const std::vector<fdb5::Key>& keys);
 
 public:
 
     FDBWrite(int argc, char **argv) :
         fdb5::FDBTool(argc, argv),
-        verbose_(false) {
+        verbose_(false),
+        threads_(1) {
 
         options_.push_back(new eckit::option::SimpleOption<std::string>("expver", "Reset expver on data"));
         options_.push_back(new eckit::option::SimpleOption<std::string>("class", "Reset class on data"));
@@ -62,15 +97,18 @@ public:
         options_.push_back(new eckit::option::SimpleOption<long>("nlevels", "Number of levels"));
         options_.push_back(new eckit::option::SimpleOption<long>("nparams", "Number of parameters"));
         options_.push_back(new eckit::option::SimpleOption<bool>("verbose", "Print verbose output"));
+        options_.push_back(new eckit::option::SimpleOption<long>("threads", "Number of threads to decode the messages of a step on"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("expansion", "Also report the rate of schema expansion for the keys written"));
     }
     ~FDBWrite() override {}
 
 private:
     bool verbose_;
+    long threads_;
 };
 
 void FDBWrite::usage(const std::string &tool) const {
-    eckit::Log::info() << std::endl << "Usage: " << tool << " [--statistics] [--read] --nsteps=<nsteps> --nensembles=<nensembles> --nlevels=<nlevels> --nparams=<nparams> --expver=<expver> <grib_path>" << std::endl;
+    eckit::Log::info() << std::endl << "Usage: " << tool << " [--statistics] [--read] [--expansion] --nsteps=<nsteps> --nensembles=<nensembles> --nlevels=<nlevels> --nparams=<nparams> --expver=<expver> <grib_path>" << std::endl;
     fdb5::FDBTool::usage(tool);
 }
 
@@ -85,6 +123,10 @@ void FDBWrite::init(const eckit::option::CmdArgs& args)
     ASSERT(args.has("nparams"));
 
     verbose_ = args.getBool("verbose", false);
+    threads_ = args.getLong("threads", 1);
+    if (threads_ < 1) {
+        throw eckit::UserError("--threads must be at least 1", Here());
+    }
 }
 
 void FDBWrite::execute(const eckit::option::CmdArgs &args) {
@@ -115,6 +157,7 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
     size_t size = 0;
 
     fdb5::MessageArchiver archiver(fdb5::Key(), false, verbose_, args);
+    archiver.threads(threads_);
 
     std::string expver = args.getString("expver");
     size = expver.length();
@@ -129,6 +172,11 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
     size_t writeCount = 0;
     size_t bytesWritten = 0;
 
+    bool expansion = args.getBool("expansion", false);
+    std::vector<fdb5::Key> keys;
+
+    std::vector<char> stepMessages;
+
     timer.start();
 
     for (size_t member = 0; member < nensembles; ++member) {
@@ -154,21 +202,28 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
 
                     CODES_CHECK(codes_get_message(handle, reinterpret_cast<const void**>(&buffer), &size), 0);
 
-                    gribTimer.stop();
-                    elapsed_grib += gribTimer.elapsed();
+                    if (expansion) {
+                        MemoryHandle kh(buffer, size);
+                        eckit::message::Reader reader(kh);
+                        keys.emplace_back(fdb5::MessageDecoder::messageToKey(reader.next()));
+                    }
 
-                    MemoryHandle dh(buffer, size);
-                    archiver.archive(dh);
+                    stepMessages.insert(stepMessages.end(), buffer, buffer + size);
                     writeCount++;
                     bytesWritten += size;
-
-                    gribTimer.start();
                 }
             }
 
+            // The messages of a step are archived together, so that they can be decoded on several threads
+
             gribTimer.stop();
             elapsed_grib += gribTimer.elapsed();
+
+            MemoryHandle dh(stepMessages.data(), stepMessages.size());
+            archiver.archive(dh);
             archiver.flush();
+            stepMessages.clear();
+
             gribTimer.start();
         }
     }
@@ -187,6 +242,35 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
     Log::info() << "Writing duration: " << timer.elapsed() - elapsed_grib << std::endl;
     Log::info() << "Total rate: " << double(bytesWritten) / timer.elapsed() << " bytes / s" << std::endl;
     Log::info() << "Total rate: " << double(bytesWritten) / (timer.elapsed() * 1024 * 1024) << " MB / s" << std::endl;
+
+    if (expansion) {
+        reportExpansion(args, keys);
+    }
+}
+
+void FDBWrite::reportExpansion(const eckit::option::CmdArgs& args, const std::vector<fdb5::Key>& keys) {
+
+    const fdb5::Schema& schema = config(args).schema();
+
+    std::vector<fdb5::Key> prev;
+    ExpansionVisitor visitor(schema, prev);
+
+    // Repeat the keys written often enough for the timing to mean something
+
+    size_t passes = std::max<size_t>(1, 1000000 / std::max<size_t>(1, keys.size()));
+
+    eckit::Timer timer;
+    timer.start();
+    for (size_t pass = 0; pass < passes; ++pass) {
+        for (const fdb5::Key& key : keys) {
+            schema.expand(key, visitor);
+        }
+    }
+    timer.stop();
+
+    Log::info() << "Schema expansions: " << visitor.count() << std::endl;
+    Log::info() << "Expansion duration: " << timer.elapsed() << std::endl;
+    Log::info() << "Expansion rate: " << double(visitor.count()) / timer.elapsed() << " fields / s" << std::endl;
 }
 
 
@@ -11,6 +11,7 @@
 #include <memory>
 
 #include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
 #include "eckit/io/DataHandle.h"
 #include "eckit/option/CmdArgs.h"
 #include "eckit/option/SimpleOption.h"
@@ -35,7 +36,8 @@ public:
 
     FDBWrite(int argc, char **argv) :
         fdb5::FDBTool(argc, argv),
-        verbose_(false) {
+        verbose_(false),
+        threads_(1) {
 
         options_.push_back(
                     new eckit::option::SimpleOption<std::string>("include-filter",
@@ -53,12 +55,15 @@ public:
         options_.push_back(new eckit::option::SimpleOption<bool>("statistics", "Report timing statistics"));
 
         options_.push_back(new eckit::option::SimpleOption<bool>("verbose", "Print verbose output"));
+
+        options_.push_back(new eckit::option::SimpleOption<long>("threads", "Number of threads to decode the messages on"));
     }
 
     std::string filterInclude_;
     std::string filterExclude_;
     std::string modifiers_;
     bool verbose_;
+    long threads_;
 };
 
 void FDBWrite::usage(const std::string &tool) const {
@@ -73,6 +78,10 @@ void FDBWrite::init(const eckit::option::CmdArgs& args)
     args.get("exclude-filter", filterExclude_);
     args.get("modifiers", modifiers_);
     verbose_ = args.getBool("verbose", false);
+    threads_ = args.getLong("threads", 1);
+    if (threads_ < 1) {
+        throw eckit::UserError("--threads must be at least 1", Here());
+    }
 }
 
 void FDBWrite::execute(const eckit::option::CmdArgs &args) {
@@ -81,6 +90,7 @@ void FDBWrite::execute(const eckit::option::CmdArgs &args) {
 
     archiver.filters(filterInclude_, filterExclude_);
     archiver.modifiers(modifiers_);
+    archiver.threads(threads_);
 
     for (size_t i = 0; i < args.count(); i++) {
 
@@ -18,9 +18,12 @@
 #ifndef fdb_testing_ApiSpy_H
 #define fdb_testing_ApiSpy_H
 
+#include <chrono>
+#include <thread>
 #include <vector>
 #include <tuple>
 
+#include "eckit/exception/Exceptions.h"
 #include "eckit/message/Message.h"
 
 #include "fdb5/api/FDBFactory.h"
@@ -80,6 +83,9 @@ public: // methods
     }
 
     void archive(const fdb5::Key& key, const void* data, size_t length) override {
+        if (failArchives_) {
+            throw eckit::SeriousBug("ApiSpy archive failed", Here());
+        }
         counts_.archive += 1;
         archives_.push_back(std::make_tuple(key, data, length));
     }
@@ -87,12 +93,12 @@ public: // methods
     fdb5::ListIterator inspect(const metkit::mars::MarsRequest& request) override {
         counts_.inspect += 1;
         retrieves_.push_back(request);
-        return fdb5::ListIterator(0);
+        return listingIterator();
     }
 
     fdb5::ListIterator list(const fdb5::FDBToolRequest& request) override {
         counts_.list += 1;
-        return fdb5::ListIterator(0);
+        return listingIterator();
     }
 
     fdb5::DumpIterator dump(const fdb5::FDBToolRequest& request, bool simple) override {
@@ -133,6 +139,12 @@ public: // methods
     }
 
     void flush() override {
+        if (flushDelay_) {
+            std::this_thread::sleep_for(std::chrono::microseconds(flushDelay_));
+        }
+        if (failFlushes_) {
+            throw eckit::SeriousBug("ApiSpy flush failed", Here());
+        }
         counts_.flush += 1;
     }
 
@@ -143,6 +155,17 @@ public: // methods
     const Archives& archives() const { return archives_; }
     const Retrieves& retrieves() const { return retrieves_; }
 
+    /// The fields that inspect() and list() return, produced one at a time, each after the given delay
+    void listing(const std::vector<fdb5::ListElement>& elements, unsigned int delayMicros = 0) {
+        listing_ = elements;
+        listingDelay_ = delayMicros;
+    }
+
+    /// Make archive() and flush() fail (without being counted), and flush() take the given time
+    void failArchives(bool fail) { failArchives_ = fail; }
+    void failFlushes(bool fail) { failFlushes_ = fail; }
+    void flushDelay(unsigned int micros) { flushDelay_ = micros; }
+
     static std::vector<ApiSpy*>& knownSpies() {
         static std::vector<ApiSpy*> s;
         return s;
@@ -152,12 +175,33 @@ private: // methods
 
     void print(std::ostream& s) const override { s << "ApiSpy()"; }
 
+    fdb5::ListIterator listingIterator() const {
+        if (listing_.empty()) {
+            return fdb5::ListIterator(0);
+        }
+        std::vector<fdb5::ListElement> elements(listing_);
+        unsigned int delay = listingDelay_;
+        return fdb5::ListIterator(new fdb5::ListAsyncIterator([elements, delay](eckit::Queue<fdb5::ListElement>& queue) {
+            for (const fdb5::ListElement& elem : elements) {
+                std::this_thread::sleep_for(std::chrono::microseconds(delay));
+                queue.emplace(elem);
+            }
+        }));
+    }
+
 private: // members
 
     Counts counts_;
 
     Archives archives_;
     Retrieves retrieves_;
+
+    std::vector<fdb5::ListElement> listing_;
+    unsigned int listingDelay_ = 0;
+
+    bool failArchives_ = false;
+    bool failFlushes_ = false;
+    unsigned int flushDelay_ = 0;
 };
 
 
@@ -0,0 +1,218 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/helpers/APIIterator.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef fdb5::APIIterator<size_t> Iterator;
+typedef std::vector<std::function<Iterator()>> Sources;
+
+/// The sources being iterated, to check that none is left behind
+std::atomic<long> live(0);
+
+/// Gives lane * 1000000 + i for i in [0, count), then fails if asked to
+class LaneIterator : public fdb5::APIIteratorBase<size_t> {
+public:
+
+    LaneIterator(size_t lane, size_t count, bool fail, size_t delayMicros) :
+        lane_(lane), count_(count), fail_(fail), delay_(delayMicros), next_(0) {
+        ++live;
+    }
+
+    ~LaneIterator() override { --live; }
+
+    bool next(size_t& elem) override {
+        if (delay_) {
+            std::this_thread::sleep_for(std::chrono::microseconds(delay_));
+        }
+        if (next_ == count_) {
+            if (fail_) {
+                throw eckit::SeriousBug("Lane " + std::to_string(lane_) + " failed", Here());
+            }
+            return false;
+        }
+        elem = lane_ * 1000000 + next_++;
+        return true;
+    }
+
+private:
+
+    size_t lane_;
+    size_t count_;
+    bool fail_;
+    size_t delay_;
+    size_t next_;
+};
+
+Sources lanes(const std::vector<size_t>& counts, long failing = -1, size_t delayMicros = 0) {
+    Sources sources;
+    for (size_t lane = 0; lane < counts.size(); ++lane) {
+        size_t count = counts[lane];
+        bool fail = (long(lane) == failing);
+        sources.emplace_back([lane, count, fail, delayMicros] {
+            return Iterator(new LaneIterator(lane, count, fail, delayMicros));
+        });
+    }
+    return sources;
+}
+
+/// Reads to the end, returning the number of elements read
+size_t drain(fdb5::APIIteratorBase<size_t>& it) {
+    size_t count = 0;
+    size_t elem;
+    while (it.next(elem)) {
+        ++count;
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Interleaving keeps the order within each lane" ) {
+
+    std::vector<size_t> counts{1000, 0, 1, 5000, 200};
+
+    for (size_t queueSize : {1, 10, 100}) {
+
+        fdb5::APIInterleavingIterator<size_t> it(lanes(counts), queueSize);
+
+        std::vector<size_t> seen(counts.size(), 0);
+        size_t elem;
+        while (it.next(elem)) {
+            size_t lane = elem / 1000000;
+            EXPECT(lane < counts.size());
+            EXPECT(elem % 1000000 == seen[lane]);
+            ++seen[lane];
+        }
+
+        EXPECT(seen == counts);
+        EXPECT(!it.next(elem));
+    }
+
+    EXPECT(live == 0);
+
+    // And with no lanes at all
+    fdb5::APIInterleavingIterator<size_t> none(Sources{});
+    size_t elem;
+    EXPECT(!none.next(elem));
+}
+
+CASE( "An error in one lane reaches next()" ) {
+
+    for (long failing : {0, 2}) {
+
+        fdb5::APIInterleavingIterator<size_t> it(lanes({100, 100, 100}, failing), 10);
+
+        EXPECT_THROWS_AS(drain(it), eckit::SeriousBug);
+    }
+
+    // Also if making the lane's iterator fails
+
+    Sources sources = lanes({100, 100});
+    sources.emplace_back([]() -> Iterator { throw eckit::UserError("No such lane", Here()); });
+
+    {
+        fdb5::APIInterleavingIterator<size_t> it(sources, 10);
+        EXPECT_THROWS_AS(drain(it), eckit::UserError);
+    }
+
+    EXPECT(live == 0);
+}
+
+CASE( "Destroying a partly consumed iterator joins its workers" ) {
+
+    for (size_t consumed : {0, 1, 50}) {
+        {
+            // Far more than the queue holds, some slow, so that the workers are blocked or busy
+            fdb5::APIInterleavingIterator<size_t> it(lanes({1000000, 1000000, 1000}, -1, 0), 10);
+            fdb5::APIInterleavingIterator<size_t> slow(lanes({1000, 1000}, -1, 1000), 10);
+            size_t elem;
+            for (size_t i = 0; i < consumed; ++i) {
+                EXPECT(it.next(elem));
+                EXPECT(slow.next(elem));
+            }
+        }
+        EXPECT(live == 0);
+    }
+}
+
+CASE( "An async iterator hands on its worker's error, and joins it when destroyed part way through" ) {
+
+    auto worker = [](size_t count, bool fail) {
+        return [count, fail](eckit::Queue<size_t>& queue) {
+            for (size_t i = 0; i < count; ++i) {
+                queue.emplace(i);
+            }
+            if (fail) {
+                throw eckit::SeriousBug("Worker failed", Here());
+            }
+        };
+    };
+
+    {
+        fdb5::APIAsyncIterator<size_t> it(worker(100, false), 10);
+        size_t elem;
+        size_t expected = 0;
+        while (it.next(elem)) {
+            EXPECT(elem == expected++);
+        }
+        EXPECT(expected == 100);
+    }
+
+    {
+        fdb5::APIAsyncIterator<size_t> it(worker(100, true), 10);
+        EXPECT_THROWS_AS(drain(it), eckit::SeriousBug);
+    }
+
+    std::atomic<bool> finished(false);
+    {
+        fdb5::APIAsyncIterator<size_t> it([&finished](eckit::Queue<size_t>& queue) {
+            try {
+                for (size_t i = 0; i < 1000000; ++i) {
+                    queue.emplace(i);
+                }
+            } catch (...) {
+                finished = true;
+                throw;
+            }
+            finished = true;
+        }, 10);
+        size_t elem;
+        EXPECT(it.next(elem));
+    }
+    EXPECT(finished);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -13,7 +13,10 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <algorithm>
 #include <cstdlib>
+#include <string>
+#include <vector>
 
 #include "eckit/testing/Test.h"
 #include "eckit/utils/Translator.h"
@@ -268,6 +271,86 @@ CASE( "lists_distributed_according_to_dist" ) {
 }
 
 
+/// Gives each lane's spy some fields to list, the first lane the slowest. Returns the fields of each lane.
+std::vector<std::vector<std::string>> giveListings(size_t count) {
+
+    std::vector<std::vector<std::string>> lanes;
+
+    for (size_t lane = 0; lane < ApiSpy::knownSpies().size(); ++lane) {
+        std::vector<fdb5::ListElement> elements;
+        lanes.emplace_back();
+        for (size_t n = 0; n < count; ++n) {
+            fdb5::Key key;
+            key.set("lane", std::to_string(lane));
+            key.set("n", std::to_string(n));
+            elements.emplace_back(std::vector<fdb5::Key>{key}, nullptr, 0);
+            lanes.back().push_back(key.valuesToString());
+        }
+        ApiSpy::knownSpies()[lane]->listing(elements, lane == 0 ? 2000 : 0);
+    }
+
+    return lanes;
+}
+
+std::vector<std::string> drain(fdb5::ListIterator&& it) {
+    std::vector<std::string> out;
+    fdb5::ListElement elem;
+    while (it.next(elem)) {
+        out.push_back(elem.combinedKey().valuesToString());
+    }
+    return out;
+}
+
+CASE( "Inspecting the lanes gives their fields in lane order, however long each takes" ) {
+
+    fdb5::FDB fdb(defaultConfig());
+    EXPECT(ApiSpy::knownSpies().size() == 3);
+
+    std::vector<std::vector<std::string>> lanes = giveListings(50);
+    std::vector<std::string> expected;
+    for (const auto& lane : lanes) {
+        expected.insert(expected.end(), lane.begin(), lane.end());
+    }
+
+    metkit::mars::MarsRequest req;
+    req.setValuesTyped(new metkit::mars::TypeAny("class"), std::vector<std::string>{"od"});
+    req.setValuesTyped(new metkit::mars::TypeAny("expver"), std::vector<std::string>{"xxxx"});
+
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT(drain(fdb.inspect(req)) == expected);
+    }
+}
+
+CASE( "Listing the lanes interleaves them, keeping the order within each lane" ) {
+
+    fdb5::FDB fdb(defaultConfig());
+    EXPECT(ApiSpy::knownSpies().size() == 3);
+
+    std::vector<std::vector<std::string>> lanes = giveListings(50);
+
+    std::vector<std::string> listed = drain(fdb.list(fdb5::FDBToolRequest({}, true)));
+    EXPECT(listed.size() == 3 * 50);
+
+    // Each lane's fields are a subsequence of the output
+
+    for (const auto& lane : lanes) {
+        auto pos = listed.begin();
+        for (const std::string& field : lane) {
+            pos = std::find(pos, listed.end(), field);
+            EXPECT(pos != listed.end());
+        }
+    }
+
+    // The slow lane does not hold up the others
+    EXPECT(listed.front() != lanes[0].front());
+
+    // And a listing abandoned part way through can be destroyed
+    fdb5::ListIterator it = fdb.list(fdb5::FDBToolRequest({}, true));
+    fdb5::ListElement elem;
+    EXPECT(it.next(elem));
+}
+
+
 CASE( "dump_distributed_according_to_dist" ) {
 
     // Build FDB from default config
@@ -62,6 +62,39 @@ void key_compare(const std::vector<fdb5::Key>& keys, fdb_listiterator_t *it, boo
     err = fdb_delete_splitkey(sk);
 }
 
+/// Retrieves a single field, and checks that it is byte for byte the expected data
+void check_retrieve(fdb_handle_t* fdb, const char* expver, const char* levelist, const eckit::Buffer& expected) {
+    fdb_request_t* request;
+    fdb_new_request(&request);
+    fdb_request_add1(request, "domain", "g");
+    fdb_request_add1(request, "stream", "oper");
+    fdb_request_add1(request, "levtype", "pl");
+    fdb_request_add1(request, "levelist", levelist);
+    fdb_request_add1(request, "date", "20191110");
+    fdb_request_add1(request, "time", "0000");
+    fdb_request_add1(request, "step", "0");
+    fdb_request_add1(request, "param", "138");
+    fdb_request_add1(request, "class", "rd");
+    fdb_request_add1(request, "type", "an");
+    fdb_request_add1(request, "expver", expver);
+
+    long size;
+    long read = 0;
+    fdb_datareader_t* dr;
+    fdb_new_datareader(&dr);
+    EXPECT(fdb_retrieve(fdb, request, dr) == FDB_SUCCESS);
+    fdb_datareader_open(dr, &size);
+    EXPECT_EQUAL(long(expected.size()), size);
+
+    eckit::Buffer buf(size);
+    fdb_datareader_read(dr, buf, size, &read);
+    EXPECT_EQUAL(size, read);
+    EXPECT(::memcmp(buf, expected, size) == 0);
+
+    fdb_delete_datareader(dr);
+    fdb_delete_request(request);
+}
+
 CASE( "fdb_c - archive & list" ) {
     size_t length;
     DataHandle *dh;
@@ -206,6 +239,119 @@ CASE( "fdb_c - archive & list" ) {
 }
 
 
+CASE( "fdb_c - batch archive & list" ) {
+    DataHandle *dh;
+
+    fdb_handle_t* fdb;
+    fdb_new_handle(&fdb);
+
+    fdb_key_t* keys[2];
+    const char* levelists[] = {"300", "400"};
+    for (size_t i = 0; i < 2; i++) {
+        fdb_new_key(&keys[i]);
+        fdb_key_add(keys[i], "domain", "g");
+        fdb_key_add(keys[i], "stream", "oper");
+        fdb_key_add(keys[i], "levtype", "pl");
+        fdb_key_add(keys[i], "levelist", levelists[i]);
+        fdb_key_add(keys[i], "date", "20191110");
+        fdb_key_add(keys[i], "time", "0000");
+        fdb_key_add(keys[i], "step", "0");
+        fdb_key_add(keys[i], "param", "138");
+        fdb_key_add(keys[i], "class", "rd");
+        fdb_key_add(keys[i], "type", "an");
+        fdb_key_add(keys[i], "expver", "xxxz");
+    }
+
+    eckit::PathName grib1("x138-300.grib");
+    size_t length1 = grib1.size();
+    eckit::Buffer buf1(length1);
+    dh = grib1.fileHandle();
+    dh->openForRead();
+    dh->read(buf1, length1);
+    dh->close();
+
+    eckit::PathName grib2("x138-400.grib");
+    size_t length2 = grib2.size();
+    eckit::Buffer buf2(length2);
+    dh = grib2.fileHandle();
+    dh->openForRead();
+    dh->read(buf2, length2);
+    dh->close();
+
+    // Out of index order, to be sorted on the way in
+    fdb_key_t* batchKeys[] = {keys[1], keys[0]};
+    const char* batchData[] = {buf2, buf1};
+    size_t batchLengths[] = {length2, length1};
+
+    EXPECT(FDB_SUCCESS == fdb_archive_batch(fdb, batchKeys, batchData, batchLengths, 2));
+    EXPECT(FDB_SUCCESS == fdb_flush(fdb));
+
+    fdb_request_t* request;
+    fdb_new_request(&request);
+    fdb_request_add1(request, "domain", "g");
+    fdb_request_add1(request, "stream", "oper");
+    fdb_request_add1(request, "levtype", "pl");
+    fdb_request_add(request, "levelist", levelists, 2);
+    fdb_request_add1(request, "date", "20191110");
+    fdb_request_add1(request, "time", "0000");
+    fdb_request_add1(request, "step", "0");
+    fdb_request_add1(request, "param", "138");
+    fdb_request_add1(request, "class", "rd");
+    fdb_request_add1(request, "type", "an");
+    fdb_request_add1(request, "expver", "xxxz");
+
+    fdb_listiterator_t* it;
+    fdb_list(fdb, request, &it, true);
+
+    size_t count = 0;
+    int err;
+    while ((err = fdb_listiterator_next(it)) == FDB_SUCCESS) {
+        const char *uri;
+        size_t off, attr_len;
+        fdb_listiterator_attrs(it, &uri, &off, &attr_len);
+        EXPECT(attr_len == 3280398);
+        count++;
+    }
+    EXPECT(err == FDB_ITERATION_COMPLETE);
+    EXPECT(count == 2);
+    fdb_delete_listiterator(it);
+
+    check_retrieve(fdb, "xxxz", "300", buf1);
+    check_retrieve(fdb, "xxxz", "400", buf2);
+
+    // A key repeated within a batch resolves to its last occurrence, as for separate archive calls
+
+    for (size_t i = 0; i < 2; i++) {
+        fdb_key_add(keys[i], "expver", "xxzd");
+    }
+
+    fdb_key_t* dupKeys[] = {keys[0], keys[1], keys[0]};
+    const char* dupData[] = {buf1, buf2, buf2};
+    size_t dupLengths[] = {length1, length2, length2};
+
+    EXPECT(FDB_SUCCESS == fdb_archive_batch(fdb, dupKeys, dupData, dupLengths, 3));
+    EXPECT(FDB_SUCCESS == fdb_flush(fdb));
+
+    fdb_request_add1(request, "expver", "xxzd");
+    fdb_list(fdb, request, &it, true);
+
+    count = 0;
+    while ((err = fdb_listiterator_next(it)) == FDB_SUCCESS) {
+        count++;
+    }
+    EXPECT(err == FDB_ITERATION_COMPLETE);
+    EXPECT(count == 2);
+    fdb_delete_listiterator(it);
+
+    check_retrieve(fdb, "xxzd", "300", buf2);
+    check_retrieve(fdb, "xxzd", "400", buf2);
+
+    fdb_delete_request(request);
+    fdb_delete_key(keys[0]);
+    fdb_delete_key(keys[1]);
+    fdb_delete_handle(fdb);
+}
+
 #if fdb5_HAVE_GRIB
 CASE( "fdb_c - multiple archive & list" ) {
     size_t length1, length2, length3;
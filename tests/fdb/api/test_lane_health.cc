@@ -0,0 +1,351 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run with a probe interval of 1s, a slow lane minimum of 2 flushes and 0.01s, and a lane order cache of 2 DBs
+
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/LaneHealth.h"
+#include "fdb5/config/Config.h"
+
+#include "ApiSpy.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool near(double a, double b) {
+    return std::abs(a - b) < 1e-9;
+}
+
+fdb5::Config distConfig(const std::string& distribution) {
+
+    std::vector<LocalConfiguration> lanes;
+    for (const char* id : {"1", "2", "3"}) {
+        LocalConfiguration lane;
+        lane.set("type", "spy");
+        lane.set("id", id);
+        lanes.push_back(lane);
+    }
+
+    fdb5::Config cfg;
+    cfg.set("type", "dist");
+    cfg.set("distribution", distribution);
+    cfg.set("lanes", lanes);
+    return cfg;
+}
+
+/// A DistFDB and the spies that are its lanes
+struct Dist {
+
+    Dist(const std::string& distribution = "field") :
+        first(ApiSpy::knownSpies().size()),
+        fdb(distConfig(distribution)) {
+        spies.assign(ApiSpy::knownSpies().begin() + first, ApiSpy::knownSpies().end());
+        ASSERT(spies.size() == 3);
+    }
+
+    /// Archives the field, returning the lane that it went to
+    size_t archive(const fdb5::Key& key) {
+        std::vector<size_t> before;
+        for (const ApiSpy* spy : spies) {
+            before.push_back(spy->counts().archive);
+        }
+        int data = 1234;
+        fdb.archive(key, &data, sizeof(data));
+        for (size_t idx = 0; idx < spies.size(); ++idx) {
+            if (spies[idx]->counts().archive != before[idx]) {
+                return idx;
+            }
+        }
+        return spies.size();
+    }
+
+    size_t first;
+    fdb5::FDB fdb;
+    std::vector<ApiSpy*> spies;
+};
+
+fdb5::Key field(size_t i) {
+    fdb5::Key k;
+    k.set("class", "od");
+    k.set("expver", "xxxx");
+    k.set("f", std::to_string(i));
+    return k;
+}
+
+fdb5::Key dbField(size_t db, const std::string& param) {
+    fdb5::Key k;
+    k.set("class", "rd");
+    k.set("expver", "xxxx");
+    k.set("stream", "oper");
+    k.set("date", std::to_string(20201101 + db));
+    k.set("time", "0000");
+    k.set("domain", "g");
+    k.set("type", "an");
+    k.set("levtype", "pl");
+    k.set("step", "0");
+    k.set("levelist", "500");
+    k.set("param", param);
+    return k;
+}
+
+/// Counts the fields [begin, end) that a healthy DistFDB puts first on the lane, and that go there on the given one
+void archiveFields(Dist& dist, Dist& healthy, size_t lane, size_t begin, size_t end, size_t& preferred,
+                   size_t& received) {
+    preferred = 0;
+    received = 0;
+    for (size_t i = begin; i < end; ++i) {
+        size_t to = dist.archive(field(i));
+        EXPECT(to < dist.spies.size());
+        if (healthy.archive(field(i)) == lane) ++preferred;
+        if (to == lane) ++received;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Lane health averages the flush latency and error rate, and takes a failing lane out of use for a while" ) {
+
+    using clock = fdb5::LaneHealth::clock;
+
+    fdb5::LaneHealth health;
+    clock::time_point now = clock::now();
+
+    EXPECT(health.available(now));
+    EXPECT(!health.disabled());
+    EXPECT(health.flushes() == 0);
+    EXPECT(health.flushLatency() == 0);
+    EXPECT(health.errorRate() == 0);
+
+    // The first flush is taken as it is, later ones are averaged in
+
+    health.flushed(2.0);
+    EXPECT(health.flushes() == 1);
+    EXPECT(near(health.flushLatency(), 2.0));
+
+    health.flushed(1.0);
+    EXPECT(health.flushes() == 2);
+    EXPECT(near(health.flushLatency(), 1.9));
+
+    // A failure takes the lane out of use until the probe interval has passed
+
+    health.failure(now, std::chrono::seconds(10));
+    EXPECT(health.disabled());
+    EXPECT(near(health.errorRate(), 0.1));
+    EXPECT(!health.available(now));
+    EXPECT(!health.available(now + std::chrono::seconds(9)));
+    EXPECT(health.available(now + std::chrono::seconds(10)));
+
+    health.failure(now, std::chrono::seconds(10));
+    EXPECT(near(health.errorRate(), 0.19));
+
+    // Successful flushes make the errors less recent, but only a successful archive brings the lane back
+
+    health.flushed(1.9);
+    EXPECT(health.disabled());
+    EXPECT(near(health.errorRate(), 0.171));
+    EXPECT(health.flushes() == 3);
+
+    health.archived();
+    EXPECT(!health.disabled());
+    EXPECT(health.available(now));
+    EXPECT(near(health.errorRate(), 0.1539));
+    EXPECT(near(health.flushLatency(), 1.9));
+
+    std::ostringstream oss;
+    oss << health;
+    EXPECT(oss.str().find("flushes=3") != std::string::npos);
+    EXPECT(oss.str().find("disabled=0") != std::string::npos);
+}
+
+CASE( "A failing lane is out of use until it is probed again after the probe interval" ) {
+
+    Dist dist;
+    Dist healthy;
+
+    size_t preferred;
+    size_t received;
+
+    // The fields of the failing lane go to the others
+
+    dist.spies[0]->failArchives(true);
+    archiveFields(dist, healthy, 0, 0, 30, preferred, received);
+    EXPECT(preferred > 0);
+    EXPECT(received == 0);
+
+    // And still do once it would work again, until the probe interval is over
+
+    dist.spies[0]->failArchives(false);
+    archiveFields(dist, healthy, 0, 30, 60, preferred, received);
+    EXPECT(preferred > 0);
+    EXPECT(received == 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    archiveFields(dist, healthy, 0, 60, 120, preferred, received);
+    EXPECT(received > 0);
+    EXPECT(received <= preferred);
+
+    // So too a lane whose flush fails
+
+    dist.fdb.flush();
+
+    dist.spies[1]->failFlushes(true);
+    archiveFields(dist, healthy, 1, 120, 150, preferred, received);
+    EXPECT(received > 0);
+    EXPECT_THROWS_AS(dist.fdb.flush(), eckit::SeriousBug);
+
+    dist.spies[1]->failFlushes(false);
+    archiveFields(dist, healthy, 1, 150, 180, preferred, received);
+    EXPECT(preferred > 0);
+    EXPECT(received == 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    archiveFields(dist, healthy, 1, 180, 240, preferred, received);
+    EXPECT(received > 0);
+    dist.fdb.flush();
+}
+
+CASE( "A lane much slower to flush than the others is spilled over, but used if nothing else works" ) {
+
+    Dist dist;
+    Dist healthy;
+
+    size_t preferred;
+    size_t received;
+
+    // Until each lane has been flushed twice, the slow lane gets its share
+
+    dist.spies[1]->flushDelay(50000);
+    for (size_t round = 0; round < 2; ++round) {
+        archiveFields(dist, healthy, 1, round * 30, (round + 1) * 30, preferred, received);
+        EXPECT(preferred > 0);
+        EXPECT(received == preferred);
+        dist.fdb.flush();
+    }
+    for (const ApiSpy* spy : dist.spies) {
+        EXPECT(spy->counts().flush == 2);
+    }
+
+    // After that, hardly any of it
+
+    archiveFields(dist, healthy, 1, 60, 360, preferred, received);
+    EXPECT(preferred > 0);
+    EXPECT(received * 4 <= preferred);
+    dist.fdb.flush();
+
+    // If the other lanes fail, everything goes to the slow lane
+
+    dist.spies[0]->failArchives(true);
+    dist.spies[2]->failArchives(true);
+    archiveFields(dist, healthy, 1, 360, 390, preferred, received);
+    EXPECT(received == 30);
+    dist.fdb.flush();
+
+    // And if it fails too, there is nowhere left
+
+    dist.spies[1]->failArchives(true);
+    EXPECT_THROWS_AS(dist.archive(field(390)), eckit::Exception);
+}
+
+CASE( "A lane that has been failing is spilled over as often as it has failed" ) {
+
+    Dist dist;
+    Dist healthy;
+
+    // Its error rate builds up as its flushes keep failing
+
+    size_t i = 0;
+    while (dist.archive(field(i)) != 2) {
+        ++i;
+        ASSERT(i < 100);
+    }
+
+    dist.spies[2]->failFlushes(true);
+    for (size_t n = 0; n < 20; ++n) {
+        EXPECT_THROWS_AS(dist.fdb.flush(), eckit::SeriousBug);
+    }
+    dist.spies[2]->failFlushes(false);
+    dist.fdb.flush();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    // It is back in use, but some of its fields go elsewhere until it has been succeeding for a while
+
+    size_t preferred;
+    size_t received;
+    archiveFields(dist, healthy, 2, 1000, 1300, preferred, received);
+    EXPECT(received > 0);
+    EXPECT(received < preferred);
+}
+
+CASE( "With distribution by database, the fields of a DB all go to one lane, whether its lane order is cached or not" ) {
+
+    const std::vector<std::string> params{"130", "131", "138"};
+    const size_t databases = 8;
+
+    std::map<size_t, size_t> laneOf;
+
+    {
+        // Interleaved, so that the lane orders of more DBs than are cached are needed again and again
+
+        Dist dist("database");
+        for (size_t round = 0; round < 3; ++round) {
+            for (size_t db = 0; db < databases; ++db) {
+                for (const std::string& param : params) {
+                    size_t lane = dist.archive(dbField(db, param));
+                    EXPECT(lane < dist.spies.size());
+                    auto it = laneOf.emplace(db, lane).first;
+                    EXPECT(it->second == lane);
+                }
+            }
+        }
+    }
+
+    std::set<size_t> used;
+    for (const auto& kv : laneOf) {
+        used.insert(kv.second);
+    }
+    EXPECT(used.size() > 1);
+
+    // A new DistFDB, seeing the DBs in another order, agrees
+
+    Dist fresh("database");
+    for (size_t db = databases; db-- > 0;) {
+        EXPECT(fresh.archive(dbField(db, "155")) == laneOf[db]);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
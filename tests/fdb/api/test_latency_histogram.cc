@@ -0,0 +1,170 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/LatencyHistogram.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The upper bound of the bucket the value falls in, as given by a histogram holding it and a larger value
+double bucketBound(double seconds) {
+    fdb5::LatencyHistogram h;
+    h.add(seconds);
+    h.add(1e6);
+    return h.percentile(0.5);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "An empty histogram" ) {
+
+    fdb5::LatencyHistogram h;
+    EXPECT(h.count() == 0);
+    EXPECT(h.max() == 0);
+    EXPECT(h.percentile(0.5) == 0);
+    EXPECT(h.percentile(1) == 0);
+}
+
+CASE( "Microseconds are counted exactly up to 16us" ) {
+
+    for (size_t us = 0; us < 16; ++us) {
+        double bound = bucketBound((us + 0.5) * 1e-6);
+        EXPECT(std::abs(bound - (us + 1) * 1e-6) < 1e-12);
+    }
+}
+
+CASE( "Beyond 16us, buckets are within 12.5% of their values" ) {
+
+    double previous = 0;
+    for (double us = 16; us < 1e11; us *= 1.01) {
+        double seconds = us * 1e-6;
+        double bound = bucketBound(seconds);
+        EXPECT(bound > seconds);
+        EXPECT(bound <= seconds * 1.125 + 1e-6);
+        EXPECT(bound >= previous);
+        previous = bound;
+    }
+
+    // The first buckets above the exact ones
+    EXPECT(std::abs(bucketBound(16.5e-6) - 18e-6) < 1e-12);
+    EXPECT(std::abs(bucketBound(17.5e-6) - 18e-6) < 1e-12);
+    EXPECT(std::abs(bucketBound(18.5e-6) - 20e-6) < 1e-12);
+    EXPECT(std::abs(bucketBound(31.5e-6) - 32e-6) < 1e-12);
+    EXPECT(std::abs(bucketBound(32.5e-6) - 36e-6) < 1e-12);
+}
+
+CASE( "Percentiles are found within the precision of the buckets" ) {
+
+    // 1ms to 1s, uniformly
+    fdb5::LatencyHistogram h;
+    for (size_t ms = 1; ms <= 1000; ++ms) {
+        h.add(ms * 1e-3);
+    }
+
+    EXPECT(h.count() == 1000);
+    EXPECT(h.max() == 1.0);
+
+    for (double p : {0.001, 0.1, 0.5, 0.9, 0.99, 0.999}) {
+        double exact = p;
+        EXPECT(h.percentile(p) >= exact);
+        EXPECT(h.percentile(p) <= exact * 1.125);
+    }
+
+    // Never beyond the largest value
+    EXPECT(h.percentile(1) == 1.0);
+}
+
+CASE( "Histograms are merged" ) {
+
+    fdb5::LatencyHistogram all;
+    fdb5::LatencyHistogram odd;
+    fdb5::LatencyHistogram even;
+
+    for (size_t i = 1; i <= 5000; ++i) {
+        double seconds = std::pow(1.003, double(i)) * 1e-6;
+        all.add(seconds);
+        (i % 2 ? odd : even).add(seconds);
+    }
+
+    fdb5::LatencyHistogram merged(odd);
+    merged += even;
+
+    EXPECT(merged.count() == all.count());
+    EXPECT(merged.max() == all.max());
+    for (double p : {0.0, 0.25, 0.5, 0.75, 0.99, 1.0}) {
+        EXPECT(merged.percentile(p) == all.percentile(p));
+    }
+}
+
+CASE( "A duration may be counted several times, as if added once for each" ) {
+
+    fdb5::LatencyHistogram weighted;
+    fdb5::LatencyHistogram single;
+
+    for (size_t i = 1; i <= 50; ++i) {
+        double seconds = i * 1e-4;
+        weighted.add(seconds, i);
+        for (size_t n = 0; n < i; ++n) {
+            single.add(seconds);
+        }
+    }
+
+    EXPECT(weighted.count() == 50 * 51 / 2);
+    EXPECT(weighted.count() == single.count());
+    EXPECT(weighted.max() == single.max());
+    for (double p : {0.0, 0.25, 0.5, 0.75, 0.99, 1.0}) {
+        EXPECT(weighted.percentile(p) == single.percentile(p));
+    }
+
+    // Nothing, if counted no times
+    fdb5::LatencyHistogram none;
+    none.add(1.0, 0);
+    EXPECT(none.count() == 0);
+    EXPECT(none.max() == 0);
+}
+
+CASE( "Durations that are not positive count as zero" ) {
+
+    fdb5::LatencyHistogram h;
+    h.add(-1);
+    h.add(0);
+    h.add(std::numeric_limits<double>::quiet_NaN());
+
+    EXPECT(h.count() == 3);
+    EXPECT(h.max() == 0);
+    EXPECT(h.percentile(1) == 0);
+
+    // And very long ones fall in the last buckets
+    h.add(1e20);
+    h.add(std::numeric_limits<double>::infinity());
+    EXPECT(h.count() == 5);
+    EXPECT(h.percentile(0.7) > 1e9);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,286 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "metkit/mars/MarsExpension.h"
+#include "metkit/mars/MarsParser.h"
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/message/MessageArchiver.h"
+
+#include "ApiSpy.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The keys and lengths of the messages archived, in order
+using Archived = std::vector<std::pair<fdb5::Key, size_t>>;
+
+/// The concatenation of the test files, in the order given
+std::string messages(const std::vector<std::string>& files) {
+    std::string out;
+    for (const std::string& file : files) {
+        eckit::PathName path(file);
+        std::unique_ptr<eckit::DataHandle> dh(path.fileHandle());
+        std::string buffer(size_t(path.size()), '\0');
+        dh->openForRead();
+        EXPECT(dh->read(&buffer[0], buffer.size()) == long(buffer.size()));
+        dh->close();
+        out += buffer;
+    }
+    return out;
+}
+
+/// Archives the messages through a spy FDB, decoding them on the given number of threads. Records what the
+/// spy received, and the error the archiver failed with, if any.
+Archived archive(const std::string& data, const fdb5::Key& expected, const std::string& include, size_t threads,
+                 std::string& error) {
+
+    fdb5::Config cfg;
+    cfg.set("type", "spy");
+
+    fdb5::MessageArchiver archiver(expected, false, false, cfg);
+    archiver.filters(include, "");
+    archiver.threads(threads);
+
+    ApiSpy& spy(*ApiSpy::knownSpies().back());
+
+    error.clear();
+    try {
+        eckit::MemoryHandle dh(data.data(), data.size());
+        archiver.archive(dh);
+    }
+    catch (eckit::Exception& e) {
+        error = e.what();
+    }
+
+    Archived archived;
+    for (const auto& a : spy.archives()) {
+        archived.emplace_back(std::get<0>(a), std::get<2>(a));
+    }
+    return archived;
+}
+
+/// The key of the (single) message of a test file
+fdb5::Key keyOf(const std::string& file) {
+    std::string error;
+    Archived archived = archive(messages({file}), fdb5::Key(), "", 1, error);
+    EXPECT(error.empty());
+    EXPECT(archived.size() == 1);
+    return archived.front().first;
+}
+
+/// Archives serially, then on several threads, and checks that the spy sees the same in each case
+void check(const std::string& data, const fdb5::Key& expected, const std::string& include, size_t count, bool fails) {
+
+    std::string serialError;
+    Archived serial = archive(data, expected, include, 1, serialError);
+
+    EXPECT(serial.size() == count);
+    EXPECT(serialError.empty() == !fails);
+
+    for (size_t threads : {2, 4, 8}) {
+        std::string parallelError;
+        Archived parallel = archive(data, expected, include, threads, parallelError);
+
+        EXPECT(parallel == serial);
+        EXPECT(parallelError == serialError);
+    }
+}
+
+std::vector<std::string> mixed(size_t n) {
+    std::vector<std::string> files;
+    for (size_t i = 0; i < n; ++i) {
+        files.push_back(i % 3 ? "x138-300.grib" : "x138-400.grib");
+    }
+    return files;
+}
+
+/// The filter requests, as the archiver made them before they were compiled: parsed, expanded and reduced to the
+/// keywords given
+std::vector<metkit::mars::MarsRequest> filterRequests(const std::string& str) {
+
+    std::vector<metkit::mars::MarsRequest> out;
+    if (str.empty()) {
+        return out;
+    }
+
+    std::istringstream in("retrieve," + str);
+    metkit::mars::MarsParser parser(in);
+    metkit::mars::MarsExpension expand(true);
+
+    std::set<std::string> keys = fdb5::Key(str).keys();
+    for (const metkit::mars::MarsRequest& r : expand.expand(parser.parse())) {
+        out.push_back(r.subset(keys));
+    }
+    return out;
+}
+
+/// Whether the filters leave the key out, as the archiver decided before they were compiled, with
+/// MarsRequest::matches on a request made of the key
+bool filterOutByRequest(const fdb5::Key& key, const std::string& include, const std::string& exclude) {
+
+    metkit::mars::MarsRequest field;
+    for (const auto& kv : key) {
+        field.values(kv.first, std::vector<std::string>{kv.second});
+    }
+
+    auto matchAny = [&field](const std::vector<metkit::mars::MarsRequest>& filters) {
+        for (const metkit::mars::MarsRequest& r : filters) {
+            if (field.matches(r)) return true;
+        }
+        return false;
+    };
+
+    std::vector<metkit::mars::MarsRequest> includes = filterRequests(include);
+    std::vector<metkit::mars::MarsRequest> excludes = filterRequests(exclude);
+
+    if (!includes.empty() && !matchAny(includes)) return true;
+    if (!excludes.empty() && matchAny(excludes)) return true;
+    return false;
+}
+
+/// Every combination of some values of levelist, param, levtype and number, each of which may also be missing
+std::vector<fdb5::Key> filterKeys() {
+
+    std::vector<fdb5::Key> keys;
+
+    for (const char* levelist : {"", "300", "400", "500"}) {
+        for (const char* param : {"", "130", "138", "155"}) {
+            for (const char* levtype : {"", "pl", "sfc"}) {
+                for (const char* number : {"", "1", "3"}) {
+                    fdb5::Key key;
+                    key.set("class", "od");
+                    key.set("expver", "0001");
+                    key.set("stream", "oper");
+                    if (*levelist) key.set("levelist", levelist);
+                    if (*param) key.set("param", param);
+                    if (*levtype) key.set("levtype", levtype);
+                    if (*number) key.set("number", number);
+                    keys.push_back(key);
+                }
+            }
+        }
+    }
+
+    return keys;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "The compiled filters leave out the same fields as matching the filter requests did" ) {
+
+    const std::vector<std::string> filters{
+        "",
+        "levelist=400",
+        "levelist=300/400",
+        "param=t/138",
+        "param=138,levtype=pl",
+        "levelist=300/500,param=130/155,levtype=pl/sfc",
+        "number=1",
+        "number=1/3,levelist=400",
+        "class=od,expver=0001",
+        "class=rd",
+    };
+
+    fdb5::Config cfg;
+    cfg.set("type", "spy");
+
+    std::vector<fdb5::Key> keys = filterKeys();
+
+    size_t kept = 0;
+    size_t left = 0;
+
+    for (const std::string& include : filters) {
+        for (const std::string& exclude : filters) {
+
+            fdb5::MessageArchiver archiver(fdb5::Key(), false, false, cfg);
+            archiver.filters(include, exclude);
+
+            for (const fdb5::Key& key : keys) {
+                bool out = archiver.filterOut(key);
+                EXPECT(out == filterOutByRequest(key, include, exclude));
+                ++(out ? left : kept);
+            }
+        }
+    }
+
+    // Both ways, often
+    EXPECT(kept > keys.size());
+    EXPECT(left > keys.size());
+}
+
+CASE( "Parallel archiving commits the same messages, in the same order, as serial archiving" ) {
+
+    std::vector<std::string> files = mixed(20);
+    files.push_back("y138-400.grib");
+    files.push_back("x138-300.grib");
+
+    check(messages(files), fdb5::Key(), "", files.size(), false);
+}
+
+CASE( "Filtered messages are skipped alike" ) {
+
+    EXPECT(keyOf("x138-400.grib").get("levelist") == "400");
+
+    // Every third message of 20 is at level 400
+    check(messages(mixed(20)), fdb5::Key(), "levelist=400", 7, false);
+
+    // With several values, and with a keyword the messages do not have
+    check(messages(mixed(20)), fdb5::Key(), "levelist=300/400", 20, false);
+    check(messages(mixed(20)), fdb5::Key(), "number=1", 0, false);
+}
+
+CASE( "A message that fails to decode stops both at the same point, with the same error" ) {
+
+    // Messages that do not match the key the archiver is given fail to decode
+
+    fdb5::Key expected;
+    expected.set("levelist", keyOf("x138-300.grib").get("levelist"));
+    EXPECT(!keyOf("x138-400.grib").match(expected));
+
+    std::vector<std::string> files(10, "x138-300.grib");
+    files.push_back("x138-400.grib");
+    files.insert(files.end(), 20, "x138-300.grib");
+
+    check(messages(files), expected, "", 10, true);
+
+    // And at the very first message
+
+    check(messages({"x138-400.grib", "x138-300.grib", "x138-300.grib"}), expected, "", 0, true);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
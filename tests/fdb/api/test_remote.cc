@@ -0,0 +1,179 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <atomic>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/net/Endpoint.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/RemoteFDB.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/rules/Schema.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const char* rules =
+    "[ class, expver, stream, date, time, domain\n"
+    "    [ type, levtype\n"
+    "        [ step, levelist?, param ]]\n"
+    "]\n";
+
+fdb5::Key field(const std::string& expver, const std::string& date, const std::string& param) {
+    fdb5::Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", date);
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", "an");
+    key.set("levtype", "pl");
+    key.set("step", "0");
+    key.set("levelist", "500");
+    key.set("param", param);
+    return key;
+}
+
+std::string flushError(const std::vector<std::function<void()>>& flushes) {
+    try {
+        fdb5::RemoteFDB::flushLanes(flushes, eckit::net::Endpoint("localhost", 7654));
+    }
+    catch (eckit::Exception& e) {
+        return e.what();
+    }
+    return "";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "The number of archive connections must be positive" ) {
+
+    for (int connections : {0, -1}) {
+        fdb5::Config config;
+        config.set("host", "localhost");
+        config.set("port", 7654);
+        config.set("archiveConnections", connections);
+        EXPECT_THROWS_AS(fdb5::RemoteFDB(config, "remote"), eckit::UserError);
+    }
+
+    // n.b. nothing is connected until it is used
+    fdb5::Config config;
+    config.set("host", "localhost");
+    config.set("port", 7654);
+    config.set("archiveConnections", 3);
+    fdb5::RemoteFDB fdb(config, "remote");
+}
+
+CASE( "Fields are striped over the archive connections by DB" ) {
+
+    std::istringstream s(rules);
+    fdb5::Schema schema(s);
+
+    const size_t connections = 4;
+    std::set<size_t> used;
+
+    for (size_t d = 0; d < 64; ++d) {
+
+        std::string date = std::to_string(20200101 + d);
+        size_t lane = fdb5::RemoteFDB::archiveLane(schema, field("xxxx", date, "138"), connections);
+        EXPECT(lane < connections);
+        used.insert(lane);
+
+        // Every field of a DB goes the same way, whatever its index and datum
+        for (const std::string& param : {"130", "131", "155"}) {
+            fdb5::Key key = field("xxxx", date, param);
+            EXPECT(fdb5::RemoteFDB::archiveLane(schema, key, connections) == lane);
+            key.set("type", "fc");
+            key.set("step", "6");
+            EXPECT(fdb5::RemoteFDB::archiveLane(schema, key, connections) == lane);
+        }
+    }
+
+    // And the DBs are spread over all of the connections
+    EXPECT(used.size() == connections);
+
+    // With one connection, everything goes down it
+    EXPECT(fdb5::RemoteFDB::archiveLane(schema, field("xxxx", "20200101", "138"), 1) == 0);
+}
+
+CASE( "Fields that do not match the schema go down the main connection" ) {
+
+    std::istringstream s(rules);
+    fdb5::Schema schema(s);
+
+    for (size_t d = 0; d < 16; ++d) {
+        fdb5::Key key = field("xxxx", std::to_string(20200101 + d), "138");
+        key.unset("domain");
+        EXPECT(fdb5::RemoteFDB::archiveLane(schema, key, 4) == 0);
+    }
+}
+
+CASE( "Every archive connection is flushed, even if others fail" ) {
+
+    std::atomic<size_t> flushed(0);
+    auto ok = [&flushed] { ++flushed; };
+    auto fails = [&flushed](const std::string& what) {
+        return [&flushed, what] {
+            ++flushed;
+            throw eckit::SeriousBug(what, Here());
+        };
+    };
+
+    EXPECT(flushError({ok, ok, ok}) == "");
+    EXPECT(flushed == 3);
+
+    // A single failure is rethrown as it is, from the main connection or a lane
+
+    flushed = 0;
+    EXPECT_THROWS_AS(fdb5::RemoteFDB::flushLanes({fails("main"), ok, ok}, eckit::net::Endpoint("localhost", 7654)),
+                     eckit::SeriousBug);
+    EXPECT(flushed == 3);
+
+    flushed = 0;
+    EXPECT_THROWS_AS(fdb5::RemoteFDB::flushLanes({ok, ok, fails("lane")}, eckit::net::Endpoint("localhost", 7654)),
+                     eckit::SeriousBug);
+    EXPECT(flushed == 3);
+
+    // Several are reported together, each with its connection
+
+    flushed = 0;
+    std::string error = flushError({fails("main failed"), ok, fails("second failed"), fails("third failed")});
+    EXPECT(flushed == 4);
+    EXPECT(error.find("Flush failed on 3 of 4 archive connections") != std::string::npos);
+    EXPECT(error.find("main failed") != std::string::npos);
+    EXPECT(error.find("archive connection 2: ") != std::string::npos);
+    EXPECT(error.find("second failed") != std::string::npos);
+    EXPECT(error.find("archive connection 3: ") != std::string::npos);
+    EXPECT(error.find("third failed") != std::string::npos);
+    EXPECT(error.find("archive connection 1: ") == std::string::npos);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
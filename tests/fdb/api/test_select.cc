@@ -14,8 +14,14 @@
  */
 
 #include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "eckit/exception/Exceptions.h"
 #include "eckit/testing/Test.h"
+#include "eckit/utils/Regex.h"
 
 #include "metkit/mars/TypeAny.h"
 
@@ -690,6 +696,121 @@ CASE( "control_distributed_according_to_select" ) {
     }
 }
 
+/// Overlapping selects, on different keywords
+const std::vector<std::vector<std::pair<std::string, std::string>>> routingSelects{
+    {{"class", "od"}, {"stream", "o.*"}},
+    {{"class", "rd"}, {"expver", "xx.?.?"}},
+    {{"class", "rd"}},
+    {{"stream", "enfo"}},
+};
+
+/// The first FDB whose selects all match, as found by scanning them. A keyword that is selected on but missing
+/// from the key does not match. Returns the number of FDBs if there is none.
+size_t scan(const fdb5::Key& key) {
+    for (size_t i = 0; i < routingSelects.size(); ++i) {
+        bool match = true;
+        for (const auto& kv : routingSelects[i]) {
+            auto it = key.find(kv.first);
+            if (it == key.end() || !eckit::Regex(kv.second).match(it->second)) {
+                match = false;
+                break;
+            }
+        }
+        if (match) {
+            return i;
+        }
+    }
+    return routingSelects.size();
+}
+
+/// Every combination of the values given, leaving out a keyword where its value is empty
+std::vector<fdb5::Key> routingKeys() {
+
+    std::map<std::string, std::vector<std::string>> values{
+        {"class", {"od", "rd", "ea", ""}},
+        {"expver", {"xxxx", "xx01", "yyyy", ""}},
+        {"stream", {"oper", "enfo", "elda", ""}},
+        {"param", {"130", "138"}},  // not selected on
+    };
+
+    std::vector<fdb5::Key> keys(1);
+    for (const auto& kv : values) {
+        std::vector<fdb5::Key> more;
+        for (const fdb5::Key& key : keys) {
+            for (const std::string& value : kv.second) {
+                fdb5::Key k(key);
+                if (!value.empty()) {
+                    k.set(kv.first, value);
+                }
+                more.push_back(k);
+            }
+        }
+        keys.swap(more);
+    }
+    return keys;
+}
+
+CASE( "Cached routing sends each key where a scan of the selects does" ) {
+
+    std::vector<LocalConfiguration> fdbs;
+    for (const auto& selects : routingSelects) {
+        std::string select;
+        for (const auto& kv : selects) {
+            select += (select.empty() ? "" : ",") + kv.first + "=" + kv.second;
+        }
+        LocalConfiguration c;
+        c.set("type", "spy");
+        c.set("select", select);
+        fdbs.push_back(c);
+    }
+
+    fdb5::Config cfg;
+    cfg.set("type", "select");
+    cfg.set("fdbs", fdbs);
+
+    fdb5::FDB fdb(cfg);
+    EXPECT(ApiSpy::knownSpies().size() == routingSelects.size());
+
+    std::vector<fdb5::Key> keys = routingKeys();
+    std::vector<size_t> targets(routingSelects.size() + 1, 0);
+
+    // Twice over, so that the second pass is routed from the cache (unless it is smaller than the number of
+    // keys, see fdbSelectRoutingCacheSize, in which case it is cleared on the way), and with new keys of the same
+    // values each time
+
+    for (size_t pass = 0; pass < 2; ++pass) {
+        for (const fdb5::Key& original : keys) {
+
+            fdb5::Key key(original);
+            size_t expected = scan(key);
+            ++targets[expected];
+
+            if (expected == routingSelects.size()) {
+                EXPECT_THROWS_AS(fdb.archive(key, (const void*)0x1234, 1234), eckit::UserError);
+                continue;
+            }
+
+            std::vector<size_t> before;
+            for (ApiSpy* spy : ApiSpy::knownSpies()) {
+                before.push_back(spy->counts().archive);
+            }
+
+            fdb.archive(key, (const void*)0x1234, 1234);
+
+            for (size_t i = 0; i < routingSelects.size(); ++i) {
+                ApiSpy& spy(*ApiSpy::knownSpies()[i]);
+                EXPECT(spy.counts().archive == before[i] + (i == expected ? 1 : 0));
+            }
+            EXPECT(std::get<0>(ApiSpy::knownSpies()[expected]->archives().back()) == key);
+        }
+    }
+
+    // Every FDB, and no FDB at all, is a target of some of the keys
+    for (size_t count : targets) {
+        EXPECT(count > 0);
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 }  // namespace test
@@ -0,0 +1,145 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <memory>
+#include <string>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Archiver.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/AdoptVisitor.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+fdb5::Config pipelinedConfig() {
+    eckit::LocalConfiguration user;
+    user.set("archivePipeline", true);
+    return fdb5::Config(fdb5::Config().expandConfig(), user);
+}
+
+fdb5::Key fieldKey(const std::string& type, const std::string& levelist) {
+    fdb5::Key key;
+    key.set("class", "rd");
+    key.set("expver", "pip1");
+    key.set("stream", "oper");
+    key.set("date", "20201102");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", type);
+    key.set("levtype", "pl");
+    key.set("step", "0");
+    key.set("levelist", levelist);
+    key.set("param", "138");
+    return key;
+}
+
+std::string retrieve(fdb5::FDB& fdb, const std::string& type, const std::string& levelist) {
+
+    std::string request = "class=rd,expver=pip1,stream=oper,date=20201102,time=0000,domain=g,levtype=pl,step=0,param=138"
+                          ",type=" + type + ",levelist=" + levelist;
+
+    std::unique_ptr<eckit::DataHandle> dh(fdb.retrieve(fdb5::FDBToolRequest::requestsFromString(request)[0].request()));
+
+    std::string out;
+    char buf[1024];
+    long len;
+    dh->openForRead();
+    while ((len = dh->read(buf, sizeof(buf))) > 0) {
+        out.append(buf, len);
+    }
+    dh->close();
+    return out;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Pipelined archive, with a generic visitor in the middle" ) {
+
+    const std::string a = "field a, type=an, levelist=300";
+    const std::string b = "field b, type=fc, levelist=300 (adopted)";
+    const std::string c = "field c, type=an, levelist=400";
+    const std::string d = "field d, type=fc, levelist=400";
+
+    // The adopted data lives in a file of its own
+
+    eckit::PathName adopted = eckit::PathName("test_archiver_adopted.data").realName();
+    {
+        eckit::FileHandle fh(adopted);
+        fh.openForWrite(0);
+        fh.write(b.data(), b.size());
+        fh.close();
+    }
+
+    {
+        fdb5::Archiver archiver(pipelinedConfig());
+
+        // a selects the type=an index on the worker of the DB. The adoption then selects the type=fc index on the
+        // same DB, behind the worker's back. c must still go in the type=an index.
+
+        archiver.archive(fieldKey("an", "300"), a.data(), a.size());
+
+        fdb5::AdoptVisitor visitor(archiver, fieldKey("fc", "300"), adopted, 0, b.size());
+        archiver.archive(fieldKey("fc", "300"), visitor);
+
+        archiver.archive(fieldKey("an", "400"), c.data(), c.size());
+        archiver.archive(fieldKey("fc", "400"), d.data(), d.size());
+
+        archiver.flush();
+    }
+
+    fdb5::FDB fdb;
+
+    EXPECT(retrieve(fdb, "an", "300") == a);
+    EXPECT(retrieve(fdb, "fc", "300") == b);
+    EXPECT(retrieve(fdb, "an", "400") == c);
+    EXPECT(retrieve(fdb, "fc", "400") == d);
+}
+
+CASE( "Pipelined archive through the FDB" ) {
+
+    const std::string e = "field e, type=an, levelist=500";
+    const std::string f = "field f, type=fc, levelist=500";
+
+    {
+        fdb5::FDB fdb(pipelinedConfig());
+        fdb.archive(fieldKey("an", "500"), e.data(), e.size());
+        fdb.archive(fieldKey("fc", "500"), f.data(), f.size());
+        fdb.flush();
+    }
+
+    fdb5::FDB fdb;
+
+    EXPECT(retrieve(fdb, "an", "500") == e);
+    EXPECT(retrieve(fdb, "fc", "500") == f);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
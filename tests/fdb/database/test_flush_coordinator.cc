@@ -0,0 +1,211 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/database/FlushCoordinator.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void pause(size_t micros) {
+    std::this_thread::sleep_for(std::chrono::microseconds(micros));
+}
+
+/// Tracks how many tasks run at once, and on how many threads over all (n.b. threads started one after the other
+/// may be counted separately)
+class Concurrency {
+public:
+
+    Concurrency() : active_(0), max_(0) {}
+
+    void enter() {
+        size_t n = ++active_;
+        size_t m = max_.load();
+        while (n > m && !max_.compare_exchange_weak(m, n)) {}
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.insert(std::this_thread::get_id());
+    }
+
+    void leave() { --active_; }
+
+    size_t max() const { return max_; }
+    size_t threads() const { return threads_.size(); }
+
+private:
+
+    std::atomic<size_t> active_;
+    std::atomic<size_t> max_;
+    std::mutex mutex_;
+    std::set<std::thread::id> threads_;
+};
+
+/// The error the function fails with, if any
+std::string error(const std::function<void()>& fn) {
+    try {
+        fn();
+    } catch (eckit::Exception& e) {
+        return e.what();
+    }
+    return "";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Every task is run, even if some fail, and the first error is rethrown once they are all done" ) {
+
+    std::atomic<size_t> done(0);
+
+    std::string e = error([&done] {
+        fdb5::FlushCoordinator::run(100, [&done](size_t i) {
+            pause(100);
+            ++done;
+            if (i == 10 || i == 50 || i == 99) {
+                throw eckit::SeriousBug("Task " + std::to_string(i) + " failed", Here());
+            }
+        });
+    });
+
+    EXPECT(done == 100);
+    EXPECT(e.find("Task 10 failed") != std::string::npos);
+
+    // And with nothing to do, nothing is done
+
+    fdb5::FlushCoordinator::run(0, [](size_t) { throw eckit::SeriousBug("Nothing to do", Here()); });
+}
+
+CASE( "The catalogue of a DB whose store failed to flush is not flushed, and the others are after all the stores" ) {
+
+    const size_t n = 8;
+
+    std::atomic<size_t> stores(0);
+    std::vector<int> catalogues(n, 0);
+    std::atomic<size_t> early(0);
+
+    auto flushStore = [&stores](size_t i) {
+        pause(1000);
+        ++stores;
+        if (i == 2 || i == 5) {
+            throw eckit::WriteError("store " + std::to_string(i), Here());
+        }
+    };
+    auto flushCatalogue = [&](size_t i) {
+        if (stores != n) ++early;
+        ++catalogues[i];
+    };
+
+    std::string e = error([&] { fdb5::FlushCoordinator::flush(n, flushStore, flushCatalogue); });
+
+    EXPECT(stores == n);
+    EXPECT(early == 0);
+    EXPECT(catalogues == std::vector<int>({1, 1, 0, 1, 1, 0, 1, 1}));
+    EXPECT(e.find("store 2") != std::string::npos);
+
+    // A store's error comes before that of a catalogue, and all the catalogues are flushed anyway
+
+    std::vector<int> flushed(n, 0);
+    e = error([&] {
+        fdb5::FlushCoordinator::flush(
+            n,
+            [](size_t i) {
+                if (i == 6) throw eckit::WriteError("store 6", Here());
+            },
+            [&flushed](size_t i) {
+                ++flushed[i];
+                if (i == 1 || i == 3) throw eckit::SeriousBug("catalogue " + std::to_string(i), Here());
+            });
+    });
+
+    EXPECT(e.find("store 6") != std::string::npos);
+    EXPECT(flushed == std::vector<int>({1, 1, 1, 1, 1, 1, 0, 1}));
+
+    // Or the first catalogue's error, if all the stores were flushed
+
+    e = error([&] {
+        fdb5::FlushCoordinator::flush(
+            n, [](size_t) {},
+            [](size_t i) {
+                if (i == 3 || i == 7) throw eckit::SeriousBug("catalogue " + std::to_string(i), Here());
+            });
+    });
+
+    EXPECT(e.find("catalogue 3") != std::string::npos);
+}
+
+CASE( "Nested runs share the flush threads" ) {
+
+    size_t threads = fdb5::FlushCoordinator::threads();
+    EXPECT(threads >= 1);
+
+    // Each store flushing several data files, as TocStore does
+
+    Concurrency concurrency;
+    std::atomic<size_t> files(0);
+
+    fdb5::FlushCoordinator::flush(
+        16,
+        [&](size_t) {
+            fdb5::FlushCoordinator::run(16, [&](size_t) {
+                concurrency.enter();
+                pause(500);
+                ++files;
+                concurrency.leave();
+            });
+        },
+        [](size_t) {});
+
+    EXPECT(files == 16 * 16);
+    EXPECT(concurrency.max() <= threads);
+
+    // A single store gets them all, as none are left in use
+
+    Concurrency single;
+    fdb5::FlushCoordinator::flush(
+        1,
+        [&](size_t) {
+            fdb5::FlushCoordinator::run(32, [&](size_t) {
+                single.enter();
+                pause(2000);
+                single.leave();
+            });
+        },
+        [](size_t) {});
+
+    EXPECT(single.max() <= threads);
+    if (threads > 1) {
+        EXPECT(single.threads() > 1);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
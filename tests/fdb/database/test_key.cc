@@ -0,0 +1,212 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+#include "eckit/types/Types.h"
+
+#include "fdb5/database/Key.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// What a Key used to be: a StringDict, and the keywords in the order they were added
+struct Reference {
+    eckit::StringDict dict_;
+    eckit::StringList names_;
+
+    void set(const std::string& k, const std::string& v) {
+        if (dict_.find(k) == dict_.end()) {
+            names_.push_back(k);
+        }
+        dict_[k] = v;
+    }
+    void push(const std::string& k, const std::string& v) {
+        dict_[k] = v;
+        names_.push_back(k);
+    }
+    void pop(const std::string& k) {
+        dict_.erase(k);
+        names_.pop_back();
+    }
+    void unset(const std::string& k) {
+        dict_.erase(k);
+    }
+};
+
+/// The same entries, added in keyword order
+fdb5::Key rebuild(const Reference& ref) {
+    fdb5::Key key;
+    for (const auto& kv : ref.dict_) {
+        key.push(kv.first, kv.second);
+    }
+    return key;
+}
+
+void check(const fdb5::Key& key, const Reference& ref) {
+    EXPECT(key.keyDict() == ref.dict_);
+    EXPECT(key.names() == ref.names_);
+    EXPECT(key.size() == ref.dict_.size());
+    EXPECT(key.empty() == ref.dict_.empty());
+
+    // The hash maintained as the key is modified is that of the same entries, however they were added
+    fdb5::Key fresh = rebuild(ref);
+    EXPECT(key == fresh);
+    EXPECT(!(key != fresh));
+    EXPECT(key.hash() == fresh.hash());
+    EXPECT(std::hash<fdb5::Key>()(key) == key.hash());
+
+    for (const auto& kv : ref.dict_) {
+        EXPECT(key.get(kv.first) == kv.second);
+        EXPECT(key.find(kv.first) != key.end());
+    }
+    EXPECT(key.find("absent") == key.end());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "set, push, pop and unset behave as on a StringDict and list of names" ) {
+
+    fdb5::Key key;
+    Reference ref;
+    check(key, ref);
+
+    key.set("b", "1");      ref.set("b", "1");      check(key, ref);
+    key.set("a", "2");      ref.set("a", "2");      check(key, ref);
+    key.set("b", "3");      ref.set("b", "3");      check(key, ref);  // no new name
+    key.push("c", "");      ref.push("c", "");      check(key, ref);
+    key.push("a", "4");     ref.push("a", "4");     check(key, ref);  // name added again
+    key.pop("a");           ref.pop("a");           check(key, ref);
+    key.unset("b");         ref.unset("b");         check(key, ref);  // name kept
+    key.unset("absent");    ref.unset("absent");    check(key, ref);
+
+    EXPECT_THROWS(key.get("b"));
+
+    key.clear();
+    check(key, Reference());
+    EXPECT(key.hash() == fdb5::Key().hash());
+}
+
+CASE( "Random sequences of modifications keep the entries and hash consistent" ) {
+
+    std::vector<std::string> keywords{"class", "expver", "date", "a", "z", "levelist"};
+    std::vector<std::string> values{"", "0", "1", "10", "2", "od", "0001", "20201102"};
+
+    std::mt19937 rng(42);
+    auto pick = [&rng](const std::vector<std::string>& from) { return from[rng() % from.size()]; };
+
+    for (size_t run = 0; run < 50; ++run) {
+        fdb5::Key key;
+        Reference ref;
+        for (size_t step = 0; step < 40; ++step) {
+            std::string k = pick(keywords);
+            std::string v = pick(values);
+            switch (rng() % 4) {
+            case 0:
+                key.set(k, v);
+                ref.set(k, v);
+                break;
+            case 1:
+                if (ref.dict_.find(k) == ref.dict_.end()) {
+                    key.push(k, v);
+                    ref.push(k, v);
+                }
+                break;
+            case 2:
+                if (!ref.names_.empty() && ref.dict_.find(ref.names_.back()) != ref.dict_.end()) {
+                    std::string last = ref.names_.back();
+                    key.pop(last);
+                    ref.pop(last);
+                }
+                break;
+            default:
+                key.unset(k);
+                ref.unset(k);
+                break;
+            }
+            check(key, ref);
+        }
+    }
+}
+
+CASE( "Keys compare as their StringDicts do" ) {
+
+    std::vector<eckit::StringDict> dicts{
+        {},
+        {{"a", "1"}},
+        {{"a", "10"}},
+        {{"a", "2"}},
+        {{"a", ""}},
+        {{"b", "1"}},
+        {{"a", "1"}, {"b", "1"}},
+        {{"a", "1"}, {"b", "2"}},
+        {{"a", "1"}, {"c", "1"}},
+        {{"a", "2"}, {"b", "1"}},
+        {{"class", "od"}, {"date", "20201102"}, {"expver", "0001"}},
+        {{"class", "od"}, {"date", "20201102"}, {"expver", "0002"}},
+        {{"class", "rd"}, {"date", "20201101"}, {"expver", "0001"}},
+    };
+
+    for (const eckit::StringDict& a : dicts) {
+        for (const eckit::StringDict& b : dicts) {
+            fdb5::Key ka(a);
+            fdb5::Key kb(b);
+            EXPECT((ka < kb) == (a < b));
+            EXPECT((ka == kb) == (a == b));
+            EXPECT((ka != kb) == (a != b));
+            if (a == b) {
+                EXPECT(ka.hash() == kb.hash());
+            }
+        }
+    }
+
+    // Insertion order does not matter to comparison or hashing
+    fdb5::Key forward;
+    forward.push("a", "1");
+    forward.push("b", "2");
+    fdb5::Key backward;
+    backward.push("b", "2");
+    backward.push("a", "1");
+    EXPECT(forward == backward);
+    EXPECT(!(forward < backward) && !(backward < forward));
+    EXPECT(forward.hash() == backward.hash());
+    EXPECT(forward.names() != backward.names());
+}
+
+CASE( "Interned strings are shared and counted" ) {
+
+    size_t count = fdb5::Key::internedCount();
+    size_t bytes = fdb5::Key::internedBytes();
+
+    const std::string& s = fdb5::Key::intern("test_key: a string not interned before");
+    EXPECT(&fdb5::Key::intern(std::string("test_key: a string not interned before")) == &s);
+
+    EXPECT(fdb5::Key::internedCount() == count + 1);
+    EXPECT(fdb5::Key::internedBytes() == bytes + s.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
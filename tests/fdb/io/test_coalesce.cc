@@ -0,0 +1,252 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Also run with FDB_READ_COALESCE_GAP and FDB_READ_COALESCE_MAX_EXTENT set, so that the HandleGatherer
+/// reads through holes
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/serialisation/FileStream.h"
+#include "eckit/serialisation/Reanimator.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/database/Key.h"
+#include "fdb5/io/CoalescedFileHandle.h"
+#include "fdb5/io/HandleGatherer.h"
+#include "fdb5/toc/TocFieldLocation.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef fdb5::CoalescedFileHandle::Ranges Ranges;
+
+char patternByte(size_t seed, size_t pos) {
+    return char((seed * 131 + pos * 7 + pos / 251) & 0xff);
+}
+
+eckit::PathName writeFile(size_t seed, size_t size) {
+    eckit::PathName path = eckit::PathName::unique(eckit::PathName("coalesce.data"));
+    std::vector<char> data(size);
+    for (size_t pos = 0; pos < size; ++pos) {
+        data[pos] = patternByte(seed, pos);
+    }
+    std::unique_ptr<eckit::DataHandle> out(path.fileHandle());
+    out->openForWrite(size);
+    out->write(data.data(), data.size());
+    out->close();
+    return path;
+}
+
+std::vector<char> expected(size_t seed, const Ranges& ranges) {
+    std::vector<char> out;
+    for (const auto& range : ranges) {
+        for (size_t pos = 0; pos < size_t(range.second); ++pos) {
+            out.push_back(patternByte(seed, size_t(range.first) + pos));
+        }
+    }
+    return out;
+}
+
+/// The rest of the data of an open handle
+std::vector<char> readRest(eckit::DataHandle& h, size_t piece) {
+    std::vector<char> out;
+    std::vector<char> buf(piece);
+    long len;
+    while ((len = h.read(buf.data(), buf.size())) > 0) {
+        out.insert(out.end(), buf.begin(), buf.begin() + len);
+    }
+    return out;
+}
+
+std::vector<char> readAll(eckit::DataHandle& h, size_t piece) {
+    h.openForRead();
+    std::vector<char> out = readRest(h, piece);
+    h.close();
+    return out;
+}
+
+std::string describe(const eckit::DataHandle& h) {
+    std::ostringstream oss;
+    oss << h;
+    return oss.str();
+}
+
+/// Checks the data returned, and the number of reads that the handle makes to return them
+void check(const eckit::PathName& path, const Ranges& ranges, size_t gap, size_t maxExtent, size_t reads) {
+
+    fdb5::CoalescedFileHandle h(path, ranges, gap, maxExtent);
+
+    std::ostringstream oss;
+    oss << "," << reads << (reads == 1 ? " read]" : " reads]");
+    EXPECT(describe(h).find(oss.str()) != std::string::npos);
+
+    std::vector<char> want = expected(0, ranges);
+    EXPECT(h.estimate() == eckit::Length(want.size()));
+    for (size_t piece : {1, 7, 4096}) {
+        EXPECT(readAll(h, piece) == want);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Ranges separated by small holes are read at once" ) {
+
+    eckit::PathName path = writeFile(0, 10000);
+
+    // Two adjacent ranges, then holes of 50, 790 and 50 bytes. The duplicated range is returned twice.
+    Ranges ranges{{0, 100}, {100, 50}, {200, 10}, {1000, 100}, {1150, 20}, {1150, 20}};
+
+    check(path, ranges, 0, 1000, 5);     // no holes read through, but adjacent ranges joined
+    check(path, ranges, 64, 1000, 3);    // [0, 210), [1000, 1170) and the duplicate
+    check(path, ranges, 1000, 10000, 2); // [0, 1170) and the duplicate
+
+    path.unlink();
+}
+
+CASE( "A read through holes never exceeds the maximum extent" ) {
+
+    eckit::PathName path = writeFile(0, 10000);
+
+    Ranges ranges{{0, 100}, {100, 50}, {200, 10}, {1000, 100}, {1150, 20}};
+
+    check(path, ranges, 64, 160, 4);    // [0, 150) alone, as [0, 210) would be too large
+    check(path, ranges, 64, 210, 2);    // exactly at the limit
+    check(path, ranges, 1000, 1169, 2); // [0, 1170) is one byte too large
+
+    // Adjacent ranges beyond the maximum extent are still read directly, as one
+    check(path, {{0, 5000}, {5000, 5000}}, 64, 100, 1);
+
+    path.unlink();
+}
+
+CASE( "Sorted gathering returns each file's ranges in offset order, files in first seen order" ) {
+
+    eckit::PathName path1 = writeFile(1, 10000);
+    eckit::PathName path2 = writeFile(2, 10000);
+
+    Ranges ranges1{{5000, 100}, {200, 10}, {0, 100}, {100, 50}, {1150, 20}};
+    Ranges ranges2{{300, 300}, {0, 300}, {9000, 1000}};
+
+    fdb5::HandleGatherer gatherer(true);
+    for (size_t i = 0; i < std::max(ranges1.size(), ranges2.size()); ++i) {
+        if (i < ranges2.size()) {
+            gatherer.add(fdb5::TocFieldLocation(path2, ranges2[i].first, ranges2[i].second, fdb5::Key()));
+        }
+        if (i < ranges1.size()) {
+            gatherer.add(fdb5::TocFieldLocation(path1, ranges1[i].first, ranges1[i].second, fdb5::Key()));
+        }
+    }
+    EXPECT(gatherer.count() == ranges1.size() + ranges2.size());
+
+    std::vector<char> want = expected(2, {{0, 300}, {300, 300}, {9000, 1000}});
+    std::vector<char> want1 = expected(1, {{0, 100}, {100, 50}, {200, 10}, {1150, 20}, {5000, 100}});
+    want.insert(want.end(), want1.begin(), want1.end());
+
+    std::unique_ptr<eckit::DataHandle> h(gatherer.dataHandle());
+    EXPECT(readAll(*h, 333) == want);
+
+    path1.unlink();
+    path2.unlink();
+}
+
+CASE( "Seeking and rewinding return the data from the requested position" ) {
+
+    eckit::PathName path = writeFile(0, 10000);
+
+    // Holes read through, holes skipped, and a duplicated range
+    Ranges ranges{{0, 100}, {100, 50}, {200, 10}, {1000, 100}, {1150, 20}, {1150, 20}, {5000, 3000}};
+    std::vector<char> want = expected(0, ranges);
+
+    fdb5::CoalescedFileHandle h(path, ranges, 64, 1000);
+    EXPECT(h.canSeek());
+
+    h.openForRead();
+    EXPECT(h.position() == eckit::Offset(0));
+
+    std::vector<char> buf(200);
+    EXPECT(h.read(buf.data(), buf.size()) == long(buf.size()));
+    EXPECT(h.position() == eckit::Offset(200));
+
+    // To every position, backwards and forwards, including the boundaries of the pieces
+    for (size_t offset : {want.size() - 1, size_t(0), size_t(150), size_t(149), size_t(160), size_t(260),
+                          size_t(280), size_t(300), size_t(59), size_t(3000)}) {
+        EXPECT(h.seek(offset) == eckit::Offset(offset));
+        EXPECT(h.position() == eckit::Offset(offset));
+        std::vector<char> rest = readRest(h, 7);
+        EXPECT(rest == std::vector<char>(want.begin() + offset, want.end()));
+        EXPECT(h.position() == eckit::Offset(want.size()));
+    }
+
+    // Past the end
+    EXPECT(h.seek(want.size() + 100) == eckit::Offset(want.size()));
+    EXPECT(h.read(buf.data(), buf.size()) == 0);
+
+    h.rewind();
+    EXPECT(h.position() == eckit::Offset(0));
+    EXPECT(readRest(h, 4096) == want);
+    h.close();
+
+    path.unlink();
+}
+
+CASE( "The handle can be sent over a stream" ) {
+
+    eckit::PathName path = writeFile(0, 10000);
+
+    Ranges ranges{{0, 100}, {100, 50}, {200, 10}, {1000, 100}, {1150, 20}, {5000, 3000}};
+    std::vector<char> want = expected(0, ranges);
+
+    eckit::PathName stream = eckit::PathName::unique(eckit::PathName("coalesce.stream"));
+    std::string before;
+    {
+        fdb5::CoalescedFileHandle h(path, ranges, 64, 1000);
+        before = describe(h);
+        eckit::FileStream s(stream, "w");
+        s << h;
+        s.close();
+    }
+
+    std::unique_ptr<eckit::DataHandle> h;
+    {
+        eckit::FileStream s(stream, "r");
+        h.reset(eckit::Reanimator<eckit::DataHandle>::reanimate(s));
+        s.close();
+    }
+
+    // With the same reads, and the same data
+    EXPECT(h);
+    EXPECT(describe(*h) == before);
+    EXPECT(h->estimate() == eckit::Length(want.size()));
+    EXPECT(readAll(*h, 333) == want);
+
+    stream.unlink();
+    path.unlink();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,252 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/serialisation/FileStream.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/io/ReadAheadHandle.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+char patternByte(size_t seed, size_t pos) {
+    return char((seed * 131 + pos * 7 + pos / 251) & 0xff);
+}
+
+/// Returns `size` bytes of a pattern, without holding them in memory, and counts the bytes it has returned
+class PatternHandle : public eckit::DataHandle {
+public:
+    PatternHandle(size_t seed, size_t size, size_t estimate, std::atomic<size_t>& produced, size_t failAt = size_t(-1)) :
+        seed_(seed), size_(size), estimate_(estimate), failAt_(failAt), pos_(0), produced_(produced) {}
+
+    void print(std::ostream& s) const override { s << "PatternHandle[" << seed_ << "]"; }
+    eckit::Length openForRead() override { pos_ = 0; return estimate_; }
+    void openForWrite(const eckit::Length&) override { NOTIMP; }
+    void openForAppend(const eckit::Length&) override { NOTIMP; }
+    eckit::Length estimate() override { return estimate_; }
+    long write(const void*, long) override { NOTIMP; }
+    void close() override {}
+
+    long read(void* buffer, long length) override {
+        if (pos_ >= failAt_) {
+            throw eckit::ReadError("PatternHandle: failing as asked", Here());
+        }
+        size_t n = std::min(size_t(length), std::min(size_, failAt_) - pos_);
+        char* out = static_cast<char*>(buffer);
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = patternByte(seed_, pos_ + i);
+        }
+        pos_ += n;
+        produced_ += n;
+        return n;
+    }
+
+private:
+    size_t seed_;
+    size_t size_;
+    size_t estimate_;
+    size_t failAt_;
+    size_t pos_;
+    std::atomic<size_t>& produced_;
+};
+
+/// The concatenated patterns, from the given offset
+std::vector<char> expected(const std::vector<size_t>& sizes, size_t from = 0) {
+    std::vector<char> out;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        for (size_t pos = 0; pos < sizes[i]; ++pos) {
+            out.push_back(patternByte(i, pos));
+        }
+    }
+    return std::vector<char>(out.begin() + from, out.end());
+}
+
+std::vector<char> readAll(eckit::DataHandle& h, size_t piece) {
+    std::vector<char> out;
+    std::vector<char> buf(piece);
+    long len;
+    while ((len = h.read(buf.data(), buf.size())) > 0) {
+        out.insert(out.end(), buf.begin(), buf.begin() + len);
+    }
+    return out;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Data are returned in order, whatever the depth and estimates" ) {
+
+    // Including empty handles, and estimates that are too short or too long
+    std::vector<size_t> sizes{0, 1, 100000, 5 * 1024 * 1024, 3, 70000, 0, 12345};
+    std::vector<size_t> estimates{0, 10, 100000, 1024 * 1024, 3, 200000, 5, 12345};
+
+    for (size_t depth : {1, 2, 8}) {
+        std::atomic<size_t> produced(0);
+        std::vector<eckit::DataHandle*> handles;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            handles.push_back(new PatternHandle(i, sizes[i], estimates[i], produced));
+        }
+
+        fdb5::ReadAheadHandle h(handles, depth, 256 * 1024);
+        h.openForRead();
+        EXPECT(readAll(h, 10000) == expected(sizes));
+        h.close();
+    }
+}
+
+CASE( "Handles larger than the memory budget are read in bounded chunks" ) {
+
+    const size_t budget = 1024 * 1024;
+    std::vector<size_t> sizes(3, 16 * 1024 * 1024);
+
+    std::atomic<size_t> produced(0);
+    std::vector<eckit::DataHandle*> handles;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        handles.push_back(new PatternHandle(i, sizes[i], sizes[i], produced));
+    }
+
+    fdb5::ReadAheadHandle h(handles, 4, budget);
+    h.openForRead();
+
+    std::vector<char> want = expected(sizes);
+    std::vector<char> buf(4096);
+    size_t consumed = 0;
+    long len;
+    while ((len = h.read(buf.data(), buf.size())) > 0) {
+        EXPECT(std::equal(buf.begin(), buf.begin() + len, want.begin() + consumed));
+        consumed += len;
+
+        // Whatever has been read from the handles, but not yet by us, is buffered. At most one chunk over.
+        EXPECT(produced - consumed <= 2 * budget);
+    }
+    EXPECT(consumed == want.size());
+    h.close();
+}
+
+CASE( "A read error is reported once the data before it have been returned" ) {
+
+    std::atomic<size_t> produced(0);
+    std::vector<eckit::DataHandle*> handles{new PatternHandle(0, 1000, 1000, produced),
+                                            new PatternHandle(1, 1000, 1000, produced, 500),
+                                            new PatternHandle(2, 1000, 1000, produced)};
+
+    fdb5::ReadAheadHandle h(handles, 3, 1024 * 1024);
+    h.openForRead();
+
+    std::vector<char> buf(1000);
+    EXPECT(h.read(buf.data(), 1000) == 1000);
+    EXPECT(h.read(buf.data(), 500) == 500);
+    EXPECT_THROWS_AS(h.read(buf.data(), 1000), eckit::ReadError);
+    h.close();
+}
+
+CASE( "Rewinding and seeking read through the handles again" ) {
+
+    std::vector<size_t> sizes{100000, 3 * 1024 * 1024, 70000};
+    std::vector<char> want = expected(sizes);
+
+    std::atomic<size_t> produced(0);
+    std::vector<eckit::DataHandle*> handles;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        handles.push_back(new PatternHandle(i, sizes[i], sizes[i], produced));
+    }
+
+    fdb5::ReadAheadHandle h(handles, 2, 256 * 1024);
+    h.openForRead();
+
+    std::vector<char> buf(150000);
+    EXPECT(h.read(buf.data(), buf.size()) == long(buf.size()));
+    EXPECT(h.position() == eckit::Offset(150000));
+
+    // Backwards
+    EXPECT(h.seek(50000) == eckit::Offset(50000));
+    EXPECT(h.read(buf.data(), 1000) == 1000);
+    EXPECT(std::equal(buf.begin(), buf.begin() + 1000, want.begin() + 50000));
+
+    // Forwards, into the last handle
+    size_t offset = 100000 + 3 * 1024 * 1024 + 10;
+    EXPECT(h.seek(offset) == eckit::Offset(offset));
+    EXPECT(readAll(h, 4096) == expected(sizes, offset));
+
+    // Past the end
+    EXPECT(h.seek(want.size() + 100) == eckit::Offset(want.size()));
+
+    h.rewind();
+    EXPECT(readAll(h, 65536) == want);
+    h.close();
+}
+
+CASE( "The handle can be sent over a stream" ) {
+
+    std::vector<eckit::PathName> paths;
+    std::vector<size_t> sizes{1000, 200000, 0, 5};
+    std::vector<char> want = expected(sizes);
+
+    std::vector<eckit::DataHandle*> handles;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        paths.push_back(eckit::PathName::unique(eckit::PathName("read_ahead.data")));
+        std::vector<char> data(sizes[i]);
+        for (size_t pos = 0; pos < data.size(); ++pos) {
+            data[pos] = patternByte(i, pos);
+        }
+        std::unique_ptr<eckit::DataHandle> out(paths.back().fileHandle());
+        out->openForWrite(data.size());
+        out->write(data.data(), data.size());
+        out->close();
+        handles.push_back(paths.back().fileHandle());
+    }
+
+    eckit::PathName stream = eckit::PathName::unique(eckit::PathName("read_ahead.stream"));
+    {
+        fdb5::ReadAheadHandle h(handles, 2, 64 * 1024);
+        eckit::FileStream s(stream, "w");
+        s << h;
+        s.close();
+    }
+
+    std::unique_ptr<eckit::DataHandle> h;
+    {
+        eckit::FileStream s(stream, "r");
+        h.reset(eckit::Reanimator<eckit::DataHandle>::reanimate(s));
+        s.close();
+    }
+
+    EXPECT(h);
+    h->openForRead();
+    EXPECT(readAll(*h, 4096) == want);
+    h->close();
+
+    stream.unlink();
+    for (const eckit::PathName& path : paths) {
+        path.unlink();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,177 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/io/VectoredRead.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+char patternByte(size_t pos) {
+    return char((pos * 7 + pos / 251) & 0xff);
+}
+
+/// A file of the given size, open for reading, removed once done with
+class TestFile {
+public:
+    TestFile(size_t size) : path_(eckit::PathName::unique(eckit::PathName("vectored_read.data"))) {
+        std::vector<char> data(size);
+        for (size_t pos = 0; pos < size; ++pos) {
+            data[pos] = patternByte(pos);
+        }
+        std::unique_ptr<eckit::DataHandle> out(path_.fileHandle());
+        out->openForWrite(size);
+        out->write(data.data(), data.size());
+        out->close();
+        SYSCALL(fd_ = ::open(path_.localPath(), O_RDONLY));
+    }
+    ~TestFile() {
+        ::close(fd_);
+        path_.unlink();
+    }
+    int fd() const { return fd_; }
+    const eckit::PathName& path() const { return path_; }
+private:
+    eckit::PathName path_;
+    int fd_;
+};
+
+/// Returns no more than `limit` bytes per call, and no more than IOV_MAX iovecs may be passed
+fdb5::PReadV shortReads(size_t limit, size_t& calls) {
+    return [limit, &calls](int fd, const struct iovec* iov, int iovcnt, off_t offset) -> ssize_t {
+        EXPECT(iovcnt > 0 && iovcnt <= IOV_MAX);
+        ++calls;
+        std::vector<struct iovec> capped;
+        size_t total = 0;
+        for (int i = 0; i < iovcnt && total < limit; ++i) {
+            size_t n = std::min(iov[i].iov_len, limit - total);
+            capped.push_back({iov[i].iov_base, n});
+            total += n;
+        }
+        return ::preadv(fd, capped.data(), int(capped.size()), offset);
+    };
+}
+
+/// Reads ranges of the given lengths from offset, as the remote server does, skipping holes into one buffer.
+/// Lengths of holes are given as negative numbers.
+void check(const TestFile& file, off_t offset, const std::vector<long>& lengths, size_t limit) {
+
+    std::vector<std::vector<char>> buffers;
+    std::vector<char> hole(*std::min_element(lengths.begin(), lengths.end()) < 0 ? 100000 : 0);
+    std::vector<struct iovec> iov;
+
+    buffers.reserve(lengths.size());
+    for (long length : lengths) {
+        if (length < 0) {
+            iov.push_back({hole.data(), size_t(-length)});
+        } else {
+            buffers.emplace_back(length);
+            iov.push_back({buffers.back().data(), size_t(length)});
+        }
+    }
+
+    size_t calls = 0;
+    fdb5::preadvFully(file.fd(), iov, offset, file.path(), shortReads(limit, calls));
+
+    size_t pos = offset;
+    size_t b = 0;
+    for (long length : lengths) {
+        if (length < 0) {
+            pos += -length;
+            continue;
+        }
+        const std::vector<char>& buffer(buffers[b++]);
+        for (size_t i = 0; i < buffer.size(); ++i) {
+            EXPECT(buffer[i] == patternByte(pos + i));
+        }
+        pos += length;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Short reads are resumed where they stopped" ) {
+
+    TestFile file(100000);
+
+    // Including empty iovecs, and holes read into a shared buffer
+    std::vector<long> lengths{10, 0, 1, 2000, -50, 3, 0, 0, 7, -1, 30000, 1};
+
+    for (size_t limit : {1, 3, 10, 11, 1000, 100000}) {
+        check(file, 0, lengths, limit);
+        check(file, 12345, lengths, limit);
+    }
+}
+
+CASE( "No more than IOV_MAX iovecs are passed at once" ) {
+
+    TestFile file(10000);
+
+    std::vector<long> lengths(3 * IOV_MAX + 5, 1);
+    check(file, 17, lengths, 100000);
+    check(file, 17, lengths, 7);
+}
+
+CASE( "Reading past the end of the file fails" ) {
+
+    TestFile file(1000);
+
+    std::vector<char> buffer(500);
+    std::vector<struct iovec> iov{{buffer.data(), buffer.size()}};
+    EXPECT_THROWS_AS(fdb5::preadvFully(file.fd(), iov, 600, file.path()), eckit::ReadError);
+
+    // Even when the iovecs are only partly beyond the end
+    size_t calls = 0;
+    iov = {{buffer.data(), 300}, {buffer.data(), 300}};
+    EXPECT_THROWS_AS(fdb5::preadvFully(file.fd(), iov, 500, file.path(), shortReads(100, calls)), eckit::ReadError);
+    EXPECT(calls == 6);
+}
+
+CASE( "Errors from the system call are reported" ) {
+
+    TestFile file(1000);
+
+    std::vector<char> buffer(500);
+    std::vector<struct iovec> iov{{buffer.data(), buffer.size()}};
+
+    auto failing = [](int, const struct iovec*, int, off_t) -> ssize_t {
+        errno = EIO;
+        return -1;
+    };
+    EXPECT_THROWS_AS(fdb5::preadvFully(file.fd(), iov, 0, file.path(), failing), eckit::FailedSystemCall);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
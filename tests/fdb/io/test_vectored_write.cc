@@ -0,0 +1,313 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/io/FDBVectoredFileHandle.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Data that differs from one write to the next, so that misplaced bytes show
+std::string data(size_t length, size_t seed) {
+    std::string out(length, '\0');
+    for (size_t pos = 0; pos < length; ++pos) {
+        out[pos] = char((pos * 7 + seed * 13 + pos / 251) & 0xff);
+    }
+    return out;
+}
+
+/// A path for a file that does not exist yet, removed once done with
+class TestFile {
+public:
+    TestFile() : path_(eckit::PathName::unique(eckit::PathName("vectored_write.data"))) {}
+    ~TestFile() {
+        if (path_.exists()) path_.unlink();
+    }
+    const eckit::PathName& path() const { return path_; }
+
+    /// What the file holds, nothing if it does not exist
+    std::string contents() const {
+        if (!path_.exists()) {
+            return "";
+        }
+        std::string out(size_t(path_.size()), '\0');
+        std::unique_ptr<eckit::DataHandle> dh(path_.fileHandle());
+        dh->openForRead();
+        EXPECT(dh->read(&out[0], out.size()) == long(out.size()));
+        dh->close();
+        return out;
+    }
+private:
+    eckit::PathName path_;
+};
+
+/// Writes no more than `limit` bytes per call, counting the calls and the bytes written
+fdb5::PWriteV shortWrites(size_t limit, size_t& calls, size_t& bytes) {
+    return [limit, &calls, &bytes](int fd, const struct iovec* iov, int iovcnt, off_t offset) -> ssize_t {
+        EXPECT(iovcnt > 0 && iovcnt <= IOV_MAX);
+        ++calls;
+        std::vector<struct iovec> capped;
+        size_t total = 0;
+        for (int i = 0; i < iovcnt && total < limit; ++i) {
+            size_t n = std::min(iov[i].iov_len, limit - total);
+            capped.push_back({iov[i].iov_base, n});
+            total += n;
+        }
+        ssize_t n = ::pwritev(fd, capped.data(), int(capped.size()), offset);
+        if (n > 0) bytes += n;
+        return n;
+    };
+}
+
+const std::vector<size_t> mixedSizes{1, 100, 1023, 1024, 1025, 0, 3000, 5000, 7, 4096, 17, 10000, 2, 4095, 333};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Writes of mixed sizes end up in the file as written, at the position reported" ) {
+
+    TestFile file;
+    std::string expected;
+
+    {
+        fdb5::FDBVectoredFileHandle dh(file.path(), 4, 1024);
+        dh.openForAppend(0);
+        EXPECT(dh.position() == Offset(0));
+
+        for (size_t i = 0; i < mixedSizes.size(); ++i) {
+            std::string d = data(mixedSizes[i], i);
+            EXPECT(dh.write(d.data(), d.size()) == long(d.size()));
+            expected += d;
+
+            EXPECT(dh.position() == Offset(expected.size()));
+            EXPECT(dh.allocated() <= 4 * 1024);
+
+            // Anything not yet written is buffered, and no more than fits
+            std::string written = file.contents();
+            EXPECT(written.size() <= expected.size());
+            EXPECT(expected.size() - written.size() <= 4 * 1024);
+            EXPECT(expected.compare(0, written.size(), written) == 0);
+        }
+
+        dh.flush();
+        EXPECT(file.contents() == expected);
+        EXPECT(dh.position() == Offset(expected.size()));
+
+        for (size_t i = 0; i < mixedSizes.size(); ++i) {
+            std::string d = data(mixedSizes[i], 100 + i);
+            dh.write(d.data(), d.size());
+            expected += d;
+        }
+
+        dh.close();
+        EXPECT(file.contents() == expected);
+    }
+
+    // Appending to the file, from where it ends
+
+    fdb5::FDBVectoredFileHandle dh(file.path(), 2, 100);
+    dh.openForAppend(0);
+    EXPECT(dh.position() == Offset(expected.size()));
+
+    std::string d = data(150, 999);
+    dh.write(d.data(), d.size());
+    expected += d;
+    EXPECT(dh.position() == Offset(expected.size()));
+
+    dh.close();
+    EXPECT(file.contents() == expected);
+}
+
+CASE( "Data is buffered until the buffers are full, and written with a write that does not fit in the same call" ) {
+
+    TestFile file;
+    std::string expected;
+
+    size_t calls = 0;
+    size_t bytes = 0;
+    fdb5::FDBVectoredFileHandle dh(file.path(), 2, 100, shortWrites(1000000, calls, bytes));
+    dh.openForAppend(0);
+
+    // The buffers are allocated as they are filled
+
+    EXPECT(dh.allocated() == 0);
+
+    std::string d = data(50, 1);
+    dh.write(d.data(), d.size());
+    expected += d;
+    EXPECT(calls == 0);
+    EXPECT(dh.allocated() == 100);
+
+    d = data(150, 2);
+    dh.write(d.data(), d.size());
+    expected += d;
+    EXPECT(calls == 0);
+    EXPECT(dh.allocated() == 200);
+    EXPECT(file.contents().empty());
+
+    // Full, so a write that does not fit is not copied but written with the buffered data
+
+    d = data(60, 3);
+    dh.write(d.data(), d.size());
+    expected += d;
+    EXPECT(calls == 1);
+    EXPECT(bytes == 260);
+    EXPECT(file.contents() == expected);
+    EXPECT(dh.position() == Offset(260));
+
+    // A write larger than all the buffers goes directly
+
+    d = data(500, 4);
+    dh.write(d.data(), d.size());
+    expected += d;
+    EXPECT(calls == 2);
+    EXPECT(file.contents() == expected);
+
+    // Flushing writes what is buffered, and releases the buffers
+
+    d = data(10, 5);
+    dh.write(d.data(), d.size());
+    expected += d;
+    EXPECT(calls == 2);
+    EXPECT(dh.allocated() == 200);
+
+    dh.flush();
+    EXPECT(calls == 3);
+    EXPECT(dh.allocated() == 0);
+    EXPECT(file.contents() == expected);
+
+    // With nothing buffered, flushing writes nothing
+
+    dh.flush();
+    EXPECT(calls == 3);
+
+    // And so does closing
+
+    d = data(120, 6);
+    dh.write(d.data(), d.size());
+    expected += d;
+    EXPECT(dh.allocated() == 200);
+
+    dh.close();
+    EXPECT(calls == 4);
+    EXPECT(dh.allocated() == 0);
+    EXPECT(file.contents() == expected);
+    EXPECT(bytes == expected.size());
+}
+
+CASE( "Short writes are resumed where they stopped, also part way through a buffer" ) {
+
+    for (size_t limit : {1, 7, 100, 150, 333}) {
+
+        TestFile file;
+        std::string expected;
+
+        size_t calls = 0;
+        size_t bytes = 0;
+        fdb5::FDBVectoredFileHandle dh(file.path(), 3, 100, shortWrites(limit, calls, bytes));
+        dh.openForAppend(0);
+
+        for (size_t i = 0; i < mixedSizes.size(); ++i) {
+            std::string d = data(mixedSizes[i] % 700, i);
+            dh.write(d.data(), d.size());
+            expected += d;
+            EXPECT(dh.position() == Offset(expected.size()));
+        }
+
+        dh.close();
+
+        EXPECT(file.contents() == expected);
+        EXPECT(bytes == expected.size());
+        EXPECT(calls >= (expected.size() + limit - 1) / limit);
+    }
+}
+
+CASE( "Interrupted writes are retried, and failed ones release the buffers on close" ) {
+
+    TestFile file;
+    std::string expected;
+
+    // Every other call is interrupted before writing anything
+
+    size_t calls = 0;
+    fdb5::FDBVectoredFileHandle retried(file.path(), 2, 100, [&calls](int fd, const struct iovec* iov, int iovcnt, off_t offset) -> ssize_t {
+        if (calls++ % 2 == 0) {
+            errno = EINTR;
+            return -1;
+        }
+        return ::pwritev(fd, iov, iovcnt, offset);
+    });
+    retried.openForAppend(0);
+
+    for (size_t i = 0; i < mixedSizes.size(); ++i) {
+        std::string d = data(mixedSizes[i], i);
+        retried.write(d.data(), d.size());
+        expected += d;
+    }
+    retried.close();
+    EXPECT(file.contents() == expected);
+
+    // A failure is reported, and the buffers are released all the same
+
+    fdb5::FDBVectoredFileHandle failing(file.path(), 2, 100, [](int, const struct iovec*, int, off_t) -> ssize_t {
+        errno = ENOSPC;
+        return -1;
+    });
+    failing.openForAppend(0);
+
+    std::string d = data(150, 1);
+    failing.write(d.data(), d.size());
+    EXPECT(failing.allocated() == 200);
+
+    EXPECT_THROWS_AS(failing.close(), eckit::WriteError);
+    EXPECT(failing.allocated() == 0);
+    EXPECT(file.contents() == expected);
+
+    // After a failed flush the data is still buffered, so closing fails too, but releases the buffers and the file
+
+    fdb5::FDBVectoredFileHandle flushFails(file.path(), 2, 100, [](int, const struct iovec*, int, off_t) -> ssize_t {
+        errno = EIO;
+        return -1;
+    });
+    flushFails.openForAppend(0);
+    flushFails.write(d.data(), d.size());
+    EXPECT_THROWS_AS(flushFails.flush(), eckit::WriteError);
+    EXPECT(flushFails.allocated() == 200);
+    EXPECT_THROWS_AS(flushFails.close(), eckit::WriteError);
+    EXPECT(flushFails.allocated() == 0);
+    flushFails.close();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
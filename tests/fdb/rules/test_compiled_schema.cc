@@ -0,0 +1,234 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/database/WriteVisitor.h"
+#include "fdb5/rules/Rule.h"
+#include "fdb5/rules/Schema.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Records every call made on it, with the keys and rules it is given
+class RecordingVisitor : public fdb5::WriteVisitor {
+public:
+    RecordingVisitor(std::vector<fdb5::Key>& prev, const fdb5::Schema& schema, std::vector<std::string>& calls) :
+        fdb5::WriteVisitor(prev), schema_(schema), calls_(calls) {}
+
+    bool selectDatabase(const fdb5::Key& key, const fdb5::Key& full) override {
+        record("database", key, full);
+        return true;
+    }
+
+    bool selectIndex(const fdb5::Key& key, const fdb5::Key& full) override {
+        record("index", key, full);
+        return true;
+    }
+
+    bool selectDatum(const fdb5::Key& key, const fdb5::Key& full) override {
+        record("datum", key, full);
+        return true;
+    }
+
+    const fdb5::Schema& databaseSchema() const override { return schema_; }
+
+private:
+    void print(std::ostream& out) const override { out << "RecordingVisitor"; }
+
+    void record(const char* call, const fdb5::Key& key, const fdb5::Key& full) {
+        std::ostringstream oss;
+        oss << call << " " << key << " [" << key.valuesToString() << "] " << full;
+        calls_.push_back(oss.str());
+    }
+
+    const fdb5::Schema& schema_;
+    std::vector<std::string>& calls_;
+};
+
+fdb5::Key field(const std::vector<std::pair<std::string, std::string>>& values) {
+    fdb5::Key key;
+    for (const auto& kv : values) {
+        key.set(kv.first, kv.second);
+    }
+    return key;
+}
+
+/// The calls made expanding the fields in turn, with the same visitor, and the rule each field ends up with
+/// or the error it fails with
+std::vector<std::string> expand(const fdb5::Schema& schema, const std::vector<fdb5::Key>& fields) {
+    std::vector<std::string> calls;
+    std::vector<fdb5::Key> prev;
+    RecordingVisitor visitor(prev, schema, calls);
+    for (const fdb5::Key& key : fields) {
+        try {
+            schema.expand(key, visitor);
+        }
+        catch (eckit::Exception& e) {
+            calls.push_back(std::string("throws ") + e.what());
+        }
+        std::ostringstream oss;
+        oss << "rule ";
+        if (visitor.rule()) {
+            oss << *visitor.rule() << " of " << visitor.rule()->topRule();
+        } else {
+            oss << "none";
+        }
+        calls.push_back(oss.str());
+    }
+    return calls;
+}
+
+void check(fdb5::Schema& compiled, fdb5::Schema& tree, const std::vector<fdb5::Key>& fields) {
+
+    compiled.compiled(true);
+    tree.compiled(false);
+    EXPECT(compiled.compiled());
+    EXPECT(!tree.compiled());
+
+    std::vector<std::string> want = expand(tree, fields);
+    std::vector<std::string> got = expand(compiled, fields);
+
+    EXPECT(got.size() == want.size());
+    for (size_t i = 0; i < std::min(got.size(), want.size()); ++i) {
+        if (got[i] != want[i]) {
+            Log::info() << "Compiled: " << got[i] << std::endl
+                        << "Rules:    " << want[i] << std::endl;
+        }
+        EXPECT(got[i] == want[i]);
+    }
+}
+
+fdb5::Key base(const std::string& stream, const std::string& date, const std::string& type) {
+    return field({{"class", "rd"}, {"expver", "xxxx"}, {"stream", stream}, {"date", date}, {"time", "0000"},
+                  {"domain", "g"}, {"type", type}, {"levtype", "pl"}, {"step", "0"}, {"param", "138"}});
+}
+
+fdb5::Key with(fdb5::Key key, const std::vector<std::pair<std::string, std::string>>& values) {
+    for (const auto& kv : values) {
+        key.set(kv.first, kv.second);
+    }
+    return key;
+}
+
+fdb5::Key without(const fdb5::Key& key, const std::string& keyword) {
+    fdb5::Key result;
+    for (fdb5::Key::const_iterator i = key.begin(); i != key.end(); ++i) {
+        if (i->first != keyword) {
+            result.set(i->first, i->second);
+        }
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "The compiled test schema expands fields as its rules do" ) {
+
+    eckit::PathName path = fdb5::Config().expandConfig().schemaPath();
+
+    fdb5::Schema compiled(path);
+    fdb5::Schema tree(path);
+
+    fdb5::Key an = base("oper", "20201102", "an");
+
+    std::vector<fdb5::Key> fields{
+        with(an, {{"levelist", "300"}}),
+        with(an, {{"levelist", "400"}}),                         // same index
+        with(an, {{"levelist", "400"}, {"param", "130"}}),
+        an,                                                      // optional levelist missing
+        with(base("oper", "20201102", "fc"), {{"levelist", "300"}}), // new index
+        with(base("oper", "20201103", "fc"), {{"levelist", "300"}}), // new database
+        without(with(an, {{"levelist", "300"}}), "domain"),      // optional domain missing
+        with(base("oper", "20201102", "ssd"), {{"ident", "1"}, {"instrument", "2"}, {"channel", "3"}}),
+        with(base("oper", "20201102", "im"), {{"ident", "1"}, {"instrument", "2"}, {"channel", "3"}}),
+        with(base("enfo", "20201102", "pf"), {{"number", "1"}, {"levelist", "300"}}),
+        with(base("enfo", "20201102", "tu"), {{"number", "1"}, {"reference", "12"}}),
+        with(base("enfo", "20201102", "pf"), {{"levtype", "dp"}, {"product", "inst"}, {"range", "6"}}),
+        with(base("oper", "20201102", "ofb"), {{"obsgroup", "1"}, {"reportype", "16001"}}),
+        without(an, "date"),                                     // the matching rule requires a date
+        with(an, {{"levelist", "500"}}),
+        field({{"class", "ti"}, {"expver", "0001"}, {"stream", "enfo"}, {"date", "20201102"}, {"time", "1200"},
+               {"model", "glob"}, {"origin", "ecmf"}, {"type", "cf"}, {"levtype", "sfc"}, {"step", "6"},
+               {"param", "167"}}),
+    };
+
+    check(compiled, tree, fields);
+}
+
+CASE( "A compiled schema with alternatives, optional, hidden and typed keywords expands as its rules do" ) {
+
+    std::string rules =
+        "number: Integer;\n"
+        "[ class=od/rd, expver, stream, date, time, domain?g\n"
+        "    [ type=cf/pf, levtype\n"
+        "        [ step, number?, levelist?, param, grid- ]]\n"
+        "    [ type, levtype\n"
+        "        [ step, levelist?, param ]]\n"
+        "]\n"
+        "[ class, expver, stream=enfo, date, time, domain\n"
+        "    [ type=cf/pf, levtype, origin?ecmf\n"
+        "        [ step, number, param ]]\n"
+        "]\n"
+        "[ class, expver, stream=oper/enfo, date, time\n"
+        "    [ type\n"
+        "        [ param ]]\n"
+        "]\n";
+
+    std::istringstream s1(rules);
+    std::istringstream s2(rules);
+    fdb5::Schema compiled(s1);
+    fdb5::Schema tree(s2);
+
+    fdb5::Key pf = with(base("oper", "20201102", "pf"), {{"number", "007"}, {"grid", "O1280"}});
+
+    std::vector<fdb5::Key> fields{
+        pf,
+        with(pf, {{"number", "8"}}),
+        without(pf, "grid"),
+        without(without(pf, "number"), "domain"),
+        with(pf, {{"levelist", "850"}}),
+        base("oper", "20201102", "an"),
+        with(base("enfo", "20201102", "pf"), {{"class", "ea"}, {"number", "1"}}),
+        with(base("enfo", "20201102", "pf"), {{"class", "ea"}, {"number", "1"}, {"origin", "kwbc"}}),
+        without(with(base("enfo", "20201102", "pf"), {{"class", "ea"}}), "number"),   // a required keyword is missing
+        with(base("enfo", "20201102", "an"), {{"class", "ea"}}),                       // falls through to the last rule
+        with(base("wave", "20201102", "an"), {{"class", "ea"}}),                       // matches no rule
+        field({{"class", "ea"}, {"param", "1"}}),
+        with(base("oper", "20201102", "cf"), {{"class", "ea"}}),
+        pf,
+    };
+
+    check(compiled, tree, fields);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
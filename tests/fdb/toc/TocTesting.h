@@ -0,0 +1,100 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   TocTesting.h
+/// @date   Oct 2026
+
+#ifndef fdb_testing_TocTesting_H
+#define fdb_testing_TocTesting_H
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/filesystem/PathName.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The test configuration, with or without subtocs. Other settings come from the test environment.
+inline fdb5::Config config(bool subtocs) {
+    eckit::LocalConfiguration user;
+    user.set("useSubToc", subtocs);
+    return fdb5::Config(fdb5::Config().expandConfig(), user);
+}
+
+/// A DB of the test schema, one per expver so that the tests (and the variants of a test) don't share DBs
+inline fdb5::Key dbKey(const std::string& expver) {
+    fdb5::Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", "20201102");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    return key;
+}
+
+/// Archives a field in the index of the given type. Nothing is flushed.
+inline void archive(fdb5::DB& db, const std::string& type, const std::string& levelist) {
+
+    fdb5::Key index;
+    index.set("type", type);
+    index.set("levtype", "pl");
+
+    fdb5::Key datum;
+    datum.set("step", "0");
+    datum.set("levelist", levelist);
+    datum.set("param", "138");
+
+    std::string data = type + ":" + levelist;
+
+    db.selectIndex(index);
+    db.archive(datum, data.data(), data.size());
+}
+
+/// Hides whatever earlier runs left in the DB, from a writer that writes nothing else. Returns the DB directory.
+inline eckit::PathName clearAll(const std::string& expver, const fdb5::Config& cfg) {
+    std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+    archive(*writer, "an", "1");
+    writer->flush();
+    writer.reset();
+
+    writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+    writer->hideContents();
+    return writer->uri().path();
+}
+
+/// The keys and locations of the indexes, in order, to compare what different readers see
+inline std::vector<std::string> describe(const std::vector<fdb5::Index>& indexes) {
+    std::vector<std::string> out;
+    for (const fdb5::Index& index : indexes) {
+        std::ostringstream oss;
+        oss << index.key() << " " << index.location();
+        out.push_back(oss.str());
+    }
+    return out;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace test
+} // namespace fdb
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/BinaryIndexKey.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+typedef fdb5::BinaryIndexKey<24> Key24;
+typedef fdb5::BinaryIndexKey<32> Key32;
+
+/// Each fingerprint must sort strictly before the next
+void checkOrdered(const std::vector<std::string>& fingerprints) {
+    for (size_t i = 0; i < fingerprints.size(); ++i) {
+        for (size_t j = 0; j < fingerprints.size(); ++j) {
+            Key32 a(fingerprints[i]);
+            Key32 b(fingerprints[j]);
+            EXPECT((a < b) == (i < j));
+            EXPECT((a > b) == (i > j));
+            EXPECT((a == b) == (i == j));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Fingerprints are recovered exactly" ) {
+
+    std::vector<std::string> fingerprints{
+        "0", "1", "-1", "255", "256", "-256", "-257", "850", "20261018",
+        "999999999999999999", "-999999999999999999",
+        "od:0001:oper", "rd:xxxx:20201102:0000:g", "an:pl", "0:138:-1",
+        "", "a::b", ":", "x:"
+    };
+
+    for (const std::string& fingerprint : fingerprints) {
+        EXPECT(Key32(fingerprint).fingerprint() == fingerprint);
+    }
+
+    EXPECT(Key32().fingerprint() == "");
+}
+
+CASE( "A key is encoded as its values fingerprint" ) {
+
+    fdb5::Key key;
+    key.set("a", "od");
+    key.set("b", "850");
+    key.set("c", "-3");
+
+    EXPECT(Key32(key) == Key32(key.valuesToString()));
+    EXPECT(Key32(key).fingerprint() == key.valuesToString());
+}
+
+CASE( "Integers sort numerically, and before strings" ) {
+
+    checkOrdered({"-999999999999999999", "-65537", "-65536", "-257", "-256", "-255", "-2", "-1",
+                  "0", "1", "2", "255", "256", "850", "65535", "65536", "20261018", "999999999999999999",
+                  "", "-", "0001", "a", "ab", "b"});
+}
+
+CASE( "Keys sort by their first value, shorter keys first" ) {
+
+    checkOrdered({"1", "1:-1", "1:0", "1:a", "1:a:0", "1:b", "2", "2:1", "a", "a:1", "a:b"});
+
+    EXPECT(Key32() < Key32("0"));
+    EXPECT(Key32("") > Key32());
+    EXPECT(Key32::max() > Key32("zzzz:zzzz"));
+}
+
+CASE( "Values that are not canonical integers are strings" ) {
+
+    int64_t n;
+    for (const std::string& value : {"", "-", "-0", "007", "+5", " 5", "5 ", "1e3", "0x10", "1.5",
+                                     "1234567890123456789", "9223372036854775808", "-9223372036854775809"}) {
+        EXPECT(!Key32::integer(value, n));
+        EXPECT(Key32(value).fingerprint() == value);
+    }
+
+    EXPECT(Key32::integer("-5", n));
+    EXPECT(n == -5);
+    EXPECT(Key32::integer("123456789012345678", n));
+    EXPECT(n == 123456789012345678);
+
+    // Too long to be encoded as an integer, so it sorts with the strings
+    EXPECT(Key32("123456789012345678") < Key32("1234567890123456789"));
+}
+
+CASE( "Keys that do not fit are rejected" ) {
+
+    // A tag, 22 characters and the terminating NUL
+    std::string fits(22, 'x');
+    EXPECT(Key24(fits).fingerprint() == fits);
+    EXPECT_THROWS_AS(Key24(fits + "x"), eckit::UserError);
+
+    // Four 5 byte dates and two 2 byte integers fill the key exactly
+    EXPECT(Key24("20261018:20261018:20261018:20261018:1:2").fingerprint() ==
+           "20261018:20261018:20261018:20261018:1:2");
+    EXPECT_THROWS_AS(Key24("20261018:20261018:20261018:20261018:1:2:0"), eckit::UserError);
+    EXPECT_THROWS_AS(Key24("-999999999999999999:-999999999999999999:-999999999999999999"), eckit::UserError);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,350 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run with FDB_MAP_TOCS_ON_READ set, so that the cached DBs can be refreshed
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/FDBStats.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/DBCache.h"
+#include "fdb5/database/Field.h"
+#include "fdb5/database/Key.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const size_t unbounded = size_t(1) << 40;
+
+/// A DB holding the given levels of one field, and nothing left by earlier runs
+void populate(const std::string& expver, const fdb5::Config& cfg, const std::vector<std::string>& levelists) {
+    clearAll(expver, cfg);
+    std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+    for (const std::string& levelist : levelists) {
+        archive(*writer, "an", levelist);
+    }
+    writer->flush();
+}
+
+std::unique_ptr<fdb5::DB> reader(const std::string& expver, const fdb5::Config& cfg) {
+    std::unique_ptr<fdb5::DB> db = fdb5::DB::buildReader(dbKey(expver), cfg);
+    EXPECT(db->open());
+    return db;
+}
+
+std::unique_ptr<fdb5::DB> checkout(fdb5::DBCache& cache, const std::string& expver, const fdb5::Config& cfg,
+                                   fdb5::FDBStats& stats) {
+    return cache.checkout(fdb5::DBCache::location(dbKey(expver), cfg), stats);
+}
+
+bool has(fdb5::DB& db, const std::string& levelist) {
+
+    fdb5::Key index;
+    index.set("type", "an");
+    index.set("levtype", "pl");
+
+    fdb5::Key datum;
+    datum.set("step", "0");
+    datum.set("levelist", levelist);
+    datum.set("param", "138");
+
+    fdb5::Field field;
+    return db.selectIndex(index) && db.inspect(datum, field);
+}
+
+void expectStats(const fdb5::FDBStats& stats, size_t hits, size_t misses, size_t evictions, size_t invalidations,
+                 size_t refreshes) {
+    EXPECT(stats.numCatalogueCacheHit() == hits);
+    EXPECT(stats.numCatalogueCacheMiss() == misses);
+    EXPECT(stats.numCatalogueCacheEviction() == evictions);
+    EXPECT(stats.numCatalogueCacheInvalidation() == invalidations);
+    EXPECT(stats.numCatalogueCacheRefresh() == refreshes);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "A DB checked in is handed out again, once" ) {
+
+    fdb5::Config cfg = config(false);
+    populate("dbc1", cfg, {"1"});
+
+    fdb5::DBCache cache(unbounded, 16);
+    fdb5::FDBStats stats;
+
+    EXPECT(!checkout(cache, "dbc1", cfg, stats));
+    expectStats(stats, 0, 1, 0, 0, 0);
+
+    std::unique_ptr<fdb5::DB> db = reader("dbc1", cfg);
+    fdb5::DB* original = db.get();
+    cache.checkin(std::move(db), stats);
+
+    db = checkout(cache, "dbc1", cfg, stats);
+    EXPECT(db.get() == original);
+    EXPECT(has(*db, "1"));
+    expectStats(stats, 1, 1, 0, 0, 0);
+
+    // Whilst it is checked out, another reader of the same location has to open its own
+    EXPECT(!checkout(cache, "dbc1", cfg, stats));
+    expectStats(stats, 1, 2, 0, 0, 0);
+}
+
+CASE( "Readers of the same location at once each get their own DB" ) {
+
+    fdb5::Config cfg = config(false);
+    populate("dbc2", cfg, {"1", "2"});
+
+    fdb5::DBCache cache(unbounded, 16);
+    fdb5::FDBStats stats;
+
+    // Two DBs of the same location are both kept, and handed out to two readers
+
+    std::unique_ptr<fdb5::DB> a = reader("dbc2", cfg);
+    std::unique_ptr<fdb5::DB> b = reader("dbc2", cfg);
+    std::set<fdb5::DB*> originals{a.get(), b.get()};
+    cache.checkin(std::move(a), stats);
+    cache.checkin(std::move(b), stats);
+
+    a = checkout(cache, "dbc2", cfg, stats);
+    b = checkout(cache, "dbc2", cfg, stats);
+    EXPECT(a && b);
+    EXPECT(a.get() != b.get());
+    EXPECT((std::set<fdb5::DB*>{a.get(), b.get()}) == originals);
+    EXPECT(!checkout(cache, "dbc2", cfg, stats));
+    expectStats(stats, 2, 1, 0, 0, 0);
+
+    cache.checkin(std::move(a), stats);
+    cache.checkin(std::move(b), stats);
+
+    // And from several threads, no DB is ever in use by two of them. n.b. failures are counted, and checked
+    // once the threads are joined.
+
+    std::mutex mutex;
+    std::set<fdb5::DB*> inUse;
+    std::atomic<size_t> failures(0);
+    std::vector<fdb5::FDBStats> threadStats(8);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < threadStats.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < 20; ++i) {
+                std::unique_ptr<fdb5::DB> db = checkout(cache, "dbc2", cfg, threadStats[t]);
+                if (!db) {
+                    db = fdb5::DB::buildReader(dbKey("dbc2"), cfg);
+                    if (!db->open()) {
+                        ++failures;
+                        continue;
+                    }
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!inUse.insert(db.get()).second) {
+                        ++failures;
+                    }
+                }
+                if (!has(*db, "1") || !has(*db, "2")) {
+                    ++failures;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    inUse.erase(db.get());
+                }
+                cache.checkin(std::move(db), threadStats[t]);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    EXPECT(failures == 0);
+
+    fdb5::FDBStats total;
+    for (const fdb5::FDBStats& s : threadStats) {
+        total += s;
+    }
+    EXPECT(total.numCatalogueCacheHit() + total.numCatalogueCacheMiss() == 8 * 20);
+    EXPECT(total.numCatalogueCacheHit() >= 2);
+}
+
+CASE( "A DB appended to on disk is refreshed as it is checked out" ) {
+
+    fdb5::Config cfg = config(false);
+    populate("dbc3", cfg, {"1"});
+
+    fdb5::DBCache cache(unbounded, 16);
+    fdb5::FDBStats stats;
+
+    std::unique_ptr<fdb5::DB> db = reader("dbc3", cfg);
+    fdb5::DB* original = db.get();
+    EXPECT(!has(*db, "2"));
+    cache.checkin(std::move(db), stats);
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey("dbc3"), cfg);
+        archive(*writer, "an", "2");
+        writer->flush();
+    }
+
+    db = checkout(cache, "dbc3", cfg, stats);
+    EXPECT(db.get() == original);
+    EXPECT(has(*db, "1"));
+    EXPECT(has(*db, "2"));
+    expectStats(stats, 1, 0, 0, 0, 1);
+
+    // Unmodified, it is handed out as it is
+    cache.checkin(std::move(db), stats);
+    db = checkout(cache, "dbc3", cfg, stats);
+    EXPECT(db.get() == original);
+    expectStats(stats, 2, 0, 0, 0, 1);
+}
+
+CASE( "A DB whose indexes are masked on disk is reloaded" ) {
+
+    fdb5::Config cfg = config(false);
+    populate("dbc4", cfg, {"1"});
+
+    fdb5::DBCache cache(unbounded, 16);
+    fdb5::FDBStats stats;
+
+    cache.checkin(reader("dbc4", cfg), stats);
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey("dbc4"), cfg);
+        writer->hideContents();
+    }
+
+    // The cached DB is dropped, and the reader opens the DB afresh, without the masked data
+
+    EXPECT(!checkout(cache, "dbc4", cfg, stats));
+    expectStats(stats, 0, 1, 0, 1, 0);
+
+    std::unique_ptr<fdb5::DB> db = reader("dbc4", cfg);
+    EXPECT(!has(*db, "1"));
+
+    // Nor is it cached any more
+    EXPECT(!checkout(cache, "dbc4", cfg, stats));
+    expectStats(stats, 0, 2, 0, 1, 0);
+}
+
+CASE( "The least recently used DBs are evicted beyond fdbMaxOpenDatabases" ) {
+
+    fdb5::Config cfg = config(false);
+    for (const char* expver : {"dbc5", "dbc6", "dbc7", "dbc8"}) {
+        populate(expver, cfg, {"1"});
+    }
+
+    fdb5::DBCache cache(unbounded, 2);
+    fdb5::FDBStats stats;
+
+    cache.checkin(reader("dbc5", cfg), stats);
+    cache.checkin(reader("dbc6", cfg), stats);
+    expectStats(stats, 0, 0, 0, 0, 0);
+
+    cache.checkin(reader("dbc7", cfg), stats);
+    expectStats(stats, 0, 0, 1, 0, 0);
+
+    // dbc5 is gone. Using dbc6 makes dbc7 the least recently used.
+
+    EXPECT(!checkout(cache, "dbc5", cfg, stats));
+    std::unique_ptr<fdb5::DB> db = checkout(cache, "dbc6", cfg, stats);
+    EXPECT(db);
+    cache.checkin(std::move(db), stats);
+    expectStats(stats, 1, 1, 1, 0, 0);
+
+    cache.checkin(reader("dbc8", cfg), stats);
+    expectStats(stats, 1, 1, 2, 0, 0);
+
+    EXPECT(!checkout(cache, "dbc7", cfg, stats));
+    EXPECT(checkout(cache, "dbc6", cfg, stats));
+    EXPECT(checkout(cache, "dbc8", cfg, stats));
+    expectStats(stats, 3, 2, 2, 0, 0);
+}
+
+CASE( "The least recently used DBs are evicted beyond fdbCatalogueCacheMemory" ) {
+
+    fdb5::Config cfg = config(false);
+    populate("dbc9", cfg, {"1"});
+    populate("dbc10", cfg, {"1", "2", "3"});
+
+    std::unique_ptr<fdb5::DB> a = reader("dbc9", cfg);
+    std::unique_ptr<fdb5::DB> b = reader("dbc10", cfg);
+    size_t footprintA = a->footprint();
+    size_t footprintB = b->footprint();
+    EXPECT(footprintA > 0);
+    EXPECT(footprintB > 0);
+
+    // Room for both, but not a byte more
+
+    {
+        fdb5::DBCache cache(footprintA + footprintB, 16);
+        fdb5::FDBStats stats;
+
+        cache.checkin(reader("dbc9", cfg), stats);
+        cache.checkin(reader("dbc10", cfg), stats);
+        expectStats(stats, 0, 0, 0, 0, 0);
+
+        cache.checkin(reader("dbc9", cfg), stats);
+        expectStats(stats, 0, 0, 1, 0, 0);
+
+        // The first copy of dbc9 went first, leaving one of each
+        EXPECT(checkout(cache, "dbc9", cfg, stats));
+        EXPECT(checkout(cache, "dbc10", cfg, stats));
+        EXPECT(!checkout(cache, "dbc9", cfg, stats));
+        expectStats(stats, 2, 1, 1, 0, 0);
+    }
+
+    // A DB larger than the whole cache is not kept at all
+
+    {
+        fdb5::DBCache cache(footprintB - 1, 16);
+        fdb5::FDBStats stats;
+
+        cache.checkin(std::move(b), stats);
+        expectStats(stats, 0, 0, 1, 0, 0);
+        EXPECT(!checkout(cache, "dbc10", cfg, stats));
+    }
+
+    // And with no memory, nothing is cached, nor counted as evicted
+
+    {
+        fdb5::DBCache cache(0, 16);
+        fdb5::FDBStats stats;
+
+        cache.checkin(std::move(a), stats);
+        EXPECT(!checkout(cache, "dbc9", cfg, stats));
+        expectStats(stats, 0, 1, 0, 0, 0);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,259 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run with FDB_ROOT_SCAN_CACHE=1, and FDB_ROOT_SCAN_CACHE_DIR set, so that the scans are cached
+
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/os/Stat.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/toc/RootScanner.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Long enough ago for the modification times to be trusted
+const time_t aged = ::time(nullptr) - 3600;
+
+eckit::PathName newRoot(const std::string& name) {
+    eckit::PathName root = eckit::PathName::unique(eckit::PathName::cwd() / name);
+    root.mkdir();
+    return root;
+}
+
+/// A DB is a directory with a toc file
+void addDB(const eckit::PathName& path) {
+    path.mkdir();
+    (path / "toc").touch();
+}
+
+void removeDB(const eckit::PathName& path) {
+    (path / "toc").unlink();
+    path.rmdir();
+}
+
+void setModified(const eckit::PathName& path, time_t when) {
+    struct timeval times[2];
+    times[0].tv_sec  = when;
+    times[0].tv_usec = 0;
+    times[1] = times[0];
+    SYSCALL(::utimes(path.asString().c_str(), times));
+}
+
+std::list<std::string> scan(const eckit::PathName& root) {
+    return fdb5::RootScanner(root).scan();
+}
+
+std::list<std::string> dbs(const eckit::PathName& root, const std::vector<std::string>& names) {
+    std::list<std::string> result;
+    for (const std::string& name : names) {
+        result.push_back(root.asString() + "/" + name);
+    }
+    result.sort();
+    return result;
+}
+
+/// root/db0, root/a/db1, root/a/db2, root/b/c/db3, with every directory (DB or not) aged
+eckit::PathName tree(const std::string& name) {
+
+    eckit::PathName root = newRoot(name);
+
+    addDB(root / "db0");
+    (root / "a").mkdir();
+    addDB(root / "a" / "db1");
+    addDB(root / "a" / "db2");
+    (root / "b").mkdir();
+    (root / "b" / "c").mkdir();
+    addDB(root / "b" / "c" / "db3");
+
+    for (const char* dir : {"a", "b/c", "b", "."}) {
+        setModified(root / dir, aged);
+    }
+    return root;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "The DBs under a root are found, sorted" ) {
+
+    eckit::PathName root = newRoot("scan");
+
+    std::vector<std::string> names;
+    for (size_t i = 0; i < 20; ++i) {
+        std::string sub = "s" + std::to_string(i % 4);
+        if (i < 4) {
+            (root / sub).mkdir();
+        }
+        names.push_back(sub + "/db" + std::to_string(19 - i));
+        addDB(root / names.back());
+    }
+
+    std::list<std::string> found = scan(root);
+    EXPECT(found == dbs(root, names));
+    EXPECT(std::is_sorted(found.begin(), found.end()));
+
+    // And the same from the cache
+    EXPECT(scan(root) == found);
+}
+
+CASE( "The cache is not written in the root, so leaves it trusted" ) {
+
+    eckit::PathName root = tree("scan");
+    std::vector<std::string> all{"db0", "a/db1", "a/db2", "b/c/db3"};
+
+    EXPECT(scan(root) == dbs(root, all));
+
+    eckit::Stat::Struct info;
+    EXPECT(eckit::Stat::stat(root.asString().c_str(), &info) == 0);
+    EXPECT(info.st_mtime == aged);
+    EXPECT(!(root / "scan.cache").exists());
+
+    // A directory whose entries are trusted is not read again: a DB added behind the cache's back (restoring the
+    // modification time of its parent) is not seen
+
+    addDB(root / "a" / "hidden");
+    setModified(root / "a", aged);
+    EXPECT(scan(root) == dbs(root, all));
+
+    // Until the parent is modified
+
+    setModified(root / "a", aged + 1);
+    all.push_back("a/hidden");
+    EXPECT(scan(root) == dbs(root, all));
+}
+
+CASE( "A directory added below a cached parent is found" ) {
+
+    eckit::PathName root = tree("scan");
+    EXPECT(scan(root) == dbs(root, {"db0", "a/db1", "a/db2", "b/c/db3"}));
+
+    // In a cached directory
+    addDB(root / "a" / "db4");
+
+    // Deeper below a cached directory (b) that is itself unmodified, with some new levels of directories between
+    (root / "b" / "c" / "d").mkdir();
+    (root / "b" / "c" / "d" / "e").mkdir();
+    addDB(root / "b" / "c" / "d" / "e" / "db5");
+
+    std::vector<std::string> all{"db0", "a/db1", "a/db2", "a/db4", "b/c/db3", "b/c/d/e/db5"};
+    EXPECT(scan(root) == dbs(root, all));
+
+    // And the new directories, once cached, are still found
+    for (const char* dir : {"a", "b/c/d/e", "b/c/d", "b/c"}) {
+        setModified(root / dir, aged + 2);
+    }
+    EXPECT(scan(root) == dbs(root, all));
+    EXPECT(scan(root) == dbs(root, all));
+}
+
+CASE( "A stale cache is not trusted" ) {
+
+    eckit::PathName root = tree("scan");
+    EXPECT(scan(root) == dbs(root, {"db0", "a/db1", "a/db2", "b/c/db3"}));
+
+    // DBs wiped and added, the directories modified
+
+    removeDB(root / "a" / "db1");
+    removeDB(root / "b" / "c" / "db3");
+    (root / "b" / "c").rmdir();
+    addDB(root / "b" / "db6");
+
+    EXPECT(scan(root) == dbs(root, {"db0", "a/db2", "b/db6"}));
+
+    // A directory replaced by another with the same modification time: the parent is unmodified too, but the
+    // directory is not the same
+
+    setModified(root, aged);
+    setModified(root / "a", aged);
+    setModified(root / "b", aged);
+    EXPECT(scan(root) == dbs(root, {"db0", "a/db2", "b/db6"}));
+
+    // n.b. the replacement is made before the original is removed, so that it may not reuse its inode
+
+    (root / "x").mkdir();
+    addDB(root / "x" / "db7");
+    removeDB(root / "a" / "db2");
+    (root / "a").rmdir();
+    eckit::PathName::rename(root / "x", root / "a");
+    setModified(root / "a", aged);
+    setModified(root, aged);
+
+    EXPECT(scan(root) == dbs(root, {"db0", "a/db7", "b/db6"}));
+
+    // A cache that cannot be read is ignored
+
+    eckit::PathName cacheDir(::getenv("FDB_ROOT_SCAN_CACHE_DIR"));
+    std::vector<eckit::PathName> files;
+    std::vector<eckit::PathName> dirs;
+    cacheDir.children(files, dirs);
+    EXPECT(!files.empty());
+    for (const eckit::PathName& file : files) {
+        std::unique_ptr<eckit::DataHandle> dh(file.fileHandle());
+        dh->openForWrite(0);
+        dh->write("garbage", 7);
+        dh->close();
+    }
+
+    EXPECT(scan(root) == dbs(root, {"db0", "a/db7", "b/db6"}));
+    EXPECT(scan(root) == dbs(root, {"db0", "a/db7", "b/db6"}));
+}
+
+CASE( "A moved root is scanned as any other, and so is a root put in its place" ) {
+
+    eckit::PathName root = tree("scan");
+    std::vector<std::string> all{"db0", "a/db1", "a/db2", "b/c/db3"};
+    EXPECT(scan(root) == dbs(root, all));
+
+    eckit::PathName moved = eckit::PathName::unique(eckit::PathName::cwd() / "moved");
+    eckit::PathName::rename(root, moved);
+
+    EXPECT(scan(moved) == dbs(moved, all));
+
+    // A new root at the old path, with the same directories, as old as the cached ones
+
+    root.mkdir();
+    addDB(root / "db8");
+    (root / "a").mkdir();
+    addDB(root / "a" / "db9");
+    (root / "b").mkdir();
+    setModified(root / "a", aged);
+    setModified(root / "b", aged);
+    setModified(root, aged);
+
+    EXPECT(scan(root) == dbs(root, {"db8", "a/db9"}));
+    EXPECT(scan(moved) == dbs(moved, all));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,239 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run with FDB5_SERIALISATION_VERSION=4 and FDB_INDEX_BLOOM_FILTER_BITS_PER_KEY set, so that the indexes are
+/// written with their Bloom filters
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/serialisation/MemoryStream.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/BloomFilter.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/TocHandler.h"
+#include "fdb5/toc/TocIndex.h"
+#include "fdb5/toc/TocSerialisationVersion.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+fdb5::Key datum(size_t levelist, size_t param) {
+    fdb5::Key key;
+    key.set("step", "0");
+    key.set("levelist", std::to_string(levelist));
+    key.set("param", std::to_string(param));
+    return key;
+}
+
+std::vector<uint64_t> hashes(size_t n, size_t offset = 0) {
+    std::vector<uint64_t> result;
+    for (size_t i = 0; i < n; ++i) {
+        result.push_back(fdb5::BloomFilter::hash(datum(offset + i, 138)));
+    }
+    return result;
+}
+
+/// Archives (levelist, param) = (i, 100 + i) for i in [1, n], so that every other combination of the values
+/// on the axes is absent. Returns the indexes of the DB, as a reader sees them.
+std::vector<fdb5::Index> archiveDiagonal(const std::string& expver, size_t n) {
+
+    fdb5::Config cfg = fdb5::Config().expandConfig();
+
+    fdb5::Key index;
+    index.set("type", "an");
+    index.set("levtype", "pl");
+
+    eckit::PathName dir = clearAll(expver, cfg);
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+        writer->selectIndex(index);
+        for (size_t i = 1; i <= n; ++i) {
+            std::string data = std::to_string(i);
+            writer->archive(datum(i, 100 + i), data.data(), data.size());
+        }
+        writer->flush();
+    }
+
+    fdb5::TocHandler reader(dir, cfg);
+    return reader.loadIndexes();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "A filter has no false negatives, and few false positives" ) {
+
+    for (size_t bitsPerKey : {1, 4, 10, 16}) {
+        for (size_t n : {1, 10, 1000, 20000}) {
+            fdb5::BloomFilter filter(hashes(n), bitsPerKey, 1024 * 1024);
+            EXPECT(!filter.empty());
+
+            for (uint64_t h : hashes(n)) {
+                EXPECT(filter.mayContain(h));
+            }
+
+            if (bitsPerKey >= 10 && n >= 1000) {
+                size_t positives = 0;
+                for (uint64_t h : hashes(n, n)) {
+                    positives += filter.mayContain(h) ? 1 : 0;
+                }
+                // About 1% expected at 10 bits per key
+                EXPECT(positives < n / 20);
+            }
+        }
+    }
+
+    // An empty filter rejects nothing
+    EXPECT(fdb5::BloomFilter().mayContain(hashes(1)[0]));
+    EXPECT(fdb5::BloomFilter(hashes(10), 0, 1024).empty());
+    EXPECT(fdb5::BloomFilter(std::vector<uint64_t>(), 10, 1024).empty());
+}
+
+CASE( "Filters larger than the limit are not built" ) {
+
+    // 8 bits per key is a byte per key, but never less than 64 bits
+    EXPECT(fdb5::BloomFilter(hashes(1000), 8, 1000).footprint() == 1000);
+    EXPECT(fdb5::BloomFilter(hashes(1001), 8, 1000).empty());
+    EXPECT(fdb5::BloomFilter(hashes(1), 1, 8).footprint() == 8);
+    EXPECT(fdb5::BloomFilter(hashes(1), 1, 7).empty());
+
+    fdb5::BloomFilter skipped(hashes(1001), 8, 1000);
+    for (uint64_t h : hashes(2000)) {
+        EXPECT(skipped.mayContain(h));
+    }
+}
+
+CASE( "A filter is encoded and decoded" ) {
+
+    fdb5::BloomFilter filter(hashes(500), 10, 1024 * 1024);
+
+    std::vector<char> buffer(1024 * 1024);
+    {
+        eckit::MemoryStream s(buffer.data(), buffer.size());
+        filter.encode(s);
+    }
+
+    fdb5::BloomFilter decoded;
+    {
+        eckit::MemoryStream s(buffer.data(), buffer.size());
+        decoded.decode(s);
+    }
+
+    EXPECT(decoded.footprint() == filter.footprint());
+    for (uint64_t h : hashes(1000)) {
+        EXPECT(decoded.mayContain(h) == filter.mayContain(h));
+    }
+}
+
+CASE( "Indexes are written to the TOC with their filters" ) {
+
+    fdb5::TocSerialisationVersion version(fdb5::Config().expandConfig());
+    EXPECT(version.used() == 4);
+
+    const size_t n = 50;
+    std::vector<fdb5::Index> indexes = archiveDiagonal("blm1", n);
+    EXPECT(indexes.size() == 1);
+    const fdb5::Index& index(indexes.front());
+
+    for (size_t i = 1; i <= n; ++i) {
+        EXPECT(index.mayContain(datum(i, 100 + i)));
+    }
+
+    // Every value of each axis is in the index, so only the filter rejects the other combinations
+
+    size_t positives = 0;
+    for (size_t i = 1; i <= n; ++i) {
+        for (size_t j = 1; j <= n; ++j) {
+            if (i != j) {
+                positives += index.mayContain(datum(i, 100 + j)) ? 1 : 0;
+            }
+        }
+    }
+    EXPECT(positives < n * (n - 1) / 10);
+
+    // And the index is read back as written
+
+    std::vector<char> buffer(1024 * 1024);
+    {
+        eckit::MemoryStream s(buffer.data(), buffer.size());
+        index.encode(s, 4);
+    }
+    eckit::MemoryStream s(buffer.data(), buffer.size());
+    fdb5::Index decoded(new fdb5::TocIndex(s, 4, "/", "/index", 0));
+    for (size_t i = 1; i <= n; ++i) {
+        for (size_t j = 1; j <= n; ++j) {
+            EXPECT(decoded.mayContain(datum(i, 100 + j)) == index.mayContain(datum(i, 100 + j)));
+        }
+    }
+}
+
+CASE( "Readers of earlier versions reject version 4 indexes" ) {
+
+    std::vector<fdb5::Index> indexes = archiveDiagonal("blm2", 10);
+    EXPECT(indexes.size() == 1);
+    const fdb5::Index& index(indexes.front());
+
+    // The TOC records carry their version, which a reader checks against those it supports
+
+    fdb5::TocSerialisationVersion version(fdb5::Config().expandConfig());
+    EXPECT(version.check(4, false));
+    EXPECT_THROWS_AS(version.check(fdb5::TocSerialisationVersion::latest() + 1, true), eckit::SeriousBug);
+
+    // And the filter is not a member of the index as decoded before version 4
+
+    std::vector<char> buffer(1024 * 1024);
+    {
+        eckit::MemoryStream s(buffer.data(), buffer.size());
+        index.encode(s, 4);
+    }
+    {
+        eckit::MemoryStream s(buffer.data(), buffer.size());
+        EXPECT_THROWS_AS(fdb5::TocIndex(s, 3, "/", "/index", 0), eckit::SeriousBug);
+    }
+
+    // Written as version 3, the index has no filter, and is read by any reader
+
+    {
+        eckit::MemoryStream s(buffer.data(), buffer.size());
+        index.encode(s, 3);
+    }
+    eckit::MemoryStream s(buffer.data(), buffer.size());
+    fdb5::Index decoded(new fdb5::TocIndex(s, 3, "/", "/index", 0));
+    for (size_t i = 1; i <= 10; ++i) {
+        for (size_t j = 1; j <= 10; ++j) {
+            EXPECT(decoded.mayContain(datum(i, 100 + j)));
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
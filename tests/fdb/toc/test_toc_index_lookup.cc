@@ -0,0 +1,173 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run with FDB_MAP_TOCS_ON_READ set, so that the readers can be refreshed
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+#include "eckit/types/Types.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Field.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/TocHandler.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+fdb5::Key indexKey(const std::string& type) {
+    fdb5::Key key;
+    key.set("type", type);
+    key.set("levtype", "pl");
+    return key;
+}
+
+fdb5::Key datumKey(const std::string& levelist) {
+    fdb5::Key key;
+    key.set("step", "0");
+    key.set("levelist", levelist);
+    key.set("param", "138");
+    return key;
+}
+
+/// What a reader finds for a field: whether the index is selected, the levelists of the selected indexes, and
+/// where the field is
+struct Found {
+    bool selected = false;
+    eckit::StringSet levelists;
+    std::string location;
+
+    bool operator==(const Found& other) const {
+        return selected == other.selected && levelists == other.levelists && location == other.location;
+    }
+};
+
+std::string describe(const fdb5::Field& field) {
+    std::ostringstream oss;
+    oss << field.location();
+    return oss.str();
+}
+
+Found lookup(fdb5::DB& reader, const std::string& type, const std::string& levelist) {
+    Found found;
+    found.selected = reader.selectIndex(indexKey(type));
+    reader.axis("levelist", found.levelists);
+    fdb5::Field field;
+    if (reader.inspect(datumKey(levelist), field)) {
+        found.location = describe(field);
+    }
+    return found;
+}
+
+/// The linear scan the lookup replaces: every index with the key, in TOC order, the first holding the field wins
+Found scan(const std::vector<fdb5::Index>& indexes, const std::string& type, const std::string& levelist) {
+    Found found;
+    fdb5::Key key = indexKey(type);
+    for (fdb5::Index index : indexes) {
+        if (index.key() != key) {
+            continue;
+        }
+        found.selected = true;
+        if (index.axes().has("levelist")) {
+            const auto& values = index.axes().values("levelist");
+            found.levelists.insert(values.begin(), values.end());
+        }
+        fdb5::Field field;
+        if (found.location.empty() && index.mayContain(datumKey(levelist))) {
+            index.open();
+            if (index.get(datumKey(levelist), fdb5::Key(), field)) {
+                found.location = describe(field);
+            }
+        }
+    }
+    return found;
+}
+
+void compare(fdb5::DB& reader, const eckit::PathName& dir, const fdb5::Config& cfg) {
+
+    std::vector<fdb5::Index> indexes = fdb5::TocHandler(dir, cfg).loadIndexes();
+
+    for (const std::string& type : {"an", "fc", "cf", "pf", "absent"}) {
+        for (const std::string& levelist : {"1", "2", "3", "4", "5"}) {
+            EXPECT(lookup(reader, type, levelist) == scan(indexes, type, levelist));
+        }
+    }
+}
+
+void write(const std::string& expver, const fdb5::Config& cfg,
+           const std::vector<std::pair<std::string, std::string>>& fields) {
+    std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+    for (const auto& f : fields) {
+        archive(*writer, f.first, f.second);
+    }
+    writer->flush();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "The index lookup finds what a scan of the indexes finds, also after a refresh" ) {
+
+    fdb5::Config cfg = config(false);
+    eckit::PathName dir = clearAll("lku1", cfg);
+
+    // Each writer has indexes of its own, so that there are several indexes with the same key, some of them
+    // holding the same fields
+
+    write("lku1", cfg, {{"an", "1"}, {"an", "2"}, {"fc", "1"}});
+    write("lku1", cfg, {{"an", "2"}, {"an", "3"}, {"cf", "1"}});
+    write("lku1", cfg, {{"an", "3"}});
+
+    std::unique_ptr<fdb5::DB> reader = fdb5::DB::buildReader(dbKey("lku1"), cfg);
+    EXPECT(reader->open());
+    compare(*reader, dir, cfg);
+
+    // The lookup is rebuilt when the reader is refreshed, with the indexes appended since
+
+    write("lku1", cfg, {{"an", "4"}, {"an", "1"}, {"pf", "1"}});
+
+    EXPECT(reader->modified());
+    EXPECT(reader->refresh());
+    compare(*reader, dir, cfg);
+
+    EXPECT(lookup(*reader, "pf", "1").selected);
+    EXPECT(!lookup(*reader, "pf", "1").location.empty());
+
+    // Selecting the same index again, after the refresh, gives the same result as selecting it afresh
+    fdb5::Key an = indexKey("an");
+    EXPECT(reader->selectIndex(an));
+    write("lku1", cfg, {{"an", "5"}});
+    EXPECT(reader->refresh());
+    compare(*reader, dir, cfg);
+    EXPECT(!lookup(*reader, "an", "5").location.empty());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
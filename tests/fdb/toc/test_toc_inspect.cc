@@ -0,0 +1,136 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/testing/Test.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/api/helpers/ListIterator.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Key.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const size_t levels = 300;
+
+std::string levelists() {
+    std::string out;
+    for (size_t l = 1; l <= levels; ++l) {
+        out += (out.empty() ? "" : "/") + std::to_string(l);
+    }
+    return out;
+}
+
+metkit::mars::MarsRequest request(const std::string& expver) {
+    return fdb5::FDBToolRequest::requestsFromString("class=rd,expver=" + expver +
+                                                    ",stream=oper,date=20201102,time=0000,domain=g,type=an,levtype=pl,"
+                                                    "step=0,param=138,levelist=" + levelists())[0].request();
+}
+
+void populate(const std::string& expver, const fdb5::Config& cfg) {
+    clearAll(expver, cfg);
+    std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+    for (size_t l = 1; l <= levels; ++l) {
+        archive(*writer, "an", std::to_string(l));
+    }
+    writer->flush();
+}
+
+std::vector<std::string> drain(fdb5::ListIterator& it) {
+    std::vector<std::string> out;
+    fdb5::ListElement elem;
+    while (it.next(elem)) {
+        out.push_back(elem.combinedKey().get("levelist"));
+    }
+    return out;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Inspected fields come out in the order requested" ) {
+
+    fdb5::Config cfg = config(false);
+    populate("ins1", cfg);
+
+    fdb5::FDB fdb(cfg);
+    fdb5::ListIterator it = fdb.inspect(request("ins1"));
+    std::vector<std::string> found = drain(it);
+
+    EXPECT(found.size() == levels);
+    for (size_t l = 1; l <= found.size(); ++l) {
+        EXPECT(found[l - 1] == std::to_string(l));
+    }
+}
+
+CASE( "The iterator may outlive the FDB, and be abandoned part way through" ) {
+
+    fdb5::Config cfg = config(false);
+    populate("ins2", cfg);
+
+    // Consumed after the FDB is gone
+
+    std::unique_ptr<fdb5::ListIterator> it;
+    {
+        fdb5::FDB fdb(cfg);
+        it.reset(new fdb5::ListIterator(fdb.inspect(request("ins2"))));
+    }
+    EXPECT(drain(*it).size() == levels);
+
+    // Abandoned, with the worker looking up fields beyond what the queue holds
+
+    for (size_t consumed : {0, 1, 10}) {
+        fdb5::FDB fdb(cfg);
+        fdb5::ListIterator partial = fdb.inspect(request("ins2"));
+        fdb5::ListElement elem;
+        for (size_t i = 0; i < consumed; ++i) {
+            EXPECT(partial.next(elem));
+        }
+    }
+
+    // Both, with the FDB destroyed before the iterator
+
+    for (size_t consumed : {0, 5}) {
+        std::unique_ptr<fdb5::ListIterator> partial;
+        {
+            fdb5::FDB fdb(cfg);
+            partial.reset(new fdb5::ListIterator(fdb.inspect(request("ins2"))));
+            fdb5::ListElement elem;
+            for (size_t i = 0; i < consumed; ++i) {
+                EXPECT(partial->next(elem));
+            }
+        }
+        partial.reset();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
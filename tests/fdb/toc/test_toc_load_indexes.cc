@@ -0,0 +1,146 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run both with and without FDB_SUBTOC_LOAD_THREADS set, so that the concurrent loading of subtocs
+/// is checked against the same expectations as the serial walk of the TOC
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/toc/TocHandler.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Flushes a single index, so that there is exactly one index record per call
+void archiveIndex(fdb5::DB& db, const std::string& type, const std::string& levelist) {
+    archive(db, type, levelist);
+    db.flush();
+}
+
+std::vector<std::string> types(const std::vector<fdb5::Index>& indexes) {
+    std::vector<std::string> out;
+    for (const fdb5::Index& index : indexes) {
+        out.push_back(index.key().value("type"));
+    }
+    return out;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Indexes are returned in TOC order, with subtocs expanded in place" ) {
+
+    // Separate DBs, in case both variants of the test are run at once
+    std::string expver = "ord" + std::to_string(fdb5::TocHandler::subTocLoadThreads());
+
+    eckit::PathName dir = clearAll(expver, config(false));
+
+    // The master TOC ends up as: an, subtoc 1 (fc, pf), subtoc 2 (cf), cv
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), config(false));
+        archiveIndex(*writer, "an", "1");
+    }
+
+    std::unique_ptr<fdb5::DB> sub1 = fdb5::DB::buildWriter(dbKey(expver), config(true));
+    std::unique_ptr<fdb5::DB> sub2 = fdb5::DB::buildWriter(dbKey(expver), config(true));
+
+    archiveIndex(*sub1, "fc", "2");
+    archiveIndex(*sub2, "cf", "3");
+    archiveIndex(*sub1, "pf", "4");
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), config(false));
+        archiveIndex(*writer, "cv", "5");
+    }
+
+    fdb5::Config cfg = config(false);
+
+    std::set<std::string> subTocs;
+    std::vector<bool> indexInSubtoc;
+    std::vector<fdb5::Key> remapKeys;
+
+    fdb5::TocHandler handler(dir, cfg);
+    std::vector<fdb5::Index> indexes = handler.loadIndexes(false, &subTocs, &indexInSubtoc, &remapKeys);
+
+    // The last index takes precedence, so comes first
+    EXPECT(types(indexes) == (std::vector<std::string>{"cv", "cf", "pf", "fc", "an"}));
+    EXPECT(indexInSubtoc == (std::vector<bool>{false, true, true, true, false}));
+    EXPECT(remapKeys.size() == indexes.size());
+    EXPECT(subTocs.size() == 2);
+
+    // Masking an index in a subtoc removes only that index. The indexes of a subtoc are only masked by the
+    // subtoc's own clear records, so the record is written there, as the subtoc's writer would.
+
+    EXPECT(types({indexes[2]}) == std::vector<std::string>{"pf"});
+    size_t masked = 0;
+    for (const std::string& path : subTocs) {
+        fdb5::TocHandler subToc(path, dbKey(expver));
+        for (const fdb5::Index& index : subToc.loadIndexes()) {
+            if (index.key() == indexes[2].key()) {
+                subToc.writeClearRecord(index);
+                ++masked;
+            }
+        }
+    }
+    EXPECT(masked == 1);
+
+    subTocs.clear();
+    indexInSubtoc.clear();
+    remapKeys.clear();
+    indexes = fdb5::TocHandler(dir, cfg).loadIndexes(false, &subTocs, &indexInSubtoc, &remapKeys);
+
+    EXPECT(types(indexes) == (std::vector<std::string>{"cv", "cf", "fc", "an"}));
+    EXPECT(indexInSubtoc == (std::vector<bool>{false, true, true, false}));
+    EXPECT(remapKeys.size() == indexes.size());
+    EXPECT(subTocs.size() == 2);
+
+    // Closing the subtoc writers compacts their indexes into the master TOC, and masks the subtocs
+
+    sub1.reset();
+    sub2.reset();
+
+    subTocs.clear();
+    indexInSubtoc.clear();
+    indexes = fdb5::TocHandler(dir, cfg).loadIndexes(false, &subTocs, &indexInSubtoc);
+
+    std::vector<std::string> found = types(indexes);
+    std::set<std::string> remaining(found.begin(), found.end());
+    for (const std::string& type : {"an", "fc", "cf", "cv"}) {
+        EXPECT(remaining.find(type) != remaining.end());
+    }
+    EXPECT(subTocs.empty());
+    EXPECT(indexInSubtoc == std::vector<bool>(indexes.size(), false));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
@@ -0,0 +1,179 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run with FDB_MAP_TOCS_ON_READ set, so that the TOCs are mapped and refreshed incrementally
+
+#include <dirent.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/toc/TocHandler.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The reader has been open all along. It must see what a reader opened now sees.
+void check(const fdb5::TocHandler& reader, const eckit::PathName& dir, const fdb5::Config& cfg, size_t expected) {
+    std::vector<std::string> refreshed = describe(reader.loadIndexes());
+    fdb5::TocHandler fresh(dir, cfg);
+    EXPECT(refreshed == describe(fresh.loadIndexes()));
+    EXPECT(refreshed.size() == expected);
+}
+
+void appendMaskAndClear(const std::string& expver, bool subtocs) {
+
+    fdb5::Config cfg = config(subtocs);
+    eckit::PathName dir = clearAll(expver, cfg);
+
+    fdb5::TocHandler reader(dir, cfg);
+    check(reader, dir, cfg, 0);
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+
+        archive(*writer, "an", "300");
+        writer->flush();
+        check(reader, dir, cfg, 1);
+
+        archive(*writer, "fc", "300");
+        writer->flush();
+        check(reader, dir, cfg, 2);
+
+        // A second record for the same index
+        archive(*writer, "an", "400");
+        writer->flush();
+        check(reader, dir, cfg, 3);
+    }
+
+    // With subtocs, closing the writer appends its full indexes and masks its subtoc
+    size_t n = subtocs ? 2 : 3;
+    check(reader, dir, cfg, n);
+
+    {
+        std::vector<fdb5::Index> indexes = reader.loadIndexes();
+        fdb5::TocHandler masker(dir, cfg);
+        masker.writeClearRecord(indexes.front());
+    }
+    check(reader, dir, cfg, n - 1);
+
+    clearAll(expver, cfg);
+    check(reader, dir, cfg, 0);
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+        archive(*writer, "an", "500");
+        writer->flush();
+        check(reader, dir, cfg, 1);
+    }
+    check(reader, dir, cfg, 1);
+}
+
+size_t openDescriptors() {
+    size_t n = 0;
+    DIR* d = ::opendir("/proc/self/fd");
+    ASSERT(d);
+    while (::readdir(d)) {
+        ++n;
+    }
+    ::closedir(d);
+    return n;
+}
+
+size_t mappings() {
+    std::ifstream in("/proc/self/maps");
+    std::string line;
+    size_t n = 0;
+    while (std::getline(in, line)) {
+        ++n;
+    }
+    return n;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Refreshing a reader follows appends, masks and clears" ) {
+    appendMaskAndClear("rfs1", false);
+}
+
+CASE( "Refreshing a reader follows appends, masks and clears, with subtocs" ) {
+    appendMaskAndClear("rfs2", true);
+}
+
+CASE( "A reader holds no descriptor or mapping per subtoc" ) {
+
+    if (!eckit::PathName("/proc/self/maps").exists()) {
+        return;
+    }
+
+    const size_t nwriters = 100;
+
+    fdb5::Config cfg = config(true);
+    eckit::PathName dir = clearAll("rfs3", cfg);
+
+    // Each writer has a subtoc of its own, live for as long as the writer is
+
+    std::vector<std::unique_ptr<fdb5::DB>> writers;
+    for (size_t i = 0; i < nwriters; ++i) {
+        writers.emplace_back(fdb5::DB::buildWriter(dbKey("rfs3"), cfg));
+        archive(*writers.back(), "an", std::to_string(i + 1));
+        writers.back()->flush();
+    }
+
+    fdb5::TocHandler reader(dir, cfg);
+
+    size_t fds = openDescriptors();
+    size_t maps = mappings();
+
+    EXPECT(reader.loadIndexes().size() == nwriters);
+    EXPECT(openDescriptors() <= fds + 2);
+    EXPECT(mappings() <= maps + 8);
+
+    // And once each subtoc has grown
+
+    for (size_t i = 0; i < nwriters; ++i) {
+        archive(*writers[i], "fc", std::to_string(i + 1));
+        writers[i]->flush();
+    }
+
+    fds = openDescriptors();
+    maps = mappings();
+
+    EXPECT(reader.loadIndexes().size() == 2 * nwriters);
+    EXPECT(openDescriptors() <= fds + 2);
+    EXPECT(mappings() <= maps + 8);
+
+    writers.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
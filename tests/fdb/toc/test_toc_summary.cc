@@ -0,0 +1,271 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/TocHandler.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+fdb5::Config config(bool subtocs, bool summary) {
+    eckit::LocalConfiguration user;
+    user.set("useSubToc", subtocs);
+    user.set("useTocSummary", summary);
+    return fdb5::Config(fdb5::Config().expandConfig(), user);
+}
+
+void archive(const std::string& expver, const fdb5::Config& cfg, const std::vector<std::string>& types,
+             const std::string& levelist) {
+    std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+    for (const std::string& type : types) {
+        archive(*writer, type, levelist);
+    }
+    writer->flush();
+}
+
+/// As clearAll(), also removing the summary
+eckit::PathName clearSummarised(const std::string& expver, const fdb5::Config& cfg) {
+    eckit::PathName dir = clearAll(expver, cfg);
+    eckit::PathName summary = fdb5::TocHandler(dir, cfg).summaryPath();
+    if (summary.exists()) summary.unlink();
+    return dir;
+}
+
+/// A reader starting from the summary must see exactly what a reader walking the whole TOC sees
+void check(const eckit::PathName& dir, bool subtocs, size_t expected) {
+    fdb5::TocHandler summarised(dir, config(subtocs, true));
+    fdb5::TocHandler walked(dir, config(subtocs, false));
+    std::vector<std::string> indexes = describe(summarised.loadIndexes());
+    EXPECT(indexes == describe(walked.loadIndexes()));
+    EXPECT(indexes.size() == expected);
+}
+
+/// The bytes read by the process so far, if the system tells
+bool bytesRead(size_t& n) {
+    std::ifstream in("/proc/self/io");
+    std::string name;
+    while (in >> name >> n) {
+        if (name == "rchar:") {
+            return true;
+        }
+    }
+    return false;
+}
+
+ino_t inode(const eckit::PathName& path) {
+    struct stat st;
+    SYSCALL(::stat(path.localPath(), &st));
+    return st.st_ino;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "A summary gives the same indexes as walking the TOC" ) {
+
+    fdb5::Config cfg = config(false, true);
+    eckit::PathName dir = clearSummarised("sum1", cfg);
+
+    archive("sum1", cfg, {"an", "fc"}, "300");
+    archive("sum1", cfg, {"an"}, "400");
+
+    fdb5::TocHandler handler(dir, cfg);
+    handler.writeSummary(true);
+    EXPECT(handler.summaryPath().exists());
+    check(dir, false, 3);
+
+    // Records appended since the summary are walked on top of it
+    archive("sum1", config(false, false), {"fc"}, "400");
+    check(dir, false, 4);
+
+    {
+        std::vector<fdb5::Index> indexes = fdb5::TocHandler(dir, cfg).loadIndexes();
+        fdb5::TocHandler masker(dir, cfg);
+        masker.writeClearRecord(indexes.front());
+    }
+    check(dir, false, 3);
+
+    // A summary that covers most of the TOC is not rewritten, unless forced
+    handler.writeSummary(true);
+    ino_t written = inode(handler.summaryPath());
+    handler.writeSummary();
+    EXPECT(inode(handler.summaryPath()) == written);
+    handler.writeSummary(true);
+    EXPECT(inode(handler.summaryPath()) != written);
+    check(dir, false, 3);
+}
+
+CASE( "A summary holding live subtocs survives the DB being moved" ) {
+
+    fdb5::Config cfg = config(true, true);
+    eckit::PathName dir = clearSummarised("sum2", cfg);
+
+    std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey("sum2"), cfg);
+    archive(*writer, "an", "300");
+    archive(*writer, "fc", "300");
+    writer->flush();
+
+    fdb5::TocHandler(dir, cfg).writeSummary(true);
+    check(dir, true, 2);
+
+    // The subtoc grows after the summary is written
+    archive(*writer, "an", "400");
+    writer->flush();
+    check(dir, true, 3);
+
+    eckit::PathName moved(dir.asString() + ".moved");
+    EXPECT(!moved.exists());
+    eckit::PathName::rename(dir, moved);
+    check(moved, true, 3);
+    eckit::PathName::rename(moved, dir);
+
+    // Closing the writer compacts and masks its subtoc
+    writer.reset();
+    check(dir, true, 2);
+}
+
+CASE( "A summary of a TOC that was truncated or rewritten in place is ignored" ) {
+
+    fdb5::Config cfg = config(false, true);
+    fdb5::Config plain = config(false, false);
+    eckit::PathName dir = clearSummarised("sum3", plain);
+
+    fdb5::TocHandler handler(dir, cfg);
+    eckit::PathName toc = handler.tocPath();
+
+    archive("sum3", plain, {"an"}, "300");
+    off_t before = toc.size();
+    archive("sum3", plain, {"fc"}, "300");
+
+    handler.writeSummary(true);
+    off_t summarised = toc.size();
+    check(dir, false, 2);
+
+    SYSCALL(::truncate(toc.localPath(), before));
+    check(dir, false, 1);
+
+    // Grow the TOC past the summarised length again, with different records
+    archive("sum3", plain, {"cf", "pf", "fc"}, "400");
+    EXPECT(toc.size() > summarised);
+    check(dir, false, 4);
+}
+
+CASE( "A truncated or corrupt summary is ignored" ) {
+
+    fdb5::Config cfg = config(false, true);
+    eckit::PathName dir = clearSummarised("sum4", cfg);
+
+    archive("sum4", cfg, {"an", "fc"}, "300");
+
+    fdb5::TocHandler handler(dir, cfg);
+    handler.writeSummary(true);
+    eckit::PathName summary = handler.summaryPath();
+
+    off_t length = summary.size();
+    for (off_t l : {length - 1, length / 2, off_t(8), off_t(0)}) {
+        handler.writeSummary(true);
+        SYSCALL(::truncate(summary.localPath(), l));
+        check(dir, false, 2);
+    }
+
+    {
+        std::ofstream out(summary.localPath());
+        out << "this is not a summary";
+    }
+    check(dir, false, 2);
+}
+
+CASE( "Opening from a summary reads only the tail of the TOC" ) {
+
+    size_t before;
+    if (!bytesRead(before)) {
+        return;
+    }
+
+    fdb5::Config cfg = config(false, true);
+    eckit::PathName dir = clearSummarised("sum5", cfg);
+
+    // A long TOC, all of it masked, so that the summary is short
+
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey("sum5"), cfg);
+        for (size_t i = 0; i < 500; ++i) {
+            archive(*writer, (i % 2) ? "an" : "fc", std::to_string(i));
+            writer->flush();
+        }
+    }
+    {
+        std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey("sum5"), cfg);
+        writer->hideContents();
+    }
+
+    fdb5::TocHandler handler(dir, cfg);
+    handler.writeSummary(true);
+    off_t summarised = handler.tocPath().size();
+
+    archive("sum5", config(false, false), {"an", "fc"}, "1");
+    off_t tail = handler.tocPath().size() - summarised;
+
+    // The summary, the end of the summarised part of the TOC that is checked, and the tail, with some slack
+    // for the index files
+
+    size_t bound = size_t(handler.summaryPath().size()) + 64 * 1024 + size_t(tail) + 64 * 1024;
+    EXPECT(size_t(summarised) > 2 * bound);
+
+    bytesRead(before);
+    fdb5::TocHandler reader(dir, cfg);
+    EXPECT(reader.loadIndexes().size() == 2);
+    size_t after;
+    EXPECT(bytesRead(after));
+
+    EXPECT(after - before < bound);
+
+    // And the same for what is appended later, on the same reader
+
+    archive("sum5", config(false, false), {"cf"}, "1");
+    bytesRead(before);
+    EXPECT(reader.loadIndexes().size() == 3);
+    EXPECT(bytesRead(after));
+    EXPECT(after - before < bound);
+
+    check(dir, false, 3);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}
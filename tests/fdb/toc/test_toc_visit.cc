@@ -0,0 +1,244 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// Run with FDB_VISIT_READ_AHEAD_THREADS set, so that the indexes are read ahead
+
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/testing/Test.h"
+
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Catalogue.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/database/EntryVisitMechanism.h"
+#include "fdb5/database/Field.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+
+#include "TocTesting.h"
+
+using namespace eckit::testing;
+using namespace eckit;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const std::vector<std::string> expvers{"vis1", "vis2", "vis3", "vis4", "vis5", "vis6"};
+
+fdb5::Config visitConfig(size_t threads) {
+    eckit::LocalConfiguration user;
+    user.set("visitThreads", threads);
+    return fdb5::Config(fdb5::Config().expandConfig(), user);
+}
+
+fdb5::FDBToolRequest request() {
+    std::string expver;
+    for (const std::string& e : expvers) {
+        expver += (expver.empty() ? "" : "/") + e;
+    }
+    return fdb5::FDBToolRequest::requestsFromString("class=rd,expver=" + expver +
+                                                    ",stream=oper,date=20201102,time=0000,domain=g")[0];
+}
+
+/// Several indexes in each DB, from several writers, so that there are indexes to read ahead
+void populate(const fdb5::Config& cfg) {
+    for (const std::string& expver : expvers) {
+        clearAll(expver, cfg);
+        for (size_t w = 0; w < 3; ++w) {
+            std::unique_ptr<fdb5::DB> writer = fdb5::DB::buildWriter(dbKey(expver), cfg);
+            for (const char* type : {"an", "fc", "cf", "pf"}) {
+                for (const char* levelist : {"1", "2", "3"}) {
+                    archive(*writer, type, levelist);
+                }
+            }
+            writer->flush();
+        }
+    }
+}
+
+/// The index files that the process holds open
+size_t openIndexFiles() {
+
+    size_t count = 0;
+
+    DIR* dir = ::opendir("/proc/self/fd");
+    ASSERT(dir);
+    while (struct dirent* e = ::readdir(dir)) {
+        char target[PATH_MAX];
+        std::string fd = std::string("/proc/self/fd/") + e->d_name;
+        ssize_t len = ::readlink(fd.c_str(), target, sizeof(target) - 1);
+        if (len <= 0) {
+            continue;
+        }
+        std::string path(target, len);
+        if (path.size() > 6 && path.compare(path.size() - 6, 6, ".index") == 0) {
+            ++count;
+        }
+    }
+    ::closedir(dir);
+
+    return count;
+}
+
+/// Records what it visits. Fails part way through the indexes of the DB of the given expver, if any.
+class Recorder : public fdb5::EntryVisitor {
+public:
+
+    Recorder(const std::string& failing = "") : failing_(failing), fail_(false), count_(0) {}
+
+    bool visitDatabase(const fdb5::Catalogue& catalogue, const fdb5::Store& store) override {
+        EntryVisitor::visitDatabase(catalogue, store);
+        std::ostringstream oss;
+        oss << "db " << catalogue.key();
+        output_.push_back(oss.str());
+        fail_ = (catalogue.key().get("expver") == failing_);
+        return true;
+    }
+
+    bool visitIndex(const fdb5::Index& index) override {
+        EntryVisitor::visitIndex(index);
+        std::ostringstream oss;
+        oss << "index " << index.key() << " " << index.location();
+        output_.push_back(oss.str());
+        return true;
+    }
+
+    const std::vector<std::string>& output() const { return output_; }
+
+private:
+
+    void visitDatum(const fdb5::Field& field, const fdb5::Key& key) override {
+        std::ostringstream oss;
+        oss << key << " " << field.location();
+        output_.push_back(oss.str());
+
+        if (fail_ && ++count_ == 20) {
+            throw eckit::SeriousBug("Visit failed in " + failing_, Here());
+        }
+    }
+
+    std::string failing_;
+    bool fail_;
+    size_t count_;
+    std::vector<std::string> output_;
+};
+
+std::vector<std::string> visitSerially(const fdb5::Config& cfg) {
+    Recorder visitor;
+    fdb5::EntryVisitMechanism(cfg).visit(request(), visitor);
+    return visitor.output();
+}
+
+/// The output of the visitors, in the order collected. Counts the visitors completed.
+std::vector<std::string> visitThreaded(const fdb5::Config& cfg, const std::string& failing, size_t& completed) {
+
+    std::vector<std::string> output;
+    completed = 0;
+    std::mutex mutex;
+
+    fdb5::EntryVisitMechanism mechanism(cfg);
+    mechanism.visit(
+        request(), fdb5::EntryVisitMechanism::threads(cfg),
+        [&failing] { return std::unique_ptr<fdb5::EntryVisitor>(new Recorder(failing)); },
+        [&](fdb5::EntryVisitor&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++completed;
+        },
+        [&](fdb5::EntryVisitor& visitor) {
+            const std::vector<std::string>& out = dynamic_cast<Recorder&>(visitor).output();
+            output.insert(output.end(), out.begin(), out.end());
+        });
+
+    return output;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE( "Visiting DBs on several threads gives the output of a serial visit, in the same order" ) {
+
+    fdb5::Config serial = visitConfig(1);
+    populate(serial);
+
+    std::vector<std::string> expected = visitSerially(serial);
+    EXPECT(!expected.empty());
+    EXPECT(std::count_if(expected.begin(), expected.end(), [](const std::string& s) { return s.find("db ") == 0; }) ==
+           long(expvers.size()));
+
+    for (size_t threads : {2, 3, 4, 8}) {
+        fdb5::Config cfg = visitConfig(threads);
+        EXPECT(fdb5::EntryVisitMechanism::threads(cfg) == threads);
+
+        size_t completed;
+        EXPECT(visitThreaded(cfg, "", completed) == expected);
+        EXPECT(completed == expvers.size());
+        EXPECT(openIndexFiles() == 0);
+
+        // And the serial visit, reading the indexes ahead, gives the same too
+        EXPECT(visitSerially(cfg) == expected);
+        EXPECT(openIndexFiles() == 0);
+    }
+}
+
+CASE( "A DB failing part way through its visit leaves no thread blocked, nor any index open" ) {
+
+    fdb5::Config cfg = visitConfig(4);
+    populate(cfg);
+
+    EXPECT(openIndexFiles() == 0);
+
+    for (const std::string& failing : {"vis1", "vis3", "vis6"}) {
+
+        // The DBs not yet started are skipped, those started are completed, and the error is reported once the
+        // workers are all done
+
+        size_t completed = 0;
+        EXPECT_THROWS_AS(visitThreaded(cfg, failing, completed), eckit::SeriousBug);
+        EXPECT(completed > 0);
+        EXPECT(completed <= expvers.size());
+        EXPECT(openIndexFiles() == 0);
+
+        // The serial visit stops at the failing DB, also closing the indexes it read ahead
+
+        Recorder visitor(failing);
+        EXPECT_THROWS_AS(fdb5::EntryVisitMechanism(cfg).visit(request(), visitor), eckit::SeriousBug);
+        EXPECT(openIndexFiles() == 0);
+    }
+
+    // And later visits are unaffected
+
+    size_t completed;
+    std::vector<std::string> output = visitThreaded(cfg, "", completed);
+    EXPECT(output == visitSerially(visitConfig(1)));
+    EXPECT(openIndexFiles() == 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char **argv)
+{
+    return run_tests ( argc, argv );
+}